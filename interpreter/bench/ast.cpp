@@ -0,0 +1,228 @@
+// The tree of Box cells against the FlatAst layout of the same program. Parses Monkey
+// source of about --size megabytes, generated or the given FILEs repeated, and prints
+// the number of nodes and then, for the tree and for the FlatAst, with times the best of
+// --repeat runs:
+//   bytes/node  heap bytes held per node, token texts included for the tree,
+//   flatten ms  time to lay the tree out as a FlatAst,
+//   print ms    time for toString(),
+//   walk ms     time to count the nodes of each kind: an explicit-stack walk of the tree,
+//               and a loop over the kinds of the flat nodes.
+
+#define MONKEY_BENCH_COUNT_ALLOCATIONS
+#include "bench.h"
+
+#include "monkey/ast.h"
+#include "monkey/box.h"
+#include "monkey/flat_ast.h"
+#include "monkey/lexer.h"
+#include "monkey/overload.h"
+#include "monkey/parser.h"
+
+#include <fmt/format.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace {
+
+using namespace monkey;
+
+std::string generate(size_t bytes) {
+    std::string source;
+    for (size_t i = 0; source.size() < bytes; ++i) {
+        source += fmt::format("let step{0} = fn(count, total) {{\n"
+                              "    if (count < 10) {{\n"
+                              "        return step{0}(count + 1, total * 2 - count);\n"
+                              "    }} else {{\n"
+                              "        let label = \"total\";\n"
+                              "        [label, total, {{\"n\": count / 3}}][-1]\n"
+                              "    }}\n"
+                              "}};\n",
+                              i);
+    }
+    return source;
+}
+
+// Counts the nodes of each kind, numbered like NodeKind.
+using Histogram = std::array<size_t, static_cast<size_t>(NodeKind::BLOCK) + 1>;
+
+Histogram walk(const Program &program) {
+    using Node =
+        std::variant<const Expression *, const Statement *, const BlockStatement *>;
+    Histogram counts{};
+    std::vector<Node> pending;
+    for (const auto &stmt : program.statements) {
+        pending.emplace_back(&stmt);
+    }
+    auto count = [&](NodeKind kind) { ++counts[static_cast<size_t>(kind)]; };
+    auto block = [&](const BlockStatement &b) {
+        count(NodeKind::BLOCK);
+        for (const auto &stmt : b.statements) {
+            pending.emplace_back(&stmt);
+        }
+    };
+    auto expression = overloaded{
+        [&](const Identifier & /*e*/) { count(NodeKind::IDENTIFIER); },
+        [&](const IntegerLiteral & /*e*/) { count(NodeKind::INTEGER); },
+        [&](const BooleanLiteral & /*e*/) { count(NodeKind::BOOLEAN); },
+        [&](const StringLiteral & /*e*/) { count(NodeKind::STRING); },
+        [&](const Box<PrefixExpression> &e) {
+            count(NodeKind::PREFIX);
+            pending.emplace_back(&e->right);
+        },
+        [&](const Box<InfixExpression> &e) {
+            count(NodeKind::INFIX);
+            pending.insert(pending.end(), {&e->left, &e->right});
+        },
+        [&](const Box<IfExpression> &e) {
+            count(NodeKind::IF);
+            pending.insert(pending.end(), {&e->condition, &e->consequence});
+            if (e->alternative) {
+                pending.emplace_back(&*e->alternative);
+            }
+        },
+        [&](const Box<FunctionLiteral> &e) {
+            count(NodeKind::FUNCTION);
+            pending.emplace_back(&e->body);
+        },
+        [&](const Box<CallExpression> &e) {
+            count(NodeKind::CALL);
+            pending.emplace_back(&e->function);
+            for (const auto &arg : e->arguments) {
+                pending.emplace_back(&arg);
+            }
+        },
+        [&](const Box<ArrayLiteral> &e) {
+            count(NodeKind::ARRAY);
+            for (const auto &element : e->elements) {
+                pending.emplace_back(&element);
+            }
+        },
+        [&](const Box<IndexExpression> &e) {
+            count(NodeKind::INDEX);
+            pending.insert(pending.end(), {&e->left, &e->index});
+        },
+        [&](const Box<HashLiteral> &e) {
+            count(NodeKind::HASH);
+            for (const auto &[key, value] : e->pairs) {
+                pending.insert(pending.end(), {&key, &value});
+            }
+        },
+    };
+    auto statement = overloaded{
+        [&](const LetStatement &s) {
+            count(NodeKind::LET);
+            pending.emplace_back(&s.value);
+        },
+        [&](const ReturnStatement &s) {
+            count(NodeKind::RETURN);
+            pending.emplace_back(&s.value);
+        },
+        [&](const YieldStatement &s) {
+            count(NodeKind::YIELD);
+            pending.emplace_back(&s.value);
+        },
+        [&](const ExpressionStatement &s) {
+            count(NodeKind::EXPRESSION);
+            pending.emplace_back(&s.expression);
+        },
+        [&](const BlockStatement &s) { block(s); },
+    };
+    while (!pending.empty()) {
+        auto node = pending.back();
+        pending.pop_back();
+        std::visit(overloaded{
+                       [&](const Expression *e) { std::visit(expression, *e); },
+                       [&](const Statement *s) { std::visit(statement, *s); },
+                       [&](const BlockStatement *b) { block(*b); },
+                   },
+                   node);
+    }
+    return counts;
+}
+
+Histogram walk(const FlatAst &ast) {
+    Histogram counts{};
+    for (auto kind : ast.kinds) {
+        ++counts[static_cast<size_t>(kind)];
+    }
+    return counts;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::span<char *> args(argv + 1, static_cast<size_t>(argc - 1));
+    size_t megabytes = 16;
+    int repeat = 3;
+    std::vector<std::string> files;
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (bench::parseRepeat(args, i, repeat)) {
+            continue;
+        }
+        std::string_view arg = args[i];
+        if (arg == "--size" && i + 1 < args.size()) {
+            megabytes = std::strtoull(args[++i], nullptr, 10);
+        } else if (!arg.starts_with("--")) {
+            files.emplace_back(arg);
+        } else {
+            fmt::print(stderr, "usage: monkey_ast [--size MB] [--repeat N] [FILE...]\n");
+            return 1;
+        }
+    }
+
+    auto bytes = megabytes << 20;
+    std::string source;
+    if (files.empty()) {
+        source = generate(bytes);
+    } else {
+        std::ostringstream corpus;
+        for (const auto &file : files) {
+            std::ifstream in(file, std::ios::binary);
+            corpus << in.rdbuf() << '\n';
+        }
+        while (source.size() < bytes) {
+            source += corpus.view();
+        }
+    }
+
+    auto before = bench::heap.liveBytes.load();
+    auto program = Parser(Lexer(source)).parseProgram();
+    auto treeBytes = bench::heap.liveBytes.load() - before;
+    before = bench::heap.liveBytes.load();
+    auto ast = FlatAst::from(*program);
+    auto flatBytes = bench::heap.liveBytes.load() - before;
+    if (walk(*program) != walk(ast) ||
+        toString(*program).size() != toString(ast).size()) {
+        fmt::print(stderr, "the layouts disagree\n");
+        return 1;
+    }
+
+    auto perNode = [&](int64_t total) {
+        return static_cast<double>(total) / static_cast<double>(ast.size());
+    };
+    fmt::println("{:<18} {:>10} {:>10}", "", "tree", "flat");
+    fmt::println("{:<18} {:>10}", "nodes", ast.size());
+    fmt::println("{:<18} {:>10.1f} {:>10.1f}", "bytes/node", perNode(treeBytes),
+                 perNode(flatBytes));
+    fmt::println("{:<18} {:>10} {:>10.1f}", "flatten ms", "",
+                 bench::best(repeat, [&] { FlatAst::from(*program); }));
+    fmt::println("{:<18} {:>10.1f} {:>10.1f}", "print ms",
+                 bench::best(repeat, [&] { toString(*program); }),
+                 bench::best(repeat, [&] { toString(ast); }));
+    // The counts go to a volatile so that the walks are not optimized away.
+    volatile size_t sink = 0;
+    fmt::println("{:<18} {:>10.2f} {:>10.2f}", "walk ms",
+                 bench::best(repeat, [&] { sink = walk(*program)[0]; }),
+                 bench::best(repeat, [&] { sink = walk(ast)[0]; }));
+}
\ No newline at end of file
@@ -0,0 +1,37 @@
+#!/usr/bin/env bash
+# Compares `monkey batch --jobs N` against one monkey process per script (xargs -P N) on
+# the same set of scripts, for N = 1, 2, 4, ... up to the number of cores.
+#
+# usage: batch_scaling.sh MONKEY [SCRIPTS] [MAX_JOBS]
+
+set -euo pipefail
+
+monkey=${1:?usage: batch_scaling.sh MONKEY [SCRIPTS] [MAX_JOBS]}
+count=${2:-2000}
+max_jobs=${3:-$(nproc)}
+corpus=$(dirname "$0")/corpus
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+# Cycle through the corpus; every program appears many times, as in a real job where
+# most scripts share a handful of templates.
+programs=("$corpus"/*.monkey)
+for ((i = 0; i < count; ++i)); do
+    cp "${programs[i % ${#programs[@]}]}" "$work/$i.monkey"
+done
+find "$work" -name '*.monkey' | sort >"$work/list"
+
+elapsed_ms() {
+    local start=$(date +%s%N)
+    "$@" >/dev/null 2>&1 || true
+    echo $((($(date +%s%N) - start) / 1000000))
+}
+
+printf '%6s %12s %12s %9s\n' jobs batch_ms process_ms speedup
+for ((jobs = 1; jobs <= max_jobs; jobs *= 2)); do
+    batch=$(elapsed_ms "$monkey" batch --jobs "$jobs" --list "$work/list")
+    process=$(elapsed_ms xargs -P "$jobs" -n 1 "$monkey" batch --jobs 1 <"$work/list")
+    awk -v j="$jobs" -v b="$batch" -v p="$process" \
+        'BEGIN { printf "%6d %12d %12d %8.2fx\n", j, b, p, p / (b > 0 ? b : 1) }'
+done
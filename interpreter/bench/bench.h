@@ -0,0 +1,84 @@
+#pragma once
+
+// Helpers shared by the benchmarks: best-of-N timing, the --repeat flag, and heap
+// counters. A benchmark that reads the counters defines MONKEY_BENCH_COUNT_ALLOCATIONS
+// before including this header, which then replaces the global operator new and delete.
+// Every benchmark is a single source file, so they are defined once per program.
+
+#include <malloc.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <new>
+#include <string_view>
+
+namespace monkey::bench {
+
+using Milliseconds = std::chrono::duration<double, std::milli>;
+using Seconds = std::chrono::duration<double>;
+
+// The best time of `repeat` calls of `f`, in units of `Duration`.
+template <typename Duration = Milliseconds>
+double best(int repeat, auto f) {
+    double result = std::numeric_limits<double>::max();
+    for (int i = 0; i < repeat; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        const Duration elapsed = std::chrono::steady_clock::now() - start;
+        result = std::min(result, elapsed.count());
+    }
+    return result;
+}
+
+// Reads `--repeat N` at args[i] into `repeat`, at least 1, and leaves `i` on N. False if
+// args[i] is another argument.
+template <typename Args>
+bool parseRepeat(const Args &args, size_t &i, int &repeat) {
+    if (std::string_view(args[i]) != "--repeat" || i + 1 >= args.size()) {
+        return false;
+    }
+    repeat = std::max(1, std::atoi(std::string_view(args[++i]).data()));
+    return true;
+}
+
+// Counted by operator new and delete under MONKEY_BENCH_COUNT_ALLOCATIONS.
+struct HeapCounters {
+    std::atomic<uint64_t> allocations{0};
+    // Bytes requested since the last reset.
+    std::atomic<uint64_t> allocatedBytes{0};
+    // Bytes of the live allocations, as malloc rounds them.
+    std::atomic<int64_t> liveBytes{0};
+};
+
+inline HeapCounters heap;
+
+} // namespace monkey::bench
+
+#ifdef MONKEY_BENCH_COUNT_ALLOCATIONS
+
+// Array forms forward here by default.
+void *operator new(std::size_t size) {
+    if (void *ptr = std::malloc(size == 0 ? 1 : size)) {
+        auto &heap = monkey::bench::heap;
+        heap.allocations.fetch_add(1, std::memory_order_relaxed);
+        heap.allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+        heap.liveBytes.fetch_add(static_cast<int64_t>(malloc_usable_size(ptr)),
+                                 std::memory_order_relaxed);
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept {
+    monkey::bench::heap.liveBytes.fetch_sub(static_cast<int64_t>(malloc_usable_size(ptr)),
+                                            std::memory_order_relaxed);
+    std::free(ptr);
+}
+void operator delete(void *ptr, std::size_t /*size*/) noexcept { operator delete(ptr); }
+
+#endif
\ No newline at end of file
@@ -0,0 +1,104 @@
+// The parallel collection builtins against their sequential equivalents, on an array of
+// --size random integers:
+//   pmap     pmap(a, f) against a fold over the indices that pushes f(a[i]),
+//   preduce  preduce(a, g, 0) against a fold over the indices,
+//   psort    psort(a) against std::ranges::sort in C++.
+// f and g do a little arithmetic per element, like a real map or reduction would.
+// Prints milliseconds, best of --repeat runs, at the scheduler's size; set
+// MONKEY_THREADS to vary it, or run collections_scaling.sh for 1 to 32 threads.
+
+#include "bench.h"
+
+#include "monkey/interpreter.h"
+#include "monkey/object.h"
+#include "monkey/task.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+using namespace monkey;
+
+constexpr std::string_view PRELUDE = R"(
+    let range = fn(i, n) { if (i < n) { yield i; range(i + 1, n) } };
+    let f = fn(x) { let y = x * 3 + 1; y * y / 7 - x };
+    let g = fn(acc, x) { acc + x / 1000 };
+)";
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::span<char *> args(argv + 1, static_cast<size_t>(argc - 1));
+    size_t size = 1'000'000;
+    int repeat = 3;
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (bench::parseRepeat(args, i, repeat)) {
+            continue;
+        }
+        std::string_view arg = args[i];
+        if (arg == "--size" && i + 1 < args.size()) {
+            size = std::max<size_t>(1, std::strtoull(args[++i], nullptr, 10));
+        } else {
+            fmt::print(stderr, "usage: monkey_collections [--size N] [--repeat N]\n");
+            return 1;
+        }
+    }
+
+    std::mt19937_64 random(1);
+    std::vector<int64_t> values(size);
+    for (auto &value : values) {
+        value = static_cast<int64_t>(random() % 1'000'000);
+    }
+    Interpreter interpreter;
+    interpreter.define("a", Array(IntVector::from(values)));
+
+    // Runs `source` and fails the benchmark if it gives an Error.
+    auto script = [&](std::string_view source) {
+        auto program = compile(source);
+        return [&interpreter, program, source] {
+            auto result = interpreter.run(*program);
+            if (std::holds_alternative<Error>(result)) {
+                fmt::print(stderr, "{}: {}\n", source, inspect(result));
+                std::exit(1);
+            }
+        };
+    };
+    script(PRELUDE)();
+    struct Row {
+        std::string_view name;
+        std::function<void()> parallel;
+        std::function<void()> sequential;
+    };
+    const std::vector<Row> rows = {
+        {"pmap", script("pmap(a, f)"),
+         script("fold(range(0, len(a)), [], fn(r, i) { push(r, f(a[i])) })")},
+        {"preduce", script("preduce(a, g, 0)"),
+         script("fold(range(0, len(a)), 0, fn(acc, i) { g(acc, a[i]) })")},
+        {"psort", script("psort(a)"),
+         [&values] {
+             auto copy = values;
+             std::ranges::sort(copy);
+         }},
+    };
+
+    fmt::println("{} elements, {} threads", size, scheduler().size());
+    fmt::println("{:<8} {:>12} {:>14} {:>9}", "builtin", "parallel ms", "sequential ms",
+                 "speedup");
+    for (const auto &row : rows) {
+        auto parallel = bench::best(repeat, row.parallel);
+        auto sequential = bench::best(repeat, row.sequential);
+        fmt::println("{:<8} {:>12.1f} {:>14.1f} {:>8.2f}x", row.name, parallel,
+                     sequential, sequential / parallel);
+    }
+    return 0;
+}
@@ -0,0 +1,26 @@
+#!/usr/bin/env bash
+# Speedup curves of pmap, preduce and psort: runs monkey_collections with MONKEY_THREADS
+# = 1, 2, 4, ... up to MAX_THREADS and prints each builtin's time relative to one thread.
+#
+# usage: collections_scaling.sh MONKEY_COLLECTIONS [SIZE] [MAX_THREADS]
+
+set -euo pipefail
+
+bench=${1:?usage: collections_scaling.sh MONKEY_COLLECTIONS [SIZE] [MAX_THREADS]}
+size=${2:-1000000}
+max_threads=${3:-32}
+
+printf '%8s %10s %10s %10s %9s %9s %9s\n' threads pmap_ms preduce_ms psort_ms \
+    pmap preduce psort
+base=""
+for ((threads = 1; threads <= max_threads; threads *= 2)); do
+    # The rows are "name parallel_ms sequential_ms speedup"; keep the parallel times.
+    times=$(MONKEY_THREADS=$threads "$bench" --size "$size" |
+        awk '$1 == "pmap" || $1 == "preduce" || $1 == "psort" { printf "%s ", $2 }')
+    base=${base:-$times}
+    awk -v t="$threads" -v now="$times" -v base="$base" 'BEGIN {
+        split(now, n, " "); split(base, b, " ")
+        printf "%8d %10.1f %10.1f %10.1f %8.2fx %8.2fx %8.2fx\n", t, n[1], n[2], n[3],
+            b[1] / n[1], b[2] / n[2], b[3] / n[3]
+    }'
+done
@@ -0,0 +1,163 @@
+// The AST of a repetitive script before and after hashCons(). Generates --rules rules
+// that repeat the same lookups, constants and guards, and a loop that applies every rule
+// to --orders orders, or parses the given FILEs instead. Prints, for the tree as parsed
+// and after the pass, with times the best of --repeat runs:
+//   nodes       boxed nodes, and how many of them the pass shared or cached a value of,
+//   heap KB     heap bytes held by the AST,
+//   pass ms     time for hashCons(),
+//   eval ms     time for an Interpreter to run the program.
+
+#define MONKEY_BENCH_COUNT_ALLOCATIONS
+#include "bench.h"
+
+#include "monkey/ast.h"
+#include "monkey/hash_cons.h"
+#include "monkey/interpreter.h"
+#include "monkey/lexer.h"
+#include "monkey/parser.h"
+
+#include <fmt/format.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+using namespace monkey;
+
+// Identifiers are made of letters only: rule i is named `rule` followed by i in base 26.
+std::string ruleName(size_t i) {
+    std::string name = "rule";
+    do {
+        name += static_cast<char>('a' + i % 26);
+        i /= 26;
+    } while (i > 0);
+    return name;
+}
+
+// Rules as a generator would write them: each one spells out the same field lookups,
+// limits computed from constants, and guards.
+std::string generate(size_t rules, size_t orders) {
+    std::string source = "let orders = [";
+    for (size_t i = 0; i < orders; ++i) {
+        source += fmt::format(R"({}{{"total": {}, "bulk": {}, "items": {}}})",
+                              i == 0 ? "" : ", ", i * 37 % 5000, i % 3 == 0, i % 17);
+    }
+    source += "];\n";
+    for (size_t i = 0; i < rules; ++i) {
+        source += fmt::format(
+            "let {} = fn(order) {{\n"
+            "    if (order[\"total\"] > 60 * 60 + 24 * 7) {{ return 60 * 60 * 24; }}\n"
+            "    if (order[\"bulk\"] == !false) {{\n"
+            "        order[\"total\"] * (100 - 15) / 100 + order[\"items\"] * (2 * 3)\n"
+            "    }} else {{\n"
+            "        if (order[\"items\"] < 10 - 1) {{ order[\"total\"] + 30 * 24 }} "
+            "else {{ order[\"total\"] - -(5 * 5) }}\n"
+            "    }}\n"
+            "}};\n",
+            ruleName(i));
+    }
+    source += "let rules = [";
+    for (size_t i = 0; i < rules; ++i) {
+        source += fmt::format("{}{}", i == 0 ? "" : ", ", ruleName(i));
+    }
+    source += "];\n"
+              "let apply = fn(i, total) {\n"
+              "    if (i == len(orders) * len(rules)) { return total; }\n"
+              "    let rule = rules[i - i / len(rules) * len(rules)];\n"
+              "    apply(i + 1, total + rule(orders[i / len(rules)]))\n"
+              "};\n"
+              "apply(0, 0)\n";
+    return source;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::span<char *> args(argv + 1, static_cast<size_t>(argc - 1));
+    size_t rules = 2000;
+    size_t orders = 20;
+    int repeat = 3;
+    std::vector<std::string> files;
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (bench::parseRepeat(args, i, repeat)) {
+            continue;
+        }
+        std::string_view arg = args[i];
+        if (arg == "--rules" && i + 1 < args.size()) {
+            rules = std::strtoull(args[++i], nullptr, 10);
+        } else if (arg == "--orders" && i + 1 < args.size()) {
+            orders = std::strtoull(args[++i], nullptr, 10);
+        } else if (!arg.starts_with("--")) {
+            files.emplace_back(arg);
+        } else {
+            fmt::print(stderr, "usage: monkey_hash_cons [--rules N] [--orders N] "
+                               "[--repeat N] [FILE...]\n");
+            return 1;
+        }
+    }
+
+    std::string source;
+    if (files.empty()) {
+        source = generate(rules, orders);
+    } else {
+        std::ostringstream corpus;
+        for (const auto &file : files) {
+            std::ifstream in(file, std::ios::binary);
+            corpus << in.rdbuf() << '\n';
+        }
+        source = corpus.str();
+    }
+
+    auto before = bench::heap.liveBytes.load();
+    auto parser = Parser(Lexer(source));
+    auto program = parser.parseProgram();
+    auto treeBytes = bench::heap.liveBytes.load() - before;
+    if (!parser.errors().empty()) {
+        fmt::print(stderr, "{}\n", parser.errors().front());
+        return 1;
+    }
+    auto text = toString(*program);
+    before = bench::heap.liveBytes.load();
+    auto stats = hashCons(*program);
+    auto dagBytes = treeBytes + bench::heap.liveBytes.load() - before;
+    if (toString(*program) != text) {
+        fmt::print(stderr, "the program prints differently after the pass\n");
+        return 1;
+    }
+
+    auto tree = compile(source);
+    auto dag = compile(source, {.hashCons = true});
+    std::string results[2];
+    auto run = [&](const CompiledProgram &compiled, std::string &result) {
+        Interpreter interpreter;
+        result = inspect(interpreter.run(compiled));
+    };
+    auto kilobytes = [](int64_t bytes) { return static_cast<double>(bytes) / 1024; };
+    fmt::println("{:<18} {:>10} {:>10}", "", "tree", "dag");
+    fmt::println("{:<18} {:>10} {:>10}", "nodes", stats.nodes,
+                 stats.nodes - stats.shared);
+    fmt::println("{:<18} {:>10} {:>10}", "shared nodes", "", stats.shared);
+    fmt::println("{:<18} {:>10} {:>10}", "cached constants", "", stats.constants);
+    fmt::println("{:<18} {:>10.1f} {:>10.1f}", "heap KB", kilobytes(treeBytes),
+                 kilobytes(dagBytes));
+    fmt::println("{:<18} {:>10} {:>10.2f}", "pass ms", "", bench::best(repeat, [&] {
+                     auto copy = Parser(Lexer(source)).parseProgram();
+                     hashCons(*copy);
+                 }) - bench::best(repeat, [&] { Parser(Lexer(source)).parseProgram(); }));
+    fmt::println("{:<18} {:>10.1f} {:>10.1f}", "eval ms",
+                 bench::best(repeat, [&] { run(*tree, results[0]); }),
+                 bench::best(repeat, [&] { run(*dag, results[1]); }));
+    if (results[0] != results[1]) {
+        fmt::print(stderr, "the results differ: {} and {}\n", results[0], results[1]);
+        return 1;
+    }
+    fmt::println("{:<18} {:>10}", "result", results[0]);
+}
\ No newline at end of file
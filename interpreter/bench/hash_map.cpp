@@ -0,0 +1,160 @@
+// Inserts and lookups of the HashTable behind Monkey hashes against a std::unordered_map
+// with the same keys, hasher and equality, so the difference is the table layout. For
+// each key type (integers, and 16-character strings) and size from 1K up to --max
+// entries, builds a map of N keys, growing it as it goes and again after reserving room
+// for N (as hash literals do), then looks up all N keys in a shuffled order and N absent
+// keys. Prints nanoseconds per operation, best of --repeat runs.
+
+#include "bench.h"
+
+#include "monkey/memory.h"
+#include "monkey/object.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <random>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using namespace monkey;
+
+using StdMap = std::unordered_map<HashKey, Object, HashKey::Hasher, std::equal_to<>>;
+
+struct Keys {
+    std::vector<HashKey> present;
+    std::vector<HashKey> absent;
+};
+
+Keys makeKeys(size_t count, bool strings) {
+    auto make = [&](uint64_t value) {
+        Object key = static_cast<int64_t>(value);
+        if (strings) {
+            key = String(fmt::format("key-{:012x}", value));
+        }
+        return *hashKey(key);
+    };
+    Keys keys;
+    for (size_t i = 0; i < count; ++i) {
+        // Even values are present and odd ones absent.
+        keys.present.push_back(make(i * 2));
+        keys.absent.push_back(make(i * 2 + 1));
+    }
+    return keys;
+}
+
+struct Timing {
+    double insert = std::numeric_limits<double>::max();
+    double reserved = std::numeric_limits<double>::max();
+    double hit = std::numeric_limits<double>::max();
+    double miss = std::numeric_limits<double>::max();
+};
+
+// `insert(map, key)` maps the key to itself; `find(map, key)` says whether it is there.
+template <typename Map, typename Insert, typename Find>
+Timing measure(const Keys &keys, std::span<const HashKey> lookups, int repeat,
+               Insert insert, Find find) {
+    using Clock = std::chrono::steady_clock;
+    auto perOp = [&](Clock::time_point start, size_t ops) {
+        const std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+        return elapsed.count() / static_cast<double>(ops);
+    };
+    Timing best;
+    for (int r = 0; r < repeat; ++r) {
+        auto start = Clock::now();
+        Map map;
+        for (const auto &key : keys.present) {
+            insert(map, key);
+        }
+        best.insert = std::min(best.insert, perOp(start, keys.present.size()));
+
+        start = Clock::now();
+        Map presized;
+        presized.reserve(keys.present.size());
+        for (const auto &key : keys.present) {
+            insert(presized, key);
+        }
+        best.reserved = std::min(best.reserved, perOp(start, keys.present.size()));
+
+        size_t found = 0;
+        start = Clock::now();
+        for (const auto &key : lookups) {
+            found += find(map, key) ? 1U : 0U;
+        }
+        best.hit = std::min(best.hit, perOp(start, lookups.size()));
+
+        start = Clock::now();
+        for (const auto &key : keys.absent) {
+            found += find(map, key) ? 1U : 0U;
+        }
+        best.miss = std::min(best.miss, perOp(start, keys.absent.size()));
+        if (found != lookups.size()) {
+            fmt::print(stderr, "lookups found {} of {} keys\n", found, lookups.size());
+            std::exit(1);
+        }
+    }
+    return best;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::span<char *> args(argv + 1, static_cast<size_t>(argc - 1));
+    size_t max = 1'000'000;
+    int repeat = 3;
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (bench::parseRepeat(args, i, repeat)) {
+            continue;
+        }
+        std::string_view arg = args[i];
+        if (arg == "--max" && i + 1 < args.size()) {
+            max = std::strtoull(args[++i], nullptr, 10);
+        } else {
+            fmt::print(stderr, "usage: monkey_hash_map [--max N] [--repeat N]\n");
+            return 1;
+        }
+    }
+
+    fmt::println("{:<7} {:>9} {:<14} {:>10} {:>10} {:>8} {:>8}", "keys", "entries", "map",
+                 "insert ns", "reserved", "hit ns", "miss ns");
+    for (bool strings : {false, true}) {
+        for (size_t count = 1000; count <= max; count *= 10) {
+            auto keys = makeKeys(count, strings);
+            auto lookups = keys.present;
+            std::shuffle(lookups.begin(), lookups.end(), std::mt19937_64(count + 1));
+
+            auto swiss = measure<HashTable>(
+                keys, lookups, repeat,
+                [](HashTable &map, const HashKey &key) { map.insert(key, key.key); },
+                [](const HashTable &map, const HashKey &key) {
+                    return map.find(key) != nullptr;
+                });
+            auto standard = measure<StdMap>(
+                keys, lookups, repeat,
+                [](StdMap &map, const HashKey &key) {
+                    map.insert_or_assign(key, key.key);
+                },
+                [](const StdMap &map, const HashKey &key) {
+                    return map.find(key) != map.end();
+                });
+            for (const auto &[name, timing] :
+                 {std::pair{"SwissMap", swiss}, std::pair{"unordered_map", standard}}) {
+                fmt::println("{:<7} {:>9} {:<14} {:>10.1f} {:>10.1f} {:>8.1f} {:>8.1f}",
+                             strings ? "string" : "int", count, name, timing.insert,
+                             timing.reserved, timing.hit, timing.miss);
+            }
+        }
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,165 @@
+// The integer-array builtins (sum, dot, min, max, mapAdd, filterGt) against the Monkey
+// loop that computes the same thing, on arrays of --size random integers. For each
+// builtin, prints milliseconds for the kernel called directly from C++, both dispatched
+// (see monkey/simd.h) and scalar, for the builtin called from a script, and for the
+// loop; best of --repeat runs, except that the loops run once unless --repeat-loops.
+
+#include "bench.h"
+
+#include "monkey/interpreter.h"
+#include "monkey/object.h"
+#include "monkey/simd.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <random>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+using namespace monkey;
+
+constexpr std::string_view RANGE =
+    "let range = fn(i, n) { if (i < n) { yield i; range(i + 1, n) } };";
+
+struct Case {
+    std::string_view name;
+    std::string_view builtin;
+    std::string_view loop;
+    // Runs the kernel over `a` and `b`, writing to `out` if it builds an array.
+    std::function<int64_t(std::span<const int64_t>, std::span<const int64_t>, int64_t *,
+                          bool scalar)>
+        kernel;
+};
+
+// Elements in [-1000, 1000], so that no loop overflows.
+std::vector<int64_t> randomValues(size_t size, uint64_t seed) {
+    std::mt19937_64 random(seed);
+    std::vector<int64_t> values(size);
+    for (auto &value : values) {
+        value = static_cast<int64_t>(random() % 2001) - 1000;
+    }
+    return values;
+}
+
+bool same(const Object &a, const Object &b) {
+    const auto *x = std::get_if<Array>(&a);
+    const auto *y = std::get_if<Array>(&b);
+    if (x == nullptr || y == nullptr) {
+        return inspect(a) == inspect(b);
+    }
+    if (x->size() != y->size()) {
+        return false;
+    }
+    for (size_t i = 0; i < x->size(); ++i) {
+        if (std::get<int64_t>((*x)[i]) != std::get<int64_t>((*y)[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::span<char *> args(argv + 1, static_cast<size_t>(argc - 1));
+    size_t size = 10'000'000;
+    int repeat = 3;
+    bool repeatLoops = false;
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (bench::parseRepeat(args, i, repeat)) {
+            continue;
+        }
+        std::string_view arg = args[i];
+        if (arg == "--size" && i + 1 < args.size()) {
+            size = std::max<size_t>(1, std::strtoull(args[++i], nullptr, 10));
+        } else if (arg == "--repeat-loops") {
+            repeatLoops = true;
+        } else {
+            fmt::print(stderr, "usage: monkey_int_arrays [--size N] [--repeat N] "
+                               "[--repeat-loops]\n");
+            return 1;
+        }
+    }
+
+    const std::vector<Case> cases = {
+        {"sum", "sum(a)", "fold(range(0, len(a)), 0, fn(s, i) { s + a[i] })",
+         [](auto a, auto, int64_t *, bool scalar) {
+             return scalar ? simd::scalar::sum(a) : simd::sum(a);
+         }},
+        {"dot", "dot(a, b)", "fold(range(0, len(a)), 0, fn(s, i) { s + a[i] * b[i] })",
+         [](auto a, auto b, int64_t *, bool scalar) {
+             return scalar ? simd::scalar::dot(a, b) : simd::dot(a, b);
+         }},
+        {"min", "min(a)",
+         "fold(range(1, len(a)), a[0], fn(m, i) { if (a[i] < m) { a[i] } else { m } })",
+         [](auto a, auto, int64_t *, bool scalar) {
+             return scalar ? simd::scalar::min(a) : simd::min(a);
+         }},
+        {"max", "max(a)",
+         "fold(range(1, len(a)), a[0], fn(m, i) { if (m < a[i]) { a[i] } else { m } })",
+         [](auto a, auto, int64_t *, bool scalar) {
+             return scalar ? simd::scalar::max(a) : simd::max(a);
+         }},
+        {"mapAdd", "mapAdd(a, 7)",
+         "fold(range(0, len(a)), [], fn(r, i) { push(r, a[i] + 7) })",
+         [](auto a, auto, int64_t *out, bool scalar) {
+             scalar ? simd::scalar::add(a, 7, out) : simd::add(a, 7, out);
+             return out[0];
+         }},
+        {"filterGt", "filterGt(a, 0)",
+         "fold(range(0, len(a)), [],"
+         "     fn(r, i) { if (a[i] > 0) { push(r, a[i]) } else { r } })",
+         [](auto a, auto, int64_t *out, bool scalar) {
+             return static_cast<int64_t>(scalar ? simd::scalar::filterGreater(a, 0, out)
+                                                : simd::filterGreater(a, 0, out));
+         }},
+    };
+
+    auto a = randomValues(size, 1);
+    auto b = randomValues(size, 2);
+    std::vector<int64_t> out(size);
+    Interpreter interpreter;
+    interpreter.define("a", Array(IntVector::from(a)));
+    interpreter.define("b", Array(IntVector::from(b)));
+    interpreter.run(*compile(RANGE));
+
+    fmt::println("{} elements, {} kernels", size, simd::implementation());
+    fmt::println("{:<9} {:>10} {:>10} {:>10} {:>10} {:>9}", "builtin", "kernel ms",
+                 "scalar ms", "builtin ms", "loop ms", "speedup");
+    for (const auto &test : cases) {
+        // Kept in a volatile so that the calls are not optimized away.
+        volatile int64_t sink = 0;
+        auto timeKernel = [&](bool scalar) {
+            return bench::best(repeat,
+                               [&] { sink = test.kernel(a, b, out.data(), scalar); });
+        };
+        auto kernel = timeKernel(false);
+        auto scalar = timeKernel(true);
+
+        auto builtinProgram = compile(test.builtin);
+        auto loopProgram = compile(test.loop);
+        Object viaBuiltin;
+        Object viaLoop;
+        auto builtin =
+            bench::best(repeat, [&] { viaBuiltin = interpreter.run(*builtinProgram); });
+        auto loop = bench::best(repeatLoops ? repeat : 1,
+                                [&] { viaLoop = interpreter.run(*loopProgram); });
+        if (!same(viaBuiltin, viaLoop)) {
+            fmt::print(stderr, "{}: builtin and loop disagree: {} and {}\n", test.name,
+                       inspect(viaBuiltin).substr(0, 80), inspect(viaLoop).substr(0, 80));
+            return 1;
+        }
+        fmt::println("{:<9} {:>10.2f} {:>10.2f} {:>10.2f} {:>10.1f} {:>8.0f}x", test.name,
+                     kernel, scalar, builtin, loop, loop / builtin);
+    }
+    return 0;
+}
@@ -0,0 +1,159 @@
+// Throughput of the io_uring-backed readFile against blocking std::ifstream reads.
+// Creates a directory of many small files (or reads the regular files of DIR) and reads
+// all of them with
+//   ifstream  one std::ifstream after the other,
+//   io_uring  every request started through monkey::io(), then awaited,
+//   script    a Monkey script that starts every readFile before awaiting the first.
+// Prints files and megabytes per second, best of --repeat runs. The page cache is warm
+// after the first run, so this compares per-request overhead rather than the disk.
+
+#include "bench.h"
+
+#include "monkey/generator.h"
+#include "monkey/interpreter.h"
+#include "monkey/io.h"
+#include "monkey/object.h"
+#include "monkey/task.h"
+
+#include <fmt/format.h>
+
+#include <cstddef>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+using namespace monkey;
+
+// Starts every read, then awaits them in order and sums their lengths.
+constexpr std::string_view SCRIPT = R"(
+let start = fn() { let path = next(paths); if (path) { yield readFile(path); start() } };
+let pending = channel();
+fold(start(), 0, fn(n, task) { send(pending, task); n + 1 });
+close(pending);
+let drain = fn() { let task = recv(pending); if (task) { yield await(task); drain() } };
+fold(drain(), 0, fn(bytes, text) { bytes + len(text) });
+)";
+
+size_t viaIfstream(const std::vector<std::string> &paths) {
+    size_t bytes = 0;
+    for (const auto &path : paths) {
+        std::ifstream in(path, std::ios::binary);
+        std::stringstream text;
+        text << in.rdbuf();
+        bytes += text.str().size();
+    }
+    return bytes;
+}
+
+size_t viaIoLoop(const std::vector<std::string> &paths) {
+    std::vector<Task> tasks;
+    tasks.reserve(paths.size());
+    for (const auto &path : paths) {
+        tasks.push_back(io().readFile(path));
+    }
+    size_t bytes = 0;
+    for (const auto &task : tasks) {
+        auto result = task.state->await();
+        if (const auto *text = std::get_if<String>(&result)) {
+            bytes += text->size();
+        }
+    }
+    return bytes;
+}
+
+size_t viaScript(const CompiledProgram &program, const std::vector<std::string> &paths) {
+    Interpreter interpreter;
+    interpreter.define("paths", Generator{std::make_shared<GeneratorState>(
+                                    [&paths, i = size_t{0}]() mutable
+                                    -> std::optional<Object> {
+                                        if (i == paths.size()) {
+                                            return std::nullopt;
+                                        }
+                                        return String(paths[i++]);
+                                    })});
+    auto result = interpreter.run(program);
+    if (const auto *bytes = std::get_if<int64_t>(&result)) {
+        return static_cast<size_t>(*bytes);
+    }
+    fmt::print(stderr, "script failed: {}\n", inspect(result));
+    std::exit(1);
+}
+
+void report(std::string_view name, size_t files, size_t bytes, double seconds) {
+    fmt::println("{:<10} {:>12.0f} {:>10.1f}", name, static_cast<double>(files) / seconds,
+                 static_cast<double>(bytes) / seconds / 1e6);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::span<char *> args(argv + 1, static_cast<size_t>(argc - 1));
+    size_t files = 10000;
+    size_t size = 4096;
+    int repeat = 5;
+    std::optional<std::filesystem::path> dir;
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (bench::parseRepeat(args, i, repeat)) {
+            continue;
+        }
+        std::string_view arg = args[i];
+        if (arg == "--files" && i + 1 < args.size()) {
+            files = std::strtoull(args[++i], nullptr, 10);
+        } else if (arg == "--size" && i + 1 < args.size()) {
+            size = std::strtoull(args[++i], nullptr, 10);
+        } else if (!arg.starts_with("--") && !dir) {
+            dir = arg;
+        } else {
+            fmt::print(stderr, "usage: monkey_io [--files N] [--size BYTES] [--repeat N] "
+                               "[DIR]\n");
+            return 1;
+        }
+    }
+
+    bool generated = !dir;
+    if (generated) {
+        dir = std::filesystem::temp_directory_path() / "monkey_io_bench";
+        std::filesystem::create_directories(*dir);
+        const std::string contents(size, 'x');
+        for (size_t i = 0; i < files; ++i) {
+            std::ofstream(*dir / fmt::format("{}.txt", i), std::ios::binary) << contents;
+        }
+    }
+    std::vector<std::string> paths;
+    for (const auto &entry : std::filesystem::directory_iterator(*dir)) {
+        if (entry.is_regular_file()) {
+            paths.push_back(entry.path().string());
+        }
+    }
+
+    auto program = compile(SCRIPT);
+    std::vector<std::pair<std::string_view, std::function<size_t()>>> methods = {
+        {"ifstream", [&] { return viaIfstream(paths); }},
+        {"io_uring", [&] { return viaIoLoop(paths); }},
+        {"script", [&] { return viaScript(*program, paths); }},
+    };
+
+    fmt::println("{} files in {} ({})", paths.size(), dir->string(),
+                 io().async() ? "io_uring" : "io_uring unavailable, blocking fallback");
+    fmt::println("{:<10} {:>12} {:>10}", "method", "files/s", "MB/s");
+    for (const auto &[name, method] : methods) {
+        size_t bytes = 0;
+        auto seconds = bench::best<bench::Seconds>(repeat, [&] { bytes = method(); });
+        report(name, paths.size(), bytes, seconds);
+    }
+
+    if (generated) {
+        std::filesystem::remove_all(*dir);
+    }
+    return 0;
+}
\ No newline at end of file
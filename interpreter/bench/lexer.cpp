@@ -0,0 +1,151 @@
+// Lexing throughput. Generates Monkey source of --size megabytes in a few shapes, or
+// reads the given FILEs repeated up to that size, and runs the Lexer over it to the end.
+// Prints megabytes and millions of tokens per second, best of --repeat runs, for the
+// Lexer alone and for filling a TokenBuffer, and the bytes each token takes held as a
+// Token (with its string's heap block, if it has one) and in the buffer.
+//   code       short names and numbers, indented by four spaces per level,
+//   indented   the same code indented by 24 spaces per level, as generated code often is,
+//   long       the same code with 24-character names and 12-digit numbers,
+//   keywords   code made mostly of keywords.
+
+#include "bench.h"
+
+#include "monkey/lexer.h"
+#include "monkey/token.h"
+#include "monkey/token_buffer.h"
+
+#include <fmt/format.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using namespace monkey;
+
+// Repeats a function definition with `indent` spaces per level, `name` appended to each
+// identifier and `digits` appended to each number until the source reaches `bytes`.
+std::string generate(size_t bytes, size_t indent, std::string_view name,
+                     std::string_view digits) {
+    std::string source;
+    for (size_t i = 0; source.size() < bytes; ++i) {
+        auto pad = [&](size_t level) { return std::string(level * indent, ' '); };
+        source += fmt::format(
+            "let step{1}{0} = fn(count{1}, total{1}) {{\n"
+            "{2}if (count{1} < 10{3}) {{\n"
+            "{4}return step{1}{0}(count{1} + 1, total{1} * 2{3} - count{1});\n"
+            "{2}}} else {{\n"
+            "{4}let label{1} = \"total\";\n"
+            "{4}[label{1}, total{1}, {{\"n\": count{1} / 3{3}}}]\n"
+            "{2}}}\n"
+            "}};\n",
+            i, name, pad(1), digits, pad(2));
+    }
+    return source;
+}
+
+std::string generateKeywords(size_t bytes) {
+    std::string source;
+    while (source.size() < bytes) {
+        source += "let f = fn(x) { if (true) { return x; } else { "
+                  "if (false) { yield x; } else { return false; } } };\n";
+    }
+    return source;
+}
+
+size_t lex(const std::string &source) {
+    Lexer lexer(source);
+    size_t tokens = 1;
+    while (lexer.nextToken().type != TokenType::EOF_TOKEN) {
+        ++tokens;
+    }
+    return tokens;
+}
+
+size_t buffer(const std::string &source) { return TokenBuffer(Lexer(source)).size(); }
+
+// The bytes of a vector<Token> holding every token of the source. Strings of up to
+// capacity() of an empty string are stored inline.
+size_t tokenBytes(const std::string &source) {
+    const auto inline_ = std::string().capacity();
+    Lexer lexer(source);
+    size_t bytes = sizeof(Token);
+    for (auto token = lexer.nextToken(); token.type != TokenType::EOF_TOKEN;
+         token = lexer.nextToken()) {
+        bytes += sizeof(Token);
+        if (token.literal.size() > inline_) {
+            bytes += token.literal.size() + 1;
+        }
+    }
+    return bytes;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::span<char *> args(argv + 1, static_cast<size_t>(argc - 1));
+    size_t megabytes = 64;
+    int repeat = 3;
+    std::vector<std::string> files;
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (bench::parseRepeat(args, i, repeat)) {
+            continue;
+        }
+        std::string_view arg = args[i];
+        if (arg == "--size" && i + 1 < args.size()) {
+            megabytes = std::strtoull(args[++i], nullptr, 10);
+        } else if (!arg.starts_with("--")) {
+            files.emplace_back(arg);
+        } else {
+            fmt::print(stderr,
+                       "usage: monkey_lexer [--size MB] [--repeat N] [FILE...]\n");
+            return 1;
+        }
+    }
+
+    auto bytes = megabytes << 20;
+    std::vector<std::pair<std::string, std::string>> inputs;
+    if (files.empty()) {
+        inputs.emplace_back("code", generate(bytes, 4, "", ""));
+        inputs.emplace_back("indented", generate(bytes, 24, "", ""));
+        inputs.emplace_back("long",
+                            generate(bytes, 4, "_with_a_longer_name", "00000000000"));
+        inputs.emplace_back("keywords", generateKeywords(bytes));
+    } else {
+        std::ostringstream corpus;
+        for (const auto &file : files) {
+            std::ifstream in(file, std::ios::binary);
+            corpus << in.rdbuf() << '\n';
+        }
+        std::string source;
+        while (source.size() < bytes) {
+            source += corpus.view();
+        }
+        inputs.emplace_back("files", std::move(source));
+    }
+
+    fmt::println("{:<10} {:>8} {:>10} {:>12} {:>12} {:>12} {:>12}", "input", "MB", "MB/s",
+                 "Mtokens/s", "buffer MB/s", "Token bytes", "buffer bytes");
+    for (const auto &[name, source] : inputs) {
+        size_t tokens = 0;
+        auto lexing = bench::best<bench::Seconds>(repeat, [&] { tokens = lex(source); });
+        auto buffering = bench::best<bench::Seconds>(repeat, [&] { buffer(source); });
+        auto size = static_cast<double>(source.size());
+        auto perToken = [&](size_t total) {
+            return static_cast<double>(total) / static_cast<double>(tokens);
+        };
+        fmt::println("{:<10} {:>8.1f} {:>10.1f} {:>12.1f} {:>12.1f} {:>12.1f} {:>12.1f}",
+                     name, size / 1e6, size / lexing / 1e6,
+                     static_cast<double>(tokens) / lexing / 1e6, size / buffering / 1e6,
+                     perToken(tokenBytes(source)),
+                     perToken(tokens * (sizeof(TokenType) + 2 * sizeof(uint32_t))));
+    }
+}
\ No newline at end of file
@@ -0,0 +1,116 @@
+// Line-scanning throughput of the memory-mapped lines() builtin. Generates a log-like
+// file of --size megabytes (or scans FILE) and counts its lines with
+//   getline    std::getline on a std::ifstream,
+//   lines      a Monkey fold over lines(path),
+//   readLines  a Monkey fold over await(readLines(path)), which reads the whole file.
+// Prints megabytes per second, best of --repeat runs, and the peak of the interpreter's
+// MemoryAccount.
+
+#include "bench.h"
+
+#include "monkey/interpreter.h"
+#include "monkey/object.h"
+
+#include <fmt/format.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using namespace monkey;
+
+struct Scan {
+    int64_t lines = 0;
+    size_t peak = 0;
+};
+
+Scan viaGetline(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    std::string line;
+    Scan scan;
+    while (std::getline(in, line)) {
+        ++scan.lines;
+    }
+    return scan;
+}
+
+Scan viaScript(const CompiledProgram &program, const std::string &path) {
+    Interpreter interpreter;
+    interpreter.define("path", String(path));
+    auto result = interpreter.run(program);
+    if (const auto *lines = std::get_if<int64_t>(&result)) {
+        return {*lines, interpreter.memory().peak()};
+    }
+    fmt::print(stderr, "script failed: {}\n", inspect(result));
+    std::exit(1);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::span<char *> args(argv + 1, static_cast<size_t>(argc - 1));
+    size_t megabytes = 256;
+    int repeat = 3;
+    std::optional<std::string> path;
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (bench::parseRepeat(args, i, repeat)) {
+            continue;
+        }
+        std::string_view arg = args[i];
+        if (arg == "--size" && i + 1 < args.size()) {
+            megabytes = std::strtoull(args[++i], nullptr, 10);
+        } else if (!arg.starts_with("--") && !path) {
+            path = arg;
+        } else {
+            fmt::print(stderr, "usage: monkey_lines [--size MB] [--repeat N] [FILE]\n");
+            return 1;
+        }
+    }
+
+    bool generated = !path;
+    if (generated) {
+        auto file = std::filesystem::temp_directory_path() / "monkey_lines_bench.log";
+        path = file.string();
+        std::ofstream out(*path, std::ios::binary);
+        for (size_t i = 0, written = 0; written < megabytes << 20; ++i) {
+            auto line = fmt::format("2024-01-01T00:00:{:02}Z INFO request {} took {}ms\n",
+                                    i % 60, i, i % 997);
+            out << line;
+            written += line.size();
+        }
+    }
+    auto bytes = std::filesystem::file_size(*path);
+
+    auto mapped = compile(R"(fold(lines(path), 0, fn(n, line) { n + 1 }))");
+    auto read = compile(R"(fold(await(readLines(path)), 0, fn(n, line) { n + 1 }))");
+    std::vector<std::pair<std::string_view, std::function<Scan()>>> methods = {
+        {"getline", [&] { return viaGetline(*path); }},
+        {"lines", [&] { return viaScript(*mapped, *path); }},
+        {"readLines", [&] { return viaScript(*read, *path); }},
+    };
+
+    fmt::println("{:.1f} MB in {}", static_cast<double>(bytes) / 1e6, *path);
+    fmt::println("{:<10} {:>10} {:>12} {:>14}", "method", "MB/s", "lines", "peak bytes");
+    for (const auto &[name, method] : methods) {
+        Scan scan;
+        auto seconds = bench::best<bench::Seconds>(repeat, [&] { scan = method(); });
+        fmt::println("{:<10} {:>10.1f} {:>12} {:>14}", name,
+                     static_cast<double>(bytes) / seconds / 1e6, scan.lines, scan.peak);
+    }
+
+    if (generated) {
+        std::filesystem::remove(*path);
+    }
+    return 0;
+}
\ No newline at end of file
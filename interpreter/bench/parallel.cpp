@@ -0,0 +1,96 @@
+// Parallel speedup of spawn/await. Every PROGRAM.monkey is paired with
+// PROGRAM.par.monkey, the same computation split into tasks (divide-and-conquer fib, a
+// map over an index range cut in halves). Prints the best-of-N time of both and the
+// speedup, and fails if their results differ. Set MONKEY_THREADS to vary the number of
+// scheduler workers.
+
+#include "bench.h"
+
+#include "monkey/interpreter.h"
+#include "monkey/object.h"
+#include "monkey/task.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <optional>
+#include <span>
+#include <sstream>
+#include <string>
+#include <utility>
+
+namespace {
+
+using namespace monkey;
+
+struct Timing {
+    std::string result;
+    double seconds;
+};
+
+std::optional<Timing> best(const std::filesystem::path &path, int repeat) {
+    std::ifstream file(path);
+    if (!file) {
+        fmt::print(stderr, "cannot open {}\n", path.string());
+        return std::nullopt;
+    }
+    std::stringstream source;
+    source << file.rdbuf();
+    auto program = compile(source.str());
+
+    Timing timing{"", std::numeric_limits<double>::max()};
+    for (int i = 0; i < repeat; ++i) {
+        Interpreter interpreter;
+        auto start = std::chrono::steady_clock::now();
+        auto result = interpreter.run(*program);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (std::holds_alternative<Error>(result)) {
+            fmt::print(stderr, "{}: {}\n", path.string(), inspect(result));
+            return std::nullopt;
+        }
+        timing.result = inspect(result);
+        timing.seconds = std::min(timing.seconds, elapsed.count());
+    }
+    return timing;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::span<char *> args(argv + 1, static_cast<size_t>(argc - 1));
+    int repeat = 5;
+    if (size_t i = 0; !args.empty() && bench::parseRepeat(args, i, repeat)) {
+        args = args.subspan(i + 1);
+    }
+    if (args.empty()) {
+        fmt::print(stderr, "usage: monkey_parallel [--repeat N] PROGRAM.monkey...\n");
+        return 1;
+    }
+
+    fmt::println("{} scheduler threads", scheduler().size());
+    fmt::println("{:<12} {:>12} {:>12} {:>8}", "program", "seq_ms", "par_ms", "speedup");
+    bool ok = true;
+    for (std::filesystem::path sequential : args) {
+        auto parallel = sequential;
+        parallel.replace_extension(".par.monkey");
+        auto seq = best(sequential, repeat);
+        auto par = best(parallel, repeat);
+        if (!seq || !par) {
+            ok = false;
+            continue;
+        }
+        if (seq->result != par->result) {
+            fmt::print(stderr, "{}: results differ: {} vs {}\n",
+                       sequential.stem().string(), seq->result, par->result);
+            ok = false;
+            continue;
+        }
+        fmt::println("{:<12} {:>12.1f} {:>12.1f} {:>7.2f}x", sequential.stem().string(),
+                     seq->seconds * 1e3, par->seconds * 1e3, seq->seconds / par->seconds);
+    }
+    return ok ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,366 @@
+// End-to-end benchmark runner for the Monkey corpus.
+//
+// Every program is executed through the monkey_lib API in a forked child, so peak RSS and
+// allocation counts are not polluted by earlier programs. Each measurement is repeated
+// and the median is reported as JSON, one program per line, so that two runs can be
+// diffed directly.
+
+#define MONKEY_BENCH_COUNT_ALLOCATIONS
+#include "bench.h"
+
+#include "monkey/budget.h"
+#include "monkey/env.h"
+#include "monkey/eval.h"
+#include "monkey/lexer.h"
+#include "monkey/memory.h"
+#include "monkey/object.h"
+#include "monkey/parser.h"
+#include "monkey/stats.h"
+
+#include <fmt/format.h>
+#include <fmt/ranges.h>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+using namespace monkey;
+
+struct CounterSpec {
+    std::string_view name;
+    uint64_t config;
+};
+
+constexpr auto COUNTERS = std::to_array<CounterSpec>({
+    {"instructions", PERF_COUNT_HW_INSTRUCTIONS},
+    {"cycles", PERF_COUNT_HW_CPU_CYCLES},
+    {"branch_misses", PERF_COUNT_HW_BRANCH_MISSES},
+    {"cache_misses", PERF_COUNT_HW_CACHE_MISSES},
+});
+
+constexpr uint64_t MISSING = UINT64_MAX;
+
+// Hardware counters for the calling thread. Counters the kernel refuses to open (no PMU,
+// perf_event_paranoid, ...) are reported as missing instead of failing the run.
+class PerfCounters {
+  public:
+    PerfCounters() {
+        for (size_t i = 0; i < COUNTERS.size(); ++i) {
+            perf_event_attr attr{};
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.size = sizeof(attr);
+            attr.config = COUNTERS[i].config;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fds_[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+    }
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+    ~PerfCounters() {
+        for (int fd : fds_) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+    }
+
+    void start() {
+        for (int fd : fds_) {
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+    }
+
+    std::array<uint64_t, COUNTERS.size()> stop() {
+        std::array<uint64_t, COUNTERS.size()> values{};
+        for (size_t i = 0; i < COUNTERS.size(); ++i) {
+            values[i] = MISSING;
+            if (fds_[i] < 0) {
+                continue;
+            }
+            ioctl(fds_[i], PERF_EVENT_IOC_DISABLE, 0);
+            uint64_t value = 0;
+            if (read(fds_[i], &value, sizeof(value)) == sizeof(value)) {
+                values[i] = value;
+            }
+        }
+        return values;
+    }
+
+  private:
+    std::array<int, COUNTERS.size()> fds_{};
+};
+
+// Plain-old-data so that the child can hand it to the parent through a pipe.
+struct Measurement {
+    uint64_t parseNs;
+    uint64_t wallNs;
+    uint64_t peakRssKb;
+    uint64_t allocations;
+    uint64_t allocatedBytes;
+    uint64_t peakHeapBytes; // interpreter allocations charged to the MemoryAccount
+    std::array<uint64_t, COUNTERS.size()> counters;
+    RuntimeStats stats;
+    std::array<char, 128> result;
+};
+
+uint64_t elapsedNs(std::chrono::steady_clock::time_point start) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now() - start)
+                                     .count());
+}
+
+// Fuel handed to every evaluation when --fuel is given; used to measure the cost of the
+// budget checks themselves.
+std::optional<uint64_t> fuel;
+
+Measurement measure(const std::string &source) {
+    Measurement m{};
+    PerfCounters perf;
+
+    auto parseStart = std::chrono::steady_clock::now();
+    auto parser = Parser(Lexer(source));
+    auto program = parser.parseProgram();
+    m.parseNs = elapsedNs(parseStart);
+
+    MemoryAccount account;
+    const MemoryScope scope(account);
+    auto env = makeEnvironment();
+    resetRuntimeStats();
+    bench::heap.allocations = 0;
+    bench::heap.allocatedBytes = 0;
+
+    auto evalStart = std::chrono::steady_clock::now();
+    perf.start();
+    Object result;
+    if (fuel) {
+        Budget budget(*fuel);
+        result = eval(*program, env, budget);
+    } else {
+        result = eval(*program, env);
+    }
+    m.counters = perf.stop();
+    m.wallNs = elapsedNs(evalStart);
+
+    m.allocations = bench::heap.allocations;
+    m.allocatedBytes = bench::heap.allocatedBytes;
+    m.stats = runtimeStats();
+    m.peakHeapBytes = account.peak();
+
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    m.peakRssKb = static_cast<uint64_t>(usage.ru_maxrss);
+
+    auto text = parser.errors().empty() ? inspect(result) : "parse error";
+    auto len = std::min(text.size(), m.result.size() - 1);
+    std::copy_n(text.begin(), len, m.result.begin());
+    return m;
+}
+
+std::optional<Measurement> measureInChild(const std::string &source) {
+    std::array<int, 2> fds{};
+    if (pipe(fds.data()) != 0) {
+        return std::nullopt;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return std::nullopt;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        auto m = measure(source);
+        auto written = write(fds[1], &m, sizeof(m));
+        _exit(written == sizeof(m) ? 0 : 1);
+    }
+
+    close(fds[1]);
+    Measurement m{};
+    auto got = read(fds[0], &m, sizeof(m));
+    close(fds[0]);
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (got != sizeof(m) || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        return std::nullopt;
+    }
+    return m;
+}
+
+uint64_t medianOf(const std::vector<Measurement> &runs, auto projection) {
+    std::vector<uint64_t> values;
+    for (const auto &run : runs) {
+        values.push_back(std::invoke(projection, run));
+    }
+    std::ranges::sort(values);
+    return values[values.size() / 2];
+}
+
+std::string jsonEscape(std::string_view text) {
+    std::string out;
+    for (char ch : text) {
+        switch (ch) {
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        default:
+            if (static_cast<unsigned char>(ch) < 0x20) {
+                out += fmt::format("\\u{:04x}", static_cast<int>(ch));
+            } else {
+                out += ch;
+            }
+        }
+    }
+    return out;
+}
+
+std::string jsonNumber(uint64_t value) {
+    return value == MISSING ? "null" : std::to_string(value);
+}
+
+std::string summarize(const std::string &name, const std::vector<Measurement> &runs) {
+    std::string json = fmt::format(
+        R"({{"name": "{}", "result": "{}", "runs": {}, "parse_ns": {}, "wall_ns": {}, )"
+        R"("peak_rss_kb": {}, "allocations": {}, "allocated_bytes": {}, )"
+        R"("peak_heap_bytes": {})",
+        jsonEscape(name), jsonEscape(runs.front().result.data()), runs.size(),
+        medianOf(runs, &Measurement::parseNs), medianOf(runs, &Measurement::wallNs),
+        medianOf(runs, &Measurement::peakRssKb),
+        medianOf(runs, &Measurement::allocations),
+        medianOf(runs, &Measurement::allocatedBytes),
+        medianOf(runs, &Measurement::peakHeapBytes));
+
+    std::array<uint64_t, COUNTERS.size()> counters{};
+    for (size_t i = 0; i < COUNTERS.size(); ++i) {
+        counters[i] = medianOf(runs, [i](const Measurement &m) { return m.counters[i]; });
+        json += fmt::format(R"(, "{}": {})", COUNTERS[i].name, jsonNumber(counters[i]));
+    }
+
+    // counters[0] is instructions, counters[1] is cycles
+    if (counters[0] != MISSING && counters[1] != MISSING && counters[1] != 0) {
+        json += fmt::format(R"(, "ipc": {:.3f})", static_cast<double>(counters[0]) /
+                                                     static_cast<double>(counters[1]));
+    } else {
+        json += R"(, "ipc": null)";
+    }
+
+    // Interpreter counters are deterministic, so any run will do.
+    if constexpr (STATS_ENABLED) {
+        const auto &stats = runs.front().stats;
+        json += fmt::format(
+            R"(, "environments": {}, "lookups": {}, "avg_scope_depth": {:.3f}, )"
+            R"("object_copies": {}, "function_copies": {}, "heap_bytes": {}, )"
+            R"("peak_call_depth": {})",
+            stats.environmentsCreated, stats.identifierLookups, stats.averageScopeDepth(),
+            stats.objectCopies, stats.functionCopies, stats.heapBytes,
+            stats.peakCallDepth);
+    }
+    return json + "}";
+}
+
+void usage() {
+    fmt::print(stderr,
+               "usage: monkey_bench [--repeat N] [--fuel N] [--output FILE] "
+               "PROGRAM...\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    int repeat = 5;
+    std::string output;
+    std::vector<std::filesystem::path> programs;
+
+    const std::vector<std::string_view> args(argv + 1, argv + argc);
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (bench::parseRepeat(args, i, repeat)) {
+            continue;
+        }
+        if (args[i] == "--fuel" && i + 1 < args.size()) {
+            fuel = std::strtoull(args[++i].data(), nullptr, 10);
+        } else if (args[i] == "--output" && i + 1 < args.size()) {
+            output = args[++i];
+        } else if (args[i].starts_with("--")) {
+            usage();
+            return 1;
+        } else {
+            programs.emplace_back(args[i]);
+        }
+    }
+    if (programs.empty()) {
+        usage();
+        return 1;
+    }
+
+    std::vector<std::string> lines;
+    for (const auto &path : programs) {
+        std::ifstream file(path);
+        if (!file) {
+            fmt::print(stderr, "cannot open {}\n", path.string());
+            return 1;
+        }
+        std::stringstream source;
+        source << file.rdbuf();
+
+        std::vector<Measurement> runs;
+        for (int i = 0; i < repeat; ++i) {
+            if (auto m = measureInChild(source.str())) {
+                runs.push_back(*m);
+            }
+        }
+        if (runs.empty()) {
+            fmt::print(stderr, "{}: every run failed\n", path.string());
+            return 1;
+        }
+
+        lines.push_back(summarize(path.stem().string(), runs));
+        fmt::print(stderr, "{:<16} {:>12} ns\n", path.stem().string(),
+                   medianOf(runs, &Measurement::wallNs));
+    }
+
+    auto json = fmt::format("{{\"programs\": [\n  {}\n]}}\n", fmt::join(lines, ",\n  "));
+    if (output.empty()) {
+        fmt::print("{}", json);
+        return 0;
+    }
+
+    std::ofstream out(output);
+    if (!out) {
+        fmt::print(stderr, "cannot write {}\n", output);
+        return 1;
+    }
+    out << json;
+    return 0;
+}
@@ -0,0 +1,147 @@
+// Request latency of `monkey serve` against starting the `monkey` binary per request.
+// Runs a server in-process on a temporary socket, sends the program once as source and
+// then by its cached id, and compares with `monkey batch --jobs 1 PROGRAM` spawned once
+// per request. Prints mean, median and p99 latency for each.
+
+#include "monkey/server.h"
+
+#include <fmt/format.h>
+
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+extern char **environ; // NOLINT(readability-redundant-declaration)
+
+namespace {
+
+using namespace monkey;
+using Clock = std::chrono::steady_clock;
+
+void report(std::string_view name, std::vector<double> micros) {
+    std::ranges::sort(micros);
+    double mean = std::accumulate(micros.begin(), micros.end(), 0.0) /
+                  static_cast<double>(micros.size());
+    fmt::println("{:<10} {:>12.1f} {:>12.1f} {:>12.1f}", name, mean,
+                 micros[micros.size() / 2], micros[micros.size() * 99 / 100]);
+}
+
+double elapsedMicros(Clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+}
+
+// Empty if any request fails.
+std::vector<double> serverLatencies(const std::string &socketPath,
+                                    const std::string &source, int requests) {
+    std::vector<double> micros;
+    auto client = Client::connect(socketPath);
+    if (!client) {
+        return micros;
+    }
+    auto first =
+        client->evaluate({.programId = std::nullopt, .bindings = {}, .source = source});
+    if (!first || !first->ok) {
+        return micros;
+    }
+    for (int i = 0; i < requests; ++i) {
+        auto start = Clock::now();
+        auto response = client->evaluate(
+            {.programId = first->programId, .bindings = {}, .source = ""});
+        if (!response || !response->ok) {
+            return {};
+        }
+        micros.push_back(elapsedMicros(start));
+    }
+    return micros;
+}
+
+std::vector<double> processLatencies(const std::string &monkey,
+                                     const std::string &program, int requests) {
+    std::vector<double> micros;
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+
+    std::vector<std::string> args{monkey, "batch", "--jobs", "1", program};
+    std::vector<char *> argv;
+    for (auto &arg : args) {
+        argv.push_back(arg.data());
+    }
+    argv.push_back(nullptr);
+
+    for (int i = 0; i < requests; ++i) {
+        auto start = Clock::now();
+        pid_t pid = 0;
+        int status = 0;
+        if (posix_spawn(&pid, monkey.c_str(), &actions, nullptr, argv.data(),
+                        environ) != 0 ||
+            waitpid(pid, &status, 0) != pid || !WIFEXITED(status) ||
+            WEXITSTATUS(status) != 0) {
+            micros.clear();
+            break;
+        }
+        micros.push_back(elapsedMicros(start));
+    }
+    posix_spawn_file_actions_destroy(&actions);
+    return micros;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        fmt::print(stderr, "usage: monkey_server_latency MONKEY PROGRAM [REQUESTS]\n");
+        return 1;
+    }
+    const std::string monkey = argv[1];
+    const std::string program = argv[2];
+    const int requests = argc > 3 ? std::max(1, std::atoi(argv[3])) : 200;
+
+    std::ifstream file(program);
+    if (!file) {
+        fmt::print(stderr, "cannot open {}\n", program);
+        return 1;
+    }
+    std::stringstream source;
+    source << file.rdbuf();
+
+    ServerOptions options;
+    options.socketPath = (std::filesystem::temp_directory_path() /
+                          fmt::format("monkey_server_latency_{}.sock", getpid()))
+                             .string();
+    options.workers = 1;
+    Server server(options);
+    if (auto error = server.listen()) {
+        fmt::print(stderr, "{}\n", *error);
+        return 1;
+    }
+    std::thread loop([&server] { server.run(); });
+    auto served = serverLatencies(options.socketPath, source.str(), requests);
+    server.stop();
+    loop.join();
+
+    auto spawned = processLatencies(monkey, program, requests);
+    if (served.empty() || spawned.empty()) {
+        fmt::print(stderr, "{}: evaluation failed\n", program);
+        return 1;
+    }
+
+    fmt::println("{:<10} {:>12} {:>12} {:>12}", "mode", "mean_us", "p50_us", "p99_us");
+    report("serve", std::move(served));
+    report("process", std::move(spawned));
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,85 @@
+// Parallel throughput of the embedding API: one CompiledProgram shared by N threads,
+// each with its own Interpreter. Prints evaluations per second and the speedup over one
+// thread.
+
+#include "monkey/interpreter.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using namespace monkey;
+
+double evalsPerSecond(const CompiledProgram &program, unsigned threads,
+                      int runsPerThread) {
+    std::atomic<bool> go{false};
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back([&program, &go, runsPerThread] {
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            for (int i = 0; i < runsPerThread; ++i) {
+                Interpreter interpreter;
+                interpreter.run(program);
+            }
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(threads) * runsPerThread / elapsed.count();
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fmt::print(stderr,
+                   "usage: monkey_throughput PROGRAM [RUNS_PER_THREAD] [MAX_THREADS]\n");
+        return 1;
+    }
+
+    std::ifstream file(argv[1]);
+    if (!file) {
+        fmt::print(stderr, "cannot open {}\n", argv[1]);
+        return 1;
+    }
+    std::stringstream source;
+    source << file.rdbuf();
+
+    auto program = compile(source.str());
+    if (!program->ok()) {
+        fmt::print(stderr, "{}: parse errors\n", argv[1]);
+        return 1;
+    }
+
+    const int runs = argc > 2 ? std::max(1, std::atoi(argv[2])) : 20;
+    const unsigned maxThreads =
+        argc > 3 ? static_cast<unsigned>(std::max(1, std::atoi(argv[3])))
+                 : std::max(1U, std::thread::hardware_concurrency());
+
+    fmt::println("{:>7} {:>12} {:>8}", "threads", "evals/s", "speedup");
+    double base = 0;
+    for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+        double rate = evalsPerSecond(*program, threads, runs);
+        base = threads == 1 ? rate : base;
+        fmt::println("{:>7} {:>12.1f} {:>7.2f}x", threads, rate, rate / base);
+    }
+    return 0;
+}
\ No newline at end of file
@@ -1,14 +1,19 @@
 #pragma once
 
 #include "monkey/box.h"
+#include "monkey/output.h"
 #include "monkey/token.h"
 
 #include <fmt/format.h>
 
 #include <concepts>
+#include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <optional>
 #include <string>
 #include <type_traits>
+#include <utility>
 #include <variant>
 #include <vector>
 
@@ -21,6 +26,9 @@ struct IfExpression;
 struct BlockStatement;
 struct FunctionLiteral;
 struct CallExpression;
+struct ArrayLiteral;
+struct IndexExpression;
+struct HashLiteral;
 
 // Leaf expression types definitions
 struct Identifier {
@@ -37,21 +45,30 @@ struct BooleanLiteral {
     bool value = false;
 };
 
+// The text is shared with every String the literal evaluates to, so evaluating it does
+// not copy.
 struct StringLiteral {
     Token token;
-    std::string value;
+    std::shared_ptr<const std::string> value;
 };
 
 using Expression =
     std::variant<Identifier, IntegerLiteral, BooleanLiteral, StringLiteral,
                  Box<PrefixExpression>, Box<InfixExpression>, Box<IfExpression>,
-                 Box<FunctionLiteral>, Box<CallExpression>>;
+                 Box<FunctionLiteral>, Box<CallExpression>, Box<ArrayLiteral>,
+                 Box<IndexExpression>, Box<HashLiteral>>;
+
+// The value of an operator applied to constants, cached by hashCons() (see
+// monkey/hash_cons.h): null, an integer, a boolean or the text of a string.
+using Constant =
+    std::variant<std::nullptr_t, int64_t, bool, std::shared_ptr<const std::string>>;
 
 // Recursive expression types definitions
 struct PrefixExpression {
     Token token;
     std::string op;
     Expression right;
+    std::shared_ptr<const Constant> constant;
 };
 
 struct InfixExpression {
@@ -59,6 +76,7 @@ struct InfixExpression {
     Expression left;
     std::string op;
     Expression right;
+    std::shared_ptr<const Constant> constant;
 };
 
 struct CallExpression {
@@ -67,6 +85,23 @@ struct CallExpression {
     std::vector<Expression> arguments;
 };
 
+struct ArrayLiteral {
+    Token token; // The '[' token
+    std::vector<Expression> elements;
+};
+
+struct IndexExpression {
+    Token token; // The '[' token
+    Expression left;
+    Expression index;
+    std::shared_ptr<const Constant> constant;
+};
+
+struct HashLiteral {
+    Token token; // The '{' token
+    std::vector<std::pair<Expression, Expression>> pairs;
+};
+
 // Statement types definitions
 struct LetStatement {
     Token token;
@@ -79,6 +114,12 @@ struct ReturnStatement {
     Expression value;
 };
 
+// Hands a value to whoever resumed the generator the statement belongs to.
+struct YieldStatement {
+    Token token;
+    Expression value;
+};
+
 // Think of ExpressionStatement as a wrapper for expressions that appear as statements.
 // e.g., 5+5; or add(5, 10);
 struct ExpressionStatement {
@@ -86,8 +127,8 @@ struct ExpressionStatement {
     Expression expression;
 };
 
-using Statement =
-    std::variant<LetStatement, ReturnStatement, ExpressionStatement, BlockStatement>;
+using Statement = std::variant<LetStatement, ReturnStatement, YieldStatement,
+                               ExpressionStatement, BlockStatement>;
 
 struct BlockStatement {
     Token token; // The { token
@@ -105,6 +146,9 @@ struct FunctionLiteral {
     Token token; // The 'fn' token
     std::vector<Identifier> parameters;
     BlockStatement body;
+    // Set by the parser when the body yields (see yields()); calling the function then
+    // returns a Generator instead of running the body.
+    bool generator = false;
 };
 
 // Program is the root node of the AST
@@ -143,8 +187,25 @@ std::string tokenLiteral(const Variant auto &var) {
     return std::visit([](const auto &s) { return tokenLiteral(s); }, var);
 }
 
-std::string toString(const Program &program);
-std::string toString(const Expression &expr);
-std::string toString(const Statement &stmt);
+// Whether `statement` yields at statement level: it is a yield statement, or a block or
+// an if statement with one among its statements. Yields nested deeper in an expression or
+// inside a function literal do not count.
+bool yields(const Statement &statement);
+bool yields(const BlockStatement &block);
+
+// The source text of a node, fully parenthesized, cut to `limit` bytes and
+// BoundedOutput::TRUNCATED if it is longer.
+std::string toString(const Program &program,
+                     size_t limit = BoundedOutput::UNLIMITED);
+std::string toString(const Expression &expr,
+                     size_t limit = BoundedOutput::UNLIMITED);
+std::string toString(const Statement &stmt,
+                     size_t limit = BoundedOutput::UNLIMITED);
+
+// Append the same text to `out`, and stop walking the tree once `out` is truncated.
+void print(BoundedOutput &out, const Program &program);
+void print(BoundedOutput &out, const Expression &expr);
+void print(BoundedOutput &out, const Statement &stmt);
+void print(BoundedOutput &out, const BlockStatement &block);
 
 } // namespace monkey
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "monkey/interpreter.h"
+
+#include <chrono>
+#include <cstddef>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace monkey {
+
+struct BatchOptions {
+    size_t jobs = std::thread::hardware_concurrency();
+    InterpreterOptions interpreter; // limits applied to every script
+};
+
+struct ScriptResult {
+    std::string path;
+    std::string output; // inspect() of the result, or the error message
+    bool ok = false;
+    bool cached = false; // parsed by an earlier script with identical source
+    std::chrono::nanoseconds parseTime{0};
+    std::chrono::nanoseconds evalTime{0};
+};
+
+struct BatchReport {
+    std::vector<ScriptResult> scripts; // in input order
+    size_t uniquePrograms = 0;
+    size_t jobs = 0;
+    size_t steals = 0;
+    std::chrono::nanoseconds wallTime{0};
+};
+
+// Evaluates every script on a work-stealing pool of `options.jobs` workers, each script
+// in its own Interpreter. Scripts with identical source are parsed once.
+BatchReport runBatch(std::span<const std::string> paths,
+                     const BatchOptions &options = {});
+
+// One row per script (parse and eval time in microseconds) followed by a summary line.
+std::string timingTable(const BatchReport &report);
+
+} // namespace monkey
\ No newline at end of file
@@ -1,34 +1,151 @@
 #pragma once
 
+#include "monkey/memory.h"
+
+#include <atomic>
+#include <cstddef>
 #include <memory>
+#include <utility>
+
+namespace monkey {
 
+// Destroys heap cells one after another instead of nested inside each other. A cell
+// released while another one is being destroyed (say, a child of an AST node) is queued
+// and destroyed once the outer destruction returns, so dropping a deeply nested tree or
+// value costs heap rather than stack.
+void reclaim(void *cell, void (*destroy)(void *));
+
+// A T and the allocator that paid for it, for makeReclaimed().
+template <typename T>
+struct ReclaimedCell {
+    template <typename... Args>
+    explicit ReclaimedCell(AccountingAllocator<ReclaimedCell> alloc, Args &&...args)
+        : value(std::forward<Args>(args)...), allocator(alloc) {}
+
+    static void destroy(void *cell) {
+        auto *self = static_cast<ReclaimedCell *>(cell);
+        auto alloc = self->allocator;
+        std::destroy_at(self);
+        alloc.deallocate(self, 1);
+    }
+
+    T value;
+    AccountingAllocator<ReclaimedCell> allocator;
+};
+
+// Like std::allocate_shared with an AccountingAllocator, except that the object is
+// destroyed through monkey::reclaim once its last owner lets go. For shared cells that
+// values can nest through, such as array nodes and hash tables.
+template <typename T, typename... Args>
+std::shared_ptr<T> makeReclaimed(Args &&...args) {
+    using Cell = ReclaimedCell<T>;
+    AccountingAllocator<Cell> allocator;
+    Cell *cell = allocator.allocate(1);
+    try {
+        std::construct_at(cell, allocator, std::forward<Args>(args)...);
+    } catch (...) {
+        allocator.deallocate(cell, 1);
+        throw;
+    }
+    // If allocating the control block throws, the deleter still frees the cell.
+    std::shared_ptr<Cell> owner(
+        cell, [](Cell *dead) { reclaim(dead, &Cell::destroy); }, allocator);
+    return std::shared_ptr<T>(std::move(owner), &cell->value);
+}
+
+} // namespace monkey
+
+// Value-semantic heap cell for recursive types. Copies share the cell and bump a
+// reference count; mutable access to a shared cell first detaches a private copy
+// (copy-on-write), so copying a Box (and the AST or Function it holds) is O(1). Cells are
+// allocated through AccountingAllocator and charge the MemoryAccount bound at allocation
+// time, and are destroyed through monkey::reclaim.
 template <typename T>
 class Box {
   public:
     Box(T &&obj) // NOLINT(google-explicit-constructor)
                  // for easier construction of Box<T>
-        : ptr_(std::make_unique<T>(std::move(obj))) {}
+        : node_(Node::make(std::move(obj))) {}
     Box(const T &obj) // NOLINT(google-explicit-constructor)
                       // for easier construction of Box<T>
-        : ptr_(std::make_unique<T>(obj)) {}
+        : node_(Node::make(obj)) {}
 
-    Box(const Box &other) : Box(*other.ptr_) {}
+    Box(const Box &other) noexcept : node_(other.node_) { node_->retain(); }
     Box &operator=(const Box &other) {
-        if (this == &other) {
-            return *this;
-        }
-        *ptr_ = *other.ptr_;
+        Box copy(other);
+        std::swap(node_, copy.node_);
         return *this;
     }
 
-    Box(Box &&) noexcept = default;
-    Box &operator=(Box &&) noexcept = default;
+    Box(Box &&other) noexcept : node_(std::exchange(other.node_, nullptr)) {}
+    Box &operator=(Box &&other) noexcept {
+        std::swap(node_, other.node_);
+        return *this;
+    }
 
-    ~Box() = default;
+    ~Box() {
+        if (node_ != nullptr) {
+            node_->release();
+        }
+    }
 
-    auto &&operator*(this auto &&self) { return *self.ptr_; }
-    auto operator->(this auto &&self) { return self.ptr_.get(); }
+    T &operator*() {
+        detach();
+        return node_->value;
+    }
+    const T &operator*() const { return node_->value; }
+    T *operator->() {
+        detach();
+        return &node_->value;
+    }
+    const T *operator->() const { return &node_->value; }
 
   private:
-    std::unique_ptr<T> ptr_;
+    struct Node {
+        template <typename U>
+        explicit Node(monkey::AccountingAllocator<Node> alloc, U &&obj)
+            : value(std::forward<U>(obj)), allocator(alloc) {}
+
+        template <typename U>
+        static Node *make(U &&obj) {
+            monkey::AccountingAllocator<Node> allocator;
+            Node *node = allocator.allocate(1);
+            try {
+                std::construct_at(node, allocator, std::forward<U>(obj));
+            } catch (...) {
+                allocator.deallocate(node, 1);
+                throw;
+            }
+            return node;
+        }
+
+        void retain() { refs.fetch_add(1, std::memory_order_relaxed); }
+
+        void release() {
+            if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                monkey::reclaim(this, &destroy);
+            }
+        }
+
+        static void destroy(void *cell) {
+            auto *node = static_cast<Node *>(cell);
+            auto alloc = node->allocator;
+            std::destroy_at(node);
+            alloc.deallocate(node, 1);
+        }
+
+        T value;
+        std::atomic<size_t> refs{1};
+        monkey::AccountingAllocator<Node> allocator;
+    };
+
+    void detach() {
+        if (node_->refs.load(std::memory_order_acquire) != 1) {
+            Node *copy = Node::make(std::as_const(node_->value));
+            node_->release();
+            node_ = copy;
+        }
+    }
+
+    Node *node_;
 };
\ No newline at end of file
@@ -0,0 +1,166 @@
+#pragma once
+
+#include "monkey/memory.h"
+#include "monkey/object.h"
+#include "monkey/trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <span>
+#include <utility>
+
+namespace monkey {
+
+// Evaluation policy that bounds a script by fuel, wall-clock time and optionally memory.
+// One unit of fuel is spent per statement and per function application. The fuel is
+// shared with the budgets of the tasks the script spawns (fork()), and each budget takes
+// it from the shared counter FUEL_BATCH units at a time, so a step costs a decrement and
+// a predictable branch. The clock is only read every CLOCK_INTERVAL units. The memory
+// quota is enforced by the account itself, which refuses the allocation that would exceed
+// it; the next step then fails as well, so that tasks and builtins that carry on after
+// the refusal stop too. Once exhausted, every further step fails, in the tasks as well,
+// so the evaluation unwinds with the Error.
+class Budget {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr uint64_t UNLIMITED = std::numeric_limits<uint64_t>::max();
+    static constexpr uint64_t CLOCK_INTERVAL = 1024;
+    static constexpr uint64_t FUEL_BATCH = 1024;
+
+    explicit Budget(uint64_t fuel = UNLIMITED,
+                    Clock::time_point deadline = Clock::time_point::max())
+        : shared_(std::make_shared<Fuel>(fuel)), deadline_(deadline) {}
+
+    // A copy shares the fuel, but not the units this budget has taken and not spent yet.
+    Budget(const Budget &other)
+        : shared_(other.shared_), used_(other.used_), deadline_(other.deadline_),
+          account_(other.account_), refusals_(other.refusals_) {}
+    Budget &operator=(const Budget &other) {
+        Budget copy(other);
+        swap(copy);
+        return *this;
+    }
+    Budget(Budget &&other) noexcept { swap(other); }
+    Budget &operator=(Budget &&other) noexcept {
+        swap(other);
+        return *this;
+    }
+    // Gives back the fuel taken and not spent.
+    ~Budget() {
+        if (shared_ != nullptr && fuel_ > 0) {
+            shared_->left.fetch_add(fuel_, std::memory_order_relaxed);
+        }
+    }
+
+    static Budget withTimeout(Clock::duration timeout, uint64_t fuel = UNLIMITED) {
+        return Budget(fuel, Clock::now() + timeout);
+    }
+
+    // Fail once `account` (bound with a MemoryScope around the evaluation) refuses an
+    // allocation.
+    Budget &limitMemory(const MemoryAccount &account) {
+        account_ = &account;
+        refusals_ = account.refusals();
+        return *this;
+    }
+
+    // The budget of a task spawned under this one: the same deadline and memory quota,
+    // and the same fuel, so spawning does not multiply what a script may spend.
+    [[nodiscard]] Budget fork() const {
+        Budget child(*this);
+        child.used_ = 0;
+        return child;
+    }
+
+    std::optional<Error> onStep() {
+        if (fuel_ == 0 && !refuel()) {
+            return Error{"evaluation ran out of fuel"};
+        }
+        if (account_ != nullptr && account_->refusals() != refusals_) {
+            stop();
+            return Error{"evaluation exceeded its memory quota"};
+        }
+        --fuel_;
+        ++used_;
+        if (--untilClockCheck_ == 0) {
+            untilClockCheck_ = CLOCK_INTERVAL;
+            if (Clock::now() >= deadline_) {
+                stop();
+                return Error{"evaluation deadline exceeded"};
+            }
+        }
+        return std::nullopt;
+    }
+
+    void onStatement(const Statement & /*stmt*/) {}
+    void onCall(const CallExpression & /*call*/, const Function & /*fn*/,
+                std::span<const Object> /*args*/) {}
+    void onReturn(const CallExpression & /*call*/, const Object & /*result*/) {}
+    void onError(const Error & /*err*/) {}
+
+    // Spent by this budget, not counting its forks.
+    [[nodiscard]] uint64_t fuelUsed() const { return used_; }
+    [[nodiscard]] bool exhausted() const {
+        return fuel_ == 0 && (shared_->stopped.load(std::memory_order_relaxed) ||
+                              shared_->left.load(std::memory_order_relaxed) == 0);
+    }
+
+  private:
+    // The fuel a budget and its forks have not taken yet. Once stopped, nothing more is
+    // handed out, whatever is given back.
+    struct Fuel {
+        explicit Fuel(uint64_t fuel) : left(fuel) {}
+        std::atomic<uint64_t> left;
+        std::atomic<bool> stopped{false};
+    };
+
+    bool refuel() {
+        if (shared_->stopped.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        auto left = shared_->left.load(std::memory_order_relaxed);
+        uint64_t batch = 0;
+        do {
+            batch = std::min(left, FUEL_BATCH);
+        } while (batch > 0 && !shared_->left.compare_exchange_weak(
+                                  left, left - batch, std::memory_order_relaxed));
+        fuel_ = batch;
+        return batch > 0;
+    }
+
+    void stop() {
+        fuel_ = 0;
+        shared_->stopped.store(true, std::memory_order_relaxed);
+    }
+
+    void swap(Budget &other) noexcept {
+        std::swap(shared_, other.shared_);
+        std::swap(fuel_, other.fuel_);
+        std::swap(used_, other.used_);
+        std::swap(untilClockCheck_, other.untilClockCheck_);
+        std::swap(deadline_, other.deadline_);
+        std::swap(account_, other.account_);
+        std::swap(refusals_, other.refusals_);
+    }
+
+    std::shared_ptr<Fuel> shared_;
+    // Taken from shared_ and not spent yet.
+    uint64_t fuel_{0};
+    uint64_t used_{0};
+    uint64_t untilClockCheck_{CLOCK_INTERVAL};
+    Clock::time_point deadline_{Clock::time_point::max()};
+    const MemoryAccount *account_{nullptr};
+    // The refusals of the account before the evaluation started.
+    size_t refusals_{0};
+};
+
+static_assert(EvalPolicy<Budget>);
+
+} // namespace monkey
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "monkey/ast.h"
+#include "monkey/object.h"
+
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace monkey {
+
+class Environment;
+class TaskGroup;
+
+// What a builtin may ask of the evaluator that called it.
+class CallContext {
+  public:
+    // Applies a Function or Builtin under the caller's evaluation policy.
+    using Applier = std::function<Object(const Object &fn, std::span<const Object> args)>;
+
+    CallContext() = default;
+    CallContext(const CallContext &) = delete;
+    CallContext &operator=(const CallContext &) = delete;
+
+    // Applies `fn` to `args` on the calling thread.
+    virtual Object apply(const Object &fn, std::span<const Object> args) = 0;
+    // Evaluates one node in `env` on the calling thread. Generators run their body
+    // through these, a statement at a time, under the policy of whoever resumed them.
+    virtual Object evaluate(const Statement &statement,
+                            const std::shared_ptr<Environment> &env) = 0;
+    virtual Object evaluate(const Expression &expression,
+                            const std::shared_ptr<Environment> &env) = 0;
+    // An Applier for another thread. It has its own copy of the policy (a Budget keeps
+    // the deadline and memory quota, a Tracer is not carried over) and charges the
+    // caller's heap. Fork once per task; an Applier must not be shared between threads.
+    virtual Applier fork() = 0;
+    // The group that tasks spawned by this evaluation belong to.
+    virtual TaskGroup &tasks() = 0;
+    // Builds an Error and reports it to the policy; builtins create every Error here.
+    virtual Error fail(std::string message) = 0;
+
+  protected:
+    ~CallContext() = default;
+};
+
+// The builtin named `name`, or nullptr. Bindings in the environment shadow builtins.
+const Builtin *lookupBuiltin(std::string_view name);
+
+} // namespace monkey
\ No newline at end of file
@@ -1,9 +1,14 @@
 #pragma once
 
+#include "monkey/memory.h"
 #include "monkey/object.h"
+#include "monkey/stats.h"
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <optional>
+#include <shared_mutex>
 #include <string>
 #include <unordered_map>
 
@@ -12,16 +17,42 @@ namespace monkey {
 class Environment {
   public:
     explicit Environment(std::shared_ptr<Environment> outer = nullptr)
-        : outer_(std::move(outer)) {}
+        : outer_(std::move(outer)) {
+        stats::recordEnvironment(sizeof(Environment));
+    }
 
     std::optional<Object> get(const std::string &name) const;
     void set(const std::string &name, Object value);
 
+    // Makes this frame and its outer frames safe to read from other threads while their
+    // owner keeps binding names, e.g. the globals a spawned task looks up while the
+    // script continues with `let`. Frames nobody shared skip the lock.
+    void share();
+
+    [[nodiscard]] const std::shared_ptr<Environment> &outer() const { return outer_; }
+    // How many times a name was bound in this frame, not counting its outer frames.
+    // Memo tables compare it to tell whether the names a function reads were rebound.
+    [[nodiscard]] uint64_t version() const {
+        return version_.load(std::memory_order_relaxed);
+    }
+
   private:
-    std::unordered_map<std::string, Object> store_;
+    using Store =
+        std::unordered_map<std::string, Object, std::hash<std::string>,
+                           std::equal_to<std::string>,
+                           AccountingAllocator<std::pair<const std::string, Object>>>;
+
+    Store store_;
     std::shared_ptr<Environment> outer_;
+    // Set before the frame is published to a task, so a relaxed load suffices.
+    std::atomic<bool> shared_{false};
+    // Only bumped by the thread binding the name, under the lock if the frame is shared.
+    std::atomic<uint64_t> version_{0};
+    mutable std::shared_mutex mutex_;
 };
 
-std::shared_ptr<Environment> makeEnvironment();
+// Frames and their bindings are charged to the MemoryAccount bound to the thread.
+std::shared_ptr<Environment>
+makeEnvironment(std::shared_ptr<Environment> outer = nullptr);
 
 } // namespace monkey
\ No newline at end of file
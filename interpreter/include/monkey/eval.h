@@ -1,14 +1,22 @@
 #pragma once
 
 #include "monkey/ast.h"
+#include "monkey/budget.h"
 #include "monkey/env.h"
 #include "monkey/object.h"
+#include "monkey/trace.h"
 
 #include <memory>
 
 namespace monkey {
 
 Object eval(const Program &program, const std::shared_ptr<Environment> &env);
+// Same evaluation, additionally recording every hook into `tracer`.
+Object eval(const Program &program, const std::shared_ptr<Environment> &env,
+            Tracer &tracer);
+// Same evaluation, failing with an Error once `budget` runs out of fuel or time.
+Object eval(const Program &program, const std::shared_ptr<Environment> &env,
+            Budget &budget);
 Object eval(const Statement &statement, const std::shared_ptr<Environment> &env);
 Object eval(const Expression &expression, const std::shared_ptr<Environment> &env);
 
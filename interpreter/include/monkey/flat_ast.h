@@ -0,0 +1,114 @@
+#pragma once
+
+#include "monkey/ast.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace monkey {
+
+// One kind of node per type of Expression and Statement.
+enum class NodeKind : uint8_t {
+    IDENTIFIER,
+    INTEGER,
+    BOOLEAN,
+    STRING,
+    PREFIX,
+    INFIX,
+    IF,
+    FUNCTION,
+    CALL,
+    ARRAY,
+    INDEX,
+    HASH,
+    LET,
+    RETURN,
+    YIELD,
+    EXPRESSION,
+    BLOCK,
+};
+
+// The index of a node in a FlatAst.
+using NodeIndex = uint32_t;
+constexpr NodeIndex NO_NODE = std::numeric_limits<NodeIndex>::max();
+
+// A run of `count` entries of FlatAst::lists from `first`.
+struct NodeList {
+    uint32_t first;
+    uint32_t count;
+};
+
+// A Program laid out in arrays instead of a tree of Box cells. Nodes are numbered in
+// post-order, so every node comes after its children and the nodes of a subtree are
+// contiguous; `kinds` says what each node is and `slots` where its fields are in the
+// arrays of its kind. Children are NodeIndexes, and nodes with any number of them keep
+// a NodeList into `lists`. Identifiers, operators and strings are indices into `texts`,
+// which holds each distinct text once.
+//
+// A pass that wants children before parents, such as computing the length of each
+// node's text in toString(), is a loop over the nodes in order; one that wants parents
+// first is the same loop backwards. Neither needs a stack.
+struct FlatAst {
+    std::vector<NodeKind> kinds;
+    std::vector<uint32_t> slots;
+    std::vector<uint32_t> lists;
+    std::vector<std::string> texts;
+    NodeList statements{}; // the top-level statements
+
+    std::vector<uint32_t> identifiers; // text
+    std::vector<int64_t> integers;
+    std::vector<uint8_t> booleans;
+    std::vector<uint32_t> strings; // text
+    struct {
+        std::vector<uint32_t> op; // text
+        std::vector<NodeIndex> right;
+    } prefixes;
+    struct {
+        std::vector<uint32_t> op; // text
+        std::vector<NodeIndex> left;
+        std::vector<NodeIndex> right;
+    } infixes;
+    struct {
+        std::vector<NodeIndex> condition;
+        std::vector<NodeIndex> consequence; // a BLOCK
+        std::vector<NodeIndex> alternative; // a BLOCK, or NO_NODE
+    } ifs;
+    struct {
+        std::vector<NodeList> parameters; // texts
+        std::vector<NodeIndex> body;      // a BLOCK
+        std::vector<uint8_t> generator;
+    } functions;
+    struct {
+        std::vector<NodeIndex> function;
+        std::vector<NodeList> arguments;
+    } calls;
+    std::vector<NodeList> arrays; // elements
+    struct {
+        std::vector<NodeIndex> left;
+        std::vector<NodeIndex> index;
+    } indexes;
+    std::vector<NodeList> hashes; // keys and values, alternating
+    struct {
+        std::vector<uint32_t> name; // text
+        std::vector<NodeIndex> value;
+    } lets;
+    std::vector<NodeIndex> returns;     // value
+    std::vector<NodeIndex> yields;      // value
+    std::vector<NodeIndex> expressions; // expression
+    std::vector<NodeList> blocks;       // statements
+
+    // Lays out `program`, which must have fewer than NO_NODE nodes; a program parsed
+    // from less than 4 GiB of source does.
+    static FlatAst from(const Program &program);
+
+    [[nodiscard]] size_t size() const { return kinds.size(); }
+};
+
+// The same text as toString() of the Program the FlatAst was laid out from, except that
+// integers are written as their value (so `007` reads `7`).
+std::string toString(const FlatAst &ast);
+
+} // namespace monkey
\ No newline at end of file
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "monkey/box.h"
+#include "monkey/object.h"
+
+#include <atomic>
+#include <coroutine>
+#include <functional>
+#include <memory>
+#include <optional>
+
+namespace monkey {
+
+class CallContext;
+
+// Generators: calling a function whose body contains a `yield` statement binds the
+// arguments and returns a Generator without running the body. Each next() resumes the
+// body up to its next `yield` and returns the yielded value.
+//
+// The body runs in a C++20 coroutine frame that walks the statements with an explicit
+// stack of blocks, so the evaluator's own recursion never has to be suspended: statements
+// without a yield are handed whole to the evaluator of the caller that resumed the
+// generator (CallContext::evaluate), and yields are only allowed where the walker can see
+// them, as statements of the body, of its nested blocks and of its if branches.
+//
+// A generator whose body finishes by returning another generator continues with that
+// generator's values, taking over its frame. Recursive streams such as
+// `let from = fn(i) { yield i; from(i + 1) }` therefore run in constant space.
+class GeneratorState {
+  public:
+    // Produces the values of a generator implemented by the host; nullopt ends it.
+    using Source = std::function<std::optional<Object>()>;
+
+    // `env` is the call frame holding the arguments; `function` keeps the body alive.
+    GeneratorState(Box<Function> function, std::shared_ptr<Environment> env);
+    // A generator over the values of `source`, e.g. the lines of a file.
+    explicit GeneratorState(Source source);
+    GeneratorState(const GeneratorState &) = delete;
+    GeneratorState &operator=(const GeneratorState &) = delete;
+    ~GeneratorState();
+
+    // The next yielded value, or nullopt once the body finished. An Error raised by the
+    // body is returned once and finishes the generator, as does an exception such as
+    // MemoryQuotaExceeded, which is passed on. Resuming a generator that is already
+    // running (from its own body, or from another task) is an Error.
+    std::optional<Object> next(CallContext &context);
+
+    // Prepares the generator for use from another thread (see monkey/task.h).
+    void share();
+
+  private:
+    std::optional<Object> advance(CallContext &context);
+    void adopt(GeneratorState &inner);
+
+    std::coroutine_handle<> frame_;
+    std::shared_ptr<Environment> env_;
+    // Set when the body returned a generator that is also referenced elsewhere, so its
+    // frame could not be taken over.
+    std::shared_ptr<GeneratorState> delegate_;
+    std::atomic<bool> running_{false};
+    std::atomic<bool> shared_{false};
+};
+
+} // namespace monkey
\ No newline at end of file
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "monkey/ast.h"
+
+#include <cstddef>
+
+namespace monkey {
+
+struct HashConsStats {
+    size_t nodes = 0;     // boxed nodes visited
+    size_t shared = 0;    // of them, replaced by an identical node seen before
+    size_t constants = 0; // distinct nodes whose value was cached
+};
+
+// Hash-consing: turns the tree of `program` into a DAG in which structurally identical
+// subtrees are one Box cell, and string literals with the same text share it. Nodes are
+// visited children first, so two nodes are identical when their tokens and leaves are
+// equal and their boxed children are the same cells; a table of the distinct nodes
+// finds the cell each node is replaced by.
+//
+// Prefix, infix and index expressions whose operands are literals, cached constants, or
+// array and hash literals of those are evaluated once, and their value is kept in the
+// node's `constant` if it is null, an integer, a boolean or a string; the evaluator
+// then uses it without evaluating the operands. Errors, such as a division by zero, are
+// not cached, so they are still reported when the expression runs.
+// Arrays and hashes are not cached either, as values are allocated on the heap of the
+// interpreter that runs the program.
+//
+// The program must not be shared yet: compile() runs this before it hands the program
+// out, when asked to (CompileOptions::hashCons). Printing the program gives the same
+// text as before.
+HashConsStats hashCons(Program &program);
+
+} // namespace monkey
\ No newline at end of file
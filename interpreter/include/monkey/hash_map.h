@@ -0,0 +1,231 @@
+#pragma once
+
+#include "monkey/memory.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace monkey {
+
+namespace swiss {
+
+// One control byte per slot: EMPTY, or the low 7 bits of the hash of the key in the slot
+// (h2). Entries are never erased, so there is no tombstone.
+using Control = int8_t;
+constexpr Control EMPTY = -128;
+
+// Slots of a Group whose control byte matched, lowest first.
+class BitMask {
+  public:
+    // `shift` converts a bit index to a slot index.
+    BitMask(uint64_t bits, unsigned shift) : bits_(bits), shift_(shift) {}
+
+    explicit operator bool() const { return bits_ != 0; }
+    [[nodiscard]] size_t lowest() const {
+        return static_cast<size_t>(std::countr_zero(bits_)) >> shift_;
+    }
+    void dropLowest() { bits_ &= bits_ - 1; }
+
+  private:
+    uint64_t bits_;
+    unsigned shift_;
+};
+
+#if defined(__SSE2__)
+// 16 control bytes compared at once, one bit of the mask per slot.
+class Group {
+  public:
+    static constexpr size_t WIDTH = 16;
+
+    explicit Group(const Control *controls)
+        : controls_(_mm_loadu_si128(reinterpret_cast<const __m128i *>(controls))) {}
+
+    [[nodiscard]] BitMask match(Control h2) const {
+        return mask(_mm_cmpeq_epi8(controls_, _mm_set1_epi8(h2)));
+    }
+    // EMPTY is the only control byte with the sign bit set.
+    [[nodiscard]] BitMask matchEmpty() const { return mask(controls_); }
+
+  private:
+    static BitMask mask(__m128i bytes) {
+        return {static_cast<uint32_t>(_mm_movemask_epi8(bytes)), 0};
+    }
+
+    __m128i controls_;
+};
+#else
+// 8 control bytes in a word, compared with bit tricks; the mask has the top bit of each
+// matching byte. match() may report a false positive next to a true one, which the key
+// comparison weeds out.
+class Group {
+  public:
+    static constexpr size_t WIDTH = 8;
+
+    explicit Group(const Control *controls) {
+        std::memcpy(&controls_, controls, sizeof controls_);
+        if constexpr (std::endian::native == std::endian::big) {
+            controls_ = std::byteswap(controls_);
+        }
+    }
+
+    [[nodiscard]] BitMask match(Control h2) const {
+        auto x = controls_ ^ (LSBS * static_cast<uint8_t>(h2));
+        return {(x - LSBS) & ~x & MSBS, 3};
+    }
+    [[nodiscard]] BitMask matchEmpty() const { return {controls_ & MSBS, 3}; }
+
+  private:
+    static constexpr uint64_t LSBS = 0x0101010101010101;
+    static constexpr uint64_t MSBS = 0x8080808080808080;
+
+    uint64_t controls_;
+};
+#endif
+
+} // namespace swiss
+
+// Open-addressing hash map in the layout of Abseil's Swiss tables: slots are probed a
+// group of 16 (SSE2) or 8 at a time by comparing a byte of the hash against each slot's
+// control byte, so a lookup usually touches one group of control bytes and one entry.
+// The slots hold indices into a dense array of entries, which keeps them in insertion
+// order. Entries cannot be erased; inserting an existing key replaces its value.
+//
+// `Hasher` must return well-mixed 64-bit hashes, since both the group (high bits) and
+// the control byte (low 7 bits) come from them. Storage is allocated through
+// AccountingAllocator.
+template <typename Key, typename Value, typename Hasher, typename KeyEqual>
+class SwissMap {
+  public:
+    using Entry = std::pair<Key, Value>;
+
+    SwissMap() = default;
+    explicit SwissMap(size_t expected) { reserve(expected); }
+
+    [[nodiscard]] size_t size() const { return entries_.size(); }
+    [[nodiscard]] bool empty() const { return entries_.empty(); }
+    [[nodiscard]] std::span<const Entry> entries() const { return entries_; }
+
+    void reserve(size_t expected) {
+        entries_.reserve(expected);
+        // Keep the load at most 7/8.
+        auto capacity = std::bit_ceil(std::max(expected + expected / 7, Group::WIDTH));
+        if (capacity > controls_.size()) {
+            rehash(capacity);
+        }
+    }
+
+    // Returns false if `key` was present; its value is replaced.
+    bool insert(Key key, Value value) {
+        if ((entries_.size() + 1) * 8 > controls_.size() * 7) {
+            rehash(std::max(controls_.size() * 2, Group::WIDTH));
+        }
+        // One probe both looks for the key and finds the slot for it: without erasure,
+        // the first empty slot on the path is in the group where a lookup stops.
+        auto hash = Hasher{}(key);
+        bool inserted = false;
+        probe(hash, [&](size_t first) {
+            const Group group(&controls_[first]);
+            for (auto match = group.match(h2(hash)); match; match.dropLowest()) {
+                auto &entry = entries_[slots_[first + match.lowest()]];
+                if (KeyEqual{}(entry.first, key)) {
+                    entry.second = std::move(value);
+                    return true;
+                }
+            }
+            auto empty = group.matchEmpty();
+            if (!empty) {
+                return false;
+            }
+            auto slot = first + empty.lowest();
+            controls_[slot] = h2(hash);
+            slots_[slot] = static_cast<uint32_t>(entries_.size());
+            entries_.emplace_back(std::move(key), std::move(value));
+            inserted = true;
+            return true;
+        });
+        return inserted;
+    }
+
+    [[nodiscard]] const Value *find(const Key &key) const {
+        const auto *entry = findEntry(*this, key);
+        return entry != nullptr ? &entry->second : nullptr;
+    }
+
+  private:
+    using Group = swiss::Group;
+    using Control = swiss::Control;
+
+    // Visits the groups an entry with `hash` may be in, in probe order, until `visit`
+    // returns true. The triangular steps reach every group of a power-of-two table.
+    template <typename Visitor>
+    void probe(uint64_t hash, Visitor &&visit) const {
+        auto groups = controls_.size() / Group::WIDTH;
+        auto group = (hash >> 7) & (groups - 1);
+        for (size_t step = 1; !visit(group * Group::WIDTH); ++step) {
+            group = (group + step) & (groups - 1);
+        }
+    }
+
+    static Control h2(uint64_t hash) { return static_cast<Control>(hash & 0x7F); }
+
+    // The entry with `key` in `self`, const or not, or nullptr.
+    template <typename Self>
+    static auto findEntry(Self &self, const Key &key) -> decltype(&self.entries_[0]) {
+        if (self.entries_.empty()) {
+            return nullptr;
+        }
+        auto hash = Hasher{}(key);
+        decltype(&self.entries_[0]) found = nullptr;
+        self.probe(hash, [&](size_t first) {
+            const Group group(&self.controls_[first]);
+            for (auto match = group.match(h2(hash)); match; match.dropLowest()) {
+                auto &entry = self.entries_[self.slots_[first + match.lowest()]];
+                if (KeyEqual{}(entry.first, key)) {
+                    found = &entry;
+                    return true;
+                }
+            }
+            // An empty slot ends the probe: an insert would have used it.
+            return static_cast<bool>(group.matchEmpty());
+        });
+        return found;
+    }
+
+    // Puts entry `index` in the first empty slot on the probe path of `hash`.
+    void place(uint64_t hash, uint32_t index) {
+        probe(hash, [&](size_t first) {
+            auto empty = Group(&controls_[first]).matchEmpty();
+            if (!empty) {
+                return false;
+            }
+            auto slot = first + empty.lowest();
+            controls_[slot] = h2(hash);
+            slots_[slot] = index;
+            return true;
+        });
+    }
+
+    void rehash(size_t capacity) {
+        controls_.assign(capacity, swiss::EMPTY);
+        slots_.resize(capacity);
+        for (size_t i = 0; i < entries_.size(); ++i) {
+            place(Hasher{}(entries_[i].first), static_cast<uint32_t>(i));
+        }
+    }
+
+    std::vector<Entry, AccountingAllocator<Entry>> entries_;
+    std::vector<Control, AccountingAllocator<Control>> controls_;
+    std::vector<uint32_t, AccountingAllocator<uint32_t>> slots_;
+};
+
+} // namespace monkey
\ No newline at end of file
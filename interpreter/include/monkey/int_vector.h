@@ -0,0 +1,103 @@
+#pragma once
+
+#include "monkey/memory.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace monkey {
+
+// Immutable vector of integers in one contiguous buffer, so that kernels such as those
+// in monkey/simd.h can stream over it. Copies and rest() share the buffer. push() writes
+// into the spare capacity of the buffer when the vector ends where the buffer's
+// elements do, and no other vector has claimed that slot first; otherwise it copies
+// into a buffer twice the size. So pushing onto the latest version is amortized O(1),
+// and pushing onto an older one copies it.
+//
+// An element is never written after it is claimed, and every vector only reads the
+// elements it has claimed, so vectors may be read from any thread. Buffers are allocated
+// through AccountingAllocator.
+class IntVector {
+  public:
+    IntVector() = default;
+
+    static IntVector from(std::span<const int64_t> values) {
+        return build(values.size(), [values](int64_t *out) {
+            std::ranges::copy(values, out);
+            return values.size();
+        });
+    }
+
+    // A vector of the first `fill(out)` elements that `fill` wrote to `out`, which has
+    // room for `capacity`.
+    template <typename Fill>
+    static IntVector build(size_t capacity, Fill &&fill) {
+        IntVector result;
+        if (capacity == 0) {
+            return result;
+        }
+        result.buffer_ = makeBuffer(capacity);
+        auto count = fill(result.buffer_->values.data());
+        result.buffer_->used.store(count, std::memory_order_relaxed);
+        result.end_ = count;
+        return result;
+    }
+
+    [[nodiscard]] size_t size() const { return end_ - start_; }
+    [[nodiscard]] bool empty() const { return end_ == start_; }
+    [[nodiscard]] int64_t operator[](size_t index) const {
+        return buffer_->values[start_ + index];
+    }
+    [[nodiscard]] std::span<const int64_t> values() const {
+        if (!buffer_) {
+            return {};
+        }
+        return std::span<const int64_t>(buffer_->values).subspan(start_, size());
+    }
+
+    [[nodiscard]] IntVector push(int64_t value) const {
+        auto claimed = end_;
+        if (buffer_ && end_ < buffer_->values.size() &&
+            buffer_->used.compare_exchange_strong(claimed, end_ + 1)) {
+            buffer_->values[end_] = value;
+            return {buffer_, start_, end_ + 1};
+        }
+        auto current = values();
+        return build(std::max<size_t>(current.size() * 2, 8), [&](int64_t *out) {
+            std::ranges::copy(current, out);
+            out[current.size()] = value;
+            return current.size() + 1;
+        });
+    }
+
+    // All elements but the first; the vector must not be empty.
+    [[nodiscard]] IntVector rest() const { return {buffer_, start_ + 1, end_}; }
+
+  private:
+    struct Buffer {
+        explicit Buffer(size_t capacity) : values(capacity) {}
+
+        // Elements claimed by some vector; the rest of `values` is spare capacity.
+        std::atomic<size_t> used{0};
+        std::vector<int64_t, AccountingAllocator<int64_t>> values;
+    };
+
+    IntVector(std::shared_ptr<Buffer> buffer, size_t start, size_t end)
+        : buffer_(std::move(buffer)), start_(start), end_(end) {}
+
+    static std::shared_ptr<Buffer> makeBuffer(size_t capacity) {
+        return std::allocate_shared<Buffer>(AccountingAllocator<Buffer>(), capacity);
+    }
+
+    std::shared_ptr<Buffer> buffer_;
+    size_t start_ = 0;
+    size_t end_ = 0;
+};
+
+} // namespace monkey
\ No newline at end of file
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "monkey/ast.h"
+#include "monkey/env.h"
+#include "monkey/memory.h"
+#include "monkey/object.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace monkey {
+
+// Embedding API.
+//
+// Thread safety: a CompiledProgram is immutable after compile() and may be shared by any
+// number of threads without locking. An Interpreter owns its globals and its heap
+// (MemoryAccount) and must only be used by one thread at a time; run one Interpreter per
+// worker thread. Objects returned by an Interpreter live on its heap and must not outlive
+// it or be handed to another Interpreter. Tasks a script spawns (monkey/task.h) run on
+// the shared scheduler, but run() only returns once all of them have finished.
+
+struct CompileOptions {
+    // Share identical subtrees and cache constant values (see monkey/hash_cons.h), for
+    // generated scripts that repeat the same expressions.
+    bool hashCons = false;
+};
+
+class CompiledProgram {
+  public:
+    [[nodiscard]] const Program &program() const { return *program_; }
+    [[nodiscard]] const std::vector<std::string> &errors() const { return errors_; }
+    [[nodiscard]] bool ok() const { return errors_.empty(); }
+
+  private:
+    friend std::shared_ptr<const CompiledProgram> compile(std::string_view source,
+                                                          CompileOptions options);
+
+    CompiledProgram(std::unique_ptr<Program> program, std::vector<std::string> errors)
+        : program_(std::move(program)), errors_(std::move(errors)) {}
+
+    std::unique_ptr<const Program> program_;
+    std::vector<std::string> errors_;
+};
+
+// Parses `source` once. The AST is allocated outside of any MemoryAccount, so it can be
+// released from whichever thread drops the last reference.
+std::shared_ptr<const CompiledProgram> compile(std::string_view source,
+                                               CompileOptions options = {});
+
+struct InterpreterOptions {
+    size_t memoryQuota = MemoryAccount::UNLIMITED; // bytes of live interpreter heap
+    uint64_t fuel = UINT64_MAX;                   // statements + calls per run()
+    std::optional<std::chrono::steady_clock::duration> timeout; // per run()
+};
+
+class Interpreter {
+  public:
+    explicit Interpreter(InterpreterOptions options = {});
+    Interpreter(const Interpreter &) = delete;
+    Interpreter &operator=(const Interpreter &) = delete;
+    ~Interpreter();
+
+    // Evaluates `program` against this interpreter's globals. Parse errors are returned
+    // as an Error without evaluating anything.
+    Object run(const CompiledProgram &program);
+
+    // Binds a global before (or between) runs, e.g. to pass inputs to a script.
+    void define(const std::string &name, Object value);
+
+    [[nodiscard]] const MemoryAccount &memory() const { return *account_; }
+    [[nodiscard]] const std::shared_ptr<Environment> &globals() const { return globals_; }
+
+  private:
+    InterpreterOptions options_;
+    // Declared before globals_ so that it outlives every object charged to it.
+    std::unique_ptr<MemoryAccount> account_;
+    std::shared_ptr<Environment> globals_;
+};
+
+} // namespace monkey
\ No newline at end of file
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "monkey/memory.h"
+#include "monkey/object.h"
+
+#include <linux/io_uring.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <semaphore>
+#include <string>
+#include <thread>
+#include <unordered_set>
+
+namespace monkey {
+
+class TaskGroup;
+
+// Asynchronous file I/O on an io_uring event loop. A request is a small state machine
+// (open, read or write until done, close) whose operations are submitted to the ring;
+// one completion thread reaps the results and submits each request's next operation, so
+// any number of requests are in flight without a thread per request. Each request
+// completes a Task (monkey/task.h) that scripts await like a spawned one.
+//
+// If the kernel refuses io_uring (old kernel, seccomp), requests run synchronously with
+// blocking system calls on the thread that starts them.
+class IoLoop {
+  public:
+    explicit IoLoop(unsigned entries = 256);
+    IoLoop(const IoLoop &) = delete;
+    IoLoop &operator=(const IoLoop &) = delete;
+    // Requests must have completed before the loop is destroyed.
+    ~IoLoop();
+
+    // The task completes with the contents of `path` as a String, or an Error. When a
+    // group is given, it counts the request until it completes (TaskGroup::enter).
+    Task readFile(std::string path, TaskGroup *group = nullptr);
+    // Same as readFile, but completes with a Generator over the lines of the file,
+    // without their line terminators. The lines are slices of the contents.
+    Task readLines(std::string path, TaskGroup *group = nullptr);
+    // Creates or truncates `path`; the task completes with the number of bytes written.
+    Task writeFile(std::string path, ManagedString contents, TaskGroup *group = nullptr);
+
+    // False if requests fall back to blocking I/O: io_uring is unavailable, or the ring
+    // failed and the requests it held were completed with an Error.
+    [[nodiscard]] bool async() const {
+        return ring_ >= 0 && !broken_.load(std::memory_order_relaxed);
+    }
+
+  private:
+    struct Request;
+    struct Operation;
+    struct Batch;
+
+    Task start(std::unique_ptr<Request> request);
+    // Performs the operations of `request` with blocking system calls.
+    void runBlocking(std::unique_ptr<Request> request);
+    // Writes the operations of `request` to the submission queue; flush() hands them to
+    // the kernel. Both need mutex_. A null request stops the completion thread.
+    void queue(Request *request, const Batch &batch);
+    void flush();
+    // Need mutex_. unqueue() fails the requests whose operations the kernel refused to
+    // take; abandon() fails every outstanding request once the ring itself fails.
+    void unqueue(int error);
+    void abandon(int error);
+    void reap();
+    void finish(std::unique_ptr<Request> request);
+    // Unmaps the rings and closes the ring descriptor.
+    void release();
+
+    int ring_{-1};
+    // Submission queue (guarded by mutex_) and completion queue (owned by reaper_).
+    void *sqRing_{nullptr};
+    size_t sqRingSize_{0};
+    void *cqRing_{nullptr};
+    size_t cqRingSize_{0};
+    io_uring_sqe *sqes_{nullptr};
+    size_t sqesSize_{0};
+    unsigned sqEntries_{0};
+    unsigned queued_{0};
+    unsigned *sqTail_{nullptr};
+    unsigned *sqMask_{nullptr};
+    unsigned *sqArray_{nullptr};
+    unsigned *cqHead_{nullptr};
+    unsigned *cqTail_{nullptr};
+    unsigned *cqMask_{nullptr};
+    io_uring_cqe *cqes_{nullptr};
+
+    std::mutex mutex_;
+    // Requests submitted and not finished yet (guarded by mutex_).
+    std::unordered_set<Request *> outstanding_;
+    std::atomic<bool> broken_{false};
+    // Bounds the requests in flight so that their completions fit the completion queue.
+    std::counting_semaphore<> slots_{0};
+    std::thread reaper_;
+};
+
+// A generator over the lines of `path`, or an Error. The file is memory-mapped rather
+// than read: each line is a String slice of the mapping, so a script scanning a large
+// file copies nothing and keeps only the pages around the current line resident. Lines
+// the script keeps hold the mapping open. Unlike IoLoop requests this runs on the caller,
+// and mapped lines do not count towards a MemoryAccount. Pipes and other files that
+// cannot be mapped are read into memory instead.
+Object mapLines(const std::string &path);
+
+// The process-wide loop behind the I/O builtins, started on first use.
+IoLoop &io();
+
+} // namespace monkey
\ No newline at end of file
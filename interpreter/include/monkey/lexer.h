@@ -2,22 +2,37 @@
 
 #include "monkey/token.h"
 
+#include <cstddef>
 #include <string>
 #include <utility>
 
 namespace monkey {
 
+class TokenBuffer;
+
 class Lexer {
   public:
+    // A token as the part of the input it was lexed from. The text of a string is its
+    // contents, without the quotes; that of EOF_TOKEN is empty.
+    struct Lexeme {
+        TokenType type;
+        size_t start;
+        size_t length;
+    };
+
     explicit Lexer(std::string input) : input_(std::move(input)) { readChar(); }
     Token nextToken();
+    Lexeme nextLexeme();
 
   private:
+    // Lexes the whole input and then takes it over.
+    friend class TokenBuffer;
+
     void readChar();
-    std::string readString();
     [[nodiscard]] char peekChar() const;
     void skipWhitespace();
-    std::string readWhile(bool (*condition)(char));
+    // Moves to `position`, which may be the end of the input.
+    void skipTo(size_t position);
 
     std::string input_;
     size_t position_{0};      // current position in input (points to current char)
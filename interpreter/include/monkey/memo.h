@@ -0,0 +1,121 @@
+#pragma once
+
+#include "monkey/memory.h"
+#include "monkey/object.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace monkey {
+
+// Memoization: memo(fn) returns a Memo that calls `fn` once per argument tuple and
+// answers repeated calls from a MemoTable. Recursive functions defined as
+// `let f = memo(fn(n) { ... f(n - 1) ... })` look `f` up at call time, so the recursive
+// calls go through the table too, and exponential recursions such as fib, path counting
+// or edit distance take polynomial time.
+
+// Why calling `fn` may do more than compute a value from its arguments, or nullopt if it
+// cannot. `fn` and the functions its free identifiers are bound to must not be
+// generators, nor refer to a builtin that waits on, talks to or reads the outside world
+// (spawn, await, channels, next, files), under any name. Identifiers that are not bound
+// yet (such as `fn` itself, while its `let` is evaluated) are not followed.
+//
+// Whatever else a function reads from its closure may be rebound by a later `let`; the
+// MemoTable keys results by the version of those bindings, so rebinding never serves a
+// stale result.
+std::optional<std::string> impurity(const Function &fn);
+
+// An argument tuple made only of integers, booleans and strings, and the generation of
+// the bindings the result was computed under (see MemoTable::key()).
+struct MemoKey {
+    std::vector<HashKey> args;
+    uint64_t hash;
+    uint64_t generation = 0;
+
+    // nullopt if some argument is of another type; such calls are not cached.
+    static std::optional<MemoKey> from(std::span<const Object> args);
+};
+
+// Results of one function by argument tuple, at most `capacity` of them; the least
+// recently used one is evicted to make room. Thread-safe, since tasks may call the same
+// memoized function. Entries are charged to the MemoryAccount bound when the table was
+// created.
+class MemoTable {
+  public:
+    static constexpr size_t DEFAULT_CAPACITY = 65536;
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        size_t size = 0;
+        size_t capacity = 0;
+    };
+
+    MemoTable(Object function, size_t capacity)
+        : function_(std::move(function)), capacity_(capacity) {}
+
+    [[nodiscard]] const Object &function() const { return function_; }
+
+    // The key to cache the call with `args` under, or nullopt if it is not cached: some
+    // argument is not of a MemoKey type, or rebinding a name made the function impure.
+    // A new generation starts whenever a frame the function reads names from has bound
+    // a name since the last call, and the function is checked again then.
+    std::optional<MemoKey> key(std::span<const Object> args);
+
+    // The result cached for `key`, which becomes the most recently used one. Counts a
+    // hit or a miss.
+    std::optional<Object> find(const MemoKey &key);
+    void insert(MemoKey key, Object result);
+    // From now on values leave the table through share() (see monkey/task.h).
+    void share();
+    [[nodiscard]] Stats stats() const;
+
+  private:
+    struct Entry {
+        MemoKey key;
+        Object value;
+    };
+    using List = std::list<Entry, AccountingAllocator<Entry>>;
+
+    // Looks entries up by key, in place: the index holds iterators into `entries_`.
+    struct Hasher {
+        using is_transparent = void;
+        size_t operator()(const MemoKey &key) const { return key.hash; }
+        size_t operator()(List::iterator entry) const { return entry->key.hash; }
+    };
+    struct Equal {
+        using is_transparent = void;
+        static const MemoKey &key(const MemoKey &key) { return key; }
+        static const MemoKey &key(List::iterator entry) { return entry->key; }
+        bool operator()(const auto &a, const auto &b) const {
+            return key(a).hash == key(b).hash && key(a).generation == key(b).generation &&
+                   key(a).args == key(b).args;
+        }
+    };
+
+    mutable std::mutex mutex_;
+    Object function_;
+    size_t capacity_;
+    List entries_; // most recently used first
+    std::unordered_set<List::iterator, Hasher, Equal, AccountingAllocator<List::iterator>>
+        index_;
+    Stats stats_;
+    bool shared_ = false;
+    // The frames the function looks its free identifiers up in, with their versions
+    // when `generation_` started, and whether the function was pure then.
+    std::vector<std::pair<std::shared_ptr<const Environment>, uint64_t>> frames_;
+    uint64_t generation_ = 0;
+    bool checked_ = false;
+    bool pure_ = true;
+};
+
+} // namespace monkey
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <new>
+#include <string>
+#include <utility>
+
+namespace monkey {
+
+// Live and peak bytes of the interpreter allocations made while the account is bound to a
+// thread through a MemoryScope. Objects remember the account that paid for them, so an
+// account must outlive every object allocated under it (the same rule as for a
+// std::pmr::memory_resource). The counters are atomic because the tasks a script spawns
+// charge its account from the scheduler's worker threads. An allocation that would take
+// the live bytes over the quota is refused, so the peak never exceeds it.
+class MemoryAccount {
+  public:
+    static constexpr size_t UNLIMITED = std::numeric_limits<size_t>::max();
+
+    explicit MemoryAccount(size_t quota = UNLIMITED) : quota_(quota) {}
+    MemoryAccount(const MemoryAccount &) = delete;
+    MemoryAccount &operator=(const MemoryAccount &) = delete;
+    ~MemoryAccount() = default;
+
+    // Charges `bytes`, or counts a refusal and charges nothing if that would exceed the
+    // quota.
+    [[nodiscard]] bool charge(size_t bytes) {
+        if (bytes > quota_) {
+            refusals_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        auto live = live_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        if (live > quota_) {
+            live_.fetch_sub(bytes, std::memory_order_relaxed);
+            refusals_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        auto peak = peak_.load(std::memory_order_relaxed);
+        while (live > peak &&
+               !peak_.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+        }
+        return true;
+    }
+    void release(size_t bytes) { live_.fetch_sub(bytes, std::memory_order_relaxed); }
+
+    // Whether `bytes` more would fit in the quota, for memory a caller commits to before
+    // allocating it. Counts a refusal if not, as charge() does.
+    [[nodiscard]] bool fits(size_t bytes) {
+        if (bytes <= quota_ && live() <= quota_ - bytes) {
+            return true;
+        }
+        refusals_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    [[nodiscard]] size_t live() const { return live_.load(std::memory_order_relaxed); }
+    [[nodiscard]] size_t peak() const { return peak_.load(std::memory_order_relaxed); }
+    [[nodiscard]] size_t quota() const { return quota_; }
+    // How many allocations the quota refused so far.
+    [[nodiscard]] size_t refusals() const {
+        return refusals_.load(std::memory_order_relaxed);
+    }
+
+  private:
+    size_t quota_;
+    std::atomic<size_t> live_{0};
+    std::atomic<size_t> peak_{0};
+    std::atomic<size_t> refusals_{0};
+};
+
+// Thrown by AccountingAllocator when the account refuses an allocation. The evaluator
+// turns it into an Error at the entry point the evaluation started from.
+class MemoryQuotaExceeded : public std::bad_alloc {
+  public:
+    [[nodiscard]] const char *what() const noexcept override {
+        return "evaluation exceeded its memory quota";
+    }
+};
+
+namespace memory {
+inline thread_local MemoryAccount *current = nullptr;
+} // namespace memory
+
+// Makes `account` pay for the interpreter allocations of the calling thread until the
+// scope ends. Scopes nest; the previous account is restored on exit.
+class MemoryScope {
+  public:
+    explicit MemoryScope(MemoryAccount &account) : MemoryScope(&account) {}
+    // A null account leaves the allocations of the scope unaccounted.
+    explicit MemoryScope(MemoryAccount *account)
+        : previous_(std::exchange(memory::current, account)) {}
+    MemoryScope(const MemoryScope &) = delete;
+    MemoryScope &operator=(const MemoryScope &) = delete;
+    ~MemoryScope() { memory::current = previous_; }
+
+  private:
+    MemoryAccount *previous_;
+};
+
+// std::allocator that charges the account bound to the thread at construction time, or
+// nothing when no account is bound. Throws MemoryQuotaExceeded if the account refuses.
+template <typename T>
+class AccountingAllocator {
+  public:
+    using value_type = T;
+
+    AccountingAllocator() noexcept : account_(memory::current) {}
+    template <typename U>
+    AccountingAllocator(const AccountingAllocator<U> &other) noexcept // NOLINT
+        : account_(other.account()) {}
+
+    T *allocate(size_t n) {
+        if (account_ != nullptr && !account_->charge(n * sizeof(T))) {
+            throw MemoryQuotaExceeded();
+        }
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T *ptr, size_t n) noexcept {
+        if (account_ != nullptr) {
+            account_->release(n * sizeof(T));
+        }
+        std::allocator<T>().deallocate(ptr, n);
+    }
+
+    [[nodiscard]] MemoryAccount *account() const noexcept { return account_; }
+
+    template <typename U>
+    bool operator==(const AccountingAllocator<U> &other) const noexcept {
+        return account_ == other.account();
+    }
+
+  private:
+    MemoryAccount *account_;
+};
+
+using ManagedString =
+    std::basic_string<char, std::char_traits<char>, AccountingAllocator<char>>;
+
+} // namespace monkey
\ No newline at end of file
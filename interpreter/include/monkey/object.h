@@ -2,17 +2,31 @@
 
 #include "monkey/ast.h"
 #include "monkey/box.h"
+#include "monkey/hash_map.h"
+#include "monkey/int_vector.h"
+#include "monkey/memory.h"
+#include "monkey/output.h"
+#include "monkey/string.h"
+#include "monkey/vector.h"
 
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <memory>
+#include <optional>
+#include <span>
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 
 namespace monkey {
 
+class CallContext;
+class ChannelState;
 class Environment;
+class GeneratorState;
+class TaskState;
 struct ReturnValue;
 struct Function;
 
@@ -20,23 +34,164 @@ struct Error {
     std::string message;
 };
 
-struct String {
-    std::string value;
+struct Builtin;
+class Array;
+class HashTable;
+class MemoTable;
+
+// Handle to a spawned task (see monkey/task.h); copies refer to the same task.
+struct Task {
+    std::shared_ptr<TaskState> state;
+};
+
+// Handle to a channel between tasks; copies refer to the same channel.
+struct Channel {
+    std::shared_ptr<ChannelState> state;
+};
+
+// What calling a generator function returns (see monkey/generator.h); copies refer to the
+// same generator.
+struct Generator {
+    std::shared_ptr<GeneratorState> state;
+};
+
+// What memo(fn) returns (see monkey/memo.h); callable like `fn`. Copies share the
+// table of results.
+struct Memo {
+    std::shared_ptr<MemoTable> table;
 };
 
-using Object = std::variant<int64_t, bool, std::nullptr_t, String, Box<ReturnValue>,
-                            Box<Function>, Error>;
+// Immutable once built; copies share the table. Tables are created by makeReclaimed(),
+// so a hash nested in another one many levels deep is freed without recursing.
+struct Hash {
+    std::shared_ptr<const HashTable> table;
+};
+
+using Object =
+    std::variant<int64_t, bool, std::nullptr_t, String, Box<ReturnValue>, Box<Function>,
+                 Error, Builtin, Task, Channel, Generator, Array, Hash, Memo>;
+
+// Builtins get their arguments already evaluated; `context` lets them call back into the
+// evaluator (see monkey/builtins.h).
+using BuiltinFunction = Object (*)(std::span<const Object> args, CallContext &context);
+
+struct Builtin {
+    std::string_view name;
+    BuiltinFunction function;
+};
+
+// Copies share their elements, so passing an array around is O(1). An array of integers
+// only keeps them unboxed in one contiguous buffer (see monkey/int_vector.h), which the
+// vector builtins run over; any other array is a PersistentVector of objects (see
+// monkey/vector.h), where push/rest take O(log32 n). Pushing a non-integer onto an
+// integer array boxes its elements, once.
+class Array {
+  public:
+    Array() = default;
+    explicit Array(IntVector integers) : elements_(std::move(integers)) {}
+
+    static Array from(std::vector<Object> elements);
+
+    [[nodiscard]] size_t size() const {
+        return std::visit([](const auto &elements) { return elements.size(); },
+                          elements_);
+    }
+    [[nodiscard]] bool empty() const { return size() == 0; }
+    // `index` must be less than size().
+    [[nodiscard]] Object operator[](size_t index) const;
+
+    [[nodiscard]] Array push(Object value) const;
+    // All elements but the first; the array must not be empty.
+    [[nodiscard]] Array rest() const;
+
+    // The elements, if they are stored unboxed.
+    [[nodiscard]] const IntVector *integers() const {
+        return std::get_if<IntVector>(&elements_);
+    }
+    // The elements, if they are not.
+    [[nodiscard]] const PersistentVector<Object> *objects() const {
+        return std::get_if<PersistentVector<Object>>(&elements_);
+    }
+
+    // Calls `visit` with each element, in order.
+    template <typename Visitor>
+    void forEach(Visitor &&visit) const {
+        if (const auto *integers = this->integers()) {
+            for (auto value : integers->values()) {
+                visit(Object{value});
+            }
+            return;
+        }
+        std::get<PersistentVector<Object>>(elements_).forEachChunk(
+            [&visit](std::span<const Object> chunk) {
+                for (const auto &element : chunk) {
+                    visit(element);
+                }
+            });
+    }
+
+  private:
+    explicit Array(PersistentVector<Object> elements) : elements_(std::move(elements)) {}
+
+    std::variant<IntVector, PersistentVector<Object>> elements_;
+};
+
+// An integer, boolean or string usable as a hash key, with its hash computed once by
+// hashKey().
+struct HashKey {
+    Object key;
+    uint64_t hash;
+
+    struct Hasher {
+        uint64_t operator()(const HashKey &key) const { return key.hash; }
+    };
+};
+
+inline bool operator==(const HashKey &a, const HashKey &b) {
+    if (a.hash != b.hash || a.key.index() != b.key.index()) {
+        return false;
+    }
+    if (const auto *s = std::get_if<String>(&a.key)) {
+        return s->view() == std::get<String>(b.key).view();
+    }
+    if (const auto *i = std::get_if<int64_t>(&a.key)) {
+        return *i == std::get<int64_t>(b.key);
+    }
+    return std::get<bool>(a.key) == std::get<bool>(b.key);
+}
+
+// The key of `obj`, or nullopt if it cannot be a hash key.
+std::optional<HashKey> hashKey(const Object &obj);
+
+// Keys to values in insertion order (see monkey/hash_map.h).
+class HashTable : public SwissMap<HashKey, Object, HashKey::Hasher, std::equal_to<>> {
+  public:
+    using SwissMap::SwissMap;
+};
 
 struct ReturnValue {
     Object value;
 };
 
+// Shares the FunctionLiteral with the AST it came from; copying a Function is O(1).
 struct Function {
-    std::vector<Identifier> parameters;
-    BlockStatement body;
+    Box<FunctionLiteral> literal;
     std::shared_ptr<Environment> env;
+
+    [[nodiscard]] const std::vector<Identifier> &parameters() const {
+        return literal->parameters;
+    }
+    [[nodiscard]] const BlockStatement &body() const { return literal->body; }
 };
 
-std::string inspect(const Object &obj);
+// The value as the REPL prints it, cut to `limit` bytes and BoundedOutput::TRUNCATED if
+// it is longer.
+std::string inspect(const Object &obj, size_t limit = BoundedOutput::UNLIMITED);
+// Appends the same text to `out`, and stops walking the value once `out` is truncated.
+void inspect(BoundedOutput &out, const Object &obj);
+// Conditions treat false and null as false and every other value as true.
+bool isTruthy(const Object &obj);
+// Upper-case type name used in error messages, e.g. "INTEGER" or "FUNCTION".
+std::string_view typeName(const Object &obj);
 
 } // namespace monkey
\ No newline at end of file
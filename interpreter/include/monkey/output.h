@@ -0,0 +1,67 @@
+#pragma once
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <string>
+#include <string_view>
+
+namespace monkey {
+
+// Appends text to a caller's buffer, at most `limit` bytes of it. The first append that
+// does not fit writes what does, then TRUNCATED, and the rest are dropped. Printers stop
+// walking once truncated() is true, so printing a huge tree or value takes time in
+// proportion to the limit rather than to its size.
+class BoundedOutput {
+  public:
+    static constexpr size_t UNLIMITED = std::numeric_limits<size_t>::max();
+    static constexpr std::string_view TRUNCATED = "...";
+
+    explicit BoundedOutput(fmt::memory_buffer &buffer, size_t limit = UNLIMITED)
+        : buffer_(buffer), room_(limit) {}
+
+    void append(std::string_view text) {
+        if (truncated_) {
+            return;
+        }
+        if (text.size() <= room_) {
+            write(text);
+            room_ -= text.size();
+            return;
+        }
+        write(text.substr(0, room_));
+        buffer_.append(TRUNCATED);
+        room_ = 0;
+        truncated_ = true;
+    }
+
+    [[nodiscard]] bool truncated() const { return truncated_; }
+
+  private:
+    // Doubles the buffer when it is full, where memory_buffer would grow it by half,
+    // which copies large outputs about half as often.
+    void write(std::string_view text) {
+        auto size = buffer_.size() + text.size();
+        if (size > buffer_.capacity()) {
+            buffer_.reserve(std::max(size, 2 * buffer_.capacity()));
+        }
+        buffer_.append(text);
+    }
+
+    fmt::memory_buffer &buffer_;
+    size_t room_;
+    bool truncated_ = false;
+};
+
+// Runs `print` on a BoundedOutput over a fresh buffer and returns the text.
+template <typename Print>
+std::string printToString(Print print, size_t limit = BoundedOutput::UNLIMITED) {
+    fmt::memory_buffer buffer;
+    BoundedOutput out(buffer, limit);
+    print(out);
+    return fmt::to_string(buffer);
+}
+
+} // namespace monkey
\ No newline at end of file
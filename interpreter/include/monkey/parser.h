@@ -3,12 +3,14 @@
 #include "monkey/ast.h"
 #include "monkey/lexer.h"
 #include "monkey/token.h"
+#include "monkey/token_buffer.h"
 
-#include <functional>
+#include <cstddef>
 #include <memory>
 #include <optional>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <variant>
 #include <vector>
 
 namespace monkey {
@@ -21,52 +23,101 @@ enum class Precedence {
     PRODUCT,     // *
     PREFIX,      // -X or !X
     CALL,        // myFunction(X)
+    INDEX,       // array[index]
 };
 
+// A Pratt parser that keeps the constructs it is inside of on an explicit stack rather
+// than in recursive calls, so that deeply nested input (parentheses, operators, long
+// else-if chains) is limited by heap memory only.
 class Parser {
   public:
+    // Lexes the whole input into a TokenBuffer first.
     explicit Parser(Lexer lexer);
+    explicit Parser(TokenBuffer tokens);
     std::unique_ptr<Program> parseProgram();
     const std::vector<std::string> &errors() const { return errors_; }
 
   private:
-    using PrefixParseFn = std::function<std::optional<Expression>()>;
-    using InfixParseFn = std::function<std::optional<Expression>(Expression lhs)>;
+    // What the parse loop in parseProgram does next.
+    enum class Step {
+        STATEMENT,      // Start a statement at the current token, or end the block.
+        EXPRESSION,     // Parse an operand, or start the construct it opens.
+        OPERATOR,       // Extend operand_ with the next operator, or complete the top.
+        NEXT_STATEMENT, // Move past the statement just parsed.
+        RECOVER,        // Drop the statement that failed to parse.
+    };
+
+    // Nodes still waiting for parts, which the stack holds besides the AST node types.
+    struct Group {}; // A parenthesized expression
+    struct PendingInfix {
+        InfixExpression expr;
+        Precedence precedence;
+    };
+    struct PendingIf {
+        IfExpression expr;
+        bool inAlternative = false;
+    };
+    struct PendingHash {
+        HashLiteral hash;
+        std::optional<Expression> key; // Parsed, awaiting its value
+    };
+    // The innermost pending node is at the back. A block holds the statements parsed so
+    // far; the bottom one is the program's.
+    using Pending =
+        std::variant<BlockStatement, LetStatement, ReturnStatement, YieldStatement,
+                     ExpressionStatement, Group, PrefixExpression, PendingInfix,
+                     PendingIf, FunctionLiteral, CallExpression, ArrayLiteral,
+                     IndexExpression, PendingHash>;
+
+    [[nodiscard]] TokenType currentType() const { return tokens_.type(current_); }
+    [[nodiscard]] TokenType peekType() const { return tokens_.type(current_ + 1); }
+    [[nodiscard]] std::string_view currentText() const { return tokens_.text(current_); }
+    // The current token as the AST keeps it.
+    [[nodiscard]] Token currentToken() const { return tokens_.token(current_); }
 
     void nextToken();
     bool expectPeek(TokenType type);
     void peekError(TokenType type);
+    // Records `message` at the position of the token with index `token`.
+    void error(size_t token, std::string_view message);
 
     Precedence peekPrecedence() const;
     Precedence currentPrecedence() const;
+    // How tightly the innermost pending operator binds its right operand.
+    Precedence pendingPrecedence() const;
+
+    Step parseStatement();
+    Step parseLetStatement();
+    Step beginBlock();
+    Step endBlock();
+    template <typename Node>
+    Step endStatement(Node &stmt, Expression &slot);
+
+    Step parseOperand();
+    Step parseIntegerLiteral();
+    Step parseFunctionLiteral();
+    Step parseOperator();
+    Step reduce();
+    // Starts or continues a comma-separated list of expressions up to `end`.
+    template <typename Node>
+    Step beginList(TokenType end);
+    template <typename Node>
+    Step continueList(std::vector<Expression> &list, TokenType end);
+
+    // Completes `expr` as the operand of the innermost pending node.
+    Step produce(Expression expr);
+    // Pops the innermost pending node, which is a `Node`.
+    template <typename Node>
+    Node take();
+
+    TokenBuffer tokens_;
+    size_t current_ = 0;
 
-    std::optional<Statement> parseStatement();
-    std::optional<Statement> parseLetStatement();
-    std::optional<Statement> parseReturnStatement();
-    std::optional<Statement> parseExpressionStatement();
-    std::optional<BlockStatement> parseBlockStatement();
-
-    std::optional<Expression> parseExpression(Precedence precedence);
-    std::optional<Expression> parseIdentifier();
-    std::optional<Expression> parseBoolean();
-    std::optional<Expression> parseIntegerLiteral();
-    std::optional<Expression> parseFunctionLiteral();
-    std::optional<Expression> parseStringLiteral();
-    std::optional<Expression> parsePrefixExpression();
-    std::optional<Expression> parseInfixExpression(Expression left);
-    std::optional<Expression> parseGroupedExpression();
-    std::optional<Expression> parseIfExpression();
-    std::optional<Expression> parseCallExpression(Expression function);
-
-    void registerPrefix(TokenType tokenType, PrefixParseFn fn);
-    void registerInfix(TokenType tokenType, InfixParseFn fn);
-
-    Lexer lexer_;
-    Token currentToken_;
-    Token peekToken_;
-
-    std::unordered_map<TokenType, PrefixParseFn> prefixParseFns_;
-    std::unordered_map<TokenType, InfixParseFn> infixParseFns_;
+    // The operator stack: nodes whose parsing is under way, each holding the operands
+    // it has so far. Nesting costs entries here instead of C++ stack frames.
+    std::vector<Pending> pending_;
+    // The operand just completed, which the innermost pending node takes next.
+    Expression operand_;
 
     std::vector<std::string> errors_;
 };
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "monkey/interpreter.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <limits>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace monkey {
+
+// 64-bit FNV-1a of the source text. Stable across processes, so it can name a program.
+uint64_t sourceHash(std::string_view source);
+
+// Compiles each distinct source once and hands out the shared CompiledProgram, keyed by
+// sourceHash(). Holds at most `capacity` programs and evicts the least recently used one.
+// Safe to use from many threads; concurrent requests for a source that is still being
+// parsed wait for that parse instead of starting their own.
+class ProgramCache {
+  public:
+    static constexpr size_t UNLIMITED = std::numeric_limits<size_t>::max();
+
+    struct Lookup {
+        std::shared_ptr<const CompiledProgram> program;
+        uint64_t id; // sourceHash() of the source; find(id) returns the same program
+        bool hit;    // false if this call parsed the source
+    };
+
+    explicit ProgramCache(size_t capacity = UNLIMITED) : capacity_(capacity) {}
+
+    Lookup get(std::string_view source);
+    // The cached program with this id, or nullptr if it was never compiled or evicted.
+    std::shared_ptr<const CompiledProgram> find(uint64_t id);
+
+    [[nodiscard]] size_t size() const;
+    [[nodiscard]] uint64_t hits() const;
+    [[nodiscard]] uint64_t misses() const;
+
+  private:
+    using Future = std::shared_future<std::shared_ptr<const CompiledProgram>>;
+
+    struct Entry {
+        std::string source; // compared on lookup so that a hash collision is never a hit
+        Future program;
+        std::list<uint64_t>::iterator position; // in recency_
+    };
+
+    // Both require mutex_.
+    void touch(Entry &entry);
+    void insert(uint64_t id, std::string_view source,
+                std::promise<std::shared_ptr<const CompiledProgram>> &promise);
+
+    size_t capacity_;
+    mutable std::mutex mutex_;
+    std::unordered_map<uint64_t, Entry> entries_;
+    std::list<uint64_t> recency_; // most recently used first
+    uint64_t hits_{0};
+    uint64_t misses_{0};
+};
+
+} // namespace monkey
\ No newline at end of file
@@ -1,9 +1,17 @@
 #pragma once
 
+#include <cstddef>
 #include <iostream>
 
 namespace monkey {
 
-void start(std::istream &input = std::cin, std::ostream &output = std::cout);
+struct ReplOptions {
+    bool trace = false; // print the evaluator's event log after every line
+    // Bytes of each result printed; longer results are cut short with "...".
+    size_t outputLimit = size_t{1} << 20;
+};
+
+void start(std::istream &input = std::cin, std::ostream &output = std::cout,
+           const ReplOptions &options = {});
 
 } // namespace monkey
\ No newline at end of file
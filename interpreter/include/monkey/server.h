@@ -0,0 +1,162 @@
+#pragma once
+
+#include "monkey/interpreter.h"
+#include "monkey/program_cache.h"
+#include "monkey/thread_pool.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace monkey {
+
+// Wire protocol of `monkey serve`.
+//
+// Every message is a frame: a 4-byte big-endian payload length followed by the payload.
+// A request payload is a header of lines, an empty line, and the program source:
+//
+//     program 9e3779b97f4a7c15      evaluate a cached program instead of the source
+//     bind input 42                 global bound before the run: integer, true, false,
+//     bind name "monkey"            null or a double-quoted string
+//
+//     let f = fn(x) { x * 2 }; f(input);
+//
+// The response payload is `ok <program id>` or `error <program id>`, a newline, and the
+// inspected result or the error message, cut to MAX_RESULT_SIZE bytes and "..." so that
+// the response fits in a frame. Clients send the source once and then reuse the returned
+// id; a request for an evicted id fails with "unknown program" and must be retried with
+// the source.
+
+inline constexpr size_t MAX_FRAME_SIZE = 16 << 20;
+inline constexpr size_t MAX_RESULT_SIZE = MAX_FRAME_SIZE - 64;
+
+struct EvalRequest {
+    std::optional<uint64_t> programId;
+    std::vector<std::pair<std::string, std::string>> bindings; // name, literal
+    std::string source;
+};
+
+struct EvalResponse {
+    bool ok = false;
+    uint64_t programId = 0;
+    std::string result;
+};
+
+// `payload` must be at most MAX_FRAME_SIZE bytes.
+std::string encodeFrame(std::string_view payload);
+// Removes the first complete frame from `buffer` and returns its payload. Returns nullopt
+// if the frame is incomplete; sets `malformed` if it is larger than MAX_FRAME_SIZE.
+std::optional<std::string> takeFrame(std::string &buffer, bool &malformed);
+
+std::string encodeRequest(const EvalRequest &request);
+std::optional<EvalRequest> decodeRequest(std::string_view payload);
+std::string encodeResponse(const EvalResponse &response);
+std::optional<EvalResponse> decodeResponse(std::string_view payload);
+
+struct ServerOptions {
+    std::string socketPath;
+    size_t workers = std::thread::hardware_concurrency();
+    size_t cacheCapacity = 1024; // parsed programs kept, least recently used evicted
+    InterpreterOptions interpreter; // limits applied to every request
+};
+
+// Keeps parsed programs warm and evaluates requests from a Unix domain socket. One
+// thread runs an epoll loop over the listening socket and every connection; evaluation
+// happens on a ThreadPool, one fresh Interpreter per request. A connection has at most
+// one request in flight, so responses come back in request order. While it is busy the
+// server buffers at most MAX_INPUT_SIZE bytes of the requests that follow, then stops
+// reading from it. A client that shuts down its side still gets the responses to the
+// requests it sent before; the connection closes after the last one.
+class Server {
+  public:
+    explicit Server(ServerOptions options);
+    Server(const Server &) = delete;
+    Server &operator=(const Server &) = delete;
+    ~Server();
+
+    // Binds and listens on options.socketPath, replacing a stale socket file but not one
+    // another server still listens on. Returns an error message on failure.
+    std::optional<std::string> listen();
+    // Serves until stop(). Requires a successful listen().
+    void run();
+    // Makes run() return. Async-signal-safe.
+    void stop();
+
+    // Evaluates one request payload; what a worker does for every frame.
+    EvalResponse handle(std::string_view payload);
+
+    [[nodiscard]] const ProgramCache &cache() const { return cache_; }
+
+  private:
+    struct Connection {
+        explicit Connection(int socket) : fd(socket) {}
+
+        int fd;
+        std::string input;
+        std::string output;
+        bool busy = false;    // a request is on the pool
+        bool closing = false; // the client shut down its side
+        uint32_t events = 0;  // the epoll events registered for, none if removed
+    };
+
+    static constexpr size_t MAX_INPUT_SIZE = 2 * MAX_FRAME_SIZE;
+
+    // I/O thread only. flush() returns false if it had to drop the connection.
+    void acceptConnections();
+    void receive(uint64_t id);
+    void dispatch(uint64_t id, Connection &connection);
+    bool flush(uint64_t id, Connection &connection);
+    void watch(uint64_t id, Connection &connection);
+    void disconnect(uint64_t id);
+    // Called by workers.
+    void complete(uint64_t id, std::string frame);
+    void deliverCompletions();
+
+    ServerOptions options_;
+    ProgramCache cache_;
+    int listener_{-1};
+    int epoll_{-1};
+    int wakeup_{-1}; // eventfd written by workers and stop()
+    std::atomic<bool> stopping_{false};
+
+    uint64_t nextConnection_;
+    std::unordered_map<uint64_t, Connection> connections_; // owned by the I/O thread
+
+    std::mutex completionsMutex_;
+    std::deque<std::pair<uint64_t, std::string>> completions_;
+
+    // Declared last so that it is destroyed (and drained) before the state tasks use.
+    std::unique_ptr<ThreadPool> pool_;
+};
+
+// Blocking client for `monkey serve`, used by tests and benchmarks.
+class Client {
+  public:
+    static std::optional<Client> connect(const std::string &socketPath);
+
+    Client(Client &&other) noexcept : fd_(std::exchange(other.fd_, -1)) {}
+    Client &operator=(Client &&other) noexcept;
+    Client(const Client &) = delete;
+    Client &operator=(const Client &) = delete;
+    ~Client();
+
+    // nullopt if the connection failed or the request does not fit in a frame.
+    std::optional<EvalResponse> evaluate(const EvalRequest &request);
+
+  private:
+    explicit Client(int fd) : fd_(fd) {}
+
+    int fd_;
+};
+
+} // namespace monkey
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+// Kernels behind the integer-array builtins (sum, dot, min, max, mapAdd, filterGt). On
+// x86-64 they run as AVX2 code when the CPU has it, chosen once at startup; elsewhere,
+// and on older CPUs, the scalar versions run. Arithmetic wraps around on overflow.
+namespace monkey::simd {
+
+int64_t sum(std::span<const int64_t> values);
+// `a` and `b` must have the same size.
+int64_t dot(std::span<const int64_t> a, std::span<const int64_t> b);
+// `values` must not be empty.
+int64_t min(std::span<const int64_t> values);
+int64_t max(std::span<const int64_t> values);
+// Writes values[i] + addend to out[i]; `out` has room for values.size() elements.
+void add(std::span<const int64_t> values, int64_t addend, int64_t *out);
+// Writes the values greater than `bound` to `out`, in order, and returns how many there
+// were; `out` has room for values.size() elements.
+size_t filterGreater(std::span<const int64_t> values, int64_t bound, int64_t *out);
+
+// "avx2" or "scalar".
+std::string_view implementation();
+
+// The portable versions, which the tests compare the dispatched ones against.
+namespace scalar {
+int64_t sum(std::span<const int64_t> values);
+int64_t dot(std::span<const int64_t> a, std::span<const int64_t> b);
+int64_t min(std::span<const int64_t> values);
+int64_t max(std::span<const int64_t> values);
+void add(std::span<const int64_t> values, int64_t addend, int64_t *out);
+size_t filterGreater(std::span<const int64_t> values, int64_t bound, int64_t *out);
+} // namespace scalar
+
+} // namespace monkey::simd
\ No newline at end of file
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Configure with -DMONKEY_ENABLE_STATS=ON to collect runtime counters. When disabled
+// every recording hook below is an empty inline function and compiles to nothing.
+#ifndef MONKEY_ENABLE_STATS
+#define MONKEY_ENABLE_STATS 0
+#endif
+
+namespace monkey {
+
+inline constexpr bool STATS_ENABLED = MONKEY_ENABLE_STATS != 0;
+
+struct RuntimeStats {
+    uint64_t environmentsCreated = 0;
+    uint64_t identifierLookups = 0;
+    uint64_t scopesWalked = 0; // environment frames visited by all identifier lookups
+    uint64_t objectCopies = 0;
+    uint64_t functionCopies = 0; // copies of Function objects among objectCopies
+    uint64_t heapBytes = 0;      // environments, bindings, strings and boxed objects
+    uint64_t callDepth = 0;
+    uint64_t peakCallDepth = 0;
+
+    [[nodiscard]] double averageScopeDepth() const {
+        return identifierLookups == 0 ? 0.0
+                                      : static_cast<double>(scopesWalked) /
+                                            static_cast<double>(identifierLookups);
+    }
+};
+
+// Counters are per thread and accumulate across evaluations until reset.
+const RuntimeStats &runtimeStats();
+void resetRuntimeStats();
+
+namespace stats {
+
+inline thread_local RuntimeStats current{};
+
+inline void recordEnvironment(size_t bytes) {
+    if constexpr (STATS_ENABLED) {
+        ++current.environmentsCreated;
+        current.heapBytes += bytes;
+    }
+}
+
+inline void recordLookup() {
+    if constexpr (STATS_ENABLED) {
+        ++current.identifierLookups;
+    }
+}
+
+inline void recordScopeVisit() {
+    if constexpr (STATS_ENABLED) {
+        ++current.scopesWalked;
+    }
+}
+
+inline void recordObjectCopy(bool isFunction) {
+    if constexpr (STATS_ENABLED) {
+        ++current.objectCopies;
+        current.functionCopies += isFunction ? 1 : 0;
+    }
+}
+
+inline void recordHeapBytes(size_t bytes) {
+    if constexpr (STATS_ENABLED) {
+        current.heapBytes += bytes;
+    }
+}
+
+// Tracks the Monkey call depth for the lifetime of one function application.
+class CallScope {
+  public:
+    CallScope() {
+        if constexpr (STATS_ENABLED) {
+            if (++current.callDepth > current.peakCallDepth) {
+                current.peakCallDepth = current.callDepth;
+            }
+        }
+    }
+    CallScope(const CallScope &) = delete;
+    CallScope &operator=(const CallScope &) = delete;
+    ~CallScope() {
+        if constexpr (STATS_ENABLED) {
+            --current.callDepth;
+        }
+    }
+};
+
+} // namespace stats
+
+} // namespace monkey
\ No newline at end of file
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "monkey/memory.h"
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <utility>
+
+namespace monkey {
+
+// Immutable Monkey string. Copies never copy characters. A String is one of:
+// - inline: up to INLINE_CAPACITY characters stored in the String itself;
+// - shared: a view of characters kept alive by an owner, such as a buffer of its own, the
+//   StringLiteral it was evaluated from or a memory-mapped file (see monkey/io.h);
+// - a rope: the concatenation of two Strings, built by concat() in O(1) and flattened
+//   into one buffer the first time its characters are read through view().
+//
+// So `s = s + x` in a loop is linear overall: each step adds a rope node (or extends the
+// short piece at its end), and the characters are copied once, when the result is used.
+// A flattened rope lets go of its pieces, so reading every intermediate of such a loop
+// does not keep a copy of each prefix alive. Strings may be read from any thread;
+// flattening a rope happens once.
+class String {
+  public:
+    static constexpr size_t INLINE_CAPACITY = 32;
+
+    String() = default;
+    explicit String(std::string_view text);
+    explicit String(const char *text) : String(std::string_view(text)) {}
+    explicit String(ManagedString &&text);
+    // A view of `text`, which `owner` keeps alive; nothing is copied.
+    String(std::shared_ptr<const void> owner, std::string_view text)
+        : owner_(std::move(owner)), size_(text.size()),
+          data_(text.empty() ? "" : text.data()) {}
+
+    String(const String &other) = default;
+    String &operator=(const String &other) = default;
+    String(String &&other) noexcept
+        : owner_(std::move(other.owner_)), size_(std::exchange(other.size_, 0)) {
+        std::memcpy(inline_, other.inline_, INLINE_CAPACITY);
+    }
+    String &operator=(String &&other) noexcept {
+        owner_ = std::move(other.owner_);
+        size_ = std::exchange(other.size_, 0);
+        std::memcpy(inline_, other.inline_, INLINE_CAPACITY);
+        return *this;
+    }
+    ~String() = default;
+
+    // `left` followed by `right`. The caller checks that the length fits in maxSize() and
+    // is affordable().
+    static String concat(const String &left, const String &right);
+
+    [[nodiscard]] size_t size() const { return size_; }
+    [[nodiscard]] bool empty() const { return size_ == 0; }
+    [[nodiscard]] std::string_view view() const {
+        if (!owner_) {
+            return {inline_, size_};
+        }
+        return data_ != nullptr ? std::string_view(data_, size_) : flatten();
+    }
+    // What keeps the characters alive; null for inline strings.
+    [[nodiscard]] const std::shared_ptr<const void> &owner() const { return owner_; }
+    [[nodiscard]] bool isRope() const { return owner_ && data_ == nullptr; }
+
+    static size_t maxSize() { return ManagedString().max_size(); }
+    // Whether the account bound to the thread has room for a string of `size` characters.
+    // A rope only allocates its characters when it is flattened, so without this check a
+    // loop of doublings could build a string far beyond the quota out of a few nodes.
+    static bool affordable(size_t size);
+
+  private:
+    struct Rope;
+
+    static String makeRope(String left, String right);
+    [[nodiscard]] const Rope &rope() const;
+    [[nodiscard]] std::string_view flatten() const;
+
+    std::shared_ptr<const void> owner_;
+    size_t size_ = 0;
+    // inline_ when owner_ is null; otherwise data_, which is null for a rope.
+    union {
+        const char *data_ = nullptr;
+        char inline_[INLINE_CAPACITY];
+    };
+};
+
+} // namespace monkey
\ No newline at end of file
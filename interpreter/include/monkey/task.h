@@ -0,0 +1,108 @@
+#pragma once
+
+#include "monkey/object.h"
+#include "monkey/thread_pool.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+namespace monkey {
+
+// Language-level concurrency: `spawn(fn, args...)` runs a function on the scheduler and
+// returns a Task, `await(task)` waits for its result, and channels pass values between
+// tasks.
+//
+// Tasks share the heap (MemoryAccount) of the script that spawned them and read its
+// environments concurrently; every value handed to a task, through a channel or back
+// from one is passed through share() first. await() runs a task that no worker has
+// started yet on the awaiting thread, which keeps recursive divide-and-conquer mostly on
+// one stack. A worker that does have to wait (for a running task, on a channel) blocks
+// inside a ThreadPool::Blocking scope, so a spare thread takes over its queued work, or,
+// once the spares are used up, it runs queued tasks itself while it waits.
+
+// The process-wide work-stealing pool tasks run on. Sized by the MONKEY_THREADS
+// environment variable, or one worker per core.
+ThreadPool &scheduler();
+
+// Prepares a value for use on another thread: the environments a function closes over
+// are switched to locked access (Environment::share).
+void share(const Object &obj);
+
+// The tasks spawned by one top-level evaluation, including the tasks they spawn. The
+// evaluation joins its group before returning, so no task outlives the program, the
+// globals or the heap it runs against.
+class TaskGroup {
+  public:
+    TaskGroup() = default;
+    TaskGroup(const TaskGroup &) = delete;
+    TaskGroup &operator=(const TaskGroup &) = delete;
+    ~TaskGroup() { join(); }
+
+    void spawn(std::function<void()> task);
+    // Count work that does not run on the scheduler, e.g. an I/O request, towards join():
+    // every enter() must be followed by one leave().
+    void enter();
+    void leave();
+    // Blocks until every task of the group finished.
+    void join();
+
+  private:
+    std::mutex mutex_;
+    std::condition_variable done_;
+    size_t running_{0};
+};
+
+// A spawned function application and, once it ran, its result.
+class TaskState {
+  public:
+    explicit TaskState(std::function<Object()> job) : job_(std::move(job)) {}
+    // A task without a job, finished from outside the scheduler through complete(), e.g.
+    // by the I/O loop (monkey/io.h).
+    TaskState() : started_(true) {}
+
+    // Runs the job unless some thread already started it. What the scheduler calls.
+    void run();
+    // Returns (a copy of) the result, running the job here if nobody started it yet.
+    Object await();
+    // Publishes the result of a task constructed without a job.
+    void complete(Object result);
+
+  private:
+    // Only called by the thread that set started_.
+    void execute();
+
+    std::function<Object()> job_;
+    std::atomic<bool> started_{false};
+    std::mutex mutex_;
+    std::condition_variable done_;
+    std::optional<Object> result_;
+};
+
+// FIFO queue between tasks. A capacity of 0 makes the channel unbounded; otherwise
+// send() blocks while it is full.
+class ChannelState {
+  public:
+    explicit ChannelState(size_t capacity) : capacity_(capacity) {}
+
+    // False if the channel is closed.
+    bool send(Object value);
+    // The oldest value; blocks while the channel is empty and open. nullopt once the
+    // channel is closed and drained.
+    std::optional<Object> receive();
+    void close();
+
+  private:
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::deque<Object> values_;
+    size_t capacity_;
+    bool closed_{false};
+};
+
+} // namespace monkey
\ No newline at end of file
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace monkey {
+
+// Fixed-size work-stealing pool. Every worker owns a deque: it pushes and pops its own
+// work at the back (newest first, which keeps caches warm for nested submits) and idle
+// workers steal the oldest task from the front of someone else's deque. Tasks submitted
+// from outside the pool are dealt round-robin.
+//
+// A task that has to wait for another task declares it with a Blocking scope; the pool
+// then lets a spare thread run queued work in its place, so that size() threads keep
+// running tasks and waiting tasks cannot occupy every worker. At most `maxSpares` spare
+// threads are started. Past that, the blocked thread helps instead: it runs queued tasks
+// itself, nested in its wait, until what it waits for is ready. A task nested that way
+// keeps the waiter below it from resuming until it finishes, and a thread only nests 16
+// of them, to bound its stack; past that it waits like any other.
+//
+// Tasks must not throw. wait() must not be called from inside a task.
+class ThreadPool {
+  public:
+    using Task = std::function<void()>;
+
+    // Marks the calling thread as blocked for the lifetime of the scope. Only has an
+    // effect on threads of `pool`.
+    class Blocking {
+      public:
+        explicit Blocking(ThreadPool &pool);
+        Blocking(const Blocking &) = delete;
+        Blocking &operator=(const Blocking &) = delete;
+        ~Blocking();
+
+        // Whether no spare stands in for the calling thread, so that it has to call
+        // help() while it waits, and only wait for short intervals in between.
+        [[nodiscard]] bool helps() const { return helps_; }
+        // Runs one queued task on the calling thread; false if there was none, or if the
+        // thread already nests as many as it may.
+        bool help();
+
+      private:
+        ThreadPool *pool_;
+        bool helps_ = false;
+    };
+
+    explicit ThreadPool(size_t threads = std::thread::hardware_concurrency(),
+                        size_t maxSpares = std::thread::hardware_concurrency());
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+    // Finishes every submitted task before joining the workers.
+    ~ThreadPool();
+
+    void submit(Task task);
+    // Blocks until every task submitted so far (including tasks they submit) has run.
+    void wait();
+
+    [[nodiscard]] size_t size() const { return workers_.size(); }
+    // Tasks taken from another worker's deque since the pool was created.
+    [[nodiscard]] size_t steals() const {
+        return steals_.load(std::memory_order_relaxed);
+    }
+    // Spare threads started so far; never more than maxSpares.
+    [[nodiscard]] size_t spares();
+
+  private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void run(size_t self);
+    // Stands in for blocked workers; takes work from every deque.
+    void runSpare();
+    bool popLocal(size_t self, Task &task);
+    bool steal(size_t self, Task &task);
+    bool stealAny(Task &task);
+    void execute(Task &task);
+    // False if the calling thread has to help, as every spare is taken.
+    bool beginBlocking();
+    void endBlocking();
+    bool runOne();
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> workers_;
+    std::vector<std::thread> spares_; // started on demand, kept for reuse
+    size_t maxSpares_;
+
+    std::mutex mutex_; // guards sleeping and waking only; queues have their own locks
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    std::atomic<size_t> queued_{0};  // tasks sitting in some deque
+    std::atomic<size_t> pending_{0}; // tasks submitted but not finished
+    std::atomic<size_t> next_{0};
+    std::atomic<size_t> steals_{0};
+    bool stopping_{false};
+
+    // Guarded by mutex_.
+    std::condition_variable spareWake_;
+    size_t blocked_{0};       // pool threads inside a Blocking scope, but for helpers
+    size_t runningSpares_{0}; // spares standing in for one of them
+    size_t idleSpares_{0};    // parked spares
+    size_t activations_{0};   // parked spares told to run again
+};
+
+} // namespace monkey
\ No newline at end of file
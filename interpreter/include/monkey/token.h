@@ -2,12 +2,16 @@
 
 #include <algorithm>
 #include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ranges>
 #include <string>
 #include <string_view>
+#include <utility>
 
 namespace monkey {
 
-enum class TokenType {
+enum class TokenType : uint8_t {
     // Special
     ILLEGAL,
     EOF_TOKEN,
@@ -28,10 +32,13 @@ enum class TokenType {
     // Delimiters
     COMMA,
     SEMICOLON,
+    COLON,
     LPAREN,
     RPAREN,
     LBRACE,
     RBRACE,
+    LBRACKET,
+    RBRACKET,
     // Keywords
     FUNCTION,
     LET,
@@ -40,6 +47,7 @@ enum class TokenType {
     IF,
     ELSE,
     RETURN,
+    YIELD,
     // Data types
     STRING,
 };
@@ -49,36 +57,74 @@ struct Token {
     std::string literal;
 };
 
-inline TokenType lookupIdent(std::string_view ident) {
-    using namespace std::literals;
+namespace keywords {
+
+struct Keyword {
+    std::string_view word;
+    TokenType type = TokenType::IDENT;
+};
 
-    constexpr auto keywords = []() {
-        auto arr = std::to_array<std::pair<std::string_view, TokenType>>({
-            {"fn"sv, TokenType::FUNCTION},
-            {"let"sv, TokenType::LET},
-            {"true"sv, TokenType::TRUE},
-            {"false"sv, TokenType::FALSE},
-            {"if"sv, TokenType::IF},
-            {"else"sv, TokenType::ELSE},
-            {"return"sv, TokenType::RETURN},
-        });
-        std::ranges::sort(arr, std::ranges::less{},
-                          &std::pair<std::string_view, TokenType>::first);
-        return arr;
-    }();
+constexpr auto LIST = std::to_array<Keyword>({
+    {"fn", TokenType::FUNCTION},
+    {"let", TokenType::LET},
+    {"true", TokenType::TRUE},
+    {"false", TokenType::FALSE},
+    {"if", TokenType::IF},
+    {"else", TokenType::ELSE},
+    {"return", TokenType::RETURN},
+    {"yield", TokenType::YIELD},
+});
 
-    static_assert(std::ranges::is_sorted(keywords, std::ranges::less{},
-                                         &std::pair<std::string_view, TokenType>::first),
-                  "keywords array must be sorted by the first element of the pair");
+constexpr size_t SLOTS = 16;
 
-    const auto *it =
-        std::ranges::lower_bound(keywords, ident, std::ranges::less{},
-                                 &std::pair<std::string_view, TokenType>::first);
+// The shortest and longest keyword lengths.
+constexpr auto LENGTHS = std::ranges::minmax(
+    LIST | std::views::transform([](const Keyword &k) { return k.word.size(); }));
 
-    if (it != keywords.end() && it->first == ident) {
-        return it->second;
+// The slot of a word of at least one character, from its length and its first and last
+// characters.
+constexpr size_t slot(std::string_view word, size_t seed) {
+    return (static_cast<unsigned char>(word.front()) * seed +
+            static_cast<unsigned char>(word.back()) + word.size()) %
+           SLOTS;
+}
+
+// The smallest seed that gives every keyword a slot of its own, or 0 if none below 256
+// does.
+constexpr size_t SEED = [] {
+    for (size_t seed = 1; seed < 256; ++seed) {
+        std::array<bool, SLOTS> used{};
+        bool distinct = true;
+        for (const auto &keyword : LIST) {
+            distinct = !std::exchange(used[slot(keyword.word, seed)], true) && distinct;
+        }
+        if (distinct) {
+            return seed;
+        }
+    }
+    return size_t{0};
+}();
+static_assert(SEED != 0, "no seed hashes the keywords to distinct slots");
+
+// Each keyword in its slot; the other slots hold an empty word, which no identifier is.
+constexpr auto TABLE = [] {
+    std::array<Keyword, SLOTS> table{};
+    for (const auto &keyword : LIST) {
+        table[slot(keyword.word, SEED)] = keyword;
+    }
+    return table;
+}();
+
+} // namespace keywords
+
+// A perfect hash of the identifier picks the only keyword it can be, so recognizing a
+// keyword takes one string comparison.
+inline TokenType lookupIdent(std::string_view ident) {
+    if (ident.size() < keywords::LENGTHS.min || ident.size() > keywords::LENGTHS.max) {
+        return TokenType::IDENT;
     }
-    return TokenType::IDENT;
+    const auto &keyword = keywords::TABLE[keywords::slot(ident, keywords::SEED)];
+    return keyword.word == ident ? keyword.type : TokenType::IDENT;
 }
 
 } // namespace monkey
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "monkey/lexer.h"
+#include "monkey/token.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace monkey {
+
+// Where a token starts in the source. Lines and columns count from 1; a column counts
+// bytes.
+struct SourcePosition {
+    size_t line;
+    size_t column;
+};
+
+// The tokens of a whole input, lexed up front into parallel arrays of their types and
+// the 32-bit offsets and lengths of their text in the source, which the buffer keeps.
+// That is 9 bytes per token, against a Token with its std::string, and looking ahead
+// any distance is an index. The last token is EOF_TOKEN, and indices past it read as
+// EOF_TOKEN too.
+//
+// Sources of MAX_SOURCE bytes or more are not lexed: the buffer holds only EOF_TOKEN and
+// tooLarge() says why.
+class TokenBuffer {
+  public:
+    static constexpr size_t MAX_SOURCE = std::numeric_limits<uint32_t>::max();
+
+    explicit TokenBuffer(Lexer lexer);
+
+    [[nodiscard]] size_t size() const { return types_.size(); }
+    [[nodiscard]] TokenType type(size_t index) const { return types_[clamp(index)]; }
+    [[nodiscard]] std::string_view text(size_t index) const {
+        index = clamp(index);
+        return std::string_view(source_).substr(starts_[index], lengths_[index]);
+    }
+    [[nodiscard]] Token token(size_t index) const {
+        return {type(index), std::string(text(index))};
+    }
+    [[nodiscard]] SourcePosition position(size_t index) const;
+
+    [[nodiscard]] const std::string &source() const { return source_; }
+    [[nodiscard]] bool tooLarge() const { return source_.size() >= MAX_SOURCE; }
+
+  private:
+    [[nodiscard]] size_t clamp(size_t index) const {
+        return std::min(index, types_.size() - 1);
+    }
+
+    std::string source_;
+    std::vector<TokenType> types_;
+    std::vector<uint32_t> starts_;
+    std::vector<uint32_t> lengths_;
+    // The offset of every line but the first, found on the first call to position().
+    mutable std::optional<std::vector<uint32_t>> lineStarts_;
+};
+
+} // namespace monkey
\ No newline at end of file
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "monkey/ast.h"
+#include "monkey/object.h"
+
+#include <concepts>
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace monkey {
+
+// Hooks the evaluator calls at interesting points. The evaluator is instantiated once per
+// policy type, so a policy whose hooks are empty adds no code to the hot path.
+// onStep runs before every statement and function application; returning an Error aborts
+// the evaluation with it.
+template <typename T>
+concept EvalPolicy = requires(T &policy, const Statement &stmt,
+                              const CallExpression &call, const Function &fn,
+                              std::span<const Object> args, const Object &result,
+                              const Error &err) {
+    policy.onStatement(stmt);
+    policy.onCall(call, fn, args);
+    policy.onReturn(call, result);
+    policy.onError(err);
+    { policy.onStep() } -> std::same_as<std::optional<Error>>;
+};
+
+struct NoTrace {
+    std::optional<Error> onStep() { return std::nullopt; }
+    void onStatement(const Statement & /*stmt*/) {}
+    void onCall(const CallExpression & /*call*/, const Function & /*fn*/,
+                std::span<const Object> /*args*/) {}
+    void onReturn(const CallExpression & /*call*/, const Object & /*result*/) {}
+    void onError(const Error & /*err*/) {}
+};
+
+enum class TraceEventKind {
+    STATEMENT,
+    CALL,
+    RETURN,
+    ERROR,
+};
+
+struct TraceEvent {
+    TraceEventKind kind;
+    size_t depth; // Monkey call depth at which the event happened
+    std::string detail;
+};
+
+// Records every hook as a TraceEvent. Details longer than DETAIL_LIMIT bytes are cut
+// short, so tracing a program that builds large values stays cheap.
+class Tracer {
+  public:
+    static constexpr size_t DETAIL_LIMIT = 256;
+
+    std::optional<Error> onStep() { return std::nullopt; }
+    void onStatement(const Statement &stmt);
+    void onCall(const CallExpression &call, const Function &fn,
+                std::span<const Object> args);
+    void onReturn(const CallExpression &call, const Object &result);
+    void onError(const Error &err);
+
+    [[nodiscard]] const std::vector<TraceEvent> &events() const { return events_; }
+    void clear() { events_.clear(); }
+
+  private:
+    std::vector<TraceEvent> events_;
+    size_t depth_{0};
+};
+
+static_assert(EvalPolicy<NoTrace>);
+static_assert(EvalPolicy<Tracer>);
+
+std::string toString(const TraceEvent &event);
+
+} // namespace monkey
\ No newline at end of file
@@ -0,0 +1,194 @@
+#pragma once
+
+#include "monkey/box.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace monkey {
+
+// Immutable vector with structural sharing (a Clojure-style persistent vector): elements
+// live in 32-wide leaves under a trie of 32-way branches, except for the last, partly
+// filled leaf (the tail), which is kept outside the trie. push() copies the tail and,
+// once it is full, the path from the root to the new leaf; every other node is shared
+// with the vector it came from, so pushing is O(log32 n) and copying a vector is O(1).
+// rest() only moves the start index: the dropped element stays alive until the trie
+// does.
+//
+// Nodes are never modified after construction, so vectors may be read from any thread.
+// They are allocated through AccountingAllocator and charge the MemoryAccount bound when
+// they are created. They are freed through monkey::reclaim, since the elements of a leaf
+// may be arrays themselves: dropping an array nested 100,000 deep must not recurse.
+template <typename T>
+class PersistentVector {
+  public:
+    static constexpr unsigned BITS = 5;
+    static constexpr size_t WIDTH = size_t{1} << BITS;
+
+    PersistentVector() = default;
+
+    // Fills leaves directly instead of pushing the values one at a time.
+    static PersistentVector from(std::vector<T> values) {
+        PersistentVector result;
+        for (size_t first = 0; first < values.size(); first += WIDTH) {
+            auto leaf = makeLeaf();
+            auto length = std::min(WIDTH, values.size() - first);
+            std::move(values.begin() + static_cast<std::ptrdiff_t>(first),
+                      values.begin() + static_cast<std::ptrdiff_t>(first + length),
+                      leaf->values.begin());
+            if (result.tail_) {
+                result.commitTail();
+            }
+            result.tail_ = std::move(leaf);
+            result.count_ += length;
+        }
+        return result;
+    }
+
+    [[nodiscard]] size_t size() const { return count_ - start_; }
+    [[nodiscard]] bool empty() const { return count_ == start_; }
+
+    // `index` must be less than size().
+    [[nodiscard]] const T &operator[](size_t index) const {
+        auto position = start_ + index;
+        return leafFor(position)->values[position & MASK];
+    }
+
+    [[nodiscard]] PersistentVector push(T value) const {
+        PersistentVector result = *this;
+        auto tailSize = count_ - tailOffset();
+        if (tailSize < WIDTH) {
+            auto tail = tail_ ? makeLeaf(*tail_) : makeLeaf();
+            tail->values[tailSize] = std::move(value);
+            result.tail_ = std::move(tail);
+            ++result.count_;
+            return result;
+        }
+
+        result.commitTail();
+        auto tail = makeLeaf();
+        tail->values[0] = std::move(value);
+        result.tail_ = std::move(tail);
+        ++result.count_;
+        return result;
+    }
+
+    // All elements but the first; the vector must not be empty.
+    [[nodiscard]] PersistentVector rest() const {
+        PersistentVector result = *this;
+        ++result.start_;
+        return result;
+    }
+
+    // The elements from `index` to the end of the leaf holding it. `index` must be less
+    // than size().
+    [[nodiscard]] std::span<const T> chunkAt(size_t index) const {
+        auto position = start_ + index;
+        auto offset = position & MASK;
+        auto length = std::min(WIDTH - offset, count_ - position);
+        return std::span<const T>(leafFor(position)->values).subspan(offset, length);
+    }
+
+    // Calls `visit` with consecutive runs of the elements, in order, one per leaf.
+    template <typename Visitor>
+    void forEachChunk(Visitor &&visit) const {
+        for (size_t index = 0; index < size();) {
+            auto chunk = chunkAt(index);
+            visit(chunk);
+            index += chunk.size();
+        }
+    }
+
+  private:
+    static constexpr size_t MASK = WIDTH - 1;
+
+    // Leaves and branches are told apart by their depth in the trie.
+    struct Node {};
+    struct Leaf : Node {
+        std::array<T, WIDTH> values{};
+    };
+    struct Branch : Node {
+        std::array<std::shared_ptr<const Node>, WIDTH> children{};
+    };
+    using NodePtr = std::shared_ptr<const Node>;
+
+    template <typename... Args>
+    static std::shared_ptr<Leaf> makeLeaf(Args &&...args) {
+        return makeReclaimed<Leaf>(std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+    static std::shared_ptr<Branch> makeBranch(Args &&...args) {
+        return makeReclaimed<Branch>(std::forward<Args>(args)...);
+    }
+
+    // Index of the first element in the tail.
+    [[nodiscard]] size_t tailOffset() const {
+        return count_ < WIDTH ? 0 : ((count_ - 1) >> BITS) << BITS;
+    }
+
+    [[nodiscard]] const Leaf *leafFor(size_t position) const {
+        if (position >= tailOffset()) {
+            return tail_.get();
+        }
+        const Node *node = root_.get();
+        for (auto level = shift_; level > 0; level -= BITS) {
+            node = static_cast<const Branch *>(node)->children[(position >> level) & MASK]
+                       .get();
+        }
+        return static_cast<const Leaf *>(node);
+    }
+
+    // Moves the full tail into the trie, which grows a level when the root has no room
+    // left. The caller replaces the tail.
+    void commitTail() {
+        if ((count_ >> BITS) > (size_t{1} << shift_)) {
+            auto root = makeBranch();
+            root->children[0] = root_;
+            root->children[1] = newPath(shift_, tail_);
+            root_ = std::move(root);
+            shift_ += BITS;
+        } else {
+            root_ = pushTail(shift_, root_.get(), tail_);
+        }
+    }
+
+    // A chain of branches `level` bits high that leads to `node`.
+    static NodePtr newPath(unsigned level, NodePtr node) {
+        if (level == 0) {
+            return node;
+        }
+        auto branch = makeBranch();
+        branch->children[0] = newPath(level - BITS, std::move(node));
+        return branch;
+    }
+
+    // Copies the path from `parent` down to where the full tail goes.
+    NodePtr pushTail(unsigned level, const Node *parent, NodePtr tail) const {
+        auto branch = parent != nullptr ? makeBranch(*static_cast<const Branch *>(parent))
+                                        : makeBranch();
+        auto index = ((count_ - 1) >> level) & MASK;
+        if (level == BITS) {
+            branch->children[index] = std::move(tail);
+        } else if (const auto *child = branch->children[index].get()) {
+            branch->children[index] = pushTail(level - BITS, child, std::move(tail));
+        } else {
+            branch->children[index] = newPath(level - BITS, std::move(tail));
+        }
+        return branch;
+    }
+
+    NodePtr root_;
+    std::shared_ptr<const Leaf> tail_;
+    unsigned shift_ = BITS;
+    // Elements ever pushed, including the ones rest() skipped.
+    size_t count_ = 0;
+    size_t start_ = 0;
+};
+
+} // namespace monkey
\ No newline at end of file
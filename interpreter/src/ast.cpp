@@ -1,13 +1,17 @@
 #include "monkey/ast.h"
 #include "monkey/box.h"
+#include "monkey/output.h"
 #include "monkey/overload.h"
 
-#include <fmt/format.h>
-#include <fmt/ranges.h>
-
-#include <ranges>
+#include <array>
+#include <cstddef>
+#include <initializer_list>
+#include <span>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <variant>
+#include <vector>
 
 namespace monkey {
 
@@ -19,78 +23,215 @@ std::string tokenLiteral(const Program &program) {
     return monkey::tokenLiteral(program.statements[0]);
 }
 
-std::string toString(const Program &program) {
-    std::string result;
-    for (const auto &stmt : program.statements) {
-        result += toString(stmt);
+namespace {
+
+// Prints nodes with an explicit stack of the pieces still to be written, so that deeply
+// nested expressions cost heap rather than stack. A piece is a node or literal text,
+// which points into the printed tree or is a constant. Everything is appended to one
+// output, which the printer stops feeding once it is truncated.
+class Printer {
+  public:
+    using Piece = std::variant<const Expression *, const Statement *,
+                               const BlockStatement *, std::string_view>;
+
+    explicit Printer(BoundedOutput &out) : out_(out) {}
+
+    // Writes `roots` in order.
+    void print(std::span<const Piece> roots) {
+        pending_.assign(roots.rbegin(), roots.rend());
+        while (!pending_.empty() && !out_.truncated()) {
+            auto piece = pending_.back();
+            pending_.pop_back();
+            std::visit([this](auto next) { write(next); }, piece);
+        }
     }
-    return result;
-}
 
-std::string toString(const Expression &expr) {
-    return std::visit(
-        overloaded{
-            [](const Identifier &s) { return tokenLiteral(s); },
-            [](const IntegerLiteral &s) { return tokenLiteral(s); },
-            [](const BooleanLiteral &s) { return tokenLiteral(s); },
-            [](const StringLiteral &s) { return tokenLiteral(s); },
-            [](const Box<PrefixExpression> &s) {
-                return fmt::format("({}{})", s->op, toString(s->right));
-            },
-            [](const Box<InfixExpression> &s) {
-                return fmt::format("({} {} {})", toString(s->left), s->op,
-                                   toString(s->right));
+  private:
+    void write(std::string_view text) { out_.append(text); }
+
+    void write(const Expression *expr) {
+        std::visit(
+            overloaded{
+                [this](const Box<PrefixExpression> &s) {
+                    schedule({"(", s->op, &s->right, ")"});
+                },
+                [this](const Box<InfixExpression> &s) {
+                    schedule({"(", &s->left, " ", s->op, " ", &s->right, ")"});
+                },
+                [this](const Box<IfExpression> &s) {
+                    parts_.insert(parts_.end(),
+                                  {"if ", &s->condition, " ", &s->consequence});
+                    if (s->alternative) {
+                        parts_.insert(parts_.end(), {" else ", &*s->alternative});
+                    }
+                    schedule({});
+                },
+                [this](const Box<FunctionLiteral> &s) {
+                    parts_.emplace_back("fn(");
+                    join(s->parameters, [](const Identifier &p) -> Piece {
+                        return p.token.literal;
+                    });
+                    schedule({") ", &s->body});
+                },
+                [this](const Box<CallExpression> &s) {
+                    parts_.emplace_back(&s->function);
+                    parts_.emplace_back("(");
+                    join(s->arguments, [](const Expression &a) -> Piece { return &a; });
+                    schedule({")"});
+                },
+                [this](const Box<ArrayLiteral> &s) {
+                    parts_.emplace_back("[");
+                    join(s->elements, [](const Expression &e) -> Piece { return &e; });
+                    schedule({"]"});
+                },
+                [this](const Box<IndexExpression> &s) {
+                    schedule({"(", &s->left, "[", &s->index, "])"});
+                },
+                [this](const Box<HashLiteral> &s) {
+                    parts_.emplace_back("{");
+                    for (const auto &[key, value] : s->pairs) {
+                        if (&key != &s->pairs.front().first) {
+                            parts_.emplace_back(", ");
+                        }
+                        parts_.insert(parts_.end(), {&key, ":", &value});
+                    }
+                    schedule({"}"});
+                },
+                [this](const auto &leaf) { out_.append(leaf.token.literal); },
             },
-            [](const Box<IfExpression> &s) {
-                std::string result = fmt::format("if {} {}", toString(s->condition),
-                                                 toString(s->consequence));
-                if (s->alternative) {
-                    result += fmt::format(" else {}", toString(*s->alternative));
+            *expr);
+    }
+
+    void write(const Statement *stmt) {
+        std::visit(overloaded{
+                       [this](const LetStatement &s) {
+                           schedule({s.token.literal, " ", s.name.token.literal, " = ",
+                                     &s.value, ";"});
+                       },
+                       [this](const ExpressionStatement &s) {
+                           schedule({&s.expression});
+                       },
+                       [this](const BlockStatement &s) { schedule({&s}); },
+                       // Return and yield statements.
+                       [this](const auto &s) {
+                           schedule({s.token.literal, " ", &s.value, ";"});
+                       },
+                   },
+                   *stmt);
+    }
+
+    void write(const BlockStatement *block) {
+        parts_.emplace_back("{ ");
+        for (const auto &stmt : block->statements) {
+            parts_.emplace_back(&stmt);
+        }
+        schedule({" }"});
+    }
+
+    // Appends `items`, separated by commas, to the parts of the node being written.
+    template <typename Items, typename Project>
+    void join(const Items &items, Project project) {
+        for (const auto &item : items) {
+            if (&item != &items.front()) {
+                parts_.emplace_back(", ");
+            }
+            parts_.push_back(project(item));
+        }
+    }
+
+    // Finishes the parts of the node being written with `last`; they are written next,
+    // in order.
+    void schedule(std::initializer_list<Piece> last) {
+        parts_.insert(parts_.end(), last);
+        pending_.insert(pending_.end(), parts_.rbegin(), parts_.rend());
+        parts_.clear();
+    }
+
+    BoundedOutput &out_;
+    std::vector<Piece> pending_;
+    std::vector<Piece> parts_;
+};
+
+// Walks nested blocks and if branches with an explicit stack, so that long else-if
+// chains do not recurse. Generators ask for every statement they run, so the stack is
+// kept between calls rather than allocated each time.
+bool anyYields(std::span<const Statement> statements) {
+    thread_local std::vector<const Statement *> pending;
+    pending.clear();
+    auto push = [](std::span<const Statement> block) {
+        for (const auto &s : block) {
+            pending.push_back(&s);
+        }
+    };
+    push(statements);
+    while (!pending.empty()) {
+        const auto *statement = pending.back();
+        pending.pop_back();
+        if (std::holds_alternative<YieldStatement>(*statement)) {
+            return true;
+        }
+        if (const auto *block = std::get_if<BlockStatement>(statement)) {
+            push(block->statements);
+        } else if (const auto *s = std::get_if<ExpressionStatement>(statement)) {
+            if (const auto *expr = std::get_if<Box<IfExpression>>(&s->expression)) {
+                push((*expr)->consequence.statements);
+                if ((*expr)->alternative) {
+                    push((*expr)->alternative->statements);
                 }
-                return result;
-            },
-            [](const Box<FunctionLiteral> &s) {
-                return fmt::format(
-                    "fn({}) {}",
-                    fmt::join(std::views::transform(
-                                  s->parameters,
-                                  [](const Identifier &p) { return toString(p); }),
-                              ", "),
-                    toString(s->body));
-            },
-            [](const Box<CallExpression> &s) {
-                return fmt::format(
-                    "{}({})", toString(s->function),
-                    fmt::join(std::views::transform(
-                                  s->arguments,
-                                  [](const Expression &a) { return toString(a); }),
-                              ", "));
-            },
-        },
-        expr);
+            }
+        }
+    }
+    return false;
 }
 
-std::string toString(const Statement &stmt) {
-    return std::visit(
-        overloaded{
-            [](const LetStatement &s) {
-                return fmt::format("{} {} = {};", tokenLiteral(s), tokenLiteral(s.name),
-                                   toString(s.value));
-            },
-            [](const ReturnStatement &s) {
-                return fmt::format("{} {};", tokenLiteral(s), toString(s.value));
-            },
-            [](const ExpressionStatement &s) { return toString(s.expression); },
-            [](const BlockStatement &s) {
-                std::string result = "{ ";
-                for (const auto &stmt : s.statements) {
-                    result += toString(stmt);
-                }
-                result += " }";
-                return result;
-            },
-        },
-        stmt);
+} // namespace
+
+void print(BoundedOutput &out, const Program &program) {
+    std::vector<Printer::Piece> statements;
+    statements.reserve(program.statements.size());
+    for (const auto &stmt : program.statements) {
+        statements.emplace_back(&stmt);
+    }
+    Printer(out).print(statements);
+}
+
+void print(BoundedOutput &out, const Expression &expr) {
+    const std::array<Printer::Piece, 1> root{&expr};
+    Printer(out).print(root);
 }
 
+void print(BoundedOutput &out, const Statement &stmt) {
+    const std::array<Printer::Piece, 1> root{&stmt};
+    Printer(out).print(root);
+}
+
+void print(BoundedOutput &out, const BlockStatement &block) {
+    const std::array<Printer::Piece, 1> root{&block};
+    Printer(out).print(root);
+}
+
+std::string toString(const Program &program, size_t limit) {
+    return printToString([&](BoundedOutput &out) { print(out, program); }, limit);
+}
+
+std::string toString(const Expression &expr, size_t limit) {
+    return printToString([&](BoundedOutput &out) { print(out, expr); }, limit);
+}
+
+std::string toString(const Statement &stmt, size_t limit) {
+    return printToString([&](BoundedOutput &out) { print(out, stmt); }, limit);
+}
+
+bool yields(const Statement &statement) {
+    // Most statements are neither blocks nor if statements, which need the walk.
+    const auto *s = std::get_if<ExpressionStatement>(&statement);
+    if (!std::holds_alternative<BlockStatement>(statement) &&
+        (s == nullptr || !std::holds_alternative<Box<IfExpression>>(s->expression))) {
+        return std::holds_alternative<YieldStatement>(statement);
+    }
+    return anyYields({&statement, 1});
+}
+
+bool yields(const BlockStatement &block) { return anyYields(block.statements); }
+
 } // namespace monkey
\ No newline at end of file
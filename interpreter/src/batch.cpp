@@ -0,0 +1,97 @@
+#include "monkey/batch.h"
+#include "monkey/interpreter.h"
+#include "monkey/object.h"
+#include "monkey/program_cache.h"
+#include "monkey/thread_pool.h"
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <span>
+#include <sstream>
+#include <string>
+#include <variant>
+#include <vector>
+
+namespace {
+
+using namespace monkey;
+
+using Clock = std::chrono::steady_clock;
+
+void runScript(ScriptResult &script, ProgramCache &cache,
+               const InterpreterOptions &options) {
+    std::ifstream file(script.path);
+    if (!file) {
+        script.output = fmt::format("cannot open {}", script.path);
+        return;
+    }
+    std::stringstream source;
+    source << file.rdbuf();
+
+    auto parseStart = Clock::now();
+    auto [program, id, hit] = cache.get(source.str());
+    script.parseTime = Clock::now() - parseStart;
+    script.cached = hit;
+
+    auto evalStart = Clock::now();
+    Interpreter interpreter(options);
+    auto result = interpreter.run(*program);
+    script.evalTime = Clock::now() - evalStart;
+
+    script.ok = !std::holds_alternative<Error>(result);
+    script.output = inspect(result);
+}
+
+int64_t micros(std::chrono::nanoseconds time) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(time).count();
+}
+
+} // namespace
+
+namespace monkey {
+
+BatchReport runBatch(std::span<const std::string> paths, const BatchOptions &options) {
+    BatchReport report;
+    report.scripts.resize(paths.size());
+    for (size_t i = 0; i < paths.size(); ++i) {
+        report.scripts[i].path = paths[i];
+    }
+
+    ProgramCache cache;
+    auto start = Clock::now();
+    {
+        ThreadPool pool(options.jobs);
+        for (auto &script : report.scripts) {
+            pool.submit([&script, &cache, &options] {
+                runScript(script, cache, options.interpreter);
+            });
+        }
+        pool.wait();
+        report.jobs = pool.size();
+        report.steals = pool.steals();
+    }
+    report.wallTime = Clock::now() - start;
+    report.uniquePrograms = cache.size();
+    return report;
+}
+
+std::string timingTable(const BatchReport &report) {
+    std::string table = fmt::format("{:<40} {:>10} {:>10} {:>6} {}\n", "script",
+                                    "parse_us", "eval_us", "cached", "status");
+    for (const auto &script : report.scripts) {
+        table += fmt::format("{:<40} {:>10} {:>10} {:>6} {}\n", script.path,
+                             micros(script.parseTime), micros(script.evalTime),
+                             script.cached ? "yes" : "no", script.ok ? "ok" : "error");
+    }
+    table += fmt::format(
+        "{} scripts, {} unique programs, {} jobs, {} steals, {} us wall\n",
+        report.scripts.size(), report.uniquePrograms, report.jobs, report.steals,
+        micros(report.wallTime));
+    return table;
+}
+
+} // namespace monkey
\ No newline at end of file
@@ -0,0 +1,34 @@
+#include "monkey/box.h"
+
+#include <vector>
+
+namespace monkey {
+
+namespace {
+
+struct Pending {
+    void *cell;
+    void (*destroy)(void *);
+};
+
+thread_local std::vector<Pending> pending;
+thread_local bool reclaiming = false;
+
+} // namespace
+
+void reclaim(void *cell, void (*destroy)(void *)) {
+    if (reclaiming) {
+        pending.push_back({cell, destroy});
+        return;
+    }
+    reclaiming = true;
+    destroy(cell);
+    while (!pending.empty()) {
+        auto next = pending.back();
+        pending.pop_back();
+        next.destroy(next.cell);
+    }
+    reclaiming = false;
+}
+
+} // namespace monkey
\ No newline at end of file
@@ -0,0 +1,766 @@
+#include "monkey/builtins.h"
+#include "monkey/box.h"
+#include "monkey/generator.h"
+#include "monkey/io.h"
+#include "monkey/memo.h"
+#include "monkey/object.h"
+#include "monkey/simd.h"
+#include "monkey/task.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace {
+
+using namespace monkey;
+
+bool callable(const Object &obj) {
+    return std::holds_alternative<Box<Function>>(obj) ||
+           std::holds_alternative<Builtin>(obj) || std::holds_alternative<Memo>(obj);
+}
+
+std::optional<Error> checkArity(std::span<const Object> args, size_t want,
+                                CallContext &context) {
+    if (args.size() != want) {
+        return context.fail(
+            fmt::format("wrong number of arguments. got={}, want={}", args.size(), want));
+    }
+    return std::nullopt;
+}
+
+Error unsupported(std::string_view builtin, const Object &arg, CallContext &context) {
+    return context.fail(
+        fmt::format("argument to `{}` not supported, got {}", builtin, typeName(arg)));
+}
+
+// spawn(fn, args...) runs fn(args...) as a task and returns its handle.
+Object spawnBuiltin(std::span<const Object> args, CallContext &context) {
+    if (args.empty()) {
+        return context.fail("wrong number of arguments. got=0, want at least 1");
+    }
+    if (!callable(args.front())) {
+        return unsupported("spawn", args.front(), context);
+    }
+    for (const auto &arg : args) {
+        share(arg);
+    }
+
+    auto state = std::allocate_shared<TaskState>(
+        AccountingAllocator<TaskState>(),
+        [apply = context.fork(), fn = args.front(),
+         callArgs = std::vector<Object>(args.begin() + 1, args.end())] {
+            return apply(fn, callArgs);
+        });
+    context.tasks().spawn([state] { state->run(); });
+    return Task{std::move(state)};
+}
+
+// await(task) blocks until the task finished and returns its result (or its Error).
+Object awaitBuiltin(std::span<const Object> args, CallContext &context) {
+    if (auto err = checkArity(args, 1, context)) {
+        return *err;
+    }
+    const auto *task = std::get_if<Task>(&args.front());
+    if (task == nullptr) {
+        return unsupported("await", args.front(), context);
+    }
+    return task->state->await();
+}
+
+// channel() is unbounded; channel(n) holds at most n values.
+Object channelBuiltin(std::span<const Object> args, CallContext &context) {
+    if (args.size() > 1) {
+        return context.fail(
+            fmt::format("wrong number of arguments. got={}, want=0 or 1", args.size()));
+    }
+    int64_t capacity = 0;
+    if (!args.empty()) {
+        const auto *requested = std::get_if<int64_t>(&args.front());
+        if (requested == nullptr || *requested < 1) {
+            return context.fail(
+                fmt::format("channel capacity must be a positive integer, got {}",
+                            inspect(args.front())));
+        }
+        capacity = *requested;
+    }
+    return Channel{std::allocate_shared<ChannelState>(AccountingAllocator<ChannelState>(),
+                                                      static_cast<size_t>(capacity))};
+}
+
+// send(ch, value) blocks while the channel is full.
+Object sendBuiltin(std::span<const Object> args, CallContext &context) {
+    if (auto err = checkArity(args, 2, context)) {
+        return *err;
+    }
+    const auto *channel = std::get_if<Channel>(&args.front());
+    if (channel == nullptr) {
+        return unsupported("send", args.front(), context);
+    }
+    if (!channel->state->send(args[1])) {
+        return context.fail("send on closed channel");
+    }
+    return nullptr;
+}
+
+// recv(ch) blocks while the channel is empty; null once it is closed and drained.
+Object recvBuiltin(std::span<const Object> args, CallContext &context) {
+    if (auto err = checkArity(args, 1, context)) {
+        return *err;
+    }
+    const auto *channel = std::get_if<Channel>(&args.front());
+    if (channel == nullptr) {
+        return unsupported("recv", args.front(), context);
+    }
+    auto value = channel->state->receive();
+    return value ? std::move(*value) : Object{nullptr};
+}
+
+Object closeBuiltin(std::span<const Object> args, CallContext &context) {
+    if (auto err = checkArity(args, 1, context)) {
+        return *err;
+    }
+    const auto *channel = std::get_if<Channel>(&args.front());
+    if (channel == nullptr) {
+        return unsupported("close", args.front(), context);
+    }
+    channel->state->close();
+    return nullptr;
+}
+
+// next(gen) resumes the generator and returns the value it yields, or null once it is
+// exhausted.
+Object nextBuiltin(std::span<const Object> args, CallContext &context) {
+    if (auto err = checkArity(args, 1, context)) {
+        return *err;
+    }
+    const auto *generator = std::get_if<Generator>(&args.front());
+    if (generator == nullptr) {
+        return unsupported("next", args.front(), context);
+    }
+    return generator->state->next(context).value_or(nullptr);
+}
+
+// fold(gen, initial, fn) consumes the generator, returning fn(...fn(initial, a)..., z).
+// Unlike a recursive consumer written in Monkey it runs in constant space.
+Object foldBuiltin(std::span<const Object> args, CallContext &context) {
+    if (auto err = checkArity(args, 3, context)) {
+        return *err;
+    }
+    const auto *generator = std::get_if<Generator>(&args[0]);
+    if (generator == nullptr) {
+        return unsupported("fold", args[0], context);
+    }
+    if (!callable(args[2])) {
+        return unsupported("fold", args[2], context);
+    }
+
+    Object accumulator = args[1];
+    while (auto value = generator->state->next(context)) {
+        if (std::holds_alternative<Error>(*value)) {
+            return *value;
+        }
+        std::array<Object, 2> callArgs{std::move(accumulator), std::move(*value)};
+        accumulator = context.apply(args[2], callArgs);
+        if (std::holds_alternative<Error>(accumulator)) {
+            return accumulator;
+        }
+    }
+    return accumulator;
+}
+
+// len(x) is the length of a string in bytes, or the number of elements of an array.
+Object lenBuiltin(std::span<const Object> args, CallContext &context) {
+    if (auto err = checkArity(args, 1, context)) {
+        return *err;
+    }
+    if (const auto *string = std::get_if<String>(&args.front())) {
+        return static_cast<int64_t>(string->size());
+    }
+    if (const auto *array = std::get_if<Array>(&args.front())) {
+        return static_cast<int64_t>(array->size());
+    }
+    return unsupported("len", args.front(), context);
+}
+
+// first(a), last(a) and rest(a) give null for an empty array. rest(a) and push(a, x)
+// return new arrays that share their elements with `a`.
+Object firstBuiltin(std::span<const Object> args, CallContext &context) {
+    if (auto err = checkArity(args, 1, context)) {
+        return *err;
+    }
+    const auto *array = std::get_if<Array>(&args.front());
+    if (array == nullptr) {
+        return unsupported("first", args.front(), context);
+    }
+    return array->empty() ? Object{nullptr} : (*array)[0];
+}
+
+Object lastBuiltin(std::span<const Object> args, CallContext &context) {
+    if (auto err = checkArity(args, 1, context)) {
+        return *err;
+    }
+    const auto *array = std::get_if<Array>(&args.front());
+    if (array == nullptr) {
+        return unsupported("last", args.front(), context);
+    }
+    return array->empty() ? Object{nullptr} : (*array)[array->size() - 1];
+}
+
+Object restBuiltin(std::span<const Object> args, CallContext &context) {
+    if (auto err = checkArity(args, 1, context)) {
+        return *err;
+    }
+    const auto *array = std::get_if<Array>(&args.front());
+    if (array == nullptr) {
+        return unsupported("rest", args.front(), context);
+    }
+    if (array->empty()) {
+        return nullptr;
+    }
+    return array->rest();
+}
+
+Object pushBuiltin(std::span<const Object> args, CallContext &context) {
+    if (auto err = checkArity(args, 2, context)) {
+        return *err;
+    }
+    const auto *array = std::get_if<Array>(&args.front());
+    if (array == nullptr) {
+        return unsupported("push", args.front(), context);
+    }
+    return array->push(args[1]);
+}
+
+// The elements of `arg` if it is an array of integers only. Arrays that held some other
+// value once (and lost it to rest()) are unboxed here.
+std::optional<IntVector> integerElements(const Object &arg) {
+    const auto *array = std::get_if<Array>(&arg);
+    if (array == nullptr) {
+        return std::nullopt;
+    }
+    if (const auto *integers = array->integers()) {
+        return *integers;
+    }
+    bool allIntegers = true;
+    auto result = IntVector::build(array->size(), [&](int64_t *out) {
+        size_t count = 0;
+        array->forEach([&](const Object &element) {
+            if (const auto *integer = std::get_if<int64_t>(&element)) {
+                out[count++] = *integer;
+            } else {
+                allIntegers = false;
+            }
+        });
+        return count;
+    });
+    if (!allIntegers) {
+        return std::nullopt;
+    }
+    return result;
+}
+
+Error notIntegers(std::string_view builtin, const Object &arg, CallContext &context) {
+    const auto *array = std::get_if<Array>(&arg);
+    if (array == nullptr) {
+        return unsupported(builtin, arg, context);
+    }
+    std::string_view type;
+    array->forEach([&type](const Object &element) {
+        if (type.empty() && !std::holds_alternative<int64_t>(element)) {
+            type = typeName(element);
+        }
+    });
+    return context.fail(fmt::format(
+        "argument to `{}` not supported, got ARRAY with a {} element", builtin, type));
+}
+
+// sum(a), dot(a, b), min(a), max(a), mapAdd(a, n) and filterGt(a, n) take arrays of
+// integers and run the kernels in monkey/simd.h over them; sums and products wrap around
+// on overflow. min and max of an empty array are null.
+Object sumBuiltin(std::span<const Object> args, CallContext &context) {
+    if (auto err = checkArity(args, 1, context)) {
+        return *err;
+    }
+    auto values = integerElements(args[0]);
+    if (!values) {
+        return notIntegers("sum", args[0], context);
+    }
+    return simd::sum(values->values());
+}
+
+Object dotBuiltin(std::span<const Object> args, CallContext &context) {
+    if (auto err = checkArity(args, 2, context)) {
+        return *err;
+    }
+    auto a = integerElements(args[0]);
+    if (!a) {
+        return notIntegers("dot", args[0], context);
+    }
+    auto b = integerElements(args[1]);
+    if (!b) {
+        return notIntegers("dot", args[1], context);
+    }
+    if (a->size() != b->size()) {
+        return context.fail(fmt::format("arguments to `dot` differ in length: {} and {}",
+                                        a->size(), b->size()));
+    }
+    return simd::dot(a->values(), b->values());
+}
+
+Object minBuiltin(std::span<const Object> args, CallContext &context) {
+    if (auto err = checkArity(args, 1, context)) {
+        return *err;
+    }
+    auto values = integerElements(args[0]);
+    if (!values) {
+        return notIntegers("min", args[0], context);
+    }
+    return values->empty() ? Object{nullptr} : simd::min(values->values());
+}
+
+Object maxBuiltin(std::span<const Object> args, CallContext &context) {
+    if (auto err = checkArity(args, 1, context)) {
+        return *err;
+    }
+    auto values = integerElements(args[0]);
+    if (!values) {
+        return notIntegers("max", args[0], context);
+    }
+    return values->empty() ? Object{nullptr} : simd::max(values->values());
+}
+
+Object mapAddBuiltin(std::span<const Object> args, CallContext &context) {
+    if (auto err = checkArity(args, 2, context)) {
+        return *err;
+    }
+    auto values = integerElements(args[0]);
+    if (!values) {
+        return notIntegers("mapAdd", args[0], context);
+    }
+    const auto *addend = std::get_if<int64_t>(&args[1]);
+    if (addend == nullptr) {
+        return unsupported("mapAdd", args[1], context);
+    }
+    auto input = values->values();
+    return Array(IntVector::build(input.size(), [&](int64_t *out) {
+        simd::add(input, *addend, out);
+        return input.size();
+    }));
+}
+
+Object filterGtBuiltin(std::span<const Object> args, CallContext &context) {
+    if (auto err = checkArity(args, 2, context)) {
+        return *err;
+    }
+    auto values = integerElements(args[0]);
+    if (!values) {
+        return notIntegers("filterGt", args[0], context);
+    }
+    const auto *bound = std::get_if<int64_t>(&args[1]);
+    if (bound == nullptr) {
+        return unsupported("filterGt", args[1], context);
+    }
+    auto input = values->values();
+    return Array(IntVector::build(input.size(), [&](int64_t *out) {
+        return simd::filterGreater(input, *bound, out);
+    }));
+}
+
+// Runs the jobs as tasks of the caller's group and waits for all of them. The calling
+// thread runs the ones no worker has started (see TaskState::await), so this makes
+// progress on a busy or single-threaded scheduler too. Returns the first Error a job
+// returned, in job order; the other jobs still run to completion.
+std::optional<Object> runAll(std::vector<std::function<Object()>> jobs,
+                             CallContext &context) {
+    std::vector<std::shared_ptr<TaskState>> tasks;
+    tasks.reserve(jobs.size());
+    for (auto &job : jobs) {
+        auto state = std::allocate_shared<TaskState>(AccountingAllocator<TaskState>(),
+                                                     std::move(job));
+        context.tasks().spawn([state] { state->run(); });
+        tasks.push_back(std::move(state));
+    }
+    std::optional<Object> failure;
+    // Awaited in reverse: the newest tasks are the least likely to have been started.
+    for (auto it = tasks.rbegin(); it != tasks.rend(); ++it) {
+        auto result = (*it)->await();
+        if (std::holds_alternative<Error>(result)) {
+            failure = std::move(result);
+        }
+    }
+    return failure;
+}
+
+// About four chunks per scheduler worker, so that uneven chunks even out, of at least
+// `grain` elements unless there are fewer.
+size_t chunkCount(size_t size, size_t grain) {
+    return std::clamp<size_t>(size / grain, 1, scheduler().size() * 4);
+}
+
+// Runs `work(chunk, first, last, apply)` for each of the chunkCount() chunks of
+// [0, size) as a task with its own Applier.
+template <typename Work>
+std::optional<Object> forChunks(size_t size, size_t grain, CallContext &context,
+                                Work &work) {
+    auto chunks = chunkCount(size, grain);
+    std::vector<std::function<Object()>> jobs;
+    for (size_t chunk = 0; chunk < chunks; ++chunk) {
+        jobs.emplace_back([&work, chunk, first = size * chunk / chunks,
+                           last = size * (chunk + 1) / chunks,
+                           apply = context.fork()]() mutable {
+            return work(chunk, first, last, apply);
+        });
+    }
+    return runAll(std::move(jobs), context);
+}
+
+// Elements per chunk: enough calls that a chunk outweighs the cost of its task.
+constexpr size_t CALL_GRAIN = 256;
+// Elements below which psort sorts on the calling thread.
+constexpr size_t SORT_GRAIN = 16384;
+
+// pmap(a, fn), preduce(a, fn, initial) and psort(a) split an array into chunks and work
+// on them in parallel, on the scheduler (see monkey/task.h). Monkey functions cannot
+// assign to the environments they close over, so any function is safe to run this way;
+// calling pmap or preduce declares that `fn` has no other side effects whose order
+// matters (channels, files). The first Error, in array order, is returned.
+//
+// pmap(a, fn) is [fn(a[0]), fn(a[1]), ...].
+Object pmapBuiltin(std::span<const Object> args, CallContext &context) {
+    if (auto err = checkArity(args, 2, context)) {
+        return *err;
+    }
+    const auto *array = std::get_if<Array>(&args[0]);
+    if (array == nullptr) {
+        return unsupported("pmap", args[0], context);
+    }
+    if (!callable(args[1])) {
+        return unsupported("pmap", args[1], context);
+    }
+    share(args[0]);
+    share(args[1]);
+    std::vector<Object> results(array->size());
+    auto work = [&](size_t, size_t first, size_t last, CallContext::Applier &apply) {
+        for (auto i = first; i < last; ++i) {
+            std::array<Object, 1> callArgs{(*array)[i]};
+            auto result = apply(args[1], callArgs);
+            if (std::holds_alternative<Error>(result)) {
+                return result;
+            }
+            share(result);
+            results[i] = std::move(result);
+        }
+        return Object{nullptr};
+    };
+    if (auto failure = forChunks(array->size(), CALL_GRAIN, context, work)) {
+        return *failure;
+    }
+    return Array::from(std::move(results));
+}
+
+// preduce(a, fn, initial) is fold over the array when `fn` is associative: each chunk is
+// folded starting from its first element, then the chunk results are folded, in order,
+// starting from `initial`. An empty array gives `initial`.
+Object preduceBuiltin(std::span<const Object> args, CallContext &context) {
+    if (auto err = checkArity(args, 3, context)) {
+        return *err;
+    }
+    const auto *array = std::get_if<Array>(&args[0]);
+    if (array == nullptr) {
+        return unsupported("preduce", args[0], context);
+    }
+    if (!callable(args[1])) {
+        return unsupported("preduce", args[1], context);
+    }
+    share(args[0]);
+    share(args[1]);
+    std::vector<Object> partials;
+    auto work = [&](size_t chunk, size_t first, size_t last,
+                    CallContext::Applier &apply) {
+        auto accumulator = (*array)[first];
+        for (auto i = first + 1; i < last; ++i) {
+            std::array<Object, 2> callArgs{std::move(accumulator), (*array)[i]};
+            accumulator = apply(args[1], callArgs);
+            if (std::holds_alternative<Error>(accumulator)) {
+                return accumulator;
+            }
+        }
+        share(accumulator);
+        partials[chunk] = std::move(accumulator);
+        return Object{nullptr};
+    };
+    if (!array->empty()) {
+        partials.resize(chunkCount(array->size(), CALL_GRAIN));
+        if (auto failure = forChunks(array->size(), CALL_GRAIN, context, work)) {
+            return *failure;
+        }
+    }
+    auto accumulator = args[2];
+    for (auto &partial : partials) {
+        std::array<Object, 2> callArgs{std::move(accumulator), std::move(partial)};
+        accumulator = context.apply(args[1], callArgs);
+        if (std::holds_alternative<Error>(accumulator)) {
+            return accumulator;
+        }
+    }
+    return accumulator;
+}
+
+// Sorts `values` with `less`: the chunks in parallel, then merges pairs of neighbouring
+// runs, each round in parallel, back and forth between `values` and a scratch buffer.
+template <typename T, typename Less>
+void parallelSort(std::span<T> values, Less less, CallContext &context) {
+    auto chunks = chunkCount(values.size(), SORT_GRAIN);
+    std::vector<size_t> bounds;
+    for (size_t chunk = 0; chunk <= chunks; ++chunk) {
+        bounds.push_back(values.size() * chunk / chunks);
+    }
+    // The jobs only sort and merge in place and always return nullptr, so runAll() has
+    // no Error to report.
+    std::vector<std::function<Object()>> sorts;
+    for (size_t chunk = 0; chunk < chunks; ++chunk) {
+        sorts.emplace_back([=] {
+            std::sort(values.begin() + static_cast<std::ptrdiff_t>(bounds[chunk]),
+                      values.begin() + static_cast<std::ptrdiff_t>(bounds[chunk + 1]),
+                      less);
+            return Object{nullptr};
+        });
+    }
+    runAll(std::move(sorts), context);
+
+    std::vector<T, AccountingAllocator<T>> scratch(chunks > 1 ? values.size() : 0);
+    std::span<T> from = values;
+    std::span<T> to = scratch;
+    while (bounds.size() > 2) {
+        std::vector<size_t> merged;
+        std::vector<std::function<Object()>> merges;
+        for (size_t run = 0; run + 1 < bounds.size(); run += 2) {
+            merged.push_back(bounds[run]);
+            auto first = bounds[run];
+            auto middle = bounds[run + 1];
+            auto last = run + 2 < bounds.size() ? bounds[run + 2] : middle;
+            merges.emplace_back([=] {
+                auto at = [](std::span<T> span, size_t i) {
+                    return span.begin() + static_cast<std::ptrdiff_t>(i);
+                };
+                std::merge(std::make_move_iterator(at(from, first)),
+                           std::make_move_iterator(at(from, middle)),
+                           std::make_move_iterator(at(from, middle)),
+                           std::make_move_iterator(at(from, last)), at(to, first), less);
+                return Object{nullptr};
+            });
+        }
+        merged.push_back(values.size());
+        runAll(std::move(merges), context);
+        bounds = std::move(merged);
+        std::swap(from, to);
+    }
+    if (from.data() != values.data()) {
+        std::ranges::move(from, values.begin());
+    }
+}
+
+// psort(a) sorts an array of integers, or of strings (by their bytes).
+Object psortBuiltin(std::span<const Object> args, CallContext &context) {
+    if (auto err = checkArity(args, 1, context)) {
+        return *err;
+    }
+    const auto *array = std::get_if<Array>(&args[0]);
+    if (array == nullptr) {
+        return unsupported("psort", args[0], context);
+    }
+    if (auto integers = integerElements(args[0])) {
+        auto input = integers->values();
+        return Array(IntVector::build(input.size(), [&](int64_t *out) {
+            std::ranges::copy(input, out);
+            parallelSort(std::span(out, input.size()), std::less<>(), context);
+            return input.size();
+        }));
+    }
+    std::vector<Object> strings;
+    strings.reserve(array->size());
+    std::string_view other;
+    array->forEach([&](const Object &element) {
+        if (std::holds_alternative<String>(element)) {
+            strings.push_back(element);
+        } else if (other.empty()) {
+            other = typeName(element);
+        }
+    });
+    if (!other.empty()) {
+        return context.fail(fmt::format(
+            "argument to `psort` not supported, got ARRAY with a {} element", other));
+    }
+    parallelSort(std::span(strings),
+                 [](const Object &a, const Object &b) {
+                     return std::get<String>(a).view() < std::get<String>(b).view();
+                 },
+                 context);
+    return Array::from(std::move(strings));
+}
+
+// memo(fn) and memo(fn, capacity) return `fn` memoized (see monkey/memo.h), keeping the
+// results of at most `capacity` argument tuples. `fn` must pass impurity().
+Object memoBuiltin(std::span<const Object> args, CallContext &context) {
+    if (args.empty() || args.size() > 2) {
+        return context.fail(
+            fmt::format("wrong number of arguments. got={}, want=1 or 2", args.size()));
+    }
+    const auto *fn = std::get_if<Box<Function>>(&args[0]);
+    if (fn == nullptr) {
+        return unsupported("memo", args[0], context);
+    }
+    auto capacity = static_cast<int64_t>(MemoTable::DEFAULT_CAPACITY);
+    if (args.size() == 2) {
+        const auto *requested = std::get_if<int64_t>(&args[1]);
+        if (requested == nullptr || *requested <= 0) {
+            return context.fail(fmt::format(
+                "memo capacity must be a positive integer, got {}", inspect(args[1])));
+        }
+        capacity = *requested;
+    }
+    if (auto reason = impurity(*std::as_const(*fn))) {
+        return context.fail("cannot memoize " + *reason);
+    }
+    return Memo{std::allocate_shared<MemoTable>(AccountingAllocator<MemoTable>(), args[0],
+                                                static_cast<size_t>(capacity))};
+}
+
+// memoStats(m) is a hash of the hits, misses and evictions of m's table, its size and
+// its capacity.
+Object memoStatsBuiltin(std::span<const Object> args, CallContext &context) {
+    if (auto err = checkArity(args, 1, context)) {
+        return *err;
+    }
+    const auto *memo = std::get_if<Memo>(&args[0]);
+    if (memo == nullptr) {
+        return unsupported("memoStats", args[0], context);
+    }
+    auto stats = memo->table->stats();
+    auto table = makeReclaimed<HashTable>(size_t{5});
+    for (auto [name, value] : {std::pair{"hits", stats.hits},
+                               std::pair{"misses", stats.misses},
+                               std::pair{"evictions", stats.evictions},
+                               std::pair{"size", uint64_t{stats.size}},
+                               std::pair{"capacity", uint64_t{stats.capacity}}}) {
+        table->insert(*hashKey(String(name)), static_cast<int64_t>(value));
+    }
+    return Hash{std::move(table)};
+}
+
+// readFile(path), readLines(path) and writeFile(path, contents) start a request on the
+// I/O loop and return a task; await it for the contents, a generator of the lines or
+// the number of bytes written.
+Object readFileBuiltin(std::span<const Object> args, CallContext &context) {
+    if (auto err = checkArity(args, 1, context)) {
+        return *err;
+    }
+    const auto *path = std::get_if<String>(&args.front());
+    if (path == nullptr) {
+        return unsupported("readFile", args.front(), context);
+    }
+    return io().readFile(std::string(path->view()), &context.tasks());
+}
+
+Object readLinesBuiltin(std::span<const Object> args, CallContext &context) {
+    if (auto err = checkArity(args, 1, context)) {
+        return *err;
+    }
+    const auto *path = std::get_if<String>(&args.front());
+    if (path == nullptr) {
+        return unsupported("readLines", args.front(), context);
+    }
+    return io().readLines(std::string(path->view()), &context.tasks());
+}
+
+// lines(path) is a generator over the lines of a file, mapped into memory rather than
+// read (see mapLines()).
+Object linesBuiltin(std::span<const Object> args, CallContext &context) {
+    if (auto err = checkArity(args, 1, context)) {
+        return *err;
+    }
+    const auto *path = std::get_if<String>(&args.front());
+    if (path == nullptr) {
+        return unsupported("lines", args.front(), context);
+    }
+    return mapLines(std::string(path->view()));
+}
+
+Object writeFileBuiltin(std::span<const Object> args, CallContext &context) {
+    if (auto err = checkArity(args, 2, context)) {
+        return *err;
+    }
+    const auto *path = std::get_if<String>(&args[0]);
+    if (path == nullptr) {
+        return unsupported("writeFile", args[0], context);
+    }
+    const auto *contents = std::get_if<String>(&args[1]);
+    if (contents == nullptr) {
+        return unsupported("writeFile", args[1], context);
+    }
+    return io().writeFile(std::string(path->view()), ManagedString(contents->view()),
+                          &context.tasks());
+}
+
+// Sorted by name for lookupBuiltin().
+constexpr auto BUILTINS = std::to_array<Builtin>({
+    {"await", awaitBuiltin},
+    {"channel", channelBuiltin},
+    {"close", closeBuiltin},
+    {"dot", dotBuiltin},
+    {"filterGt", filterGtBuiltin},
+    {"first", firstBuiltin},
+    {"fold", foldBuiltin},
+    {"last", lastBuiltin},
+    {"len", lenBuiltin},
+    {"lines", linesBuiltin},
+    {"mapAdd", mapAddBuiltin},
+    {"max", maxBuiltin},
+    {"memo", memoBuiltin},
+    {"memoStats", memoStatsBuiltin},
+    {"min", minBuiltin},
+    {"next", nextBuiltin},
+    {"pmap", pmapBuiltin},
+    {"preduce", preduceBuiltin},
+    {"psort", psortBuiltin},
+    {"push", pushBuiltin},
+    {"readFile", readFileBuiltin},
+    {"readLines", readLinesBuiltin},
+    {"recv", recvBuiltin},
+    {"rest", restBuiltin},
+    {"send", sendBuiltin},
+    {"spawn", spawnBuiltin},
+    {"sum", sumBuiltin},
+    {"writeFile", writeFileBuiltin},
+});
+
+static_assert(std::ranges::is_sorted(BUILTINS, std::ranges::less{}, &Builtin::name),
+              "BUILTINS must be sorted by name");
+
+} // namespace
+
+namespace monkey {
+
+const Builtin *lookupBuiltin(std::string_view name) {
+    const auto *it =
+        std::ranges::lower_bound(BUILTINS, name, std::ranges::less{}, &Builtin::name);
+    if (it != BUILTINS.end() && it->name == name) {
+        return it;
+    }
+    return nullptr;
+}
+
+} // namespace monkey
\ No newline at end of file
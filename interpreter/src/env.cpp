@@ -1,14 +1,27 @@
 #include "monkey/env.h"
+#include "monkey/memory.h"
 
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <shared_mutex>
 #include <string>
+#include <variant>
 
 namespace monkey {
 
 std::optional<Object> Environment::get(const std::string &name) const {
-    auto it = store_.find(name);
-    if (it != store_.end()) {
-        return it->second;
+    stats::recordScopeVisit();
+    {
+        std::shared_lock lock(mutex_, std::defer_lock);
+        if (shared_.load(std::memory_order_relaxed)) {
+            lock.lock();
+        }
+        auto it = store_.find(name);
+        if (it != store_.end()) {
+            stats::recordObjectCopy(std::holds_alternative<Box<Function>>(it->second));
+            return it->second;
+        }
     }
     if (outer_ != nullptr) {
         return outer_->get(name);
@@ -17,9 +30,29 @@ std::optional<Object> Environment::get(const std::string &name) const {
 }
 
 void Environment::set(const std::string &name, Object value) {
-    store_[name] = std::move(value);
+    std::unique_lock lock(mutex_, std::defer_lock);
+    if (shared_.load(std::memory_order_relaxed)) {
+        lock.lock();
+    }
+    auto [it, inserted] = store_.insert_or_assign(name, std::move(value));
+    version_.store(version_.load(std::memory_order_relaxed) + 1,
+                   std::memory_order_relaxed);
+    if (inserted) {
+        stats::recordHeapBytes(sizeof(*it) + name.size());
+    }
+}
+
+void Environment::share() {
+    // The outer frames of a shared frame are already shared.
+    for (auto *frame = this; frame != nullptr && !frame->shared_.load();
+         frame = frame->outer_.get()) {
+        frame->shared_.store(true);
+    }
 }
 
-std::shared_ptr<Environment> makeEnvironment() { return std::make_shared<Environment>(); }
+std::shared_ptr<Environment> makeEnvironment(std::shared_ptr<Environment> outer) {
+    return std::allocate_shared<Environment>(AccountingAllocator<Environment>(),
+                                             std::move(outer));
+}
 
 } // namespace monkey
\ No newline at end of file
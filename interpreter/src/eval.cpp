@@ -1,16 +1,36 @@
 #include "monkey/eval.h"
 #include "monkey/ast.h"
 #include "monkey/box.h"
+#include "monkey/budget.h"
+#include "monkey/builtins.h"
 #include "monkey/env.h"
+#include "monkey/generator.h"
+#include "monkey/memo.h"
+#include "monkey/memory.h"
 #include "monkey/object.h"
 #include "monkey/overload.h"
+#include "monkey/stats.h"
+#include "monkey/task.h"
+#include "monkey/trace.h"
 
 #include <fmt/format.h>
 
+#include <algorithm>
+#include <array>
+#include <concepts>
+#include <cstddef>
 #include <cstdint>
+#include <deque>
+#include <iterator>
+#include <limits>
 #include <memory>
+#include <new>
+#include <optional>
 #include <ranges>
+#include <span>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <variant>
 #include <vector>
 
@@ -18,288 +38,1118 @@ namespace {
 
 using namespace monkey;
 
-bool isTrue(const Object &obj) {
-    if (std::holds_alternative<bool>(obj)) {
-        return std::get<bool>(obj);
+void recordCopy(const Object &obj) {
+    stats::recordObjectCopy(std::holds_alternative<Box<Function>>(obj));
+}
+
+// The policy a spawned task evaluates under. The trace log is not thread-safe, so tasks
+// of a traced evaluation are not traced.
+NoTrace forkPolicy(const NoTrace & /*policy*/) { return {}; }
+NoTrace forkPolicy(const Tracer & /*tracer*/) { return {}; }
+Budget forkPolicy(const Budget &budget) { return budget.fork(); }
+
+using Env = const std::shared_ptr<Environment> *;
+
+// What a frame of the work stack does when it is resumed, which happens once the value
+// it waits for is on top of the value stack (and once when it is pushed).
+enum class Step : uint8_t {
+    PROGRAM, // The statements of a program
+    BLOCK,   // The statements of a block
+    LET,
+    RETURN,
+    PREFIX,
+    INFIX,
+    IF,
+    INDEX,
+    CALL,
+    ARRAY,
+    HASH,
+    BODY, // A function body, which returns to its call site
+    MEMO, // A call to a memoized function, whose result goes into the table
+};
+
+struct Frame {
+    Step step;
+    // How many of its statements or operands the frame has started.
+    uint32_t next = 0;
+    // The statements of a block, the call site of a body, or else the node of the step.
+    const void *node = nullptr;
+    Env env = nullptr;
+    // The height of the value stack below the values the frame collects.
+    size_t base = 0;
+
+    template <typename Node>
+    [[nodiscard]] const Node &as() const {
+        return *static_cast<const Node *>(node);
     }
-    if (std::holds_alternative<std::nullptr_t>(obj)) {
-        return false;
+};
+
+// A function body under way: the frame binding its arguments, and its call depth.
+struct Activation {
+    std::shared_ptr<Environment> env;
+    stats::CallScope scope;
+};
+
+// A hash literal under way: the pairs so far, and the key whose value is being evaluated.
+struct PendingHash {
+    std::shared_ptr<HashTable> table;
+    std::optional<HashKey> key;
+};
+
+// A call to a memoized function; arguments that cannot be hashed have no key.
+struct PendingMemo {
+    std::shared_ptr<MemoTable> table;
+    std::optional<MemoKey> key;
+};
+
+// The stacks of the evaluations on a thread. Evaluations on one thread nest (a builtin
+// that applies a function evaluates inside the evaluation that called it) and each pops
+// exactly what it pushed, so they share the stacks of their thread.
+struct Stacks {
+    std::vector<Frame> work;
+    std::vector<Object> values;
+    // A deque, so that frames can point at the environments.
+    std::deque<Activation> activations;
+    std::vector<PendingHash> hashes;
+    std::vector<PendingMemo> memos;
+};
+
+thread_local Stacks stacks;
+
+// The evaluator is parameterized by an EvalPolicy so that hooks such as tracing are
+// resolved at compile time; Evaluator<NoTrace> compiles to the plain tree walker.
+//
+// A node with operands pushes a Frame onto the work stack, which starts its operands one
+// at a time and is resumed as each of their values arrives on the value stack. Every
+// statement and expression leaves exactly one value there. A freshly pushed frame is
+// resumed right away, nested in the C++ call that pushed it, but at most MAX_INLINE deep;
+// beyond that it is left for the loop in run(). Nested expressions, blocks and function
+// calls thus cost heap memory rather than C++ stack; only builtins that call back into
+// the evaluator (fold, pmap, next, ...) nest a C++ call of unbounded depth, which runs
+// the loop until the frames pushed for it are done.
+template <EvalPolicy Policy>
+class Evaluator {
+  public:
+    Evaluator(Policy &policy, TaskGroup &tasks)
+        : policy_(policy), tasks_(tasks), stacks_(stacks) {}
+
+    Object evalProgram(const std::vector<Statement> &statements,
+                       const std::shared_ptr<Environment> &env) {
+        return guarded([&] { push(Step::PROGRAM, &statements, &env); });
     }
-    return true;
-}
 
-Object evalProgram(const std::vector<Statement> &statements,
-                   const std::shared_ptr<Environment> &env) {
-    Object result;
-    for (const auto &statement : statements) {
-        result = eval(statement, env);
-        if (std::holds_alternative<Box<ReturnValue>>(result)) {
-            return std::get<Box<ReturnValue>>(result)->value;
+    Object eval(const Statement &statement, const std::shared_ptr<Environment> &env) {
+        return guarded([&] { begin(statement, &env); });
+    }
+
+    Object eval(const Expression &expression, const std::shared_ptr<Environment> &env) {
+        return guarded([&] { begin(expression, &env); });
+    }
+
+    // Applies a Function, Builtin or Memo to already evaluated arguments. `call` is the
+    // call site reported to the policy hooks.
+    Object apply(const Object &function, std::span<const Object> args,
+                 const CallExpression &call) {
+        auto base = stacks_.values.size();
+        return guarded([&] { invoke(function, args, call, base); });
+    }
+
+  private:
+    // Handed to a builtin for the duration of one call.
+    class Context final : public CallContext {
+      public:
+        Context(Evaluator &evaluator, const CallExpression &call)
+            : evaluator_(evaluator), call_(call) {}
+
+        Object apply(const Object &fn, std::span<const Object> args) override {
+            return evaluator_.apply(fn, args, call_);
         }
-        if (std::holds_alternative<Error>(result)) {
-            return std::get<Error>(result);
+
+        Object evaluate(const Statement &statement,
+                        const std::shared_ptr<Environment> &env) override {
+            return evaluator_.eval(statement, env);
+        }
+
+        Object evaluate(const Expression &expression,
+                        const std::shared_ptr<Environment> &env) override {
+            return evaluator_.eval(expression, env);
         }
-    }
-    return result;
-}
 
-Object evalBlockStatements(const std::vector<Statement> &statements,
-                           const std::shared_ptr<Environment> &env) {
-    Object result;
-    for (const auto &statement : statements) {
-        result = eval(statement, env);
-        if (std::holds_alternative<Box<ReturnValue>>(result)) {
-            return result;
+        Applier fork() override {
+            // Tasks finish before the evaluation returns (TaskGroup), so the call site
+            // and the group outlive every copy of the Applier.
+            return [policy = forkPolicy(evaluator_.policy_), tasks = &evaluator_.tasks_,
+                    account = memory::current, call = &call_](
+                       const Object &fn, std::span<const Object> args) mutable {
+                const MemoryScope scope(account);
+                Evaluator<decltype(policy)> evaluator(policy, *tasks);
+                return evaluator.apply(fn, args, *call);
+            };
         }
-        if (std::holds_alternative<Error>(result)) {
-            return result;
+
+        TaskGroup &tasks() override { return evaluator_.tasks_; }
+
+        Error fail(std::string message) override {
+            return evaluator_.fail(Error{std::move(message)});
         }
+
+      private:
+        Evaluator &evaluator_;
+        const CallExpression &call_;
+    };
+
+    // Every Error starts here so that the policy sees it exactly once.
+    template <typename... Args>
+    Error error(fmt::format_string<Args...> format, Args &&...args) {
+        return fail(Error{fmt::format(format, std::forward<Args>(args)...)});
     }
-    return result;
-}
 
-Object evalLetStatement(const LetStatement &stmt,
-                        const std::shared_ptr<Environment> &env) {
-    auto value = eval(stmt.value, env);
-    if (std::holds_alternative<Error>(value)) {
-        return value;
+    Error fail(Error err) {
+        policy_.onError(err);
+        return err;
     }
-    env->set(tokenLiteral(stmt.name), value);
-    return nullptr;
-}
 
-std::vector<Object> evalExpressions(const std::vector<Expression> &exps,
-                                    const std::shared_ptr<Environment> &env) {
-    std::vector<Object> result;
-    for (const auto &e : exps) {
-        auto evaluated = eval(e, env);
-        if (std::holds_alternative<Error>(evaluated)) {
-            return {evaluated};
+    // Starts an evaluation and runs it to its value. An allocation the memory quota
+    // refuses (or that fails) unwinds to here: the stacks are cut back to where they were
+    // and the evaluation fails with an Error instead.
+    Object guarded(auto start) {
+        const auto work = stacks_.work.size();
+        const auto values = stacks_.values.size();
+        const auto activations = stacks_.activations.size();
+        const auto hashes = stacks_.hashes.size();
+        const auto memos = stacks_.memos.size();
+        try {
+            start();
+            return run(work);
+        } catch (const std::bad_alloc &e) {
+            auto cut = [](auto &stack, size_t height) {
+                while (stack.size() > height) {
+                    stack.pop_back();
+                }
+            };
+            cut(stacks_.work, work);
+            cut(stacks_.values, values);
+            cut(stacks_.activations, activations);
+            cut(stacks_.hashes, hashes);
+            cut(stacks_.memos, memos);
+            if (dynamic_cast<const MemoryQuotaExceeded *>(&e) != nullptr) {
+                return fail(Error{e.what()});
+            }
+            return error("evaluation ran out of memory");
         }
-        result.push_back(evaluated);
     }
-    return result;
-}
 
-Object evalPrefixExpression(const PrefixExpression &expr,
-                            const std::shared_ptr<Environment> &env) {
-    auto right = eval(expr.right, env);
+    // Resumes the frames above `depth` until they are done, and pops the value they
+    // leave.
+    Object run(size_t depth) {
+        while (stacks_.work.size() > depth) {
+            resume(stacks_.work.size() - 1);
+        }
+        auto result = std::move(stacks_.values.back());
+        stacks_.values.pop_back();
+        return result;
+    }
 
-    if (std::holds_alternative<Error>(right)) {
-        return right;
+    void push(Step step, const void *node, Env env, size_t base = 0) {
+        stacks_.work.push_back({.step = step, .next = 0, .node = node, .env = env,
+                                .base = base});
     }
-    if (expr.op == "!") {
-        if (std::holds_alternative<bool>(right)) {
-            return !std::get<bool>(right);
+
+    // Pushes a frame and, unless that nests too deep on the C++ stack, resumes it right
+    // away rather than from run(). Returns whether the frame is done.
+    template <Step step>
+    bool enter(const void *node, Env env) {
+        auto at = stacks_.work.size();
+        push(step, node, env);
+        if (inline_ == MAX_INLINE) {
+            return false;
         }
-        if (std::holds_alternative<int64_t>(right)) {
-            return std::get<int64_t>(right) == 0;
+        ++inline_;
+        resume<step>(at);
+        --inline_;
+        return stacks_.work.size() == at;
+    }
+
+    // Replaces the values from height `base` up with `value`.
+    void finish(size_t base, Object value) {
+        auto &values = stacks_.values;
+        values.erase(values.begin() + static_cast<std::ptrdiff_t>(base), values.end());
+        values.push_back(std::move(value));
+    }
+
+    // Starts evaluating `statement` or `expression`, and returns whether its value is
+    // already on the value stack. Otherwise begin() left a frame to resume.
+    bool begin(const Statement &statement, Env env) {
+        auto &values = stacks_.values;
+        if (auto stop = policy_.onStep()) {
+            values.emplace_back(fail(std::move(*stop)));
+            return true;
         }
-        if (std::holds_alternative<std::nullptr_t>(right)) {
+        policy_.onStatement(statement);
+        return std::visit(
+            overloaded{[this, env](const ExpressionStatement &stmt) {
+                           return begin(stmt.expression, env);
+                       },
+                       [this, env](const BlockStatement &stmt) {
+                           return enter<Step::BLOCK>(&stmt.statements, env);
+                       },
+                       [this, &values, env](const ReturnStatement &stmt) {
+                           if (!isSimple(stmt.value)) {
+                               return enter<Step::RETURN>(&stmt, env);
+                           }
+                           values.push_back(returned(simple(stmt.value, env)));
+                           return true;
+                       },
+                       [this, &values, env](const LetStatement &stmt) {
+                           if (!isSimple(stmt.value)) {
+                               return enter<Step::LET>(&stmt, env);
+                           }
+                           values.push_back(bind(stmt, *env, simple(stmt.value, env)));
+                           return true;
+                       },
+                       [this, &values](const YieldStatement & /*stmt*/) {
+                           // Generators walk their yields themselves (monkey/generator.h)
+                           values.emplace_back(error("yield outside of a generator"));
+                           return true;
+                       }},
+            statement);
+    }
+
+    bool begin(const Expression &expression, Env env) {
+        if (isLeaf(expression)) {
+            stacks_.values.push_back(leaf(expression, env));
             return true;
         }
-        return false;
+        return std::visit(
+            [this, env]<typename Node>(const Node &expr) {
+                auto &values = stacks_.values;
+                if constexpr (std::same_as<Node, Box<PrefixExpression>>) {
+                    if (!isLeaf(expr->right) && !expr->constant) {
+                        return enter<Step::PREFIX>(&*expr, env);
+                    }
+                    values.push_back(applyLeaves(*expr, env));
+                    return true;
+                } else if constexpr (std::same_as<Node, Box<InfixExpression>>) {
+                    if ((!isLeaf(expr->left) || !isLeaf(expr->right)) &&
+                        !expr->constant) {
+                        return enter<Step::INFIX>(&*expr, env);
+                    }
+                    values.push_back(applyLeaves(*expr, env));
+                    return true;
+                } else if constexpr (std::same_as<Node, Box<IndexExpression>>) {
+                    if ((!isLeaf(expr->left) || !isLeaf(expr->index)) &&
+                        !expr->constant) {
+                        return enter<Step::INDEX>(&*expr, env);
+                    }
+                    values.push_back(applyLeaves(*expr, env));
+                    return true;
+                } else if constexpr (std::same_as<Node, Box<IfExpression>>) {
+                    if (!isSimple(expr->condition)) {
+                        return enter<Step::IF>(&*expr, env);
+                    }
+                    return branch(*expr, simple(expr->condition, env), env);
+                } else if constexpr (std::same_as<Node, Box<CallExpression>>) {
+                    return enter<Step::CALL>(&*expr, env);
+                } else if constexpr (std::same_as<Node, Box<ArrayLiteral>>) {
+                    return enter<Step::ARRAY>(&*expr, env);
+                } else if constexpr (std::same_as<Node, Box<HashLiteral>>) {
+                    return enter<Step::HASH>(&*expr, env);
+                } else {
+                    std::unreachable();
+                    return false;
+                }
+            },
+            expression);
     }
-    if (expr.op == "-") {
-        if (std::holds_alternative<int64_t>(right)) {
-            return -std::get<int64_t>(right);
+
+    // Literals, identifiers and function literals, whose values take no evaluation of
+    // other expressions.
+    static bool isLeaf(const Expression &expression) {
+        return expression.index() < std::variant_size_v<Expression> &&
+               LEAVES[expression.index()];
+    }
+
+    static constexpr auto LEAVES = []<size_t... I>(std::index_sequence<I...>) {
+        return std::array{
+            (!Boxed<std::variant_alternative_t<I, Expression>> ||
+             std::same_as<std::variant_alternative_t<I, Expression>,
+                          Box<FunctionLiteral>>)...};
+    }(std::make_index_sequence<std::variant_size_v<Expression>>());
+
+    // Leaves, and operators applied to leaves: these are evaluated by simple() without
+    // a frame, and most expressions in a program are.
+    static bool isSimple(const Expression &expression) {
+        return std::visit(overloaded{[](const Box<PrefixExpression> &expr) {
+                                         return isLeaf(expr->right);
+                                     },
+                                     [](const Box<InfixExpression> &expr) {
+                                         return isLeaf(expr->left) && isLeaf(expr->right);
+                                     },
+                                     [](const Box<IndexExpression> &expr) {
+                                         return isLeaf(expr->left) && isLeaf(expr->index);
+                                     },
+                                     [&expression](const auto & /*expr*/) {
+                                         return isLeaf(expression);
+                                     }},
+                          expression);
+    }
+
+    Object simple(const Expression &expression, Env env) {
+        return std::visit(
+            overloaded{[this, env](const Box<PrefixExpression> &expr) {
+                           return applyLeaves(*expr, env);
+                       },
+                       [this, env](const Box<InfixExpression> &expr) {
+                           return applyLeaves(*expr, env);
+                       },
+                       [this, env](const Box<IndexExpression> &expr) {
+                           return applyLeaves(*expr, env);
+                       },
+                       [this, &expression, env](const auto & /*expr*/) {
+                           return leaf(expression, env);
+                       }},
+            expression);
+    }
+
+    // Operators applied to leaves, or to constants whose value hashCons() cached.
+    Object applyLeaves(const PrefixExpression &expr, Env env) {
+        if (expr.constant) {
+            return constant(*expr.constant);
         }
+        auto right = leaf(expr.right, env);
+        if (std::holds_alternative<Error>(right)) {
+            return right;
+        }
+        return evalPrefixExpression(expr, right);
     }
-    return Error{
-        fmt::format("unknown operator: {}{}", expr.op, tokenLiteral(expr.right))};
-}
 
-Object evalIntegerInfixExpression(const std::string &op, int64_t left, int64_t right) {
-    if (op == "+") {
-        return left + right;
+    Object applyLeaves(const InfixExpression &expr, Env env) {
+        if (expr.constant) {
+            return constant(*expr.constant);
+        }
+        auto left = leaf(expr.left, env);
+        if (std::holds_alternative<Error>(left)) {
+            return left;
+        }
+        auto right = leaf(expr.right, env);
+        if (std::holds_alternative<Error>(right)) {
+            return right;
+        }
+        return evalInfixExpression(expr, left, right);
     }
-    if (op == "-") {
-        return left - right;
+
+    Object applyLeaves(const IndexExpression &expr, Env env) {
+        if (expr.constant) {
+            return constant(*expr.constant);
+        }
+        auto left = leaf(expr.left, env);
+        if (std::holds_alternative<Error>(left)) {
+            return left;
+        }
+        auto index = leaf(expr.index, env);
+        if (std::holds_alternative<Error>(index)) {
+            return index;
+        }
+        return evalIndexExpression(left, index);
     }
-    if (op == "*") {
-        return left * right;
+
+    Object leaf(const Expression &expression, Env env) {
+        return std::visit(
+            overloaded{
+                [](const IntegerLiteral &expr) -> Object { return expr.value; },
+                [](const BooleanLiteral &expr) -> Object { return expr.value; },
+                [](const StringLiteral &expr) -> Object { return string(expr.value); },
+                [this, env](const Identifier &expr) -> Object {
+                    return evalIdentifier(expr, *env);
+                },
+                [env](const Box<FunctionLiteral> &expr) -> Object {
+                    stats::recordHeapBytes(sizeof(Function));
+                    return Function{expr, *env};
+                },
+                [](const auto & /*expr*/) -> Object { std::unreachable(); }},
+            expression);
     }
-    if (op == "/") {
-        return left / right;
+
+    // Short texts are copied inline rather than sharing the AST text.
+    static String string(const std::shared_ptr<const std::string> &text) {
+        if (text->size() <= String::INLINE_CAPACITY) {
+            return String(*text);
+        }
+        return String(text, *text);
     }
-    if (op == "<") {
-        return left < right;
+
+    static Object constant(const Constant &value) {
+        return std::visit(
+            overloaded{[](const std::shared_ptr<const std::string> &text) -> Object {
+                           return string(text);
+                       },
+                       [](auto scalar) -> Object { return scalar; }},
+            value);
     }
-    if (op == ">") {
-        return left > right;
+
+    // The value of a let statement binding `value`.
+    Object bind(const LetStatement &stmt, const std::shared_ptr<Environment> &env,
+                Object value) {
+        if (std::holds_alternative<Error>(value)) {
+            return value;
+        }
+        recordCopy(value);
+        env->set(tokenLiteral(stmt.name), std::move(value));
+        return nullptr;
     }
-    if (op == "==") {
-        return left == right;
+
+    // The value of a return statement returning `value`.
+    static Object returned(Object value) {
+        if (std::holds_alternative<Error>(value)) {
+            return value;
+        }
+        stats::recordHeapBytes(sizeof(ReturnValue));
+        return ReturnValue{std::move(value)};
     }
-    if (op == "!=") {
-        return left != right;
+
+    // Begins the branch of `expr` that `condition` selects.
+    bool branch(const IfExpression &expr, Object condition, Env env) {
+        auto &values = stacks_.values;
+        if (std::holds_alternative<Error>(condition)) {
+            values.push_back(std::move(condition));
+            return true;
+        }
+        if (isTruthy(condition)) {
+            return enter<Step::BLOCK>(&expr.consequence.statements, env);
+        }
+        if (expr.alternative.has_value()) {
+            return enter<Step::BLOCK>(&expr.alternative->statements, env);
+        }
+        values.emplace_back(nullptr);
+        return true;
     }
-    return Error{fmt::format("unknown operator: {} {} {}", left, op, right)};
-}
 
-Object evalBooleanInfixExpression(const std::string &op, bool left, bool right) {
-    if (op == "==") {
-        return left == right;
+    // Resumes the frame at position `at` of the work stack. A handler that begins an
+    // operand returns if begin() left a frame, and otherwise finds its own frame by
+    // position again, as the operand may have grown the work stack in between.
+    void resume(size_t at) {
+        switch (stacks_.work[at].step) {
+        case Step::PROGRAM:
+        case Step::BLOCK:
+            resume<Step::BLOCK>(at);
+            break;
+        case Step::LET:
+            resume<Step::LET>(at);
+            break;
+        case Step::RETURN:
+            resume<Step::RETURN>(at);
+            break;
+        case Step::PREFIX:
+            resume<Step::PREFIX>(at);
+            break;
+        case Step::INFIX:
+        case Step::INDEX:
+            resume<Step::INFIX>(at);
+            break;
+        case Step::IF:
+            resume<Step::IF>(at);
+            break;
+        case Step::CALL:
+            resume<Step::CALL>(at);
+            break;
+        case Step::ARRAY:
+            resume<Step::ARRAY>(at);
+            break;
+        case Step::HASH:
+            resume<Step::HASH>(at);
+            break;
+        case Step::BODY:
+            resume<Step::BODY>(at);
+            break;
+        case Step::MEMO:
+            resume<Step::MEMO>(at);
+            break;
+        }
     }
-    if (op == "!=") {
-        return left != right;
+
+    // enter() knows the step of the frame it resumes, which saves the switch.
+    template <Step step>
+    void resume(size_t at) {
+        if constexpr (step == Step::PROGRAM || step == Step::BLOCK) {
+            resumeBlock(at);
+        } else if constexpr (step == Step::LET) {
+            resumeLet(at);
+        } else if constexpr (step == Step::RETURN) {
+            resumeReturn(at);
+        } else if constexpr (step == Step::PREFIX) {
+            resumePrefix(at);
+        } else if constexpr (step == Step::INFIX || step == Step::INDEX) {
+            resumeBinary(at);
+        } else if constexpr (step == Step::IF) {
+            resumeIf(at);
+        } else if constexpr (step == Step::CALL) {
+            resumeCall(at);
+        } else if constexpr (step == Step::ARRAY) {
+            resumeArray(at);
+        } else if constexpr (step == Step::HASH) {
+            resumeHash(at);
+        } else if constexpr (step == Step::BODY) {
+            resumeBody();
+        } else {
+            resumeMemo();
+        }
     }
-    return Error{fmt::format("unknown operator: {} {} {}", left, op, right)};
-}
 
-Object evalInfixExpression(const InfixExpression &expr,
-                           const std::shared_ptr<Environment> &env) {
-    auto left = eval(expr.left, env);
-    if (std::holds_alternative<Error>(left)) {
-        return left;
+    // Runs the statements in turn. A return value or an error ends the block early.
+    void resumeBlock(size_t at) {
+        auto &work = stacks_.work;
+        auto &values = stacks_.values;
+        const auto &statements = work[at].as<std::vector<Statement>>();
+        auto env = work[at].env;
+        if (statements.empty()) {
+            work.pop_back();
+            values.emplace_back();
+            return;
+        }
+        while (true) {
+            auto &frame = work[at];
+            if (frame.next > 0) {
+                const auto &result = values.back();
+                if (frame.next == statements.size() ||
+                    std::holds_alternative<Box<ReturnValue>>(result) ||
+                    std::holds_alternative<Error>(result)) {
+                    endBlock(frame.step == Step::PROGRAM);
+                    return;
+                }
+                values.pop_back();
+            }
+            if (!begin(statements[frame.next++], env)) {
+                return;
+            }
+        }
     }
 
-    auto right = eval(expr.right, env);
-    if (std::holds_alternative<Error>(right)) {
-        return right;
+    void endBlock(bool program) {
+        stacks_.work.pop_back();
+        // The program's value is what its return statement returns.
+        auto &result = stacks_.values.back();
+        const auto *returned = std::get_if<Box<ReturnValue>>(&result);
+        if (program && returned != nullptr) {
+            Object value = (*returned)->value;
+            result = std::move(value);
+        }
     }
 
-    if (std::holds_alternative<int64_t>(left) && std::holds_alternative<int64_t>(right)) {
-        int64_t leftVal = std::get<int64_t>(left);
-        int64_t rightVal = std::get<int64_t>(right);
-        return evalIntegerInfixExpression(expr.op, leftVal, rightVal);
+    // Let, return and prefix frames are only resumed with their operand done when it
+    // is not simple: begin() finishes them otherwise.
+    void resumeLet(size_t at) {
+        auto &work = stacks_.work;
+        const auto &stmt = work[at].as<LetStatement>();
+        auto env = work[at].env;
+        if (work[at].next++ == 0 && !begin(stmt.value, env)) {
+            return;
+        }
+        work.pop_back();
+        auto &value = stacks_.values.back();
+        value = bind(stmt, *env, std::move(value));
     }
-    if (std::holds_alternative<bool>(left) && std::holds_alternative<bool>(right)) {
-        bool leftVal = std::get<bool>(left);
-        bool rightVal = std::get<bool>(right);
-        return evalBooleanInfixExpression(expr.op, leftVal, rightVal);
+
+    void resumeReturn(size_t at) {
+        auto &work = stacks_.work;
+        const auto &stmt = work[at].as<ReturnStatement>();
+        if (work[at].next++ == 0 && !begin(stmt.value, work[at].env)) {
+            return;
+        }
+        work.pop_back();
+        auto &value = stacks_.values.back();
+        value = returned(std::move(value));
     }
-    if (std::holds_alternative<String>(left) && std::holds_alternative<String>(right)) {
-        const auto &leftVal = std::get<String>(left).value;
-        const auto &rightVal = std::get<String>(right).value;
-        if (expr.op == "+") {
-            return String{leftVal + rightVal};
+
+    void resumePrefix(size_t at) {
+        auto &work = stacks_.work;
+        const auto &expr = work[at].as<PrefixExpression>();
+        if (work[at].next++ == 0 && !begin(expr.right, work[at].env)) {
+            return;
+        }
+        work.pop_back();
+        auto &right = stacks_.values.back();
+        if (!std::holds_alternative<Error>(right)) {
+            right = evalPrefixExpression(expr, right);
         }
-        return Error{
-            fmt::format("unknown operator: {} {} {}", leftVal, expr.op, rightVal)};
     }
 
-    return Error{fmt::format("type mismatch: {} {} {}", tokenLiteral(expr.left), expr.op,
-                             tokenLiteral(expr.right))};
-}
+    // Infix and index expressions: the left operand, then the right one.
+    void resumeBinary(size_t at) {
+        auto &work = stacks_.work;
+        auto &values = stacks_.values;
+        const auto *infix = work[at].step == Step::INFIX ? &work[at].as<InfixExpression>()
+                                                         : nullptr;
+        const auto *index = infix == nullptr ? &work[at].as<IndexExpression>() : nullptr;
+        auto env = work[at].env;
+        if (work[at].next == 0) {
+            work[at].next = 1;
+            if (!begin(infix != nullptr ? infix->left : index->left, env)) {
+                return;
+            }
+        }
+        if (work[at].next == 1) {
+            if (std::holds_alternative<Error>(values.back())) {
+                work.pop_back();
+                return;
+            }
+            work[at].next = 2;
+            if (!begin(infix != nullptr ? infix->right : index->index, env)) {
+                return;
+            }
+        }
+        work.pop_back();
+        auto &right = values.back();
+        auto &left = *std::prev(&right);
+        auto result = std::holds_alternative<Error>(right) ? std::move(right)
+                      : infix != nullptr ? evalInfixExpression(*infix, left, right)
+                                         : evalIndexExpression(left, right);
+        values.pop_back();
+        values.back() = std::move(result);
+    }
 
-Object evalIfExpression(const IfExpression &expr,
-                        const std::shared_ptr<Environment> &env) {
-    auto condition = eval(expr.condition, env);
-    if (std::holds_alternative<Error>(condition)) {
-        return condition;
+    // Only resumed for a condition that is not simple.
+    void resumeIf(size_t at) {
+        auto &work = stacks_.work;
+        const auto &expr = work[at].as<IfExpression>();
+        auto env = work[at].env;
+        if (work[at].next++ == 0 && !begin(expr.condition, env)) {
+            return;
+        }
+        work.pop_back();
+        auto condition = std::move(stacks_.values.back());
+        stacks_.values.pop_back();
+        branch(expr, std::move(condition), env);
     }
 
-    if (isTrue(condition)) {
-        return eval(expr.consequence, env);
+    // Evaluates the function, then the arguments, then applies the one to the others.
+    void resumeCall(size_t at) {
+        auto &work = stacks_.work;
+        auto &values = stacks_.values;
+        const auto &call = work[at].as<CallExpression>();
+        auto env = work[at].env;
+        if (work[at].next == 0) {
+            work[at].base = values.size();
+            work[at].next = 1;
+            if (!begin(call.function, env)) {
+                return;
+            }
+        }
+        while (true) {
+            auto &frame = work[at];
+            if (std::holds_alternative<Error>(values.back())) {
+                auto base = frame.base;
+                work.pop_back();
+                finish(base, std::move(values.back()));
+                return;
+            }
+            if (frame.next > 1) {
+                recordCopy(values.back());
+            }
+            if (frame.next > call.arguments.size()) {
+                break;
+            }
+            if (!begin(call.arguments[frame.next++ - 1], env)) {
+                return;
+            }
+        }
+
+        auto base = work[at].base;
+        work.pop_back();
+        // A function body runs with the function and its arguments left on the value
+        // stack, which keeps them alive until it returns. A builtin or memoized function
+        // gets them moved out, as it may evaluate further and so grow the value stack;
+        // a few arguments move to the C++ stack.
+        if (std::holds_alternative<Box<Function>>(values[base])) {
+            invoke(values[base], std::span(values).subspan(base + 1), call, base);
+            return;
+        }
+        auto function = std::move(values[base]);
+        auto args = std::span(values).subspan(base + 1);
+        if (args.size() <= FEW_ARGS) {
+            std::array<Object, FEW_ARGS> moved;
+            std::ranges::move(args, moved.begin());
+            values.resize(base);
+            invoke(function, std::span(moved).first(args.size()), call, base);
+            return;
+        }
+        std::vector<Object> moved(std::make_move_iterator(args.begin()),
+                                  std::make_move_iterator(args.end()));
+        values.resize(base);
+        invoke(function, moved, call, base);
     }
 
-    if (expr.alternative.has_value()) {
-        return eval(*expr.alternative, env);
+    void resumeArray(size_t at) {
+        auto &work = stacks_.work;
+        auto &values = stacks_.values;
+        const auto &expr = work[at].as<ArrayLiteral>();
+        auto env = work[at].env;
+        if (work[at].next == 0) {
+            work[at].base = values.size();
+        }
+        while (true) {
+            auto &frame = work[at];
+            if (frame.next > 0) {
+                if (std::holds_alternative<Error>(values.back())) {
+                    auto base = frame.base;
+                    work.pop_back();
+                    finish(base, std::move(values.back()));
+                    return;
+                }
+                recordCopy(values.back());
+            }
+            if (frame.next == expr.elements.size()) {
+                break;
+            }
+            if (!begin(expr.elements[frame.next++], env)) {
+                return;
+            }
+        }
+        auto base = work[at].base;
+        work.pop_back();
+        auto first = values.begin() + static_cast<std::ptrdiff_t>(base);
+        std::vector<Object> elements(std::make_move_iterator(first),
+                                     std::make_move_iterator(values.end()));
+        finish(base, Array::from(std::move(elements)));
     }
 
-    return nullptr;
-}
+    // Keys are hashed once, here; later pairs with an equal key replace earlier ones.
+    void resumeHash(size_t at) {
+        auto &work = stacks_.work;
+        auto &values = stacks_.values;
+        auto &hashes = stacks_.hashes;
+        const auto &expr = work[at].as<HashLiteral>();
+        auto env = work[at].env;
+        if (work[at].next == 0) {
+            hashes.push_back({makeReclaimed<HashTable>(expr.pairs.size()), std::nullopt});
+        }
+        while (true) {
+            auto &frame = work[at];
+            if (frame.next > 0) {
+                auto value = std::move(values.back());
+                values.pop_back();
+                auto &pending = hashes.back();
+                // Odd steps evaluated a key, even ones a value.
+                if (!std::holds_alternative<Error>(value) && frame.next % 2 == 1) {
+                    pending.key = hashKey(value);
+                    if (!pending.key) {
+                        value = error("unusable as hash key: {}", typeName(value));
+                    }
+                } else if (!std::holds_alternative<Error>(value)) {
+                    pending.table->insert(std::move(*pending.key), std::move(value));
+                }
+                if (std::holds_alternative<Error>(value)) {
+                    hashes.pop_back();
+                    work.pop_back();
+                    values.push_back(std::move(value));
+                    return;
+                }
+            }
+            if (frame.next == 2 * expr.pairs.size()) {
+                break;
+            }
+            const auto &[key, value] = expr.pairs[frame.next / 2];
+            if (!begin(frame.next++ % 2 == 0 ? key : value, env)) {
+                return;
+            }
+        }
+        work.pop_back();
+        values.emplace_back(Hash{std::move(hashes.back().table)});
+        hashes.pop_back();
+    }
 
-Object evalIdentifier(const Identifier &expr, const std::shared_ptr<Environment> &env) {
-    auto value = env->get(tokenLiteral(expr));
-    if (value.has_value()) {
-        return *value;
+    // The body's value takes the place of the function and its arguments.
+    void resumeBody() {
+        auto &values = stacks_.values;
+        const auto &frame = stacks_.work.back();
+        const auto &call = frame.as<CallExpression>();
+        auto base = frame.base;
+        stacks_.work.pop_back();
+        auto &evaluated = values.back();
+
+        // Unwrap the return value if it's a ReturnValue, otherwise return the evaluated
+        // result
+        if (auto *returned = std::get_if<Box<ReturnValue>>(&evaluated)) {
+            Object value = std::move((*returned)->value);
+            evaluated = std::move(value);
+        }
+        policy_.onReturn(call, evaluated);
+        stacks_.activations.pop_back();
+        // apply() has no function and arguments on the value stack.
+        if (values.size() > base + 1) {
+            values[base] = std::move(evaluated);
+            values.resize(base + 1);
+        }
     }
-    return Error{fmt::format("identifier not found: {}", tokenLiteral(expr))};
-}
 
-Object evalCallExpression(const CallExpression &expr,
-                          const std::shared_ptr<Environment> &env) {
-    // Evaluate the function whether it's a function literal or an identifier
-    auto function = eval(expr.function, env);
-    if (std::holds_alternative<Error>(function)) {
-        return function;
+    // Errors are not cached: they may come from the budget rather than the arguments.
+    void resumeMemo() {
+        stacks_.work.pop_back();
+        auto memo = std::move(stacks_.memos.back());
+        stacks_.memos.pop_back();
+        const auto &result = stacks_.values.back();
+        if (memo.key && !std::holds_alternative<Error>(result)) {
+            memo.table->insert(std::move(*memo.key), result);
+        }
     }
 
-    // Evaluate the arguments
-    auto args = evalExpressions(expr.arguments, env);
-    if (!args.empty() && std::holds_alternative<Error>(args[0])) {
-        return args[0];
+    // Applies `function` to `args`, leaving the result at height `base` of the value
+    // stack in place of the values above: right away, or once the frames pushed for a
+    // function body are done. Only a Function may take `args` from the value stack, as
+    // it binds them before anything is pushed.
+    void invoke(const Object &function, std::span<const Object> args,
+                const CallExpression &call, size_t base) {
+        if (const auto *builtin = std::get_if<Builtin>(&function)) {
+            Context context(*this, call);
+            finish(base, builtin->function(args, context));
+            return;
+        }
+        if (const auto *memo = std::get_if<Memo>(&function)) {
+            invokeMemo(memo->table, args, call, base);
+            return;
+        }
+        if (!std::holds_alternative<Box<Function>>(function)) {
+            finish(base, error("not a function: {}", inspect(function)));
+            return;
+        }
+        if (auto stop = policy_.onStep()) {
+            finish(base, fail(std::move(*stop)));
+            return;
+        }
+
+        // Extend the function's environment with the arguments from the ouside. Only read
+        // through a const Box so that a shared Function is never detached.
+        const auto &fn = std::as_const(std::get<Box<Function>>(function));
+        auto extendedEnv = makeEnvironment(fn->env);
+        for (const auto &[param, arg] : std::views::zip(fn->parameters(), args)) {
+            recordCopy(arg);
+            extendedEnv->set(tokenLiteral(param), arg);
+        }
+
+        // Evaluate the function body in the extended environment. A generator function
+        // only binds the arguments; its body runs when the generator is resumed.
+        policy_.onCall(call, *fn, args);
+        if (fn->literal->generator) {
+            Object generator = Generator{std::allocate_shared<GeneratorState>(
+                AccountingAllocator<GeneratorState>(), fn, std::move(extendedEnv))};
+            policy_.onReturn(call, generator);
+            finish(base, std::move(generator));
+            return;
+        }
+        push(Step::BODY, &call, nullptr, base);
+        const auto &activation = stacks_.activations.emplace_back(std::move(extendedEnv));
+        if (enter<Step::BLOCK>(&fn->body().statements, &activation.env)) {
+            resumeBody();
+        }
     }
 
-    if (!std::holds_alternative<Box<Function>>(function)) {
-        return Error{fmt::format("not a function: {}", inspect(function))};
+    // The pending memo keeps the table, and with it the function, alive during the call.
+    void invokeMemo(const std::shared_ptr<MemoTable> &table, std::span<const Object> args,
+                    const CallExpression &call, size_t base) {
+        auto key = table->key(args);
+        if (key) {
+            if (auto cached = table->find(*key)) {
+                finish(base, std::move(*cached));
+                return;
+            }
+        }
+        stacks_.memos.push_back({table, std::move(key)});
+        push(Step::MEMO, nullptr, nullptr);
+        invoke(stacks_.memos.back().table->function(), args, call, base);
     }
 
-    // Extend the function's environment with the arguments from the ouside
-    auto fn = std::get<Box<Function>>(function);
-    auto extendedEnv = std::make_shared<Environment>(fn->env);
-    for (const auto &[param, arg] : std::views::zip(fn->parameters, args)) {
-        extendedEnv->set(tokenLiteral(param), arg);
+    Object evalPrefixExpression(const PrefixExpression &expr, const Object &right) {
+        if (expr.op == "!") {
+            if (std::holds_alternative<bool>(right)) {
+                return !std::get<bool>(right);
+            }
+            if (std::holds_alternative<int64_t>(right)) {
+                return std::get<int64_t>(right) == 0;
+            }
+            if (std::holds_alternative<std::nullptr_t>(right)) {
+                return true;
+            }
+            return false;
+        }
+        if (expr.op == "-") {
+            if (std::holds_alternative<int64_t>(right)) {
+                return -std::get<int64_t>(right);
+            }
+        }
+        return error("unknown operator: {}{}", expr.op, tokenLiteral(expr.right));
     }
 
-    // Evaluate the function body in the extended environment
-    auto evaluated = eval(fn->body, extendedEnv);
+    Object evalIntegerInfixExpression(const std::string &op, int64_t left,
+                                      int64_t right) {
+        if (op == "+") {
+            return left + right;
+        }
+        if (op == "-") {
+            return left - right;
+        }
+        if (op == "*") {
+            return left * right;
+        }
+        if (op == "/") {
+            // Both would trap rather than give a value.
+            if (right == 0) {
+                return error("division by zero: {} / {}", left, right);
+            }
+            if (right == -1 && left == std::numeric_limits<int64_t>::min()) {
+                return error("integer overflow: {} / {}", left, right);
+            }
+            return left / right;
+        }
+        if (op == "<") {
+            return left < right;
+        }
+        if (op == ">") {
+            return left > right;
+        }
+        if (op == "==") {
+            return left == right;
+        }
+        if (op == "!=") {
+            return left != right;
+        }
+        return error("unknown operator: {} {} {}", left, op, right);
+    }
 
-    // Unwrap the return value if it's a ReturnValue, otherwise return the evaluated
-    // result
-    if (std::holds_alternative<Box<ReturnValue>>(evaluated)) {
-        return std::get<Box<ReturnValue>>(evaluated)->value;
+    Object evalBooleanInfixExpression(const std::string &op, bool left, bool right) {
+        if (op == "==") {
+            return left == right;
+        }
+        if (op == "!=") {
+            return left != right;
+        }
+        return error("unknown operator: {} {} {}", left, op, right);
     }
-    return evaluated;
-}
+
+    Object evalInfixExpression(const InfixExpression &expr, const Object &left,
+                               const Object &right) {
+        if (std::holds_alternative<int64_t>(left) &&
+            std::holds_alternative<int64_t>(right)) {
+            int64_t leftVal = std::get<int64_t>(left);
+            int64_t rightVal = std::get<int64_t>(right);
+            return evalIntegerInfixExpression(expr.op, leftVal, rightVal);
+        }
+        if (std::holds_alternative<bool>(left) && std::holds_alternative<bool>(right)) {
+            bool leftVal = std::get<bool>(left);
+            bool rightVal = std::get<bool>(right);
+            return evalBooleanInfixExpression(expr.op, leftVal, rightVal);
+        }
+        if (std::holds_alternative<String>(left) &&
+            std::holds_alternative<String>(right)) {
+            const auto &leftVal = std::get<String>(left);
+            const auto &rightVal = std::get<String>(right);
+            if (expr.op == "+") {
+                if (leftVal.size() > String::maxSize() - rightVal.size()) {
+                    return error("string too long: {} + {} characters", leftVal.size(),
+                                 rightVal.size());
+                }
+                if (!String::affordable(leftVal.size() + rightVal.size())) {
+                    return error("evaluation exceeded its memory quota");
+                }
+                auto joined = String::concat(leftVal, rightVal);
+                // A rope node holds its two halves.
+                stats::recordHeapBytes(joined.isRope() ? 2 * sizeof(String) : 0);
+                return joined;
+            }
+            return error("unknown operator: {} {} {}", leftVal.view(), expr.op,
+                         rightVal.view());
+        }
+
+        return error("type mismatch: {} {} {}", tokenLiteral(expr.left), expr.op,
+                     tokenLiteral(expr.right));
+    }
+
+    Object evalIdentifier(const Identifier &expr,
+                          const std::shared_ptr<Environment> &env) {
+        stats::recordLookup();
+        auto name = tokenLiteral(expr);
+        // Environment::get() counts the copy it returns.
+        auto value = env->get(name);
+        if (value.has_value()) {
+            return std::move(*value);
+        }
+        if (const auto *builtin = lookupBuiltin(name)) {
+            return *builtin;
+        }
+        return error("identifier not found: {}", name);
+    }
+
+    Object evalIndexExpression(const Object &left, const Object &index) {
+        if (const auto *hash = std::get_if<Hash>(&left)) {
+            auto key = hashKey(index);
+            if (!key) {
+                return error("unusable as hash key: {}", typeName(index));
+            }
+            const auto *value = hash->table->find(*key);
+            if (value == nullptr) {
+                return nullptr;
+            }
+            recordCopy(*value);
+            return *value;
+        }
+
+        const auto *array = std::get_if<Array>(&left);
+        const auto *position = std::get_if<int64_t>(&index);
+        if (array == nullptr || position == nullptr) {
+            return error("index operator not supported: {}", typeName(left));
+        }
+        // Out of range reads give null, as in the book.
+        if (*position < 0 || static_cast<size_t>(*position) >= array->size()) {
+            return nullptr;
+        }
+        auto element = (*array)[static_cast<size_t>(*position)];
+        recordCopy(element);
+        return element;
+    }
+
+    // How deep the handlers that enter() resumed nest on the C++ stack.
+    static constexpr unsigned MAX_INLINE = 64;
+    static constexpr size_t FEW_ARGS = 4;
+
+    Policy &policy_;
+    TaskGroup &tasks_;
+    Stacks &stacks_;
+    unsigned inline_ = 0;
+};
 
 } // namespace
 
 namespace monkey {
 
+// Each entry point owns the TaskGroup of its evaluation; its destructor waits for the
+// tasks the evaluation spawned.
+
 Object eval(const Program &program, const std::shared_ptr<Environment> &env) {
-    return evalProgram(program.statements, env);
+    NoTrace policy;
+    TaskGroup tasks;
+    return Evaluator(policy, tasks).evalProgram(program.statements, env);
+}
+
+Object eval(const Program &program, const std::shared_ptr<Environment> &env,
+            Tracer &tracer) {
+    TaskGroup tasks;
+    return Evaluator(tracer, tasks).evalProgram(program.statements, env);
+}
+
+Object eval(const Program &program, const std::shared_ptr<Environment> &env,
+            Budget &budget) {
+    TaskGroup tasks;
+    return Evaluator(budget, tasks).evalProgram(program.statements, env);
 }
 
 Object eval(const Statement &statement, const std::shared_ptr<Environment> &env) {
-    return std::visit(overloaded{[&env](const ExpressionStatement &stmt) -> Object {
-                                     return eval(stmt.expression, env);
-                                 },
-                                 [&env](const BlockStatement &stmt) -> Object {
-                                     return evalBlockStatements(stmt.statements, env);
-                                 },
-                                 [&env](const ReturnStatement &stmt) -> Object {
-                                     auto result = eval(stmt.value, env);
-                                     if (std::holds_alternative<Error>(result)) {
-                                         return result;
-                                     }
-                                     return ReturnValue{result};
-                                 },
-                                 [&env](const LetStatement &stmt) -> Object {
-                                     return evalLetStatement(stmt, env);
-                                 },
-                                 [](const auto &) -> Object { return Object{}; }},
-                      statement);
+    NoTrace policy;
+    TaskGroup tasks;
+    return Evaluator(policy, tasks).eval(statement, env);
 }
 
 Object eval(const Expression &expression, const std::shared_ptr<Environment> &env) {
-    return std::visit(
-        overloaded{
-            [](const IntegerLiteral &expr) -> Object { return expr.value; },
-            [](const BooleanLiteral &expr) -> Object { return expr.value; },
-            [](const StringLiteral &expr) -> Object { return String{expr.value}; },
-            [&env](const Identifier &expr) -> Object {
-                return evalIdentifier(expr, env);
-            },
-            [&env](const Box<PrefixExpression> &expr) -> Object {
-                return evalPrefixExpression(*expr, env);
-            },
-            [&env](const Box<InfixExpression> &expr) -> Object {
-                return evalInfixExpression(*expr, env);
-            },
-            [&env](const Box<IfExpression> &expr) -> Object {
-                return evalIfExpression(*expr, env);
-            },
-            [&env](const Box<FunctionLiteral> &expr) -> Object {
-                return Function{expr->parameters, expr->body, env};
-            },
-            [&env](const Box<CallExpression> &expr) -> Object {
-                return evalCallExpression(*expr, env);
-            },
-            [](const auto &) -> Object { return Error{"unknown expression type"}; }},
-        expression);
+    NoTrace policy;
+    TaskGroup tasks;
+    return Evaluator(policy, tasks).eval(expression, env);
 }
 
 } // namespace monkey
\ No newline at end of file
@@ -0,0 +1,400 @@
+#include "monkey/flat_ast.h"
+#include "monkey/ast.h"
+#include "monkey/box.h"
+#include "monkey/overload.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace monkey {
+
+namespace {
+
+using TreeNode =
+    std::variant<const Expression *, const Statement *, const BlockStatement *>;
+
+// Calls `f` with each child of `node`, in order. A Statement holding a block stands for
+// the block.
+template <typename F>
+void forEachChild(TreeNode node, F f) {
+    auto block = [&](const BlockStatement &b) {
+        for (const auto &stmt : b.statements) {
+            f(&stmt);
+        }
+    };
+    auto expression = overloaded{
+        [&](const Box<PrefixExpression> &s) { f(&s->right); },
+        [&](const Box<InfixExpression> &s) {
+            f(&s->left);
+            f(&s->right);
+        },
+        [&](const Box<IfExpression> &s) {
+            f(&s->condition);
+            f(&s->consequence);
+            if (s->alternative) {
+                f(&*s->alternative);
+            }
+        },
+        [&](const Box<FunctionLiteral> &s) { f(&s->body); },
+        [&](const Box<CallExpression> &s) {
+            f(&s->function);
+            for (const auto &arg : s->arguments) {
+                f(&arg);
+            }
+        },
+        [&](const Box<ArrayLiteral> &s) {
+            for (const auto &element : s->elements) {
+                f(&element);
+            }
+        },
+        [&](const Box<IndexExpression> &s) {
+            f(&s->left);
+            f(&s->index);
+        },
+        [&](const Box<HashLiteral> &s) {
+            for (const auto &[key, value] : s->pairs) {
+                f(&key);
+                f(&value);
+            }
+        },
+        [](const auto & /*leaf*/) {},
+    };
+    auto statement = overloaded{
+        [&](const LetStatement &s) { f(&s.value); },
+        [&](const ExpressionStatement &s) { f(&s.expression); },
+        [&](const BlockStatement &s) { block(s); },
+        // Return and yield statements.
+        [&](const auto &s) { f(&s.value); },
+    };
+    std::visit(overloaded{
+                   [&](const Expression *e) { std::visit(expression, *e); },
+                   [&](const Statement *s) { std::visit(statement, *s); },
+                   [&](const BlockStatement *b) { block(*b); },
+               },
+               node);
+}
+
+// Lays a tree out in post-order with an explicit stack: a node is expanded into its
+// children the first time it comes off the stack, and added once they all have been,
+// when their indices are the last `children` entries of done_.
+class Builder {
+  public:
+    FlatAst build(const Program &program) {
+        for (const auto &stmt : program.statements | std::views::reverse) {
+            pending_.push_back({.node = &stmt, .children = 0, .expanded = false});
+        }
+        while (!pending_.empty()) {
+            auto frame = pending_.back();
+            pending_.pop_back();
+            if (frame.expanded) {
+                add(frame);
+                continue;
+            }
+            pending_.push_back(frame);
+            auto mark = pending_.size();
+            forEachChild(frame.node, [this](TreeNode child) {
+                pending_.push_back({.node = child, .children = 0, .expanded = false});
+            });
+            pending_[mark - 1].children = static_cast<uint32_t>(pending_.size() - mark);
+            pending_[mark - 1].expanded = true;
+            std::reverse(pending_.begin() + static_cast<ptrdiff_t>(mark), pending_.end());
+        }
+        ast_.statements = list(done_);
+        return std::move(ast_);
+    }
+
+  private:
+    struct Frame {
+        TreeNode node;
+        uint32_t children;
+        bool expanded;
+    };
+
+    void add(const Frame &frame) {
+        std::span<const NodeIndex> c(done_.end() - frame.children, done_.end());
+        auto index = static_cast<NodeIndex>(ast_.kinds.size());
+        auto &a = ast_;
+        auto node = [&](NodeKind kind, size_t slot) {
+            a.kinds.push_back(kind);
+            a.slots.push_back(static_cast<uint32_t>(slot));
+        };
+        auto expression = overloaded{
+            [&](const Identifier &s) {
+                node(NodeKind::IDENTIFIER, a.identifiers.size());
+                a.identifiers.push_back(text(s.token.literal));
+            },
+            [&](const IntegerLiteral &s) {
+                node(NodeKind::INTEGER, a.integers.size());
+                a.integers.push_back(s.value);
+            },
+            [&](const BooleanLiteral &s) {
+                node(NodeKind::BOOLEAN, a.booleans.size());
+                a.booleans.push_back(s.value ? 1 : 0);
+            },
+            [&](const StringLiteral &s) {
+                node(NodeKind::STRING, a.strings.size());
+                a.strings.push_back(text(s.token.literal));
+            },
+            [&](const Box<PrefixExpression> &s) {
+                node(NodeKind::PREFIX, a.prefixes.op.size());
+                a.prefixes.op.push_back(text(s->op));
+                a.prefixes.right.push_back(c[0]);
+            },
+            [&](const Box<InfixExpression> &s) {
+                node(NodeKind::INFIX, a.infixes.op.size());
+                a.infixes.op.push_back(text(s->op));
+                a.infixes.left.push_back(c[0]);
+                a.infixes.right.push_back(c[1]);
+            },
+            [&](const Box<IfExpression> & /*s*/) {
+                node(NodeKind::IF, a.ifs.condition.size());
+                a.ifs.condition.push_back(c[0]);
+                a.ifs.consequence.push_back(c[1]);
+                a.ifs.alternative.push_back(c.size() > 2 ? c[2] : NO_NODE);
+            },
+            [&](const Box<FunctionLiteral> &s) {
+                node(NodeKind::FUNCTION, a.functions.body.size());
+                NodeList parameters{static_cast<uint32_t>(a.lists.size()),
+                                    static_cast<uint32_t>(s->parameters.size())};
+                for (const auto &parameter : s->parameters) {
+                    a.lists.push_back(text(parameter.token.literal));
+                }
+                a.functions.parameters.push_back(parameters);
+                a.functions.body.push_back(c[0]);
+                a.functions.generator.push_back(s->generator ? 1 : 0);
+            },
+            [&](const Box<CallExpression> & /*s*/) {
+                node(NodeKind::CALL, a.calls.function.size());
+                a.calls.function.push_back(c[0]);
+                a.calls.arguments.push_back(list(c.subspan(1)));
+            },
+            [&](const Box<ArrayLiteral> & /*s*/) {
+                node(NodeKind::ARRAY, a.arrays.size());
+                a.arrays.push_back(list(c));
+            },
+            [&](const Box<IndexExpression> & /*s*/) {
+                node(NodeKind::INDEX, a.indexes.left.size());
+                a.indexes.left.push_back(c[0]);
+                a.indexes.index.push_back(c[1]);
+            },
+            [&](const Box<HashLiteral> & /*s*/) {
+                node(NodeKind::HASH, a.hashes.size());
+                a.hashes.push_back(list(c));
+            },
+        };
+        auto block = [&] {
+            node(NodeKind::BLOCK, a.blocks.size());
+            a.blocks.push_back(list(c));
+        };
+        auto statement = overloaded{
+            [&](const LetStatement &s) {
+                node(NodeKind::LET, a.lets.name.size());
+                a.lets.name.push_back(text(s.name.token.literal));
+                a.lets.value.push_back(c[0]);
+            },
+            [&](const ReturnStatement & /*s*/) {
+                node(NodeKind::RETURN, a.returns.size());
+                a.returns.push_back(c[0]);
+            },
+            [&](const YieldStatement & /*s*/) {
+                node(NodeKind::YIELD, a.yields.size());
+                a.yields.push_back(c[0]);
+            },
+            [&](const ExpressionStatement & /*s*/) {
+                node(NodeKind::EXPRESSION, a.expressions.size());
+                a.expressions.push_back(c[0]);
+            },
+            [&](const BlockStatement & /*s*/) { block(); },
+        };
+        std::visit(overloaded{
+                       [&](const Expression *e) { std::visit(expression, *e); },
+                       [&](const Statement *s) { std::visit(statement, *s); },
+                       [&](const BlockStatement * /*b*/) { block(); },
+                   },
+                   frame.node);
+        done_.resize(done_.size() - frame.children);
+        done_.push_back(index);
+    }
+
+    NodeList list(std::span<const NodeIndex> nodes) {
+        NodeList result{static_cast<uint32_t>(ast_.lists.size()),
+                        static_cast<uint32_t>(nodes.size())};
+        ast_.lists.insert(ast_.lists.end(), nodes.begin(), nodes.end());
+        return result;
+    }
+
+    // The index of `s` in the texts, added the first time it is seen. The keys view the
+    // strings of the tree, which outlives the builder.
+    uint32_t text(std::string_view s) {
+        auto [it, inserted] = texts_.try_emplace(s, ast_.texts.size());
+        if (inserted) {
+            ast_.texts.emplace_back(s);
+        }
+        return it->second;
+    }
+
+    FlatAst ast_;
+    std::vector<Frame> pending_;
+    std::vector<NodeIndex> done_;
+    std::unordered_map<std::string_view, uint32_t> texts_;
+};
+
+using Part = std::variant<std::string_view, NodeIndex>;
+
+// Calls `f` with each part of the text of `node`, in order: literal text, or a child
+// whose text goes there.
+template <typename F>
+void forEachPart(const FlatAst &ast, NodeIndex node, F f) {
+    auto parts = [&](std::initializer_list<Part> list) {
+        for (const auto &part : list) {
+            std::visit(f, part);
+        }
+    };
+    auto join = [&](NodeList list, auto project) {
+        for (uint32_t i = 0; i < list.count; ++i) {
+            if (i > 0) {
+                parts({", "});
+            }
+            project(ast.lists[list.first + i]);
+        }
+    };
+    auto child = [&](NodeIndex n) { parts({n}); };
+    auto text = [&](uint32_t t) -> std::string_view { return ast.texts[t]; };
+    auto slot = ast.slots[node];
+    switch (ast.kinds[node]) {
+    case NodeKind::IDENTIFIER:
+        parts({text(ast.identifiers[slot])});
+        break;
+    case NodeKind::INTEGER: {
+        std::array<char, 24> digits{};
+        auto end = std::to_chars(digits.begin(), digits.end(), ast.integers[slot]).ptr;
+        parts({std::string_view(digits.begin(), end)});
+        break;
+    }
+    case NodeKind::BOOLEAN:
+        parts({ast.booleans[slot] != 0 ? "true" : "false"});
+        break;
+    case NodeKind::STRING:
+        parts({text(ast.strings[slot])});
+        break;
+    case NodeKind::PREFIX:
+        parts({"(", text(ast.prefixes.op[slot]), ast.prefixes.right[slot], ")"});
+        break;
+    case NodeKind::INFIX:
+        parts({"(", ast.infixes.left[slot], " ", text(ast.infixes.op[slot]), " ",
+               ast.infixes.right[slot], ")"});
+        break;
+    case NodeKind::IF:
+        parts({"if ", ast.ifs.condition[slot], " ", ast.ifs.consequence[slot]});
+        if (ast.ifs.alternative[slot] != NO_NODE) {
+            parts({" else ", ast.ifs.alternative[slot]});
+        }
+        break;
+    case NodeKind::FUNCTION:
+        parts({"fn("});
+        join(ast.functions.parameters[slot], [&](uint32_t t) { parts({text(t)}); });
+        parts({") ", ast.functions.body[slot]});
+        break;
+    case NodeKind::CALL:
+        parts({ast.calls.function[slot], "("});
+        join(ast.calls.arguments[slot], child);
+        parts({")"});
+        break;
+    case NodeKind::ARRAY:
+        parts({"["});
+        join(ast.arrays[slot], child);
+        parts({"]"});
+        break;
+    case NodeKind::INDEX:
+        parts({"(", ast.indexes.left[slot], "[", ast.indexes.index[slot], "])"});
+        break;
+    case NodeKind::HASH: {
+        parts({"{"});
+        auto pairs = ast.hashes[slot];
+        for (uint32_t i = 0; i < pairs.count; i += 2) {
+            if (i > 0) {
+                parts({", "});
+            }
+            parts({ast.lists[pairs.first + i], ":", ast.lists[pairs.first + i + 1]});
+        }
+        parts({"}"});
+        break;
+    }
+    case NodeKind::LET:
+        parts({"let ", text(ast.lets.name[slot]), " = ", ast.lets.value[slot], ";"});
+        break;
+    case NodeKind::RETURN:
+        parts({"return ", ast.returns[slot], ";"});
+        break;
+    case NodeKind::YIELD:
+        parts({"yield ", ast.yields[slot], ";"});
+        break;
+    case NodeKind::EXPRESSION:
+        parts({ast.expressions[slot]});
+        break;
+    case NodeKind::BLOCK: {
+        parts({"{ "});
+        auto statements = ast.blocks[slot];
+        for (uint32_t i = 0; i < statements.count; ++i) {
+            parts({ast.lists[statements.first + i]});
+        }
+        parts({" }"});
+        break;
+    }
+    }
+}
+
+} // namespace
+
+FlatAst FlatAst::from(const Program &program) { return Builder().build(program); }
+
+std::string toString(const FlatAst &ast) {
+    // First the length of each node's text, children before parents. Then, parents
+    // before children, each node's own text is written where its text starts, and its
+    // children's starts replace their lengths.
+    std::vector<size_t> extents(ast.size());
+    for (NodeIndex node = 0; node < ast.size(); ++node) {
+        size_t length = 0;
+        forEachPart(ast, node,
+                    overloaded{
+                        [&](std::string_view text) { length += text.size(); },
+                        [&](NodeIndex child) { length += extents[child]; },
+                    });
+        extents[node] = length;
+    }
+
+    size_t size = 0;
+    for (uint32_t i = 0; i < ast.statements.count; ++i) {
+        auto &extent = extents[ast.lists[ast.statements.first + i]];
+        size += std::exchange(extent, size);
+    }
+    std::string out(size, '\0');
+    for (auto node = static_cast<NodeIndex>(ast.size()); node-- > 0;) {
+        auto cursor = extents[node];
+        forEachPart(ast, node,
+                    overloaded{
+                        [&](std::string_view text) {
+                            text.copy(out.data() + cursor, text.size());
+                            cursor += text.size();
+                        },
+                        [&](NodeIndex child) {
+                            cursor += std::exchange(extents[child], cursor);
+                        },
+                    });
+    }
+    return out;
+}
+
+} // namespace monkey
\ No newline at end of file
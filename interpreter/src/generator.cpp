@@ -0,0 +1,265 @@
+#include "monkey/generator.h"
+#include "monkey/ast.h"
+#include "monkey/box.h"
+#include "monkey/builtins.h"
+#include "monkey/env.h"
+#include "monkey/memory.h"
+#include "monkey/object.h"
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <optional>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace {
+
+using namespace monkey;
+
+struct Promise;
+using Handle = std::coroutine_handle<Promise>;
+
+struct Frame {
+    using promise_type = Promise;
+    Handle handle;
+};
+
+struct Promise {
+    // The caller of the current resume; only valid while the frame runs.
+    CallContext *context = nullptr;
+    // The last yielded value, or the value the body finished with.
+    Object value;
+
+    Frame get_return_object() { return {Handle::from_promise(*this)}; }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; }
+    std::suspend_always yield_value(Object yielded) {
+        value = std::move(yielded);
+        return {};
+    }
+    void return_value(Object result) { value = std::move(result); }
+    void unhandled_exception() { throw; }
+
+    // Frames are charged to the MemoryAccount like every other interpreter allocation.
+    // The allocator (and with it the account) is stored in front of the frame.
+    using Allocator = AccountingAllocator<std::max_align_t>;
+    static_assert(sizeof(Allocator) <= sizeof(std::max_align_t));
+
+    static size_t blocks(size_t size) {
+        return 1 + ((size + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t));
+    }
+
+    static void *operator new(size_t size) {
+        Allocator allocator;
+        auto *block = allocator.allocate(blocks(size));
+        std::construct_at(reinterpret_cast<Allocator *>(block), allocator);
+        return block + 1;
+    }
+
+    static void operator delete(void *ptr, size_t size) {
+        auto *block = static_cast<std::max_align_t *>(ptr) - 1;
+        auto *stored = std::launder(reinterpret_cast<Allocator *>(block));
+        auto allocator = *stored;
+        std::destroy_at(stored);
+        allocator.deallocate(block, blocks(size));
+    }
+};
+
+// `co_await CurrentPromise{}` evaluates to the promise of the running frame.
+struct CurrentPromise {
+    Promise *promise = nullptr;
+
+    [[nodiscard]] bool await_ready() const noexcept { return false; }
+    bool await_suspend(Handle handle) noexcept {
+        promise = &handle.promise();
+        return false;
+    }
+    [[nodiscard]] Promise &await_resume() const noexcept { return *promise; }
+};
+
+Handle handleOf(std::coroutine_handle<> frame) {
+    return Handle::from_address(frame.address());
+}
+
+// GCC 12 takes the frame's deallocation through Promise::operator delete for a mismatch
+// with the allocation (GCC bug 109224).
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ < 13
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+// The body of a generator. Blocks do not open scopes in Monkey, so walking into a block
+// only pushes its statements; the completion value follows evalBlockStatements.
+Frame run(Box<Function> function, std::shared_ptr<Environment> env) {
+    auto &promise = co_await CurrentPromise{};
+
+    struct Cursor {
+        const std::vector<Statement> *statements;
+        size_t next;
+    };
+    std::vector<Cursor> blocks{{&std::as_const(function)->body().statements, 0}};
+    Object last;
+
+    while (!blocks.empty()) {
+        auto &block = blocks.back();
+        if (block.next == block.statements->size()) {
+            blocks.pop_back();
+            continue;
+        }
+        const auto &statement = (*block.statements)[block.next++];
+        auto &context = *promise.context;
+
+        if (!yields(statement)) {
+            last = context.evaluate(statement, env);
+            if (std::holds_alternative<Error>(last)) {
+                co_return last;
+            }
+            if (const auto *returned = std::get_if<Box<ReturnValue>>(&last)) {
+                co_return std::as_const(*returned)->value;
+            }
+            continue;
+        }
+
+        if (const auto *stmt = std::get_if<YieldStatement>(&statement)) {
+            auto value = context.evaluate(stmt->value, env);
+            if (std::holds_alternative<Error>(value)) {
+                co_return value;
+            }
+            last = nullptr;
+            co_yield std::move(value);
+        } else if (const auto *nested = std::get_if<BlockStatement>(&statement)) {
+            blocks.push_back({&nested->statements, 0});
+        } else {
+            // An if statement with a yield in one of its branches.
+            const auto &expr =
+                *std::get<Box<IfExpression>>(std::get<ExpressionStatement>(statement)
+                                                 .expression);
+            auto condition = context.evaluate(expr.condition, env);
+            if (std::holds_alternative<Error>(condition)) {
+                co_return condition;
+            }
+            last = nullptr;
+            if (isTruthy(condition)) {
+                blocks.push_back({&expr.consequence.statements, 0});
+            } else if (expr.alternative.has_value()) {
+                blocks.push_back({&expr.alternative->statements, 0});
+            }
+        }
+    }
+    co_return last;
+}
+
+Frame produce(GeneratorState::Source source) {
+    while (auto value = source()) {
+        co_yield std::move(*value);
+    }
+    co_return nullptr;
+}
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ < 13
+#pragma GCC diagnostic pop
+#endif
+
+} // namespace
+
+namespace monkey {
+
+GeneratorState::GeneratorState(Box<Function> function, std::shared_ptr<Environment> env)
+    : frame_(run(std::move(function), env).handle), env_(std::move(env)) {}
+
+GeneratorState::GeneratorState(Source source)
+    : frame_(produce(std::move(source)).handle) {}
+
+GeneratorState::~GeneratorState() {
+    if (frame_) {
+        frame_.destroy();
+    }
+}
+
+std::optional<Object> GeneratorState::next(CallContext &context) {
+    if (running_.exchange(true, std::memory_order_acquire)) {
+        return context.fail("generator is already running");
+    }
+    // Also cleared when advance() throws, e.g. MemoryQuotaExceeded.
+    struct Running {
+        std::atomic<bool> &flag;
+        ~Running() { flag.store(false, std::memory_order_release); }
+    } running{running_};
+    return advance(context);
+}
+
+void GeneratorState::share() {
+    shared_.store(true, std::memory_order_relaxed);
+    if (env_) {
+        env_->share();
+    }
+}
+
+std::optional<Object> GeneratorState::advance(CallContext &context) {
+    while (true) {
+        if (delegate_) {
+            auto value = delegate_->next(context);
+            if (!value) {
+                delegate_ = nullptr;
+            }
+            return value;
+        }
+        if (!frame_) {
+            return std::nullopt;
+        }
+        if (frame_.done()) {
+            // The body threw out of its last resume and stopped at its final suspend.
+            std::exchange(frame_, nullptr).destroy();
+            env_ = nullptr;
+            return std::nullopt;
+        }
+
+        auto &promise = handleOf(frame_).promise();
+        promise.context = &context;
+        frame_.resume();
+        promise.context = nullptr;
+        if (!frame_.done()) {
+            return std::move(promise.value);
+        }
+
+        auto result = std::move(promise.value);
+        // Free the finished body (and the call frame it held) before the next one runs.
+        std::exchange(frame_, nullptr).destroy();
+        env_ = nullptr;
+        if (auto *inner = std::get_if<Generator>(&result)) {
+            if (inner->state.use_count() == 1) {
+                adopt(*inner->state);
+            } else {
+                if (shared_.load(std::memory_order_relaxed)) {
+                    inner->state->share();
+                }
+                delegate_ = std::move(inner->state);
+            }
+            continue;
+        }
+        if (std::holds_alternative<Error>(result)) {
+            return result;
+        }
+        return std::nullopt;
+    }
+}
+
+// Continues with the frame of `inner`, which nobody else references, so that a chain of
+// returned generators does not grow.
+void GeneratorState::adopt(GeneratorState &inner) {
+    frame_ = std::exchange(inner.frame_, nullptr);
+    env_ = std::move(inner.env_);
+    delegate_ = std::move(inner.delegate_);
+    if (shared_.load(std::memory_order_relaxed)) {
+        share();
+        if (delegate_) {
+            delegate_->share();
+        }
+    }
+}
+
+} // namespace monkey
\ No newline at end of file
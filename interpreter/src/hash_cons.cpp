@@ -0,0 +1,370 @@
+#include "monkey/hash_cons.h"
+#include "monkey/ast.h"
+#include "monkey/box.h"
+#include "monkey/env.h"
+#include "monkey/eval.h"
+#include "monkey/memory.h"
+#include "monkey/object.h"
+#include "monkey/overload.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+namespace monkey {
+
+namespace {
+
+// The fields of a node, written out so that two nodes have the same Shape exactly when
+// they are identical: texts with their length, lists with their count, leaves by their
+// text and boxed children by the address of their cell.
+class Shape {
+  public:
+    explicit Shape(const Expression &node) {
+        number(node.index());
+        std::visit(overloaded{
+                       [this](const Box<PrefixExpression> &e) {
+                           text(e->token.literal);
+                           text(e->op);
+                           expression(e->right);
+                       },
+                       [this](const Box<InfixExpression> &e) {
+                           text(e->token.literal);
+                           expression(e->left);
+                           text(e->op);
+                           expression(e->right);
+                       },
+                       [this](const Box<IfExpression> &e) {
+                           text(e->token.literal);
+                           expression(e->condition);
+                           block(e->consequence);
+                           number(e->alternative.has_value() ? 1 : 0);
+                           if (e->alternative) {
+                               block(*e->alternative);
+                           }
+                       },
+                       [this](const Box<FunctionLiteral> &e) {
+                           text(e->token.literal);
+                           number(e->parameters.size());
+                           for (const auto &parameter : e->parameters) {
+                               text(parameter.token.literal);
+                           }
+                           block(e->body);
+                           number(e->generator ? 1 : 0);
+                       },
+                       [this](const Box<CallExpression> &e) {
+                           text(e->token.literal);
+                           expression(e->function);
+                           expressions(e->arguments);
+                       },
+                       [this](const Box<ArrayLiteral> &e) {
+                           text(e->token.literal);
+                           expressions(e->elements);
+                       },
+                       [this](const Box<IndexExpression> &e) {
+                           text(e->token.literal);
+                           expression(e->left);
+                           expression(e->index);
+                       },
+                       [this](const Box<HashLiteral> &e) {
+                           text(e->token.literal);
+                           number(e->pairs.size());
+                           for (const auto &[key, value] : e->pairs) {
+                               expression(key);
+                               expression(value);
+                           }
+                       },
+                       [](const auto & /*leaf*/) {},
+                   },
+                   node);
+    }
+
+    std::string take() { return std::move(key_); }
+
+  private:
+    void number(size_t n) { key_.append(reinterpret_cast<const char *>(&n), sizeof n); }
+
+    void text(std::string_view t) {
+        number(t.size());
+        key_.append(t);
+    }
+
+    void expression(const Expression &e) {
+        number(e.index());
+        std::visit(overloaded{[this](const Boxed auto &box) {
+                                  const void *cell = &*box;
+                                  key_.append(reinterpret_cast<const char *>(&cell),
+                                              sizeof cell);
+                              },
+                              [this](const auto &leaf) { text(leaf.token.literal); }},
+                   e);
+    }
+
+    void expressions(const std::vector<Expression> &list) {
+        number(list.size());
+        for (const auto &e : list) {
+            expression(e);
+        }
+    }
+
+    // The parser only makes blocks the bodies of ifs and functions, but a block may hold
+    // blocks, so they are written from a stack.
+    void block(const BlockStatement &outer) {
+        text(outer.token.literal);
+        number(outer.statements.size());
+        std::vector<std::span<const Statement>> rest{outer.statements};
+        while (!rest.empty()) {
+            if (rest.back().empty()) {
+                rest.pop_back();
+                continue;
+            }
+            const auto &statement = rest.back().front();
+            rest.back() = rest.back().subspan(1);
+            number(statement.index());
+            std::visit(overloaded{[&](const BlockStatement &b) {
+                                      text(b.token.literal);
+                                      number(b.statements.size());
+                                      rest.emplace_back(b.statements);
+                                  },
+                                  [this](const LetStatement &s) {
+                                      text(s.token.literal);
+                                      text(s.name.token.literal);
+                                      expression(s.value);
+                                  },
+                                  [this](const ExpressionStatement &s) {
+                                      text(s.token.literal);
+                                      expression(s.expression);
+                                  },
+                                  [this](const auto &s) {
+                                      text(s.token.literal);
+                                      expression(s.value);
+                                  }},
+                       statement);
+        }
+    }
+
+    std::string key_;
+};
+
+// Visits the expressions of a program children first, from an explicit stack.
+class Consing {
+  public:
+    Consing() : env_(makeEnvironment()) {}
+
+    HashConsStats run(Program &program) {
+        add(program.statements);
+        while (!pending_.empty()) {
+            auto [slot, ready] = pending_.back();
+            pending_.pop_back();
+            if (ready) {
+                finish(*slot);
+            } else {
+                visit(*slot);
+            }
+        }
+        return stats_;
+    }
+
+  private:
+    // An expression whose children are to be visited, or are done if it is `ready`.
+    struct Item {
+        Expression *slot;
+        bool ready;
+    };
+
+    void add(Expression &expression) { pending_.push_back({&expression, false}); }
+
+    void add(std::vector<Statement> &statements) {
+        std::vector<std::vector<Statement> *> blocks{&statements};
+        while (!blocks.empty()) {
+            auto *block = blocks.back();
+            blocks.pop_back();
+            for (auto &statement : *block) {
+                std::visit(overloaded{[&](BlockStatement &b) {
+                                          blocks.push_back(&b.statements);
+                                      },
+                                      [this](ExpressionStatement &s) {
+                                          add(s.expression);
+                                      },
+                                      [this](auto &s) { add(s.value); }},
+                           statement);
+            }
+        }
+    }
+
+    // The children of a boxed node go on the stack above the node. Boxes are only
+    // shared once they are finished, so reaching into them does not copy them.
+    void visit(Expression &slot) {
+        if (auto *literal = std::get_if<StringLiteral>(&slot)) {
+            auto [interned, inserted] =
+                strings_.try_emplace(*literal->value, literal->value);
+            if (!inserted) {
+                literal->value = interned->second;
+            }
+            return;
+        }
+        if (!boxed(slot)) {
+            return;
+        }
+        pending_.push_back({&slot, true});
+        std::visit(overloaded{
+                       [this](Box<PrefixExpression> &e) { add(e->right); },
+                       [this](Box<InfixExpression> &e) {
+                           add(e->left);
+                           add(e->right);
+                       },
+                       [this](Box<IfExpression> &e) {
+                           add(e->condition);
+                           add(e->consequence.statements);
+                           if (e->alternative) {
+                               add(e->alternative->statements);
+                           }
+                       },
+                       [this](Box<FunctionLiteral> &e) { add(e->body.statements); },
+                       [this](Box<CallExpression> &e) {
+                           add(e->function);
+                           for (auto &argument : e->arguments) {
+                               add(argument);
+                           }
+                       },
+                       [this](Box<ArrayLiteral> &e) {
+                           for (auto &element : e->elements) {
+                               add(element);
+                           }
+                       },
+                       [this](Box<IndexExpression> &e) {
+                           add(e->left);
+                           add(e->index);
+                       },
+                       [this](Box<HashLiteral> &e) {
+                           for (auto &[key, value] : e->pairs) {
+                               add(key);
+                               add(value);
+                           }
+                       },
+                       [](auto & /*leaf*/) {},
+                   },
+                   slot);
+    }
+
+    // Replaces a node whose children are done by the identical node seen before, or
+    // else caches its value and makes it the one later nodes are replaced by.
+    void finish(Expression &slot) {
+        ++stats_.nodes;
+        auto key = Shape(slot).take();
+        if (auto found = nodes_.find(key); found != nodes_.end()) {
+            slot = found->second;
+            ++stats_.shared;
+            return;
+        }
+        cache(slot);
+        nodes_.emplace(std::move(key), slot);
+    }
+
+    void cache(Expression &slot) {
+        auto store = [&](std::shared_ptr<const Constant> &constant) {
+            constant = evaluate(slot);
+            if (constant != nullptr) {
+                ++stats_.constants;
+            }
+        };
+        std::visit(overloaded{
+                       [&](Box<PrefixExpression> &e) {
+                           if (isOperand(e->right)) {
+                               store(e->constant);
+                           }
+                       },
+                       [&](Box<InfixExpression> &e) {
+                           if (isOperand(e->left) && isOperand(e->right)) {
+                               store(e->constant);
+                           }
+                       },
+                       [&](Box<IndexExpression> &e) {
+                           if (isOperand(e->left) && isOperand(e->index)) {
+                               store(e->constant);
+                           }
+                       },
+                       [](auto & /*other*/) {},
+                   },
+                   slot);
+    }
+
+    // The value of `expression` if it is one a node can cache, and nullptr otherwise.
+    std::shared_ptr<const Constant> evaluate(const Expression &expression) {
+        auto value = eval(expression, env_);
+        if (std::holds_alternative<std::nullptr_t>(value)) {
+            return std::make_shared<const Constant>(nullptr);
+        }
+        if (const auto *n = std::get_if<int64_t>(&value)) {
+            return std::make_shared<const Constant>(*n);
+        }
+        if (const auto *b = std::get_if<bool>(&value)) {
+            return std::make_shared<const Constant>(*b);
+        }
+        if (const auto *s = std::get_if<String>(&value)) {
+            return std::make_shared<const Constant>(
+                std::make_shared<const std::string>(s->view()));
+        }
+        return nullptr;
+    }
+
+    static bool boxed(const Expression &expression) {
+        return std::visit([](const auto &e) { return Boxed<decltype(e)>; }, expression);
+    }
+
+    // The value cached in `expression`, if any.
+    static const Constant *cached(const Expression &expression) {
+        return std::visit(
+            overloaded{[](const Box<PrefixExpression> &e) { return e->constant.get(); },
+                       [](const Box<InfixExpression> &e) { return e->constant.get(); },
+                       [](const Box<IndexExpression> &e) { return e->constant.get(); },
+                       [](const auto & /*e*/) -> const Constant * { return nullptr; }},
+            expression);
+    }
+
+    // A literal other than a function, or an expression with a cached value.
+    static bool isConstant(const Expression &expression) {
+        return cached(expression) != nullptr ||
+               std::visit(overloaded{[](const Identifier & /*e*/) { return false; },
+                                     [](const Boxed auto & /*e*/) { return false; },
+                                     [](const auto & /*literal*/) { return true; }},
+                          expression);
+    }
+
+    // A constant, or an array or hash literal of constants: evaluating an operator on
+    // it takes time in proportion to the literal.
+    static bool isOperand(const Expression &expression) {
+        if (const auto *array = std::get_if<Box<ArrayLiteral>>(&expression)) {
+            return std::ranges::all_of((*array)->elements, isConstant);
+        }
+        if (const auto *hash = std::get_if<Box<HashLiteral>>(&expression)) {
+            return std::ranges::all_of((*hash)->pairs, [](const auto &pair) {
+                return isConstant(pair.first) && isConstant(pair.second);
+            });
+        }
+        return isConstant(expression);
+    }
+
+    std::vector<Item> pending_;
+    std::unordered_map<std::string, Expression> nodes_;
+    std::unordered_map<std::string_view, std::shared_ptr<const std::string>> strings_;
+    // Constant expressions name nothing, so they are evaluated in an empty environment.
+    std::shared_ptr<Environment> env_;
+    HashConsStats stats_;
+};
+
+} // namespace
+
+HashConsStats hashCons(Program &program) {
+    const MemoryScope unaccounted(nullptr);
+    return Consing().run(program);
+}
+
+} // namespace monkey
\ No newline at end of file
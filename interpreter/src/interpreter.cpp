@@ -0,0 +1,77 @@
+#include "monkey/interpreter.h"
+#include "monkey/budget.h"
+#include "monkey/env.h"
+#include "monkey/eval.h"
+#include "monkey/hash_cons.h"
+#include "monkey/lexer.h"
+#include "monkey/memory.h"
+#include "monkey/parser.h"
+
+#include <fmt/format.h>
+#include <fmt/ranges.h>
+
+#include <memory>
+#include <new>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace monkey {
+
+std::shared_ptr<const CompiledProgram> compile(std::string_view source,
+                                               CompileOptions options) {
+    const MemoryScope unaccounted(nullptr);
+    auto parser = Parser(Lexer(std::string(source)));
+    auto program = parser.parseProgram();
+    if (options.hashCons && parser.errors().empty()) {
+        hashCons(*program);
+    }
+    return std::shared_ptr<const CompiledProgram>(
+        new CompiledProgram(std::move(program), parser.errors()));
+}
+
+Interpreter::Interpreter(InterpreterOptions options)
+    : options_(options), account_(std::make_unique<MemoryAccount>(options.memoryQuota)) {
+    const MemoryScope scope(*account_);
+    globals_ = makeEnvironment();
+}
+
+Interpreter::~Interpreter() {
+    const MemoryScope scope(*account_);
+    globals_.reset();
+}
+
+Object Interpreter::run(const CompiledProgram &program) {
+    if (!program.ok()) {
+        return Error{fmt::format("parse errors: {}", fmt::join(program.errors(), "; "))};
+    }
+
+    const MemoryScope scope(*account_);
+    const bool limited = options_.memoryQuota != MemoryAccount::UNLIMITED ||
+                         options_.fuel != Budget::UNLIMITED ||
+                         options_.timeout.has_value();
+    // The evaluator turns failed allocations into Errors; this catches those made
+    // around it.
+    try {
+        if (!limited) {
+            return eval(program.program(), globals_);
+        }
+
+        auto budget = options_.timeout
+                          ? Budget::withTimeout(*options_.timeout, options_.fuel)
+                          : Budget(options_.fuel);
+        budget.limitMemory(*account_);
+        return eval(program.program(), globals_, budget);
+    } catch (const MemoryQuotaExceeded &e) {
+        return Error{e.what()};
+    } catch (const std::bad_alloc & /*e*/) {
+        return Error{"evaluation ran out of memory"};
+    }
+}
+
+void Interpreter::define(const std::string &name, Object value) {
+    const MemoryScope scope(*account_);
+    globals_->set(name, std::move(value));
+}
+
+} // namespace monkey
\ No newline at end of file
@@ -0,0 +1,699 @@
+#include "monkey/io.h"
+#include "monkey/generator.h"
+#include "monkey/memory.h"
+#include "monkey/object.h"
+#include "monkey/task.h"
+#include "monkey/thread_pool.h"
+
+#include <fmt/format.h>
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using namespace monkey;
+
+// The low bits of an entry's user_data tell which operation of the request completed.
+// A null request stops the completion thread.
+constexpr uint64_t TAG_MASK = 0b11;
+
+constexpr uint64_t tag(uint8_t opcode) {
+    switch (opcode) {
+    case IORING_OP_READ:
+        return 1;
+    case IORING_OP_WRITE:
+        return 2;
+    case IORING_OP_CLOSE:
+        return 3;
+    default:
+        return 0;
+    }
+}
+
+constexpr uint8_t opcode(uint64_t userData) {
+    constexpr std::array<uint8_t, 4> OPCODES = {IORING_OP_OPENAT, IORING_OP_READ,
+                                                IORING_OP_WRITE, IORING_OP_CLOSE};
+    return OPCODES.at(userData & TAG_MASK);
+}
+
+// Reads grow the buffer by this much when the file size is unknown (e.g. /proc files).
+constexpr size_t CHUNK = 64 * 1024;
+// The kernel caps a single read or write at a little under 2 GiB.
+constexpr size_t MAX_TRANSFER = size_t{1} << 30;
+
+int setup(unsigned entries, io_uring_params &params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+}
+
+int enter(int ring, unsigned submit, unsigned wait, unsigned flags) {
+    return static_cast<int>(
+        syscall(__NR_io_uring_enter, ring, submit, wait, flags, nullptr, 0));
+}
+
+void *map(int ring, size_t size, off_t offset) {
+    void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     ring, offset);
+    return ptr == MAP_FAILED ? nullptr : ptr;
+}
+
+template <typename T>
+T *at(void *base, unsigned offset) {
+    return reinterpret_cast<T *>(static_cast<char *>(base) + offset);
+}
+
+// Unmaps the pages behind the line being read every this many bytes.
+constexpr size_t RELEASE_INTERVAL = size_t{64} << 20;
+
+// The line of `text` starting at `position`, without its "\n" or "\r\n" terminator, and
+// moves `position` past it. memchr scans a vector register at a time.
+std::optional<std::string_view> nextLine(std::string_view text, size_t &position) {
+    if (position >= text.size()) {
+        return std::nullopt;
+    }
+    const auto *begin = text.data() + position;
+    const auto *newline =
+        static_cast<const char *>(std::memchr(begin, '\n', text.size() - position));
+    const auto *end = newline == nullptr ? text.data() + text.size() : newline;
+    std::string_view line(begin, static_cast<size_t>(end - begin));
+    position += line.size() + 1;
+    if (line.ends_with('\r')) {
+        line.remove_suffix(1);
+    }
+    return line;
+}
+
+// The lines of `text` as slices of it.
+GeneratorState::Source lines(ManagedString text) {
+    auto shared = std::allocate_shared<const ManagedString>(
+        AccountingAllocator<ManagedString>(), std::move(text));
+    return [text = std::move(shared), position = size_t{0}]() mutable
+           -> std::optional<Object> {
+        return nextLine(*text, position).transform([&](std::string_view line) -> Object {
+            return String(text, line);
+        });
+    };
+}
+
+// A read-only mapping of a whole file, unmapped with the last line that views it.
+class Mapping {
+  public:
+    Mapping(void *data, size_t size) : data_(data), size_(size) {}
+    Mapping(const Mapping &) = delete;
+    Mapping &operator=(const Mapping &) = delete;
+    ~Mapping() { munmap(data_, size_); }
+
+    [[nodiscard]] std::string_view text() const {
+        return {static_cast<const char *>(data_), size_};
+    }
+
+    // Drops the pages before `offset` from the process; they fault back in from the page
+    // cache if a line kept from them is read again.
+    void release(size_t offset) const {
+        auto page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        madvise(data_, offset / page * page, MADV_DONTNEED);
+    }
+
+  private:
+    void *data_;
+    size_t size_;
+};
+
+} // namespace
+
+namespace monkey {
+
+// One system call of a request, either submitted to the ring or performed directly.
+struct IoLoop::Operation {
+    uint8_t opcode;
+    int fd;
+    // The path for IORING_OP_OPENAT, the buffer otherwise.
+    const void *address;
+    // The mode for IORING_OP_OPENAT, the buffer length otherwise.
+    unsigned length;
+    uint64_t offset;
+    int flags;
+    // IOSQE_IO_HARDLINK to run the next operation of the batch after this one, even if
+    // this one fails.
+    uint8_t link;
+};
+
+// The operations a request submits next, in order.
+struct IoLoop::Batch {
+    std::array<Operation, 2> operations{};
+    size_t size = 0;
+
+    void push(const Operation &op) { operations.at(size++) = op; }
+    [[nodiscard]] std::span<const Operation> view() const {
+        return std::span(operations).first(size);
+    }
+};
+
+struct IoLoop::Request {
+    enum class Kind { READ, LINES, WRITE };
+
+    Request(Kind requested, std::string target, TaskGroup *owner)
+        : kind(requested), path(std::move(target)), group(owner) {}
+
+    [[nodiscard]] Batch begin() const {
+        auto flags = kind == Kind::WRITE ? O_WRONLY | O_CREAT | O_TRUNC : O_RDONLY;
+        Batch next;
+        next.push(
+            {IORING_OP_OPENAT, AT_FDCWD, path.c_str(), 0644, 0, flags | O_CLOEXEC, 0});
+        return next;
+    }
+
+    // Takes the result of an operation (a negated errno on failure) and returns the
+    // operations that follow it. The request is finished once none are in flight.
+    Batch advance(uint8_t opcode, int result) {
+        Batch next;
+        switch (opcode) {
+        case IORING_OP_OPENAT:
+            if (result < 0) {
+                fail("cannot open", -result);
+                break;
+            }
+            fd = result;
+            if (kind == Kind::WRITE) {
+                next.push(transfer());
+                break;
+            }
+            if (struct stat st {}; fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+                expected = static_cast<size_t>(st.st_size);
+            }
+            if (expected > 0 && expected <= MAX_TRANSFER) {
+                // The common case: one read of the size fstat reported, and the close
+                // submitted with it.
+                if (!resize(expected)) {
+                    finishTransfer(next);
+                    break;
+                }
+                closing = true;
+                next.push(transfer(IOSQE_IO_HARDLINK));
+                next.push(close());
+            } else if (resize(std::max(expected, CHUNK))) {
+                next.push(transfer());
+            } else {
+                finishTransfer(next);
+            }
+            break;
+        case IORING_OP_READ:
+        case IORING_OP_WRITE:
+            if (result < 0) {
+                fail(opcode == IORING_OP_WRITE ? "cannot write" : "cannot read", -result);
+                done = 0;
+                finishTransfer(next);
+                break;
+            }
+            done += static_cast<size_t>(result);
+            if (kind == Kind::WRITE) {
+                if (result > 0 && done < data.size()) {
+                    next.push(transfer());
+                } else {
+                    finishTransfer(next);
+                }
+            } else if (closing || result == 0 || (expected > 0 && done >= expected)) {
+                data.resize(done);
+                finishTransfer(next);
+            } else {
+                if (done == data.size() &&
+                    !resize(data.size() + std::max(data.size(), CHUNK))) {
+                    done = 0;
+                    finishTransfer(next);
+                    break;
+                }
+                next.push(transfer());
+            }
+            break;
+        default:
+            break;
+        }
+        return next;
+    }
+
+    // What the task completes with. Its value is allocated on the completion thread,
+    // where the account may refuse it as well.
+    Object result() {
+        if (!error) {
+            try {
+                return value();
+            } catch (const std::bad_alloc & /*e*/) {
+                fail("cannot read", ENOMEM);
+            }
+        }
+        return Error{std::move(*error)};
+    }
+
+    Object value() {
+        switch (kind) {
+        case Kind::READ:
+            return String(std::move(data));
+        case Kind::LINES:
+            return Generator{std::allocate_shared<GeneratorState>(
+                AccountingAllocator<GeneratorState>(), lines(std::move(data)))};
+        case Kind::WRITE:
+            break;
+        }
+        return static_cast<int64_t>(done);
+    }
+
+    // Records the first failure, which the request then completes with.
+    void fail(std::string_view what, int errnum) {
+        if (!error) {
+            auto message = std::error_code(errnum, std::system_category()).message();
+            error = fmt::format("{} {}: {}", what, path, message);
+        }
+    }
+
+    Kind kind;
+    std::string path;
+    // The bytes read or to be written. Allocated through the account of the thread that
+    // started the request, also when the completion thread grows it.
+    ManagedString data;
+    size_t done = 0;
+    // Size of the file being read, 0 if unknown.
+    size_t expected = 0;
+    int fd = -1;
+    // Set once the close is submitted.
+    bool closing = false;
+    // Operations submitted and not completed yet.
+    unsigned inFlight = 0;
+    std::optional<std::string> error;
+    std::shared_ptr<TaskState> task =
+        std::allocate_shared<TaskState>(AccountingAllocator<TaskState>());
+    TaskGroup *group;
+    MemoryAccount *account = memory::current;
+
+  private:
+    [[nodiscard]] Operation transfer(uint8_t link = 0) const {
+        auto opcode = kind == Kind::WRITE ? IORING_OP_WRITE : IORING_OP_READ;
+        auto length = static_cast<unsigned>(std::min(data.size() - done, MAX_TRANSFER));
+        return {static_cast<uint8_t>(opcode), fd, data.data() + done, length, done, 0,
+                link};
+    }
+
+    Operation close() {
+        closing = true;
+        return {IORING_OP_CLOSE, fd, nullptr, 0, 0, 0, 0};
+    }
+
+    void finishTransfer(Batch &next) {
+        if (!closing) {
+            next.push(close());
+        }
+    }
+
+    // Grows the buffer for a read, or fails the read if its account refuses the memory.
+    bool resize(size_t size) {
+        try {
+            data.resize(size);
+            return true;
+        } catch (const std::bad_alloc & /*e*/) {
+            fail("cannot read", ENOMEM);
+            return false;
+        }
+    }
+};
+
+namespace {
+
+// The blocking equivalent of submitting `op`, for when io_uring is unavailable.
+int perform(const auto &op) {
+    long result = 0;
+    switch (op.opcode) {
+    case IORING_OP_OPENAT:
+        result = ::openat(op.fd, static_cast<const char *>(op.address), op.flags,
+                          static_cast<mode_t>(op.length));
+        break;
+    case IORING_OP_READ:
+        result = ::pread(op.fd, const_cast<void *>(op.address), op.length,
+                         static_cast<off_t>(op.offset));
+        break;
+    case IORING_OP_WRITE:
+        result = ::pwrite(op.fd, op.address, op.length, static_cast<off_t>(op.offset));
+        break;
+    case IORING_OP_CLOSE:
+        result = ::close(op.fd);
+        break;
+    default:
+        errno = EINVAL;
+        result = -1;
+    }
+    return result < 0 ? -errno : static_cast<int>(result);
+}
+
+} // namespace
+
+IoLoop::IoLoop(unsigned entries) {
+    io_uring_params params{};
+    ring_ = setup(entries, params);
+    if (ring_ < 0) {
+        return;
+    }
+
+    sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqRing_ = map(ring_, sqRingSize_, IORING_OFF_SQ_RING);
+    cqRing_ = map(ring_, cqRingSize_, IORING_OFF_CQ_RING);
+    sqes_ = static_cast<io_uring_sqe *>(map(ring_, sqesSize_, IORING_OFF_SQES));
+    if (sqRing_ == nullptr || cqRing_ == nullptr || sqes_ == nullptr) {
+        release();
+        return;
+    }
+
+    sqTail_ = at<unsigned>(sqRing_, params.sq_off.tail);
+    sqMask_ = at<unsigned>(sqRing_, params.sq_off.ring_mask);
+    sqArray_ = at<unsigned>(sqRing_, params.sq_off.array);
+    cqHead_ = at<unsigned>(cqRing_, params.cq_off.head);
+    cqTail_ = at<unsigned>(cqRing_, params.cq_off.tail);
+    cqMask_ = at<unsigned>(cqRing_, params.cq_off.ring_mask);
+    cqes_ = at<io_uring_cqe>(cqRing_, params.cq_off.cqes);
+
+    sqEntries_ = params.sq_entries;
+    // A request has at most two operations in flight.
+    slots_.release(static_cast<std::ptrdiff_t>(params.cq_entries / 2));
+    reaper_ = std::thread([this] { reap(); });
+}
+
+IoLoop::~IoLoop() {
+    if (reaper_.joinable()) {
+        {
+            const std::lock_guard lock(mutex_);
+            // A broken ring has stopped the completion thread already.
+            if (!broken_.load(std::memory_order_relaxed)) {
+                Batch stop;
+                stop.push({IORING_OP_NOP, -1, nullptr, 0, 0, 0, 0});
+                queue(nullptr, stop);
+                flush();
+            }
+        }
+        reaper_.join();
+    }
+    release();
+}
+
+Task IoLoop::readFile(std::string path, TaskGroup *group) {
+    return start(std::make_unique<Request>(Request::Kind::READ, std::move(path), group));
+}
+
+Task IoLoop::readLines(std::string path, TaskGroup *group) {
+    return start(std::make_unique<Request>(Request::Kind::LINES, std::move(path), group));
+}
+
+Task IoLoop::writeFile(std::string path, ManagedString contents, TaskGroup *group) {
+    auto request =
+        std::make_unique<Request>(Request::Kind::WRITE, std::move(path), group);
+    request->data = std::move(contents);
+    return start(std::move(request));
+}
+
+Task IoLoop::start(std::unique_ptr<Request> request) {
+    Task task{request->task};
+    if (request->group != nullptr) {
+        request->group->enter();
+    }
+
+    if (!async()) {
+        runBlocking(std::move(request));
+        return task;
+    }
+
+    if (!slots_.try_acquire()) {
+        ThreadPool::Blocking blocking(scheduler());
+        if (!blocking.helps()) {
+            slots_.acquire();
+        } else {
+            // No spare stands in: run queued tasks while waiting for a slot.
+            constexpr auto interval = std::chrono::milliseconds(1);
+            while (!(blocking.help() ? slots_.try_acquire()
+                                     : slots_.try_acquire_for(interval))) {
+            }
+        }
+    }
+    std::unique_lock lock(mutex_);
+    if (broken_.load(std::memory_order_relaxed)) {
+        lock.unlock();
+        slots_.release();
+        runBlocking(std::move(request));
+        return task;
+    }
+    auto *submitted = request.release();
+    outstanding_.insert(submitted);
+    queue(submitted, submitted->begin());
+    flush();
+    return task;
+}
+
+void IoLoop::runBlocking(std::unique_ptr<Request> request) {
+    auto next = request->begin();
+    while (next.size > 0) {
+        Batch following;
+        for (const auto &op : next.view()) {
+            for (const auto &then : request->advance(op.opcode, perform(op)).view()) {
+                following.push(then);
+            }
+        }
+        next = following;
+    }
+    finish(std::move(request));
+}
+
+void IoLoop::queue(Request *request, const Batch &batch) {
+    // A linked chain must not straddle two submissions, or its operations run unordered.
+    if (queued_ + batch.size > sqEntries_) {
+        flush();
+    }
+    for (const auto &op : batch.view()) {
+        // Only threads holding mutex_ write the tail; the kernel reads it.
+        auto tail = *sqTail_;
+        auto index = tail & *sqMask_;
+        auto &sqe = sqes_[index];
+        sqe = io_uring_sqe{};
+        sqe.opcode = op.opcode;
+        sqe.flags = op.link;
+        sqe.fd = op.fd;
+        sqe.addr = reinterpret_cast<uint64_t>(op.address);
+        sqe.len = op.length;
+        sqe.off = op.offset;
+        sqe.open_flags = static_cast<uint32_t>(op.flags);
+        // Requests are aligned, which leaves the low bits for the opcode.
+        sqe.user_data = reinterpret_cast<uint64_t>(request) | tag(op.opcode);
+        sqArray_[index] = index;
+        std::atomic_ref(*sqTail_).store(tail + 1, std::memory_order_release);
+        ++queued_;
+        if (request != nullptr) {
+            ++request->inFlight;
+        }
+    }
+}
+
+void IoLoop::flush() {
+    // Without SQPOLL the kernel consumes the entries during the call.
+    while (queued_ > 0) {
+        auto submitted = enter(ring_, queued_, 0, 0);
+        if (submitted >= 0) {
+            queued_ -= static_cast<unsigned>(submitted);
+        } else if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            unqueue(errno);
+        }
+    }
+}
+
+void IoLoop::unqueue(int error) {
+    // The kernel has not seen the last queued_ entries, so the tail can be taken back.
+    auto tail = *sqTail_ - queued_;
+    for (auto index = tail; index != *sqTail_; ++index) {
+        auto data = sqes_[index & *sqMask_].user_data;
+        auto *request = reinterpret_cast<Request *>(data & ~TAG_MASK);
+        if (request == nullptr) {
+            continue;
+        }
+        request->fail("cannot submit", error);
+        if (--request->inFlight == 0) {
+            if (request->fd >= 0 && !request->closing) {
+                ::close(request->fd);
+            }
+            outstanding_.erase(request);
+            finish(std::unique_ptr<Request>(request));
+            slots_.release();
+        }
+    }
+    std::atomic_ref(*sqTail_).store(tail, std::memory_order_release);
+    queued_ = 0;
+}
+
+void IoLoop::abandon(int error) {
+    broken_.store(true, std::memory_order_relaxed);
+    for (auto *request : outstanding_) {
+        request->fail("cannot complete", error);
+        // The kernel may still write to the buffer of a request it has not completed, so
+        // the Request itself is never freed.
+        const MemoryScope scope(request->account);
+        request->task->complete(request->result());
+        if (request->group != nullptr) {
+            request->group->leave();
+        }
+        slots_.release();
+    }
+    outstanding_.clear();
+}
+
+void IoLoop::reap() {
+    std::vector<io_uring_cqe> completions;
+    bool stopping = false;
+    while (!stopping) {
+        // EBUSY and EAGAIN ask for the completions to be taken off the queue first.
+        if (enter(ring_, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR &&
+            errno != EAGAIN && errno != EBUSY) {
+            const std::lock_guard lock(mutex_);
+            abandon(errno);
+            return;
+        }
+        // Copy the completions out first: handling them submits follow-up operations,
+        // whose completions need the space.
+        auto head = *cqHead_;
+        auto tail = std::atomic_ref(*cqTail_).load(std::memory_order_acquire);
+        completions.clear();
+        for (; head != tail; ++head) {
+            completions.push_back(cqes_[head & *cqMask_]);
+        }
+        std::atomic_ref(*cqHead_).store(head, std::memory_order_release);
+
+        // Submit the follow-ups of the whole batch with one system call.
+        const std::lock_guard lock(mutex_);
+        for (const auto &cqe : completions) {
+            auto *request = reinterpret_cast<Request *>(cqe.user_data & ~TAG_MASK);
+            if (request == nullptr) {
+                stopping = true;
+                continue;
+            }
+            --request->inFlight;
+            queue(request, request->advance(opcode(cqe.user_data), cqe.res));
+            if (request->inFlight == 0) {
+                outstanding_.erase(request);
+                finish(std::unique_ptr<Request>(request));
+                slots_.release();
+            }
+        }
+        flush();
+    }
+}
+
+void IoLoop::finish(std::unique_ptr<Request> request) {
+    const MemoryScope scope(request->account);
+    auto *group = request->group;
+    request->task->complete(request->result());
+    // Free the buffer before the evaluation that started the request can return.
+    request.reset();
+    if (group != nullptr) {
+        group->leave();
+    }
+}
+
+void IoLoop::release() {
+    if (sqes_ != nullptr) {
+        munmap(sqes_, sqesSize_);
+    }
+    if (cqRing_ != nullptr) {
+        munmap(cqRing_, cqRingSize_);
+    }
+    if (sqRing_ != nullptr) {
+        munmap(sqRing_, sqRingSize_);
+    }
+    if (ring_ >= 0) {
+        ::close(ring_);
+    }
+    sqes_ = nullptr;
+    cqRing_ = sqRing_ = nullptr;
+    ring_ = -1;
+}
+
+Object mapLines(const std::string &path) {
+    auto failure = [&path](std::string_view what, int errnum) -> Object {
+        auto message = std::error_code(errnum, std::system_category()).message();
+        return Error{fmt::format("{} {}: {}", what, path, message)};
+    };
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return failure("cannot open", errno);
+    }
+    struct stat st {};
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        // Pipes and files whose size the kernel does not report (/proc) cannot be mapped;
+        // read them into memory instead.
+        ManagedString text;
+        std::array<char, CHUNK> buffer{};
+        ssize_t n = 0;
+        try {
+            while ((n = ::read(fd, buffer.data(), buffer.size())) > 0) {
+                text.append(buffer.data(), static_cast<size_t>(n));
+            }
+        } catch (const std::bad_alloc & /*e*/) {
+            ::close(fd);
+            throw;
+        }
+        auto errnum = errno;
+        ::close(fd);
+        if (n < 0) {
+            return failure("cannot read", errnum);
+        }
+        return Generator{std::allocate_shared<GeneratorState>(
+            AccountingAllocator<GeneratorState>(), lines(std::move(text)))};
+    }
+    void *data =
+        mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    auto errnum = errno;
+    // The mapping stays valid without the descriptor.
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        return failure("cannot map", errnum);
+    }
+
+    auto size = static_cast<size_t>(st.st_size);
+    madvise(data, size, MADV_SEQUENTIAL);
+    auto mapping = std::make_shared<const Mapping>(data, size);
+    GeneratorState::Source source = [mapping = std::move(mapping), position = size_t{0},
+                                     released = size_t{0}]() mutable
+        -> std::optional<Object> {
+        if (position - released >= RELEASE_INTERVAL) {
+            mapping->release(position);
+            released = position;
+        }
+        return nextLine(mapping->text(), position).transform([&](std::string_view line) {
+            return Object{String(mapping, line)};
+        });
+    };
+    return Generator{std::allocate_shared<GeneratorState>(
+        AccountingAllocator<GeneratorState>(), std::move(source))};
+}
+
+IoLoop &io() {
+    static IoLoop loop;
+    return loop;
+}
+
+} // namespace monkey
\ No newline at end of file
@@ -1,16 +1,140 @@
 #include "monkey/lexer.h"
 #include "monkey/token.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <utility>
 
 namespace {
-constexpr bool isLetter(char ch) {
-    return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || ch == '_';
+
+using monkey::TokenType;
+
+// What a character starts. Whitespace has been skipped by the time nextToken() looks at
+// the class of a character, and PUNCT covers both one-character tokens and ILLEGAL.
+enum class Kind : uint8_t { PUNCT, SPACE, LETTER, DIGIT, QUOTE, END };
+
+struct CharClass {
+    Kind kind = Kind::PUNCT;
+    // For PUNCT, the token of the character on its own, and of the character followed by
+    // '=' if that is a token too (ILLEGAL if not).
+    TokenType single = TokenType::ILLEGAL;
+    TokenType withEquals = TokenType::ILLEGAL;
+};
+
+constexpr auto CLASSES = [] {
+    std::array<CharClass, 256> table{};
+    auto set = [&](char ch, CharClass c) { table[static_cast<unsigned char>(ch)] = c; };
+    for (char ch = 'a'; ch <= 'z'; ++ch) {
+        set(ch, {.kind = Kind::LETTER});
+        set(static_cast<char>(ch - 'a' + 'A'), {.kind = Kind::LETTER});
+    }
+    set('_', {.kind = Kind::LETTER});
+    for (char ch = '0'; ch <= '9'; ++ch) {
+        set(ch, {.kind = Kind::DIGIT});
+    }
+    for (char ch : {' ', '\t', '\n', '\r'}) {
+        set(ch, {.kind = Kind::SPACE});
+    }
+    set('"', {.kind = Kind::QUOTE});
+    set('\0', {.kind = Kind::END});
+    for (auto [ch, type] : std::to_array<std::pair<char, TokenType>>({
+             {'+', TokenType::PLUS},
+             {'-', TokenType::MINUS},
+             {'*', TokenType::ASTERISK},
+             {'/', TokenType::SLASH},
+             {'<', TokenType::LT},
+             {'>', TokenType::GT},
+             {';', TokenType::SEMICOLON},
+             {':', TokenType::COLON},
+             {',', TokenType::COMMA},
+             {'(', TokenType::LPAREN},
+             {')', TokenType::RPAREN},
+             {'{', TokenType::LBRACE},
+             {'}', TokenType::RBRACE},
+             {'[', TokenType::LBRACKET},
+             {']', TokenType::RBRACKET},
+         })) {
+        set(ch, {.single = type});
+    }
+    set('=', {.single = TokenType::ASSIGN, .withEquals = TokenType::EQ});
+    set('!', {.single = TokenType::BANG, .withEquals = TokenType::NOT_EQ});
+    return table;
+}();
+
+constexpr const CharClass &classOf(char ch) {
+    return CLASSES[static_cast<unsigned char>(ch)];
 }
-constexpr bool isDigit(char ch) { return (ch >= '0' && ch <= '9'); }
-constexpr bool isWhitespace(char ch) {
-    return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r';
+
+// The classes of characters that the lexer skips runs of. Each tests one character and,
+// with SSE2, 16 at once, setting the bytes of those in the class.
+struct Letter {
+    static constexpr bool contains(char ch) { return classOf(ch).kind == Kind::LETTER; }
+#if defined(__SSE2__)
+    static __m128i contains(__m128i bytes) {
+        // Setting bit 5 folds upper case onto lower case, and nothing else onto it.
+        auto lower = _mm_or_si128(bytes, _mm_set1_epi8(0x20));
+        auto alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                   _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+        return _mm_or_si128(alpha, _mm_cmpeq_epi8(bytes, _mm_set1_epi8('_')));
+    }
+#endif
+};
+
+struct Digit {
+    static constexpr bool contains(char ch) { return classOf(ch).kind == Kind::DIGIT; }
+#if defined(__SSE2__)
+    // The comparisons are signed, so bytes from 0x80 up fall outside both bounds.
+    static __m128i contains(__m128i bytes) {
+        return _mm_and_si128(_mm_cmpgt_epi8(bytes, _mm_set1_epi8('0' - 1)),
+                             _mm_cmplt_epi8(bytes, _mm_set1_epi8('9' + 1)));
+    }
+#endif
+};
+
+struct Whitespace {
+    static constexpr bool contains(char ch) { return classOf(ch).kind == Kind::SPACE; }
+#if defined(__SSE2__)
+    static __m128i contains(__m128i bytes) {
+        auto is = [bytes](char ch) { return _mm_cmpeq_epi8(bytes, _mm_set1_epi8(ch)); };
+        return _mm_or_si128(_mm_or_si128(is(' '), is('\t')),
+                            _mm_or_si128(is('\n'), is('\r')));
+    }
+#endif
+};
+
+// The end of the run of characters in `Class` that starts at `from`, which is in the
+// class: 16 bytes at a time while they are within the input, then one at a time.
+template <typename Class>
+size_t skip(std::string_view input, size_t from) {
+    // Most runs are a single character, such as the space between two tokens.
+    if (++from == input.size() || !Class::contains(input[from])) {
+        return from;
+    }
+#if defined(__SSE2__)
+    constexpr size_t WIDTH = 16;
+    for (; from + WIDTH <= input.size(); from += WIDTH) {
+        auto bytes =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(input.data() + from));
+        auto in = static_cast<unsigned>(_mm_movemask_epi8(Class::contains(bytes)));
+        if (in != 0xFFFF) {
+            return from + static_cast<size_t>(std::countr_one(in));
+        }
+    }
+#endif
+    while (from < input.size() && Class::contains(input[from])) {
+        ++from;
+    }
+    return from;
 }
+
 } // namespace
 
 namespace monkey {
@@ -24,12 +148,9 @@ void Lexer::readChar() {
     position_ = read_position_++;
 }
 
-std::string Lexer::readString() {
-    auto start = position_ + 1; // skip the opening quote
-    do {
-        readChar();
-    } while (ch_ != '"' && ch_ != 0);
-    return input_.substr(start, position_ - start);
+void Lexer::skipTo(size_t position) {
+    read_position_ = position;
+    readChar();
 }
 
 char Lexer::peekChar() const {
@@ -40,96 +161,57 @@ char Lexer::peekChar() const {
 }
 
 Token Lexer::nextToken() {
-    Token token{};
+    auto lexeme = nextLexeme();
+    return {lexeme.type, input_.substr(lexeme.start, lexeme.length)};
+}
 
+Lexer::Lexeme Lexer::nextLexeme() {
     skipWhitespace();
 
-    switch (ch_) {
-    case '=':
-        if (peekChar() == '=') {
-            readChar(); // consume the second '='
-            token = {TokenType::EQ, "=="};
-        } else {
-            token = {TokenType::ASSIGN, "="};
-        }
-        break;
-    case '+':
-        token = {TokenType::PLUS, "+"};
-        break;
-    case '-':
-        token = {TokenType::MINUS, "-"};
-        break;
-    case '!':
-        if (peekChar() == '=') {
-            readChar(); // consume the '='
-            token = {TokenType::NOT_EQ, "!="};
-        } else {
-            token = {TokenType::BANG, "!"};
+    auto start = position_;
+    const auto &charClass = classOf(ch_);
+    switch (charClass.kind) {
+    case Kind::LETTER: {
+        skipTo(skip<Letter>(input_, start));
+        auto length = position_ - start;
+        auto ident = std::string_view(input_).substr(start, length);
+        return {lookupIdent(ident), start, length};
+    }
+    case Kind::DIGIT:
+        skipTo(skip<Digit>(input_, start));
+        return {TokenType::INT, start, position_ - start};
+    case Kind::QUOTE: {
+        auto end = std::string_view(input_).find('"', start + 1);
+        // An unterminated string runs to the end of the input.
+        skipTo(end == std::string_view::npos ? input_.size() : end);
+        Lexeme string{TokenType::STRING, start + 1, position_ - start - 1};
+        readChar(); // consume the closing quote
+        return string;
+    }
+    case Kind::END:
+        // A NUL inside the input ends it as well; lexing past it goes on after it.
+        if (start >= input_.size()) {
+            return {TokenType::EOF_TOKEN, input_.size(), 0};
         }
+        readChar();
+        return {TokenType::EOF_TOKEN, start, 0};
+    case Kind::PUNCT:
+    case Kind::SPACE:
         break;
-    case '*':
-        token = {TokenType::ASTERISK, "*"};
-        break;
-    case '/':
-        token = {TokenType::SLASH, "/"};
-        break;
-    case '<':
-        token = {TokenType::LT, "<"};
-        break;
-    case '>':
-        token = {TokenType::GT, ">"};
-        break;
-    case ';':
-        token = {TokenType::SEMICOLON, ";"};
-        break;
-    case '(':
-        token = {TokenType::LPAREN, "("};
-        break;
-    case ')':
-        token = {TokenType::RPAREN, ")"};
-        break;
-    case '{':
-        token = {TokenType::LBRACE, "{"};
-        break;
-    case '}':
-        token = {TokenType::RBRACE, "}"};
-        break;
-    case ',':
-        token = {TokenType::COMMA, ","};
-        break;
-    case '"':
-        token = {TokenType::STRING, readString()};
-        break;
-    case 0:
-        token = {TokenType::EOF_TOKEN, ""};
-        break;
-    default:
-        if (isLetter(ch_)) {
-            const std::string ident = readWhile(isLetter);
-            return {lookupIdent(ident), ident};
-        } else if (isDigit(ch_)) {
-            const std::string number = readWhile(isDigit);
-            return {TokenType::INT, number};
-        } else {
-            token = {TokenType::ILLEGAL, {ch_}};
-        }
     }
 
-    readChar();
-    return token;
-}
-
-std::string Lexer::readWhile(bool (*condition)(char)) {
-    auto start = position_;
-    while (condition(ch_)) {
-        readChar();
+    auto type = charClass.single;
+    if (charClass.withEquals != TokenType::ILLEGAL && peekChar() == '=') {
+        readChar(); // consume the '='
+        type = charClass.withEquals;
     }
-    return input_.substr(start, position_ - start);
+    readChar();
+    return {type, start, position_ - start};
 }
 
 void Lexer::skipWhitespace() {
-    while (isWhitespace(ch_)) {
-        readChar();
+    if (Whitespace::contains(ch_)) {
+        skipTo(skip<Whitespace>(input_, position_));
     }
 }
 
@@ -1,4 +1,6 @@
+#include "monkey/batch.h"
 #include "monkey/repl.h"
+#include "monkey/server.h"
 
 #include <fmt/core.h>
 
@@ -6,7 +8,171 @@
 #include <sys/types.h>
 #include <unistd.h>
 
-int main() {
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+namespace {
+
+void usage() {
+    fmt::print(stderr, "usage: monkey [--trace]\n"
+                       "       monkey batch [--jobs N] [--list FILE] [--timings FILE] "
+                       "[SCRIPT...]\n"
+                       "       monkey serve --socket PATH [--workers N] [--cache N] "
+                       "[--timeout-ms N]\n");
+}
+
+// The positive int `text` spells, or nullopt if it is anything else.
+std::optional<size_t> positive(std::string_view text) {
+    size_t value = 0;
+    const auto *end = text.data() + text.size();
+    auto [parsed, error] = std::from_chars(text.data(), end, value);
+    if (error != std::errc() || parsed != end || value == 0 ||
+        value > static_cast<size_t>(std::numeric_limits<int>::max())) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+// Script paths, one per line; blank lines are skipped.
+void readList(std::istream &input, std::vector<std::string> &paths) {
+    std::string line;
+    while (std::getline(input, line)) {
+        if (!line.empty()) {
+            paths.push_back(line);
+        }
+    }
+}
+
+// Prints the result of every script in input order on stdout and the timing table on
+// stderr (or --timings FILE). Fails if any script failed.
+int batch(std::span<char *> args) {
+    monkey::BatchOptions options;
+    std::vector<std::string> paths;
+    std::string timings;
+
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string_view arg = args[i];
+        if (arg == "--jobs" && i + 1 < args.size()) {
+            auto jobs = positive(args[++i]);
+            if (!jobs) {
+                usage();
+                return 1;
+            }
+            options.jobs = *jobs;
+        } else if (arg == "--timings" && i + 1 < args.size()) {
+            timings = args[++i];
+        } else if (arg == "--list" && i + 1 < args.size()) {
+            const std::string_view list = args[++i];
+            std::ifstream file{std::string(list)};
+            if (list != "-" && !file) {
+                fmt::print(stderr, "cannot open {}\n", list);
+                return 1;
+            }
+            readList(list == "-" ? std::cin : file, paths);
+        } else if (arg.starts_with("--")) {
+            usage();
+            return 1;
+        } else {
+            paths.emplace_back(arg);
+        }
+    }
+
+    auto report = monkey::runBatch(paths, options);
+    for (const auto &script : report.scripts) {
+        fmt::print("{}: {}\n", script.path, script.output);
+    }
+
+    auto table = monkey::timingTable(report);
+    if (timings.empty()) {
+        fmt::print(stderr, "{}", table);
+    } else if (std::ofstream out(timings); out) {
+        out << table;
+    } else {
+        fmt::print(stderr, "cannot write {}\n", timings);
+        return 1;
+    }
+
+    bool ok = std::ranges::all_of(report.scripts, &monkey::ScriptResult::ok);
+    return ok ? 0 : 1;
+}
+
+monkey::Server *runningServer = nullptr;
+
+extern "C" void stopServer(int /*signal*/) {
+    if (runningServer != nullptr) {
+        runningServer->stop();
+    }
+}
+
+// Serves evaluation requests on a Unix domain socket until SIGINT or SIGTERM.
+int serve(std::span<char *> args) {
+    monkey::ServerOptions options;
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string_view arg = args[i];
+        if (arg == "--socket" && i + 1 < args.size()) {
+            options.socketPath = args[++i];
+            continue;
+        }
+        auto value = i + 1 < args.size() ? positive(args[i + 1]) : std::nullopt;
+        if (!value) {
+            usage();
+            return 1;
+        }
+        ++i;
+        if (arg == "--workers") {
+            options.workers = *value;
+        } else if (arg == "--cache") {
+            options.cacheCapacity = *value;
+        } else if (arg == "--timeout-ms") {
+            options.interpreter.timeout =
+                std::chrono::milliseconds(static_cast<int64_t>(*value));
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (options.socketPath.empty()) {
+        usage();
+        return 1;
+    }
+
+    monkey::Server server(options);
+    if (auto error = server.listen()) {
+        fmt::print(stderr, "{}\n", *error);
+        return 1;
+    }
+    runningServer = &server;
+    std::signal(SIGINT, stopServer);
+    std::signal(SIGTERM, stopServer);
+    server.run();
+    runningServer = nullptr;
+    return 0;
+}
+
+int repl(std::span<char *> args) {
+    monkey::ReplOptions options;
+    for (std::string_view arg : args) {
+        if (arg == "--trace") {
+            options.trace = true;
+        } else {
+            usage();
+            return 1;
+        }
+    }
+
     uid_t uid = getuid();
     struct passwd *pw = getpwuid(uid);
 
@@ -18,7 +184,20 @@ int main() {
     fmt::println("Hello {}! This is the Monkey programming language!", pw->pw_name);
     fmt::println("Feel free to type in commands");
 
-    monkey::start();
+    monkey::start(std::cin, std::cout, options);
 
     return 0;
 }
+
+} // namespace
+
+int main(int argc, char **argv) {
+    auto args = std::span(argv + 1, static_cast<size_t>(argc - 1));
+    if (!args.empty() && std::string_view(args.front()) == "batch") {
+        return batch(args.subspan(1));
+    }
+    if (!args.empty() && std::string_view(args.front()) == "serve") {
+        return serve(args.subspan(1));
+    }
+    return repl(args);
+}
\ No newline at end of file
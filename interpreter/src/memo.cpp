@@ -0,0 +1,354 @@
+#include "monkey/memo.h"
+#include "monkey/ast.h"
+#include "monkey/box.h"
+#include "monkey/builtins.h"
+#include "monkey/env.h"
+#include "monkey/overload.h"
+#include "monkey/task.h"
+
+#include <algorithm>
+#include <array>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace monkey {
+
+namespace {
+
+// Builtins whose result depends on more than their arguments, or that act on the world.
+constexpr auto IMPURE_BUILTINS = std::to_array<std::string_view>({
+    "await",
+    "channel",
+    "close",
+    "fold",
+    "lines",
+    "memoStats",
+    "next",
+    "readFile",
+    "readLines",
+    "recv",
+    "send",
+    "spawn",
+    "writeFile",
+});
+
+// Walks function bodies, following the functions their free identifiers are bound to.
+// The nodes still to visit are kept on a work list rather than the C++ stack, so that
+// deeply nested bodies cannot overflow it. Free identifiers are resolved once the work
+// list is empty, when the `let`s of every scope they may refer to have been seen.
+class PurityCheck {
+  public:
+    std::optional<std::string> check(const Function &fn) {
+        visit(fn);
+        while (!reason_ && (!pending_.empty() || !references_.empty())) {
+            if (pending_.empty()) {
+                auto reference = std::move(references_.back());
+                references_.pop_back();
+                resolve(reference);
+                continue;
+            }
+            auto [node, env, scope] = pending_.back();
+            pending_.pop_back();
+            env_ = env;
+            scope_ = scope;
+            std::visit([this](const auto *n) { walk(*n); }, node);
+        }
+        return std::move(reason_);
+    }
+
+    // The frames the functions visited look their free identifiers up in.
+    [[nodiscard]] const std::vector<std::shared_ptr<const Environment>> &frames() const {
+        return frames_;
+    }
+
+  private:
+    // The names bound by the parameters and `let`s of one function literal.
+    struct Scope {
+        const Scope *outer;
+        std::unordered_set<std::string> names;
+    };
+
+    struct Pending {
+        std::variant<const Statement *, const Expression *> node;
+        // Identifiers in the node resolve here, in the closure of the enclosing function,
+        // unless `scope` binds them.
+        const Environment *env;
+        Scope *scope;
+    };
+
+    struct Reference {
+        std::string name;
+        const Environment *env;
+        const Scope *scope;
+    };
+
+    void visit(const Function &fn) {
+        if (reason_ || !visited_.insert(&*fn.literal).second) {
+            return;
+        }
+        if (fn.literal->generator) {
+            reason_ = "a generator function";
+            return;
+        }
+        for (std::shared_ptr<const Environment> frame = fn.env;
+             frame != nullptr && seen_.insert(frame.get()).second;
+             frame = frame->outer()) {
+            frames_.push_back(frame);
+        }
+        const auto *outer = std::exchange(env_, fn.env.get());
+        auto *scope = std::exchange(scope_, enter(nullptr, fn.parameters()));
+        add(fn.body());
+        env_ = outer;
+        scope_ = scope;
+    }
+
+    Scope *enter(const Scope *outer, const std::vector<Identifier> &parameters) {
+        auto &scope = scopes_.emplace_back(Scope{.outer = outer, .names = {}});
+        for (const auto &parameter : parameters) {
+            scope.names.insert(tokenLiteral(parameter));
+        }
+        return &scope;
+    }
+
+    void add(const Statement &statement) {
+        pending_.push_back({&statement, env_, scope_});
+    }
+    void add(const Expression &expression) {
+        pending_.push_back({&expression, env_, scope_});
+    }
+
+    void add(const BlockStatement &block) {
+        for (const auto &statement : block.statements) {
+            add(statement);
+        }
+    }
+
+    void walk(const Statement &statement) {
+        std::visit(overloaded{[this](const BlockStatement &block) { add(block); },
+                              [this](const LetStatement &s) {
+                                  scope_->names.insert(tokenLiteral(s.name));
+                                  add(s.value);
+                              },
+                              [this](const auto &s) {
+                                  if constexpr (requires { s.value; }) {
+                                      add(s.value);
+                                  } else {
+                                      add(s.expression);
+                                  }
+                              }},
+                   statement);
+    }
+
+    void walk(const Expression &expression) {
+        std::visit(
+            overloaded{
+                [this](const Identifier &id) {
+                    references_.push_back({tokenLiteral(id), env_, scope_});
+                },
+                [this](const Box<PrefixExpression> &e) { add(e->right); },
+                [this](const Box<InfixExpression> &e) {
+                    add(e->left);
+                    add(e->right);
+                },
+                [this](const Box<IfExpression> &e) {
+                    add(e->condition);
+                    add(e->consequence);
+                    if (e->alternative) {
+                        add(*e->alternative);
+                    }
+                },
+                [this](const Box<FunctionLiteral> &e) {
+                    // Calling it would hand every caller the same cached generator.
+                    if (e->generator) {
+                        reason_ = "a generator function";
+                        return;
+                    }
+                    auto *outer = std::exchange(scope_, enter(scope_, e->parameters));
+                    add(e->body);
+                    scope_ = outer;
+                },
+                [this](const Box<CallExpression> &e) {
+                    add(e->function);
+                    for (const auto &argument : e->arguments) {
+                        add(argument);
+                    }
+                },
+                [this](const Box<ArrayLiteral> &e) {
+                    for (const auto &element : e->elements) {
+                        add(element);
+                    }
+                },
+                [this](const Box<IndexExpression> &e) {
+                    add(e->left);
+                    add(e->index);
+                },
+                [this](const Box<HashLiteral> &e) {
+                    for (const auto &[key, value] : e->pairs) {
+                        add(key);
+                        add(value);
+                    }
+                },
+                [](const auto &) {}},
+            expression);
+    }
+
+    // Builtins are recognized by what the identifier is bound to, so that an alias such
+    // as `let s = send;` is caught too. Other values the identifier may be bound to are
+    // the concern of the memo table, which watches the frames for rebinding.
+    void resolve(const Reference &reference) {
+        for (const auto *scope = reference.scope; scope != nullptr;
+             scope = scope->outer) {
+            if (scope->names.contains(reference.name)) {
+                return;
+            }
+        }
+        auto value = reference.env->get(reference.name);
+        if (!value) {
+            if (const auto *builtin = lookupBuiltin(reference.name)) {
+                checkBuiltin(*builtin);
+            }
+            return;
+        }
+        std::visit(overloaded{[this](const Builtin &b) { checkBuiltin(b); },
+                              [this](const Box<Function> &fn) { visit(*fn); },
+                              [this](const Memo &memo) {
+                                  if (const auto *fn = std::get_if<Box<Function>>(
+                                          &memo.table->function())) {
+                                      visit(**fn);
+                                  }
+                              },
+                              [](const auto &) {}},
+                   *value);
+    }
+
+    void checkBuiltin(const Builtin &builtin) {
+        if (std::ranges::find(IMPURE_BUILTINS, builtin.name) != IMPURE_BUILTINS.end()) {
+            reason_ = "a function that calls `" + std::string(builtin.name) + "`";
+        }
+    }
+
+    std::vector<Pending> pending_;
+    std::vector<Reference> references_;
+    std::deque<Scope> scopes_;
+    std::unordered_set<const FunctionLiteral *> visited_;
+    std::unordered_set<const Environment *> seen_;
+    std::vector<std::shared_ptr<const Environment>> frames_;
+    const Environment *env_ = nullptr;
+    Scope *scope_ = nullptr;
+    std::optional<std::string> reason_;
+};
+
+} // namespace
+
+std::optional<std::string> impurity(const Function &fn) {
+    return PurityCheck().check(fn);
+}
+
+std::optional<MemoKey> MemoKey::from(std::span<const Object> args) {
+    MemoKey key{.args = {}, .hash = args.size()};
+    key.args.reserve(args.size());
+    for (const auto &arg : args) {
+        auto hashed = hashKey(arg);
+        if (!hashed) {
+            return std::nullopt;
+        }
+        // The boost::hash_combine step, widened to 64 bits.
+        key.hash ^= hashed->hash + 0x9e3779b97f4a7c15 + (key.hash << 6) + (key.hash >> 2);
+        key.args.push_back(std::move(*hashed));
+    }
+    return key;
+}
+
+std::optional<MemoKey> MemoTable::key(std::span<const Object> args) {
+    auto key = MemoKey::from(args);
+    if (!key) {
+        return std::nullopt;
+    }
+    const std::lock_guard lock(mutex_);
+    const auto *fn = std::get_if<Box<Function>>(&function_);
+    auto rebound = !checked_ || std::ranges::any_of(frames_, [](const auto &frame) {
+        return frame.first->version() != frame.second;
+    });
+    if (fn != nullptr && rebound) {
+        PurityCheck check;
+        pure_ = !check.check(**fn);
+        frames_.clear();
+        for (const auto &frame : check.frames()) {
+            frames_.emplace_back(frame, frame->version());
+        }
+        checked_ = true;
+        ++generation_;
+        index_.clear();
+        entries_.clear();
+    }
+    if (!pure_) {
+        return std::nullopt;
+    }
+    key->generation = generation_;
+    key->hash ^= generation_ + 0x9e3779b97f4a7c15 + (key->hash << 6) + (key->hash >> 2);
+    return key;
+}
+
+std::optional<Object> MemoTable::find(const MemoKey &key) {
+    const std::lock_guard lock(mutex_);
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+        ++stats_.misses;
+        return std::nullopt;
+    }
+    ++stats_.hits;
+    entries_.splice(entries_.begin(), entries_, *it);
+    return (*it)->value;
+}
+
+void MemoTable::insert(MemoKey key, Object result) {
+    if (capacity_ == 0) {
+        return;
+    }
+    if (shared_) {
+        monkey::share(result);
+    }
+    const std::lock_guard lock(mutex_);
+    // Another thread may have computed the same call meanwhile.
+    if (index_.contains(key)) {
+        return;
+    }
+    if (entries_.size() == capacity_) {
+        index_.erase(std::prev(entries_.end()));
+        entries_.pop_back();
+        ++stats_.evictions;
+    }
+    entries_.push_front({std::move(key), std::move(result)});
+    index_.insert(entries_.begin());
+}
+
+void MemoTable::share() {
+    monkey::share(function_);
+    const std::lock_guard lock(mutex_);
+    if (shared_) {
+        return;
+    }
+    shared_ = true;
+    for (const auto &entry : entries_) {
+        monkey::share(entry.value);
+    }
+}
+
+MemoTable::Stats MemoTable::stats() const {
+    const std::lock_guard lock(mutex_);
+    auto stats = stats_;
+    stats.size = entries_.size();
+    stats.capacity = capacity_;
+    return stats;
+}
+
+} // namespace monkey
@@ -1,34 +1,288 @@
 #include "monkey/object.h"
 #include "monkey/box.h"
+#include "monkey/memo.h"
+#include "monkey/output.h"
 #include "monkey/overload.h"
 
-#include <fmt/format.h>
-#include <fmt/ranges.h>
-
-#include <ranges>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <variant>
+#include <vector>
 
 namespace monkey {
 
-std::string inspect(const Object &obj) {
-    return std::visit(
-        overloaded{
-            [](int64_t value) { return std::to_string(value); },
-            [](bool value) -> std::string { return value ? "true" : "false"; },
-            [](const String &s) -> std::string { return s.value; },
-            [](std::nullptr_t) -> std::string { return "null"; },
-            [](const Box<ReturnValue> &rv) -> std::string { return inspect(rv->value); },
-            [](const Box<Function> &fn) -> std::string {
-                return fmt::format(
-                    "fn({}) {}",
-                    fmt::join(std::views::transform(
-                                  fn->parameters,
-                                  [](const Identifier &p) { return tokenLiteral(p); }),
-                              ", "),
-                    toString(fn->body));
+Array Array::from(std::vector<Object> elements) {
+    auto isInteger = [](const Object &e) { return std::holds_alternative<int64_t>(e); };
+    if (!std::ranges::all_of(elements, isInteger)) {
+        return Array(PersistentVector<Object>::from(std::move(elements)));
+    }
+    return Array(IntVector::build(elements.size(), [&elements](int64_t *out) {
+        for (const auto &element : elements) {
+            *out++ = std::get<int64_t>(element);
+        }
+        return elements.size();
+    }));
+}
+
+Object Array::operator[](size_t index) const {
+    if (const auto *integers = this->integers()) {
+        return (*integers)[index];
+    }
+    return std::get<PersistentVector<Object>>(elements_)[index];
+}
+
+Array Array::push(Object value) const {
+    if (const auto *integers = this->integers()) {
+        if (const auto *integer = std::get_if<int64_t>(&value)) {
+            return Array(integers->push(*integer));
+        }
+        std::vector<Object> boxed(integers->values().begin(), integers->values().end());
+        boxed.push_back(std::move(value));
+        return Array(PersistentVector<Object>::from(std::move(boxed)));
+    }
+    return Array(std::get<PersistentVector<Object>>(elements_).push(std::move(value)));
+}
+
+Array Array::rest() const {
+    return std::visit([](const auto &elements) { return Array(elements.rest()); },
+                      elements_);
+}
+
+namespace {
+
+// Writes values with an explicit stack of the pieces still to be written, like the AST
+// printer, so that deeply nested arrays and hashes cost heap rather than stack and every
+// piece is appended to the output once. An array or hash is written up to its next
+// element that nests, which goes on the stack above the rest of the array or hash. The
+// walk ends once the output is truncated, without visiting the rest of a large value.
+class Inspector {
+  public:
+    explicit Inspector(BoundedOutput &out) : out_(out) {}
+
+    void inspect(const Object &root) {
+        pending_.emplace_back(root);
+        while (!pending_.empty() && !out_.truncated()) {
+            auto piece = std::move(pending_.back());
+            pending_.pop_back();
+            std::visit([this](const auto &next) { write(next); }, piece);
+        }
+    }
+
+  private:
+    // The elements of an array, or the entries of a hash, from `next` on.
+    struct Elements {
+        Array array;
+        size_t next;
+    };
+    struct Entries {
+        Hash hash;
+        size_t next;
+    };
+    // Text pieces are constants; values are copies, which share their contents.
+    using Piece = std::variant<std::string_view, Object, Elements, Entries>;
+
+    void write(std::string_view text) { out_.append(text); }
+
+    // Writes elements up to the next one that is pushed onto the stack in its turn.
+    void write(const Elements &elements) {
+        const auto &array = elements.array;
+        if (const auto *integers = array.integers()) {
+            auto values = integers->values();
+            for (auto next = elements.next; next < values.size() && !out_.truncated();
+                 ++next) {
+                separate(next);
+                write(values[next]);
+            }
+        } else if (const auto *objects = array.objects()) {
+            for (auto next = elements.next;
+                 next < objects->size() && !out_.truncated();) {
+                for (const auto &element : objects->chunkAt(next)) {
+                    separate(next++);
+                    if (nests(element)) {
+                        pending_.emplace_back(Elements{array, next});
+                        pending_.emplace_back(element);
+                        return;
+                    }
+                    write(element);
+                }
+            }
+        }
+        out_.append("]");
+    }
+
+    void write(const Entries &entries) {
+        auto all = entries.hash.table->entries();
+        for (auto next = entries.next; next < all.size() && !out_.truncated(); ++next) {
+            separate(next);
+            const auto &[key, value] = all[next];
+            write(key.key);
+            out_.append(": ");
+            if (nests(value)) {
+                pending_.emplace_back(Entries{entries.hash, next + 1});
+                pending_.emplace_back(value);
+                return;
+            }
+            write(value);
+        }
+        out_.append("}");
+    }
+
+    void separate(size_t index) {
+        if (index > 0) {
+            out_.append(", ");
+        }
+    }
+
+    // Whether writing `obj` pushes pieces rather than writing all of it at once.
+    static bool nests(const Object &obj) {
+        return std::holds_alternative<Array>(obj) || std::holds_alternative<Hash>(obj) ||
+               std::holds_alternative<Memo>(obj) ||
+               std::holds_alternative<Box<ReturnValue>>(obj);
+    }
+
+    void write(int64_t value) {
+        std::array<char, 24> digits{};
+        auto end = std::to_chars(digits.begin(), digits.end(), value).ptr;
+        out_.append(std::string_view(digits.begin(), end));
+    }
+
+    void write(const Object &obj) {
+        std::visit(
+            overloaded{
+                [this](int64_t value) { write(value); },
+                [this](bool value) { out_.append(value ? "true" : "false"); },
+                [this](const String &s) { out_.append(s.view()); },
+                [this](std::nullptr_t) { out_.append("null"); },
+                [this](const Box<ReturnValue> &rv) { pending_.emplace_back(rv->value); },
+                [this](const Box<Function> &fn) {
+                    out_.append("fn(");
+                    for (const auto &parameter : fn->parameters()) {
+                        if (&parameter != &fn->parameters().front()) {
+                            out_.append(", ");
+                        }
+                        out_.append(parameter.token.literal);
+                    }
+                    out_.append(") ");
+                    print(out_, fn->body());
+                },
+                [this](const Error &err) {
+                    out_.append("ERROR: ");
+                    out_.append(err.message);
+                },
+                [this](const Builtin &builtin) {
+                    out_.append("builtin ");
+                    out_.append(builtin.name);
+                },
+                [this](const Task & /*task*/) { out_.append("task"); },
+                [this](const Channel & /*channel*/) { out_.append("channel"); },
+                [this](const Generator & /*generator*/) { out_.append("generator"); },
+                [this](const Memo &memo) {
+                    out_.append("memo(");
+                    pending_.emplace_back(std::string_view(")"));
+                    pending_.emplace_back(memo.table->function());
+                },
+                [this](const Hash &hash) {
+                    out_.append("{");
+                    pending_.emplace_back(Entries{hash, 0});
+                },
+                [this](const Array &array) {
+                    out_.append("[");
+                    pending_.emplace_back(Elements{array, 0});
+                },
             },
-            [](const Error &err) -> std::string { return "ERROR: " + err.message; }},
+            obj);
+    }
+
+    BoundedOutput &out_;
+    std::vector<Piece> pending_;
+};
+
+} // namespace
+
+void inspect(BoundedOutput &out, const Object &obj) { Inspector(out).inspect(obj); }
+
+std::string inspect(const Object &obj, size_t limit) {
+    return printToString([&](BoundedOutput &out) { inspect(out, obj); }, limit);
+}
+
+namespace {
+
+// splitmix64's finalizer: every input bit affects every output bit, so consecutive
+// integers spread over both the groups and the control bytes of a SwissMap.
+uint64_t mix(uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+    return x ^ (x >> 31);
+}
+
+// Eight bytes per multiply, then one finalizer for the whole string.
+uint64_t hashBytes(std::string_view bytes) {
+    constexpr uint64_t MULTIPLIER = 0x9e3779b97f4a7c15;
+    uint64_t hash = bytes.size() * MULTIPLIER;
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= bytes.size(); i += sizeof(uint64_t)) {
+        uint64_t word = 0;
+        std::memcpy(&word, bytes.data() + i, sizeof word);
+        hash = std::rotl((hash ^ word) * MULTIPLIER, 29);
+    }
+    if (i < bytes.size()) {
+        uint64_t word = 0;
+        std::memcpy(&word, bytes.data() + i, bytes.size() - i);
+        hash = std::rotl((hash ^ word) * MULTIPLIER, 29);
+    }
+    return mix(hash);
+}
+
+} // namespace
+
+std::optional<HashKey> hashKey(const Object &obj) {
+    if (const auto *i = std::get_if<int64_t>(&obj)) {
+        return HashKey{obj, mix(static_cast<uint64_t>(*i))};
+    }
+    if (const auto *b = std::get_if<bool>(&obj)) {
+        return HashKey{obj, mix(*b ? 0x2545f4914f6cdd1d : 0x2545f4914f6cdd1c)};
+    }
+    if (const auto *s = std::get_if<String>(&obj)) {
+        return HashKey{obj, hashBytes(s->view())};
+    }
+    return std::nullopt;
+}
+
+bool isTruthy(const Object &obj) {
+    if (std::holds_alternative<bool>(obj)) {
+        return std::get<bool>(obj);
+    }
+    if (std::holds_alternative<std::nullptr_t>(obj)) {
+        return false;
+    }
+    return true;
+}
+
+std::string_view typeName(const Object &obj) {
+    return std::visit(
+        overloaded{[](int64_t) { return "INTEGER"; }, [](bool) { return "BOOLEAN"; },
+                   [](std::nullptr_t) { return "NULL"; },
+                   [](const String &) { return "STRING"; },
+                   [](const Box<ReturnValue> &) { return "RETURN_VALUE"; },
+                   [](const Box<Function> &) { return "FUNCTION"; },
+                   [](const Error &) { return "ERROR"; },
+                   [](const Builtin &) { return "BUILTIN"; },
+                   [](const Task &) { return "TASK"; },
+                   [](const Channel &) { return "CHANNEL"; },
+                   [](const Generator &) { return "GENERATOR"; },
+                   [](const Memo &) { return "MEMO"; },
+                   [](const Array &) { return "ARRAY"; },
+                   [](const Hash &) { return "HASH"; }},
         obj);
 }
 
@@ -1,17 +1,23 @@
 #include "monkey/parser.h"
 #include "monkey/ast.h"
+#include "monkey/overload.h"
 #include "monkey/token.h"
+#include "monkey/token_buffer.h"
 
 #include <fmt/format.h>
 #include <magic_enum/magic_enum_format.hpp>
 
 #include <array>
 #include <charconv>
+#include <cstddef>
 #include <memory>
 #include <optional>
+#include <string>
+#include <string_view>
 #include <system_error>
-#include <unordered_map>
 #include <utility>
+#include <variant>
+#include <vector>
 
 namespace {
 
@@ -27,7 +33,8 @@ constexpr auto PRECEDENCES = []() {
          {TokenType::MINUS, Precedence::SUM},
          {TokenType::SLASH, Precedence::PRODUCT},
          {TokenType::ASTERISK, Precedence::PRODUCT},
-         {TokenType::LPAREN, Precedence::CALL}});
+         {TokenType::LPAREN, Precedence::CALL},
+         {TokenType::LBRACKET, Precedence::INDEX}});
     std::ranges::sort(arr, std::ranges::less{}, &std::pair<TokenType, Precedence>::first);
     return arr;
 }();
@@ -46,70 +53,28 @@ Precedence lookupPrecedence(TokenType tokenType) {
 
 namespace monkey {
 
-Parser::Parser(Lexer lexer) : lexer_(std::move(lexer)) {
-    // Initialize currentToken and peekToken
-    nextToken();
-    nextToken();
-
-    // Register prefix parse functions
-    registerPrefix(TokenType::IDENT, [this]() { return this->parseIdentifier(); });
-    registerPrefix(TokenType::INT, [this]() { return this->parseIntegerLiteral(); });
-    registerPrefix(TokenType::TRUE, [this]() { return this->parseBoolean(); });
-    registerPrefix(TokenType::FALSE, [this]() { return this->parseBoolean(); });
-    registerPrefix(TokenType::STRING, [this]() { return this->parseStringLiteral(); });
-    registerPrefix(TokenType::BANG, [this]() { return this->parsePrefixExpression(); });
-    registerPrefix(TokenType::MINUS, [this]() { return this->parsePrefixExpression(); });
-    registerPrefix(TokenType::LPAREN,
-                   [this]() { return this->parseGroupedExpression(); });
-    registerPrefix(TokenType::IF, [this]() { return this->parseIfExpression(); });
-    registerPrefix(TokenType::FUNCTION,
-                   [this]() { return this->parseFunctionLiteral(); });
-
-    // Register infix parse functions
-    auto infixParseFn = [this](Expression left) {
-        return this->parseInfixExpression(std::move(left));
-    };
-    registerInfix(TokenType::PLUS, infixParseFn);
-    registerInfix(TokenType::MINUS, infixParseFn);
-    registerInfix(TokenType::SLASH, infixParseFn);
-    registerInfix(TokenType::ASTERISK, infixParseFn);
-    registerInfix(TokenType::EQ, infixParseFn);
-    registerInfix(TokenType::NOT_EQ, infixParseFn);
-    registerInfix(TokenType::LT, infixParseFn);
-    registerInfix(TokenType::GT, infixParseFn);
-    registerInfix(TokenType::LPAREN, [this](Expression left) {
-        return this->parseCallExpression(std::move(left));
-    });
-}
+Parser::Parser(Lexer lexer) : Parser(TokenBuffer(std::move(lexer))) {}
 
-std::unique_ptr<Program> Parser::parseProgram() {
-    auto program = std::make_unique<Program>();
-
-    while (currentToken_.type != TokenType::EOF_TOKEN) {
-        if (auto stmt = parseStatement()) {
-            program->statements.emplace_back(std::move(*stmt));
-        }
-        nextToken();
+Parser::Parser(TokenBuffer tokens) : tokens_(std::move(tokens)) {
+    if (tokens_.tooLarge()) {
+        errors_.push_back(fmt::format("input of {} bytes is too large to parse",
+                                      tokens_.source().size()));
     }
-
-    return program;
 }
 
-void Parser::registerPrefix(TokenType tokenType, PrefixParseFn fn) {
-    prefixParseFns_[tokenType] = std::move(fn);
-}
-
-void Parser::registerInfix(TokenType tokenType, InfixParseFn fn) {
-    infixParseFns_[tokenType] = std::move(fn);
+void Parser::nextToken() {
+    if (current_ + 1 < tokens_.size()) {
+        ++current_;
+    }
 }
 
-void Parser::nextToken() {
-    currentToken_ = peekToken_;
-    peekToken_ = lexer_.nextToken();
+void Parser::error(size_t token, std::string_view message) {
+    auto [line, column] = tokens_.position(token);
+    errors_.push_back(fmt::format("{}:{}: {}", line, column, message));
 }
 
 bool Parser::expectPeek(TokenType type) {
-    if (peekToken_.type == type) {
+    if (peekType() == type) {
         nextToken();
         return true;
     }
@@ -118,341 +83,412 @@ bool Parser::expectPeek(TokenType type) {
 }
 
 void Parser::peekError(TokenType type) {
-    auto error = fmt::format("expected next token to be {}, got {} instead", type,
-                             peekToken_.type);
-    errors_.push_back(error);
+    error(current_ + 1, fmt::format("expected next token to be {}, got {} instead", type,
+                                    peekType()));
 }
 
-Precedence Parser::peekPrecedence() const { return lookupPrecedence(peekToken_.type); }
+Precedence Parser::peekPrecedence() const { return lookupPrecedence(peekType()); }
 
 Precedence Parser::currentPrecedence() const {
-    return lookupPrecedence(currentToken_.type);
+    return lookupPrecedence(currentType());
+}
+
+Precedence Parser::pendingPrecedence() const {
+    if (std::holds_alternative<PrefixExpression>(pending_.back())) {
+        return Precedence::PREFIX;
+    }
+    if (const auto *infix = std::get_if<PendingInfix>(&pending_.back())) {
+        return infix->precedence;
+    }
+    return Precedence::LOWEST;
+}
+
+// Parsing is a loop over steps. Where the recursive descent of the book calls itself for
+// a nested construct, the loop pushes the construct's node onto pending_ and parses what
+// it contains. Once an operand is complete, the node on top takes it: as the right side
+// of an operator, an element of a list, the condition of an if and so on. Completing
+// the node in turn makes it the next operand, and a completed statement joins the block
+// beneath it.
+std::unique_ptr<Program> Parser::parseProgram() {
+    auto program = std::make_unique<Program>();
+    pending_.clear();
+    pending_.emplace_back(BlockStatement{.token = currentToken(), .statements = {}});
+
+    auto step = Step::STATEMENT;
+    while (pending_.size() > 1 || step != Step::STATEMENT ||
+           currentType() != TokenType::EOF_TOKEN) {
+        switch (step) {
+        case Step::STATEMENT:
+            step = parseStatement();
+            break;
+        case Step::EXPRESSION:
+            step = parseOperand();
+            break;
+        case Step::OPERATOR:
+            step = parseOperator();
+            break;
+        case Step::NEXT_STATEMENT:
+            nextToken();
+            step = Step::STATEMENT;
+            break;
+        case Step::RECOVER:
+            // Like a failed parse function in the book, which the enclosing block (or
+            // the program) skips.
+            while (!std::holds_alternative<BlockStatement>(pending_.back())) {
+                pending_.pop_back();
+            }
+            step = Step::NEXT_STATEMENT;
+            break;
+        }
+    }
+
+    program->statements = std::move(take<BlockStatement>().statements);
+    return program;
 }
 
-std::optional<Statement> Parser::parseStatement() {
-    switch (currentToken_.type) {
+Parser::Step Parser::parseStatement() {
+    if (currentType() == TokenType::EOF_TOKEN ||
+        (currentType() == TokenType::RBRACE && pending_.size() > 1)) {
+        return endBlock();
+    }
+    switch (currentType()) {
     case TokenType::LET:
         return parseLetStatement();
     case TokenType::RETURN:
-        return parseReturnStatement();
+        pending_.emplace_back(ReturnStatement{.token = currentToken(), .value = {}});
+        nextToken();
+        return Step::EXPRESSION;
+    case TokenType::YIELD:
+        pending_.emplace_back(YieldStatement{.token = currentToken(), .value = {}});
+        nextToken();
+        return Step::EXPRESSION;
     default:
-        return parseExpressionStatement();
+        pending_.emplace_back(
+            ExpressionStatement{.token = currentToken(), .expression = {}});
+        return Step::EXPRESSION;
     }
 }
 
-std::optional<Statement> Parser::parseLetStatement() {
-    auto stmt = LetStatement{.token = currentToken_, .name = {}, .value = {}};
+Parser::Step Parser::parseLetStatement() {
+    auto stmt = LetStatement{.token = currentToken(), .name = {}, .value = {}};
 
     if (!expectPeek(TokenType::IDENT)) {
-        return std::nullopt;
+        return Step::RECOVER;
     }
 
-    stmt.name = Identifier{.token = currentToken_};
+    stmt.name = Identifier{.token = currentToken()};
 
     if (!expectPeek(TokenType::ASSIGN)) {
-        return std::nullopt;
+        return Step::RECOVER;
     }
 
+    pending_.emplace_back(std::move(stmt));
     nextToken();
-    auto value = parseExpression(Precedence::LOWEST);
-    if (!value) {
-        return std::nullopt;
-    }
-    stmt.value = std::move(*value);
+    return Step::EXPRESSION;
+}
 
-    if (peekToken_.type == TokenType::SEMICOLON) {
+template <typename Node>
+Parser::Step Parser::endStatement(Node &stmt, Expression &slot) {
+    slot = std::move(operand_);
+    if (peekType() == TokenType::SEMICOLON) {
+        // Optional semicolon, e.g., 5 + 5 in REPL
         nextToken();
     }
-
-    return stmt;
+    Statement statement = std::move(stmt);
+    pending_.pop_back();
+    std::get<BlockStatement>(pending_.back()).statements.emplace_back(
+        std::move(statement));
+    return Step::NEXT_STATEMENT;
 }
 
-std::optional<Statement> Parser::parseReturnStatement() {
-    auto stmt = ReturnStatement{.token = currentToken_, .value = {}};
-
+// The current token is the block's '{'.
+Parser::Step Parser::beginBlock() {
+    pending_.emplace_back(BlockStatement{.token = currentToken(), .statements = {}});
     nextToken();
-    auto value = parseExpression(Precedence::LOWEST);
-    if (!value) {
-        return std::nullopt;
-    }
-    stmt.value = std::move(*value);
-
-    if (peekToken_.type == TokenType::SEMICOLON) {
-        nextToken();
-    }
-
-    return stmt;
+    return Step::STATEMENT;
 }
 
-std::optional<Statement> Parser::parseExpressionStatement() {
-    auto stmt = ExpressionStatement{.token = currentToken_, .expression = {}};
-    auto expr = parseExpression(Precedence::LOWEST);
+// Hands the finished block to the if expression or function literal it belongs to.
+Parser::Step Parser::endBlock() {
+    auto block = take<BlockStatement>();
 
-    if (!expr) {
-        return std::nullopt;
+    if (auto *func = std::get_if<FunctionLiteral>(&pending_.back())) {
+        func->body = std::move(block);
+        func->generator = yields(func->body);
+        return produce(take<FunctionLiteral>());
     }
 
-    stmt.expression = std::move(*expr);
-
-    if (peekToken_.type == TokenType::SEMICOLON) {
-        // Optional semicolon, e.g., 5 + 5 in REPL
-        nextToken();
+    auto &pendingIf = std::get<PendingIf>(pending_.back());
+    if (pendingIf.inAlternative) {
+        pendingIf.expr.alternative = std::move(block);
+        return produce(take<PendingIf>().expr);
+    }
+    pendingIf.expr.consequence = std::move(block);
+    if (peekType() != TokenType::ELSE) {
+        return produce(take<PendingIf>().expr);
     }
-
-    return stmt;
-}
-
-std::optional<BlockStatement> Parser::parseBlockStatement() {
-    auto block = BlockStatement{.token = currentToken_, .statements = {}};
-
     nextToken();
-    while (currentToken_.type != TokenType::RBRACE &&
-           currentToken_.type != TokenType::EOF_TOKEN) {
-        if (auto stmt = parseStatement()) {
-            block.statements.emplace_back(std::move(*stmt));
-        }
-        nextToken();
+    if (!expectPeek(TokenType::LBRACE)) {
+        return Step::RECOVER;
     }
-    return block;
+    pendingIf.inAlternative = true;
+    return beginBlock();
 }
 
-std::optional<Expression> Parser::parseExpression(Precedence precedence) {
-    // Use the expression -5 + 5 * 10 as an example to understand how this works
-
-    // 1. We start with the first token, which is '-'.
-    auto prefixParseFnIt = prefixParseFns_.find(currentToken_.type);
-    if (prefixParseFnIt == prefixParseFns_.end()) {
-        auto error =
-            fmt::format("no prefix parse function for {} found", currentToken_.literal);
-        errors_.push_back(error);
-        return std::nullopt;
-    }
-
-    // We look up the prefix parse function for '-' and call it,
-    // which returns a PrefixExpression with the right side being an IntegerLiteral and
-    // consumes both the token '-' and the token '5'.
-    auto leftExpr = prefixParseFnIt->second();
-    if (!leftExpr) {
-        return std::nullopt;
-    }
-
-    // 2. Now we look at the next token, which is '+'.
-    // We check if its precedence is higher than the current precedence (LOWEST).
-    while (peekToken_.type != TokenType::SEMICOLON && precedence < peekPrecedence()) {
-        // 3. Since '+' has higher precedence than LOWEST, we look up its infix parse
-        // function.
-        auto infixParseFnIt = infixParseFns_.find(peekToken_.type);
-        if (infixParseFnIt == infixParseFns_.end()) {
-            return leftExpr;
+// The prefix half of the Pratt parser: the current token starts an operand.
+Parser::Step Parser::parseOperand() {
+    switch (currentType()) {
+    case TokenType::IDENT:
+        return produce(Identifier{.token = currentToken()});
+    case TokenType::INT:
+        return parseIntegerLiteral();
+    case TokenType::TRUE:
+    case TokenType::FALSE:
+        return produce(BooleanLiteral{.token = currentToken(),
+                                      .value = currentType() == TokenType::TRUE});
+    case TokenType::STRING: {
+        auto text = std::make_shared<const std::string>(currentText());
+        return produce(StringLiteral{.token = currentToken(), .value = std::move(text)});
+    }
+    case TokenType::BANG:
+    case TokenType::MINUS:
+        pending_.emplace_back(PrefixExpression{.token = currentToken(),
+                                               .op = std::string(currentText()),
+                                               .right = {},
+                                               .constant = {}});
+        nextToken();
+        return Step::EXPRESSION;
+    case TokenType::LPAREN:
+        pending_.emplace_back(Group{});
+        nextToken();
+        return Step::EXPRESSION;
+    case TokenType::IF:
+        pending_.emplace_back(PendingIf{.expr = {.token = currentToken(),
+                                                 .condition = {},
+                                                 .consequence = {},
+                                                 .alternative = std::nullopt}});
+        if (!expectPeek(TokenType::LPAREN)) {
+            return Step::RECOVER;
         }
-        // 4. We consume the '+' token (make it current) and parse the right side of the
-        // expression.
         nextToken();
-        auto newLeftExpr = infixParseFnIt->second(std::move(*leftExpr));
-        if (!newLeftExpr) {
-            return std::nullopt;
+        return Step::EXPRESSION;
+    case TokenType::FUNCTION:
+        return parseFunctionLiteral();
+    case TokenType::LBRACKET:
+        pending_.emplace_back(ArrayLiteral{.token = currentToken(), .elements = {}});
+        return beginList<ArrayLiteral>(TokenType::RBRACKET);
+    case TokenType::LBRACE:
+        pending_.emplace_back(
+            PendingHash{.hash = {.token = currentToken(), .pairs = {}}, .key = {}});
+        if (peekType() == TokenType::RBRACE) {
+            nextToken();
+            return produce(take<PendingHash>().hash);
         }
-        // 5. The infix parse function returns a new expression that combines the left and
-        // right sides with the operator, e.g., left(-5) + right(5 * 10). We then repeat
-        // the process, now using this new expression as the left side.
-        leftExpr = std::move(newLeftExpr);
+        nextToken();
+        return Step::EXPRESSION;
+    default:
+        error(current_,
+              fmt::format("no prefix parse function for {} found", currentText()));
+        return Step::RECOVER;
     }
-
-    return leftExpr;
-}
-
-std::optional<Expression> Parser::parseIdentifier() {
-    return Identifier{.token = currentToken_};
 }
 
-std::optional<Expression> Parser::parseIntegerLiteral() {
+Parser::Step Parser::parseIntegerLiteral() {
     int64_t value{};
-    const auto &literal = currentToken_.literal;
+    auto literal = currentText();
 
     auto [ptr, ec] =
         std::from_chars(literal.data(), literal.data() + literal.size(), value);
 
     if (ec != std::errc()) {
-        std::string error;
-        if (ec == std::errc::result_out_of_range) {
-            error =
-                fmt::format("integer literal {} is out of range", currentToken_.literal);
-        } else {
-            error = fmt::format("could not parse {} as integer", currentToken_.literal);
-        }
-        errors_.push_back(error);
-        return std::nullopt;
+        error(current_, ec == std::errc::result_out_of_range
+                            ? fmt::format("integer literal {} is out of range", literal)
+                            : fmt::format("could not parse {} as integer", literal));
+        return Step::RECOVER;
     }
 
-    return IntegerLiteral{.token = currentToken_, .value = value};
+    return produce(IntegerLiteral{.token = currentToken(), .value = value});
 }
 
-std::optional<Expression> Parser::parseFunctionLiteral() {
-    auto func = FunctionLiteral{.token = currentToken_, .parameters = {}, .body = {}};
+Parser::Step Parser::parseFunctionLiteral() {
+    auto func = FunctionLiteral{.token = currentToken(), .parameters = {}, .body = {}};
 
     if (!expectPeek(TokenType::LPAREN)) {
-        return std::nullopt;
+        return Step::RECOVER;
     }
 
-    if (peekToken_.type != TokenType::RPAREN) {
+    if (peekType() != TokenType::RPAREN) {
         // Parse the first parameter.
         nextToken();
-        func.parameters.emplace_back(Identifier{.token = currentToken_});
+        func.parameters.emplace_back(Identifier{.token = currentToken()});
 
         // Parse additional parameters, if any.
-        while (peekToken_.type == TokenType::COMMA) {
+        while (peekType() == TokenType::COMMA) {
             nextToken();
             nextToken();
-            func.parameters.emplace_back(Identifier{.token = currentToken_});
+            func.parameters.emplace_back(Identifier{.token = currentToken()});
         }
     }
 
     if (!expectPeek(TokenType::RPAREN)) {
-        return std::nullopt;
+        return Step::RECOVER;
     }
 
     if (!expectPeek(TokenType::LBRACE)) {
-        return std::nullopt;
-    }
-
-    auto body = parseBlockStatement();
-    if (!body) {
-        return std::nullopt;
+        return Step::RECOVER;
     }
-    func.body = std::move(*body);
-
-    return func;
-}
-
-std::optional<Expression> Parser::parseStringLiteral() {
-    return StringLiteral{.token = currentToken_, .value = currentToken_.literal};
-}
 
-std::optional<Expression> Parser::parseBoolean() {
-    return BooleanLiteral{.token = currentToken_,
-                          .value = currentToken_.type == TokenType::TRUE};
+    pending_.emplace_back(std::move(func));
+    return beginBlock();
 }
 
-std::optional<Expression> Parser::parsePrefixExpression() {
-    auto expr = PrefixExpression{
-        .token = currentToken_, .op = currentToken_.literal, .right = {}};
-    nextToken();
-    auto right = parseExpression(Precedence::PREFIX);
-    if (!right) {
-        return std::nullopt;
-    }
-    expr.right = std::move(*right);
-    return expr;
-}
-
-std::optional<Expression> Parser::parseInfixExpression(Expression left) {
-    auto expr = InfixExpression{.token = currentToken_,
-                                .left = std::move(left),
-                                .op = currentToken_.literal,
-                                .right = {}};
-    auto precedence = currentPrecedence();
-    nextToken();
-    auto right = parseExpression(precedence);
-    if (!right) {
-        return std::nullopt;
+// The infix half of the Pratt parser. Use the expression -5 + 5 * 10 as an example to
+// understand how this works. With operand_ = 5 and the pending '-' on top, the next
+// operator '+' binds less tightly than '-' (pendingPrecedence), so '-' takes 5 and the
+// operand becomes (-5). With nothing pending beneath, '+' binds more tightly than
+// LOWEST: it is pushed with its left side (-5), and the parser goes on with the
+// operand 5. This time '*' binds more tightly than the pending '+' and is pushed in
+// turn, with 5 as its left side. At the end of the expression, the pending '*' takes
+// 10, then '+' takes (5 * 10), giving ((-5) + (5 * 10)).
+Parser::Step Parser::parseOperator() {
+    if (peekType() == TokenType::SEMICOLON ||
+        pendingPrecedence() >= peekPrecedence()) {
+        return reduce();
     }
-    expr.right = std::move(*right);
-    return expr;
-}
-
-std::optional<Expression> Parser::parseGroupedExpression() {
     nextToken();
-    auto expr = parseExpression(Precedence::LOWEST);
-    if (!expr) {
-        return std::nullopt;
-    }
-    if (!expectPeek(TokenType::RPAREN)) {
-        return std::nullopt;
-    }
-    return expr;
-}
-
-std::optional<Expression> Parser::parseIfExpression() {
-    auto expr = IfExpression{.token = currentToken_,
-                             .condition = {},
-                             .consequence = {},
-                             .alternative = std::nullopt};
-
-    if (!expectPeek(TokenType::LPAREN)) {
-        return std::nullopt;
-    }
-
-    nextToken();
-    auto condition = parseExpression(Precedence::LOWEST);
-    if (!condition) {
-        return std::nullopt;
-    }
-    expr.condition = std::move(*condition);
-
-    if (!expectPeek(TokenType::RPAREN)) {
-        return std::nullopt;
-    }
-
-    if (!expectPeek(TokenType::LBRACE)) {
-        return std::nullopt;
-    }
-
-    auto consequence = parseBlockStatement();
-    if (!consequence) {
-        return std::nullopt;
-    }
-    expr.consequence = std::move(*consequence);
-
-    if (peekToken_.type == TokenType::ELSE) {
+    switch (currentType()) {
+    case TokenType::LPAREN:
+        pending_.emplace_back(CallExpression{
+            .token = currentToken(), .function = std::move(operand_), .arguments = {}});
+        return beginList<CallExpression>(TokenType::RPAREN);
+    case TokenType::LBRACKET:
+        pending_.emplace_back(IndexExpression{.token = currentToken(),
+                                              .left = std::move(operand_),
+                                              .index = {},
+                                              .constant = {}});
         nextToken();
-
-        if (!expectPeek(TokenType::LBRACE)) {
-            return std::nullopt;
-        }
-
-        auto alternative = parseBlockStatement();
-        if (!alternative) {
-            return std::nullopt;
-        }
-        expr.alternative = std::move(*alternative);
+        return Step::EXPRESSION;
+    default:
+        pending_.emplace_back(PendingInfix{.expr = {.token = currentToken(),
+                                                    .left = std::move(operand_),
+                                                    .op = std::string(currentText()),
+                                                    .right = {},
+                                                    .constant = {}},
+                                           .precedence = currentPrecedence()});
+        nextToken();
+        return Step::EXPRESSION;
     }
-
-    return expr;
 }
 
-std::optional<Expression> Parser::parseCallExpression(Expression function) {
-    auto expr = CallExpression{
-        .token = currentToken_, .function = std::move(function), .arguments = {}};
+// Hands operand_ to the innermost pending node.
+Parser::Step Parser::reduce() {
+    return std::visit(
+        overloaded{
+            [this](LetStatement &stmt) { return endStatement(stmt, stmt.value); },
+            [this](ReturnStatement &stmt) { return endStatement(stmt, stmt.value); },
+            [this](YieldStatement &stmt) { return endStatement(stmt, stmt.value); },
+            [this](ExpressionStatement &stmt) {
+                return endStatement(stmt, stmt.expression);
+            },
+            [this](Group & /*group*/) {
+                if (!expectPeek(TokenType::RPAREN)) {
+                    return Step::RECOVER;
+                }
+                pending_.pop_back();
+                return Step::OPERATOR;
+            },
+            [this](PrefixExpression &expr) {
+                expr.right = std::move(operand_);
+                return produce(take<PrefixExpression>());
+            },
+            [this](PendingInfix &infix) {
+                infix.expr.right = std::move(operand_);
+                return produce(take<PendingInfix>().expr);
+            },
+            [this](PendingIf &pendingIf) {
+                pendingIf.expr.condition = std::move(operand_);
+                if (!expectPeek(TokenType::RPAREN) || !expectPeek(TokenType::LBRACE)) {
+                    return Step::RECOVER;
+                }
+                return beginBlock();
+            },
+            [this](CallExpression &expr) {
+                return continueList<CallExpression>(expr.arguments, TokenType::RPAREN);
+            },
+            [this](ArrayLiteral &expr) {
+                return continueList<ArrayLiteral>(expr.elements, TokenType::RBRACKET);
+            },
+            [this](IndexExpression &expr) {
+                expr.index = std::move(operand_);
+                if (!expectPeek(TokenType::RBRACKET)) {
+                    return Step::RECOVER;
+                }
+                return produce(take<IndexExpression>());
+            },
+            [this](PendingHash &pendingHash) {
+                if (!pendingHash.key) {
+                    pendingHash.key = std::move(operand_);
+                    if (!expectPeek(TokenType::COLON)) {
+                        return Step::RECOVER;
+                    }
+                    nextToken();
+                    return Step::EXPRESSION;
+                }
+                pendingHash.hash.pairs.emplace_back(std::move(*pendingHash.key),
+                                                    std::move(operand_));
+                pendingHash.key.reset();
+                if (peekType() != TokenType::RBRACE &&
+                    !expectPeek(TokenType::COMMA)) {
+                    return Step::RECOVER;
+                }
+                nextToken();
+                if (currentType() == TokenType::RBRACE) {
+                    return produce(take<PendingHash>().hash);
+                }
+                return Step::EXPRESSION;
+            },
+            // Blocks and function literals are completed by endBlock; operands never
+            // reach them directly.
+            [](auto & /*node*/) -> Step { std::unreachable(); },
+        },
+        pending_.back());
+}
 
-    if (peekToken_.type == TokenType::RPAREN) {
+// The current token opens the list.
+template <typename Node>
+Parser::Step Parser::beginList(TokenType end) {
+    if (peekType() == end) {
         nextToken();
-        return expr;
+        return produce(take<Node>());
     }
-
-    // Parse the first argument.
     nextToken();
-    auto arg = parseExpression(Precedence::LOWEST);
-    if (!arg) {
-        return std::nullopt;
-    }
-    expr.arguments.emplace_back(std::move(*arg));
+    return Step::EXPRESSION;
+}
 
-    // Parse additional arguments, if any.
-    while (peekToken_.type == TokenType::COMMA) {
+template <typename Node>
+Parser::Step Parser::continueList(std::vector<Expression> &list, TokenType end) {
+    list.emplace_back(std::move(operand_));
+    if (peekType() == TokenType::COMMA) {
         nextToken();
         nextToken();
-        arg = parseExpression(Precedence::LOWEST);
-        if (!arg) {
-            return std::nullopt;
-        }
-        expr.arguments.emplace_back(std::move(*arg));
+        return Step::EXPRESSION;
     }
-
-    if (!expectPeek(TokenType::RPAREN)) {
-        return std::nullopt;
+    if (!expectPeek(end)) {
+        return Step::RECOVER;
     }
+    return produce(take<Node>());
+}
+
+Parser::Step Parser::produce(Expression expr) {
+    operand_ = std::move(expr);
+    return Step::OPERATOR;
+}
 
-    return expr;
+template <typename Node>
+Node Parser::take() {
+    auto node = std::move(std::get<Node>(pending_.back()));
+    pending_.pop_back();
+    return node;
 }
 
-} // namespace monkey
+} // namespace monkey
\ No newline at end of file
@@ -0,0 +1,113 @@
+#include "monkey/program_cache.h"
+#include "monkey/interpreter.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace monkey {
+
+uint64_t sourceHash(std::string_view source) {
+    constexpr uint64_t OFFSET_BASIS = 14695981039346656037ULL;
+    constexpr uint64_t PRIME = 1099511628211ULL;
+
+    uint64_t hash = OFFSET_BASIS;
+    for (char ch : source) {
+        hash ^= static_cast<unsigned char>(ch);
+        hash *= PRIME;
+    }
+    return hash;
+}
+
+ProgramCache::Lookup ProgramCache::get(std::string_view source) {
+    auto id = sourceHash(source);
+
+    std::unique_lock lock(mutex_);
+    auto it = entries_.find(id);
+    if (it != entries_.end() && it->second.source == source) {
+        ++hits_;
+        touch(it->second);
+        auto program = it->second.program;
+        lock.unlock();
+        return {program.get(), id, true};
+    }
+
+    // A different source with the same hash replaces the older program, so that an id
+    // always names the source it was last returned for.
+    ++misses_;
+    if (it != entries_.end()) {
+        recency_.erase(it->second.position);
+        entries_.erase(it);
+    }
+    std::promise<std::shared_ptr<const CompiledProgram>> promise;
+    insert(id, source, promise);
+    lock.unlock();
+
+    std::shared_ptr<const CompiledProgram> program;
+    try {
+        program = compile(source);
+    } catch (...) {
+        // Waiters fail the same way, and the next lookup compiles the source again.
+        promise.set_exception(std::current_exception());
+        lock.lock();
+        auto failed = entries_.find(id);
+        if (failed != entries_.end() && failed->second.source == source) {
+            recency_.erase(failed->second.position);
+            entries_.erase(failed);
+        }
+        throw;
+    }
+    promise.set_value(program);
+    return {std::move(program), id, false};
+}
+
+std::shared_ptr<const CompiledProgram> ProgramCache::find(uint64_t id) {
+    std::unique_lock lock(mutex_);
+    auto it = entries_.find(id);
+    if (it == entries_.end()) {
+        return nullptr;
+    }
+    ++hits_;
+    touch(it->second);
+    auto program = it->second.program;
+    lock.unlock();
+    return program.get();
+}
+
+void ProgramCache::touch(Entry &entry) {
+    recency_.splice(recency_.begin(), recency_, entry.position);
+}
+
+void ProgramCache::insert(uint64_t id, std::string_view source,
+                          std::promise<std::shared_ptr<const CompiledProgram>> &promise) {
+    recency_.push_front(id);
+    entries_.emplace(id, Entry{std::string(source), promise.get_future().share(),
+                               recency_.begin()});
+    if (entries_.size() > capacity_) {
+        entries_.erase(recency_.back());
+        recency_.pop_back();
+    }
+}
+
+size_t ProgramCache::size() const {
+    const std::lock_guard lock(mutex_);
+    return entries_.size();
+}
+
+uint64_t ProgramCache::hits() const {
+    const std::lock_guard lock(mutex_);
+    return hits_;
+}
+
+uint64_t ProgramCache::misses() const {
+    const std::lock_guard lock(mutex_);
+    return misses_;
+}
+
+} // namespace monkey
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include "monkey/eval.h"
 #include "monkey/lexer.h"
 #include "monkey/parser.h"
+#include "monkey/trace.h"
 
 #include <fmt/ostream.h>
 #include <magic_enum/magic_enum_format.hpp>
@@ -40,8 +41,9 @@ void printParserErrors(const std::vector<std::string> &errors, std::ostream &out
 
 namespace monkey {
 
-void start(std::istream &input, std::ostream &output) {
+void start(std::istream &input, std::ostream &output, const ReplOptions &options) {
     auto env = makeEnvironment();
+    Tracer tracer;
     while (true) {
         fmt::print(PROMPT);
 
@@ -60,8 +62,17 @@ void start(std::istream &input, std::ostream &output) {
             continue;
         }
 
-        Object result = eval(*program, env);
-        fmt::print(output, "{}\n", inspect(result));
+        if (!options.trace) {
+            fmt::print(output, "{}\n", inspect(eval(*program, env), options.outputLimit));
+            continue;
+        }
+
+        tracer.clear();
+        Object result = eval(*program, env, tracer);
+        for (const auto &event : tracer.events()) {
+            fmt::print(output, "{}\n", toString(event));
+        }
+        fmt::print(output, "{}\n", inspect(result, options.outputLimit));
     }
 }
 
@@ -0,0 +1,610 @@
+#include "monkey/server.h"
+#include "monkey/interpreter.h"
+#include "monkey/memory.h"
+#include "monkey/object.h"
+#include "monkey/output.h"
+#include "monkey/program_cache.h"
+#include "monkey/thread_pool.h"
+
+#include <fmt/format.h>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <variant>
+
+namespace {
+
+using namespace monkey;
+
+// epoll data of the two non-connection descriptors; connections are numbered after them.
+constexpr uint64_t LISTENER = 0;
+constexpr uint64_t WAKEUP = 1;
+
+constexpr size_t HEADER_SIZE = 4;
+
+std::string systemError(std::string_view what) {
+    return fmt::format("{}: {}", what,
+                       std::error_code(errno, std::system_category()).message());
+}
+
+std::optional<uint64_t> parseId(std::string_view text) {
+    uint64_t id = 0;
+    auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), id, 16);
+    if (ec != std::errc{} || end != text.data() + text.size()) {
+        return std::nullopt;
+    }
+    return id;
+}
+
+std::optional<Object> parseLiteral(std::string_view text) {
+    if (text == "true") {
+        return Object{true};
+    }
+    if (text == "false") {
+        return Object{false};
+    }
+    if (text == "null") {
+        return Object{nullptr};
+    }
+    if (text.size() >= 2 && text.front() == '"' && text.back() == '"') {
+        return Object{String(text.substr(1, text.size() - 2))};
+    }
+    int64_t value = 0;
+    auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc{} || end != text.data() + text.size()) {
+        return std::nullopt;
+    }
+    return Object{value};
+}
+
+// Splits off the first line of `text` (without its newline). False if there is none.
+bool nextLine(std::string_view &text, std::string_view &line) {
+    auto newline = text.find('\n');
+    if (newline == std::string_view::npos) {
+        return false;
+    }
+    line = text.substr(0, newline);
+    text.remove_prefix(newline + 1);
+    return true;
+}
+
+bool sendAll(int fd, std::string_view data) {
+    while (!data.empty()) {
+        auto sent = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent <= 0) {
+            return false;
+        }
+        data.remove_prefix(static_cast<size_t>(sent));
+    }
+    return true;
+}
+
+// `text` cut to MAX_RESULT_SIZE bytes, as inspect() would cut it.
+std::string bounded(std::string text) {
+    if (text.size() > MAX_RESULT_SIZE) {
+        text.resize(MAX_RESULT_SIZE);
+        text += BoundedOutput::TRUNCATED;
+    }
+    return text;
+}
+
+bool receiveExactly(int fd, char *data, size_t size) {
+    while (size > 0) {
+        auto got = read(fd, data, size);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            return false;
+        }
+        data += got;
+        size -= static_cast<size_t>(got);
+    }
+    return true;
+}
+
+} // namespace
+
+namespace monkey {
+
+std::string encodeFrame(std::string_view payload) {
+    auto size = static_cast<uint32_t>(payload.size());
+    std::string frame(HEADER_SIZE, '\0');
+    for (size_t i = 0; i < HEADER_SIZE; ++i) {
+        frame[i] = static_cast<char>((size >> (8 * (HEADER_SIZE - 1 - i))) & 0xff);
+    }
+    frame.append(payload);
+    return frame;
+}
+
+std::optional<std::string> takeFrame(std::string &buffer, bool &malformed) {
+    if (buffer.size() < HEADER_SIZE) {
+        return std::nullopt;
+    }
+    size_t size = 0;
+    for (size_t i = 0; i < HEADER_SIZE; ++i) {
+        size = (size << 8) | static_cast<unsigned char>(buffer[i]);
+    }
+    if (size > MAX_FRAME_SIZE) {
+        malformed = true;
+        return std::nullopt;
+    }
+    if (buffer.size() < HEADER_SIZE + size) {
+        return std::nullopt;
+    }
+    auto payload = buffer.substr(HEADER_SIZE, size);
+    buffer.erase(0, HEADER_SIZE + size);
+    return payload;
+}
+
+std::string encodeRequest(const EvalRequest &request) {
+    std::string payload;
+    if (request.programId) {
+        payload += fmt::format("program {:016x}\n", *request.programId);
+    }
+    for (const auto &[name, literal] : request.bindings) {
+        payload += fmt::format("bind {} {}\n", name, literal);
+    }
+    payload += '\n';
+    payload += request.source;
+    return payload;
+}
+
+std::optional<EvalRequest> decodeRequest(std::string_view payload) {
+    EvalRequest request;
+    std::string_view line;
+    while (nextLine(payload, line)) {
+        if (line.empty()) {
+            request.source = payload;
+            return request;
+        }
+        if (line.starts_with("program ")) {
+            request.programId = parseId(line.substr(8));
+            if (!request.programId) {
+                return std::nullopt;
+            }
+        } else if (line.starts_with("bind ")) {
+            line.remove_prefix(5);
+            auto space = line.find(' ');
+            if (space == 0 || space == std::string_view::npos) {
+                return std::nullopt;
+            }
+            request.bindings.emplace_back(line.substr(0, space), line.substr(space + 1));
+        } else {
+            return std::nullopt;
+        }
+    }
+    return std::nullopt; // no blank line before the source
+}
+
+std::string encodeResponse(const EvalResponse &response) {
+    return fmt::format("{} {:016x}\n{}", response.ok ? "ok" : "error", response.programId,
+                       response.result);
+}
+
+std::optional<EvalResponse> decodeResponse(std::string_view payload) {
+    std::string_view line;
+    if (!nextLine(payload, line)) {
+        return std::nullopt;
+    }
+    EvalResponse response;
+    if (line.starts_with("ok ")) {
+        response.ok = true;
+        line.remove_prefix(3);
+    } else if (line.starts_with("error ")) {
+        line.remove_prefix(6);
+    } else {
+        return std::nullopt;
+    }
+    auto id = parseId(line);
+    if (!id) {
+        return std::nullopt;
+    }
+    response.programId = *id;
+    response.result = payload;
+    return response;
+}
+
+Server::Server(ServerOptions options)
+    : options_(std::move(options)), cache_(options_.cacheCapacity),
+      nextConnection_(WAKEUP + 1),
+      pool_(std::make_unique<ThreadPool>(options_.workers)) {}
+
+Server::~Server() {
+    // Workers report to wakeup_, so they must be finished before it is closed.
+    pool_.reset();
+    for (auto &[id, connection] : connections_) {
+        ::close(connection.fd);
+    }
+    for (int fd : {listener_, epoll_, wakeup_}) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+    if (listener_ >= 0) {
+        unlink(options_.socketPath.c_str());
+    }
+}
+
+std::optional<std::string> Server::listen() {
+    sockaddr_un address{};
+    const auto &path = options_.socketPath;
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        return fmt::format("invalid socket path: {}", options_.socketPath);
+    }
+    options_.socketPath.copy(address.sun_path, options_.socketPath.size());
+    address.sun_family = AF_UNIX;
+
+    struct stat existing {};
+    if (lstat(options_.socketPath.c_str(), &existing) == 0) {
+        if (!S_ISSOCK(existing.st_mode)) {
+            return fmt::format("{} exists and is not a socket", options_.socketPath);
+        }
+        // Only a socket nobody listens on any more is stale and may be replaced.
+        int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (probe < 0) {
+            return systemError("socket");
+        }
+        int connected = connect(probe, reinterpret_cast<const sockaddr *>(&address),
+                                sizeof(address));
+        int error = errno;
+        ::close(probe);
+        if (connected == 0) {
+            return fmt::format("{} is already in use", options_.socketPath);
+        }
+        if (error != ECONNREFUSED) {
+            errno = error;
+            return systemError(options_.socketPath);
+        }
+        unlink(options_.socketPath.c_str());
+    }
+
+    listener_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listener_ < 0) {
+        return systemError("socket");
+    }
+    if (bind(listener_, reinterpret_cast<const sockaddr *>(&address),
+             sizeof(address)) != 0) {
+        return systemError(options_.socketPath);
+    }
+    if (::listen(listener_, SOMAXCONN) != 0) {
+        return systemError("listen");
+    }
+
+    epoll_ = epoll_create1(EPOLL_CLOEXEC);
+    wakeup_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_ < 0 || wakeup_ < 0) {
+        return systemError("epoll");
+    }
+    for (auto [fd, id] : {std::pair{listener_, LISTENER}, std::pair{wakeup_, WAKEUP}}) {
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u64 = id;
+        if (epoll_ctl(epoll_, EPOLL_CTL_ADD, fd, &event) != 0) {
+            return systemError("epoll_ctl");
+        }
+    }
+    return std::nullopt;
+}
+
+void Server::run() {
+    std::array<epoll_event, 64> events{};
+    while (!stopping_.load(std::memory_order_acquire)) {
+        int ready =
+            epoll_wait(epoll_, events.data(), static_cast<int>(events.size()), -1);
+        if (ready < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ready < 0) {
+            break;
+        }
+
+        for (const auto &event : std::span(events.data(), static_cast<size_t>(ready))) {
+            auto id = event.data.u64;
+            if (id == LISTENER) {
+                acceptConnections();
+            } else if (id == WAKEUP) {
+                uint64_t count = 0;
+                [[maybe_unused]] auto got = read(wakeup_, &count, sizeof(count));
+                deliverCompletions();
+            } else if ((event.events & EPOLLERR) != 0) {
+                disconnect(id);
+            } else {
+                // A hung up client may have left requests to read.
+                if ((event.events & (EPOLLIN | EPOLLHUP)) != 0) {
+                    receive(id);
+                }
+                auto it = connections_.find(id);
+                if ((event.events & EPOLLOUT) != 0 && it != connections_.end() &&
+                    flush(id, it->second)) {
+                    dispatch(id, it->second);
+                }
+            }
+        }
+    }
+}
+
+void Server::stop() {
+    stopping_.store(true, std::memory_order_release);
+    if (wakeup_ >= 0) {
+        uint64_t one = 1;
+        [[maybe_unused]] auto written = write(wakeup_, &one, sizeof(one));
+    }
+}
+
+EvalResponse Server::handle(std::string_view payload) {
+    auto request = decodeRequest(payload);
+    if (!request) {
+        return {false, 0, "malformed request"};
+    }
+
+    std::shared_ptr<const CompiledProgram> program;
+    uint64_t id = 0;
+    if (request->programId) {
+        id = *request->programId;
+        program = cache_.find(id);
+        if (program == nullptr) {
+            return {false, id, fmt::format("unknown program {:016x}", id)};
+        }
+    } else {
+        auto lookup = cache_.get(request->source);
+        program = std::move(lookup.program);
+        id = lookup.id;
+    }
+
+    Interpreter interpreter(options_.interpreter);
+    for (const auto &[name, literal] : request->bindings) {
+        auto value = parseLiteral(literal);
+        if (!value) {
+            return {false, id, fmt::format("invalid binding: {} {}", name, literal)};
+        }
+        interpreter.define(name, std::move(*value));
+    }
+
+    auto result = interpreter.run(*program);
+    if (const auto *err = std::get_if<Error>(&result)) {
+        return {false, id, bounded(err->message)};
+    }
+    return {true, id, inspect(result, MAX_RESULT_SIZE)};
+}
+
+void Server::acceptConnections() {
+    while (true) {
+        int fd = accept4(listener_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            return; // EAGAIN, or a connection that went away before we got to it
+        }
+        auto id = nextConnection_++;
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u64 = id;
+        if (epoll_ctl(epoll_, EPOLL_CTL_ADD, fd, &event) != 0) {
+            ::close(fd);
+            continue;
+        }
+        connections_.emplace(id, Connection(fd)).first->second.events = EPOLLIN;
+    }
+}
+
+void Server::receive(uint64_t id) {
+    auto it = connections_.find(id);
+    if (it == connections_.end()) {
+        return;
+    }
+    auto &connection = it->second;
+
+    std::array<char, 64 * 1024> buffer{};
+    while (!connection.closing && connection.input.size() < MAX_INPUT_SIZE) {
+        auto got = read(connection.fd, buffer.data(), buffer.size());
+        if (got > 0) {
+            connection.input.append(buffer.data(), static_cast<size_t>(got));
+            continue;
+        }
+        if (got == 0) {
+            connection.closing = true; // answer what was sent, then close
+            break;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        }
+        disconnect(id);
+        return;
+    }
+    dispatch(id, connection);
+}
+
+void Server::dispatch(uint64_t id, Connection &connection) {
+    if (!connection.busy) {
+        bool malformed = false;
+        auto payload = takeFrame(connection.input, malformed);
+        if (malformed) {
+            disconnect(id);
+            return;
+        }
+        if (payload) {
+            connection.busy = true;
+            pool_->submit([this, id, payload = std::move(*payload)] {
+                complete(id, encodeFrame(encodeResponse(handle(payload))));
+            });
+        } else if (connection.closing && connection.output.empty()) {
+            disconnect(id); // every request the client sent is answered
+            return;
+        }
+    }
+    watch(id, connection);
+}
+
+bool Server::flush(uint64_t id, Connection &connection) {
+    size_t offset = 0;
+    while (offset < connection.output.size()) {
+        auto sent = send(connection.fd, connection.output.data() + offset,
+                         connection.output.size() - offset, MSG_NOSIGNAL);
+        if (sent > 0) {
+            offset += static_cast<size_t>(sent);
+            continue;
+        }
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        disconnect(id);
+        return false;
+    }
+    connection.output.erase(0, offset);
+    watch(id, connection);
+    return true;
+}
+
+// Asks for EPOLLIN while the client may send requests there is room for, and for
+// EPOLLOUT only while a response is stuck in the socket buffer. A connection that waits
+// for neither is removed from the epoll set, where a hang up would keep waking the loop.
+void Server::watch(uint64_t id, Connection &connection) {
+    uint32_t events = 0;
+    if (!connection.closing && connection.input.size() < MAX_INPUT_SIZE) {
+        events |= EPOLLIN;
+    }
+    if (!connection.output.empty()) {
+        events |= EPOLLOUT;
+    }
+    if (events == connection.events) {
+        return;
+    }
+    epoll_event event{};
+    event.events = events;
+    event.data.u64 = id;
+    if (events == 0) {
+        epoll_ctl(epoll_, EPOLL_CTL_DEL, connection.fd, &event);
+    } else {
+        epoll_ctl(epoll_, connection.events == 0 ? EPOLL_CTL_ADD : EPOLL_CTL_MOD,
+                  connection.fd, &event);
+    }
+    connection.events = events;
+}
+
+void Server::disconnect(uint64_t id) {
+    auto it = connections_.find(id);
+    if (it == connections_.end()) {
+        return;
+    }
+    // A request still on the pool finds the connection gone and its response is dropped.
+    ::close(it->second.fd);
+    connections_.erase(it);
+}
+
+void Server::complete(uint64_t id, std::string frame) {
+    {
+        const std::lock_guard lock(completionsMutex_);
+        completions_.emplace_back(id, std::move(frame));
+    }
+    uint64_t one = 1;
+    [[maybe_unused]] auto written = write(wakeup_, &one, sizeof(one));
+}
+
+void Server::deliverCompletions() {
+    std::deque<std::pair<uint64_t, std::string>> completions;
+    {
+        const std::lock_guard lock(completionsMutex_);
+        completions.swap(completions_);
+    }
+    for (auto &[id, frame] : completions) {
+        auto it = connections_.find(id);
+        if (it == connections_.end()) {
+            continue;
+        }
+        auto &connection = it->second;
+        connection.busy = false;
+        connection.output += frame;
+        if (flush(id, connection)) {
+            dispatch(id, connection); // the next pipelined request, if any
+        }
+    }
+}
+
+std::optional<Client> Client::connect(const std::string &socketPath) {
+    sockaddr_un address{};
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        return std::nullopt;
+    }
+    socketPath.copy(address.sun_path, socketPath.size());
+    address.sun_family = AF_UNIX;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return std::nullopt;
+    }
+    if (::connect(fd, reinterpret_cast<const sockaddr *>(&address),
+                  sizeof(address)) != 0) {
+        ::close(fd);
+        return std::nullopt;
+    }
+    return Client(fd);
+}
+
+Client &Client::operator=(Client &&other) noexcept {
+    if (this != &other) {
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+        fd_ = std::exchange(other.fd_, -1);
+    }
+    return *this;
+}
+
+Client::~Client() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+std::optional<EvalResponse> Client::evaluate(const EvalRequest &request) {
+    auto payload = encodeRequest(request);
+    if (payload.size() > MAX_FRAME_SIZE || !sendAll(fd_, encodeFrame(payload))) {
+        return std::nullopt;
+    }
+    std::string frame(HEADER_SIZE, '\0');
+    if (!receiveExactly(fd_, frame.data(), HEADER_SIZE)) {
+        return std::nullopt;
+    }
+    bool malformed = false;
+    size_t size = 0;
+    for (char byte : frame) {
+        size = (size << 8) | static_cast<unsigned char>(byte);
+    }
+    if (size > MAX_FRAME_SIZE) {
+        return std::nullopt;
+    }
+    frame.resize(HEADER_SIZE + size);
+    if (!receiveExactly(fd_, frame.data() + HEADER_SIZE, size)) {
+        return std::nullopt;
+    }
+    auto response = takeFrame(frame, malformed);
+    return response ? decodeResponse(*response) : std::nullopt;
+}
+
+} // namespace monkey
\ No newline at end of file
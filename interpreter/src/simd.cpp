@@ -0,0 +1,243 @@
+#include "monkey/simd.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define MONKEY_HAVE_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace monkey::simd {
+
+namespace {
+
+// Two's complement wrap-around without signed overflow.
+int64_t wrapAdd(int64_t a, int64_t b) {
+    return static_cast<int64_t>(static_cast<uint64_t>(a) + static_cast<uint64_t>(b));
+}
+
+int64_t wrapMul(int64_t a, int64_t b) {
+    return static_cast<int64_t>(static_cast<uint64_t>(a) * static_cast<uint64_t>(b));
+}
+
+} // namespace
+
+namespace scalar {
+
+int64_t sum(std::span<const int64_t> values) {
+    int64_t total = 0;
+    for (auto value : values) {
+        total = wrapAdd(total, value);
+    }
+    return total;
+}
+
+int64_t dot(std::span<const int64_t> a, std::span<const int64_t> b) {
+    int64_t total = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        total = wrapAdd(total, wrapMul(a[i], b[i]));
+    }
+    return total;
+}
+
+int64_t min(std::span<const int64_t> values) { return std::ranges::min(values); }
+
+int64_t max(std::span<const int64_t> values) { return std::ranges::max(values); }
+
+void add(std::span<const int64_t> values, int64_t addend, int64_t *out) {
+    for (size_t i = 0; i < values.size(); ++i) {
+        out[i] = wrapAdd(values[i], addend);
+    }
+}
+
+size_t filterGreater(std::span<const int64_t> values, int64_t bound, int64_t *out) {
+    size_t count = 0;
+    for (auto value : values) {
+        if (value > bound) {
+            out[count++] = value;
+        }
+    }
+    return count;
+}
+
+} // namespace scalar
+
+#ifdef MONKEY_HAVE_AVX2
+// Compiled for AVX2 whatever the target flags, and only called when the CPU has it.
+// Each kernel handles four elements per step and leaves the tail to the scalar version.
+namespace avx2 {
+
+#define MONKEY_AVX2 __attribute__((target("avx2")))
+
+constexpr size_t LANES = 4;
+
+MONKEY_AVX2 __m256i load(const int64_t *p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+}
+
+MONKEY_AVX2 void store(int64_t *p, __m256i v) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v);
+}
+
+MONKEY_AVX2 std::array<int64_t, LANES> lanes(__m256i v) {
+    std::array<int64_t, LANES> result{};
+    store(result.data(), v);
+    return result;
+}
+
+// AVX2 has no 64-bit multiply; build the low 64 bits of the product from 32-bit halves.
+MONKEY_AVX2 __m256i mul(__m256i a, __m256i b) {
+    auto low = _mm256_mul_epu32(a, b);
+    auto cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a, 32), b),
+                                  _mm256_mul_epu32(a, _mm256_srli_epi64(b, 32)));
+    return _mm256_add_epi64(low, _mm256_slli_epi64(cross, 32));
+}
+
+MONKEY_AVX2 int64_t sum(std::span<const int64_t> values) {
+    // Two accumulators hide the latency of the adds.
+    auto even = _mm256_setzero_si256();
+    auto odd = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 2 * LANES <= values.size(); i += 2 * LANES) {
+        even = _mm256_add_epi64(even, load(&values[i]));
+        odd = _mm256_add_epi64(odd, load(&values[i + LANES]));
+    }
+    auto total = scalar::sum(lanes(_mm256_add_epi64(even, odd)));
+    return wrapAdd(total, scalar::sum(values.subspan(i)));
+}
+
+MONKEY_AVX2 int64_t dot(std::span<const int64_t> a, std::span<const int64_t> b) {
+    auto acc = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + LANES <= a.size(); i += LANES) {
+        acc = _mm256_add_epi64(acc, mul(load(&a[i]), load(&b[i])));
+    }
+    return wrapAdd(scalar::sum(lanes(acc)), scalar::dot(a.subspan(i), b.subspan(i)));
+}
+
+// AVX2 has no 64-bit min/max either: compare, then blend.
+template <bool Greater>
+MONKEY_AVX2 int64_t extreme(std::span<const int64_t> values) {
+    if (values.size() < LANES) {
+        return Greater ? scalar::max(values) : scalar::min(values);
+    }
+    auto best = load(values.data());
+    size_t i = LANES;
+    for (; i + LANES <= values.size(); i += LANES) {
+        auto next = load(&values[i]);
+        auto better = Greater ? _mm256_cmpgt_epi64(next, best)
+                              : _mm256_cmpgt_epi64(best, next);
+        best = _mm256_blendv_epi8(best, next, better);
+    }
+    // The last (possibly overlapping) group covers the tail.
+    auto tail = load(&values[values.size() - LANES]);
+    auto candidates = lanes(best);
+    auto last = lanes(tail);
+    return Greater ? std::max(scalar::max(candidates), scalar::max(last))
+                   : std::min(scalar::min(candidates), scalar::min(last));
+}
+
+MONKEY_AVX2 int64_t min(std::span<const int64_t> values) {
+    return extreme<false>(values);
+}
+
+MONKEY_AVX2 int64_t max(std::span<const int64_t> values) {
+    return extreme<true>(values);
+}
+
+MONKEY_AVX2 void add(std::span<const int64_t> values, int64_t addend, int64_t *out) {
+    auto broadcast = _mm256_set1_epi64x(addend);
+    size_t i = 0;
+    for (; i + LANES <= values.size(); i += LANES) {
+        store(&out[i], _mm256_add_epi64(load(&values[i]), broadcast));
+    }
+    scalar::add(values.subspan(i), addend, out + i);
+}
+
+// For each 4-bit mask of selected lanes, the 32-bit lane indices that move the selected
+// 64-bit lanes to the front.
+constexpr auto COMPRESS = [] {
+    std::array<std::array<int32_t, 8>, 16> table{};
+    for (unsigned mask = 0; mask < 16; ++mask) {
+        size_t next = 0;
+        for (int lane = 0; lane < 4; ++lane) {
+            if ((mask & (1U << lane)) != 0) {
+                table[mask][next++] = 2 * lane;
+                table[mask][next++] = 2 * lane + 1;
+            }
+        }
+    }
+    return table;
+}();
+
+MONKEY_AVX2 size_t filterGreater(std::span<const int64_t> values, int64_t bound,
+                                 int64_t *out) {
+    auto broadcast = _mm256_set1_epi64x(bound);
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + LANES <= values.size(); i += LANES) {
+        auto next = load(&values[i]);
+        auto selected = _mm256_cmpgt_epi64(next, broadcast);
+        auto mask =
+            static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(selected)));
+        auto order = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(COMPRESS[mask].data()));
+        // Writes all four lanes; since count <= i, they stay within values.size().
+        store(&out[count], _mm256_permutevar8x32_epi32(next, order));
+        count += static_cast<size_t>(std::popcount(mask));
+    }
+    return count + scalar::filterGreater(values.subspan(i), bound, out + count);
+}
+
+#undef MONKEY_AVX2
+
+} // namespace avx2
+
+namespace {
+
+const bool HAS_AVX2 = __builtin_cpu_supports("avx2") != 0;
+
+} // namespace
+
+#define MONKEY_DISPATCH(kernel, ...)                                                     \
+    return HAS_AVX2 ? avx2::kernel(__VA_ARGS__) : scalar::kernel(__VA_ARGS__)
+#else
+#define MONKEY_DISPATCH(kernel, ...) return scalar::kernel(__VA_ARGS__)
+#endif
+
+int64_t sum(std::span<const int64_t> values) { MONKEY_DISPATCH(sum, values); }
+
+int64_t dot(std::span<const int64_t> a, std::span<const int64_t> b) {
+    MONKEY_DISPATCH(dot, a, b);
+}
+
+int64_t min(std::span<const int64_t> values) { MONKEY_DISPATCH(min, values); }
+
+int64_t max(std::span<const int64_t> values) { MONKEY_DISPATCH(max, values); }
+
+void add(std::span<const int64_t> values, int64_t addend, int64_t *out) {
+    MONKEY_DISPATCH(add, values, addend, out);
+}
+
+size_t filterGreater(std::span<const int64_t> values, int64_t bound, int64_t *out) {
+    MONKEY_DISPATCH(filterGreater, values, bound, out);
+}
+
+std::string_view implementation() {
+#ifdef MONKEY_HAVE_AVX2
+    if (HAS_AVX2) {
+        return "avx2";
+    }
+#endif
+    return "scalar";
+}
+
+#undef MONKEY_DISPATCH
+
+} // namespace monkey::simd
\ No newline at end of file
@@ -0,0 +1,9 @@
+#include "monkey/stats.h"
+
+namespace monkey {
+
+const RuntimeStats &runtimeStats() { return stats::current; }
+
+void resetRuntimeStats() { stats::current = RuntimeStats{}; }
+
+} // namespace monkey
\ No newline at end of file
@@ -0,0 +1,181 @@
+#include "monkey/string.h"
+#include "monkey/memory.h"
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace monkey {
+
+// An inner node of a rope. Flattening drops the children, or every flattened
+// intermediate of a loop of appends would keep a copy of its prefix alive. Since
+// concat() and the flattening of enclosing ropes may read them from other threads at the
+// same time, the children are only read and dropped under the node's mutex.
+struct String::Rope {
+    Rope(String l, String r) : left(std::move(l)), right(std::move(r)) {}
+    Rope(const Rope &) = delete;
+    Rope &operator=(const Rope &) = delete;
+    Rope(Rope &&) = delete;
+    Rope &operator=(Rope &&) = delete;
+    ~Rope();
+
+    // Copies of the children, or nullopt once the rope is flattened.
+    [[nodiscard]] std::optional<std::pair<String, String>> children() const {
+        const std::lock_guard lock(mutex);
+        if (flattened.load(std::memory_order_relaxed)) {
+            return std::nullopt;
+        }
+        return std::pair{left, right};
+    }
+
+    mutable std::mutex mutex;
+    // Empty once the rope is flattened.
+    mutable String left;
+    mutable String right;
+    // Set once `text` holds the flattened characters; they never change after that.
+    mutable std::atomic<bool> flattened{false};
+    mutable ManagedString text;
+};
+
+// A loop builds a rope as deep as the number of pieces it appended; freeing it through
+// nested destructors would overflow the stack. Instead, the nodes only this rope holds
+// are unlinked and freed one at a time. The children a flattened rope drops go through
+// here too.
+String::Rope::~Rope() {
+    std::vector<std::shared_ptr<const void>> orphans;
+    auto adopt = [&orphans](String &child) {
+        if (child.isRope() && child.owner_.use_count() == 1) {
+            orphans.push_back(std::move(child.owner_));
+        }
+    };
+    adopt(left);
+    adopt(right);
+    while (!orphans.empty()) {
+        auto node = std::move(orphans.back());
+        orphans.pop_back();
+        // Ropes are only created non-const, by makeRope().
+        auto &rope = *static_cast<Rope *>(const_cast<void *>(node.get()));
+        adopt(rope.left);
+        adopt(rope.right);
+    }
+}
+
+String::String(std::string_view text) : size_(text.size()) {
+    if (text.size() <= INLINE_CAPACITY) {
+        if (!text.empty()) {
+            std::memcpy(inline_, text.data(), text.size());
+        }
+        return;
+    }
+    auto buffer = std::allocate_shared<const ManagedString>(
+        AccountingAllocator<ManagedString>(), text);
+    data_ = buffer->data();
+    owner_ = std::move(buffer);
+}
+
+String::String(ManagedString &&text) : size_(text.size()) {
+    if (text.size() <= INLINE_CAPACITY) {
+        std::memcpy(inline_, text.data(), text.size());
+        return;
+    }
+    auto buffer = std::allocate_shared<const ManagedString>(
+        AccountingAllocator<ManagedString>(), std::move(text));
+    data_ = buffer->data();
+    owner_ = std::move(buffer);
+}
+
+String String::concat(const String &left, const String &right) {
+    if (left.empty()) {
+        return right;
+    }
+    if (right.empty()) {
+        return left;
+    }
+    auto size = left.size() + right.size();
+    if (size <= INLINE_CAPACITY) {
+        // Neither side is a rope, since ropes are longer than INLINE_CAPACITY.
+        String result;
+        result.size_ = size;
+        std::memcpy(result.inline_, left.view().data(), left.size());
+        std::memcpy(result.inline_ + left.size(), right.view().data(), right.size());
+        return result;
+    }
+    // A short piece appended to a rope that ends in a short string is joined with that
+    // string (inline) rather than added as a node, so adding a character at a time grows
+    // the rope by one node per INLINE_CAPACITY characters. Likewise for prepending.
+    if (left.isRope()) {
+        if (auto children = left.rope().children();
+            children && children->second.size() + right.size() <= INLINE_CAPACITY) {
+            return makeRope(std::move(children->first), concat(children->second, right));
+        }
+    }
+    if (right.isRope()) {
+        if (auto children = right.rope().children();
+            children && left.size() + children->first.size() <= INLINE_CAPACITY) {
+            return makeRope(concat(left, children->first), std::move(children->second));
+        }
+    }
+    return makeRope(left, right);
+}
+
+bool String::affordable(size_t size) {
+    return size <= INLINE_CAPACITY || memory::current == nullptr ||
+           memory::current->fits(size);
+}
+
+String String::makeRope(String left, String right) {
+    String result;
+    result.size_ = left.size() + right.size();
+    auto node = std::allocate_shared<Rope>(AccountingAllocator<Rope>(), std::move(left),
+                                           std::move(right));
+    result.owner_ = std::move(node);
+    return result;
+}
+
+const String::Rope &String::rope() const {
+    return *static_cast<const Rope *>(owner_.get());
+}
+
+std::string_view String::flatten() const {
+    const auto &node = rope();
+    if (node.flattened.load(std::memory_order_acquire)) {
+        return node.text;
+    }
+    const std::lock_guard lock(node.mutex);
+    if (node.flattened.load(std::memory_order_relaxed)) {
+        return node.text;
+    }
+    ManagedString text;
+    text.reserve(size_);
+    // Left to right with an explicit stack, for the same reason as ~Rope(). Ropes
+    // flattened earlier are copied whole. The pieces are copies, which keep their nodes
+    // alive should another thread flatten an enclosing rope and drop its children.
+    std::vector<String> pending{node.right, node.left};
+    while (!pending.empty()) {
+        auto piece = std::move(pending.back());
+        pending.pop_back();
+        if (!piece.isRope()) {
+            text.append(piece.view());
+            continue;
+        }
+        if (auto children = piece.rope().children()) {
+            pending.push_back(std::move(children->second));
+            pending.push_back(std::move(children->first));
+        } else {
+            text.append(piece.rope().text);
+        }
+    }
+    node.text = std::move(text);
+    node.flattened.store(true, std::memory_order_release);
+    // Dropped through ~Rope(), which unlinks deep ropes one node at a time.
+    node.left = String();
+    node.right = String();
+    return node.text;
+}
+
+} // namespace monkey
\ No newline at end of file
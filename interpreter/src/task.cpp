@@ -0,0 +1,176 @@
+#include "monkey/task.h"
+#include "monkey/env.h"
+#include "monkey/generator.h"
+#include "monkey/memo.h"
+#include "monkey/object.h"
+#include "monkey/thread_pool.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <variant>
+
+namespace {
+
+using namespace monkey;
+
+size_t schedulerThreads() {
+    if (const char *threads = std::getenv("MONKEY_THREADS")) {
+        if (auto count = std::atoi(threads); count > 0) {
+            return static_cast<size_t>(count);
+        }
+    }
+    return std::thread::hardware_concurrency();
+}
+
+// How long a helping thread waits before it looks for queued work again.
+constexpr auto HELP_INTERVAL = std::chrono::milliseconds(1);
+
+// Waits on `changed` until `ready` holds. A scheduler worker that has to wait hands its
+// place to a spare thread meanwhile, or, once the scheduler has no spare left, runs
+// queued tasks itself.
+template <typename Predicate>
+void waitUntil(std::unique_lock<std::mutex> &lock, std::condition_variable &changed,
+               Predicate ready) {
+    if (ready()) {
+        return;
+    }
+    ThreadPool::Blocking blocking(scheduler());
+    if (!blocking.helps()) {
+        changed.wait(lock, ready);
+        return;
+    }
+    while (!ready()) {
+        lock.unlock();
+        const bool helped = blocking.help();
+        lock.lock();
+        if (!helped) {
+            changed.wait_for(lock, HELP_INTERVAL, ready);
+        }
+    }
+}
+
+} // namespace
+
+namespace monkey {
+
+ThreadPool &scheduler() {
+    static ThreadPool pool(schedulerThreads());
+    return pool;
+}
+
+void share(const Object &obj) {
+    if (const auto *fn = std::get_if<Box<Function>>(&obj)) {
+        std::as_const(*fn)->env->share();
+    } else if (const auto *rv = std::get_if<Box<ReturnValue>>(&obj)) {
+        share(std::as_const(*rv)->value);
+    } else if (const auto *generator = std::get_if<Generator>(&obj)) {
+        generator->state->share();
+    } else if (const auto *memo = std::get_if<Memo>(&obj)) {
+        memo->table->share();
+    } else if (const auto *array = std::get_if<Array>(&obj)) {
+        // Integer arrays hold nothing that needs sharing.
+        if (array->integers() == nullptr) {
+            array->forEach([](const Object &element) { share(element); });
+        }
+    } else if (const auto *hash = std::get_if<Hash>(&obj)) {
+        for (const auto &entry : hash->table->entries()) {
+            share(entry.second);
+        }
+    }
+}
+
+void TaskGroup::spawn(std::function<void()> task) {
+    enter();
+    scheduler().submit([this, task = std::move(task)]() mutable {
+        task();
+        // Drop what the task captured before join() can return.
+        task = nullptr;
+        leave();
+    });
+}
+
+void TaskGroup::enter() {
+    const std::lock_guard lock(mutex_);
+    ++running_;
+}
+
+void TaskGroup::leave() {
+    const std::lock_guard lock(mutex_);
+    if (--running_ == 0) {
+        done_.notify_all();
+    }
+}
+
+void TaskGroup::join() {
+    std::unique_lock lock(mutex_);
+    waitUntil(lock, done_, [this] { return running_ == 0; });
+}
+
+void TaskState::run() {
+    if (!started_.exchange(true, std::memory_order_acq_rel)) {
+        execute();
+    }
+}
+
+Object TaskState::await() {
+    run();
+    std::unique_lock lock(mutex_);
+    waitUntil(lock, done_, [this] { return result_.has_value(); });
+    return *result_;
+}
+
+void TaskState::execute() {
+    auto job = std::move(job_);
+    auto result = job();
+    // Release what the job captured before anyone can observe the result.
+    job = nullptr;
+    complete(std::move(result));
+}
+
+void TaskState::complete(Object result) {
+    share(result);
+    const std::lock_guard lock(mutex_);
+    result_ = std::move(result);
+    done_.notify_all();
+}
+
+bool ChannelState::send(Object value) {
+    share(value);
+    std::unique_lock lock(mutex_);
+    waitUntil(lock, changed_,
+              [this] { return closed_ || capacity_ == 0 || values_.size() < capacity_; });
+    if (closed_) {
+        return false;
+    }
+    values_.push_back(std::move(value));
+    changed_.notify_all();
+    return true;
+}
+
+std::optional<Object> ChannelState::receive() {
+    std::unique_lock lock(mutex_);
+    waitUntil(lock, changed_, [this] { return closed_ || !values_.empty(); });
+    if (values_.empty()) {
+        return std::nullopt;
+    }
+    auto value = std::move(values_.front());
+    values_.pop_front();
+    changed_.notify_all();
+    return value;
+}
+
+void ChannelState::close() {
+    const std::lock_guard lock(mutex_);
+    closed_ = true;
+    changed_.notify_all();
+}
+
+} // namespace monkey
\ No newline at end of file
@@ -0,0 +1,251 @@
+#include "monkey/thread_pool.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace {
+
+using namespace monkey;
+
+// Lets submit() from inside a task go to the calling worker's own deque.
+thread_local const ThreadPool *currentPool = nullptr;
+thread_local size_t currentWorker = 0;
+
+// currentWorker of a spare thread, which has no deque of its own.
+constexpr size_t SPARE = std::numeric_limits<size_t>::max();
+
+// Tasks a helping thread runs nested in its waits, and how many it may: each one may
+// itself go deep into the C++ stack before it waits again.
+thread_local size_t helpDepth = 0;
+constexpr size_t MAX_HELP_DEPTH = 16;
+
+} // namespace
+
+namespace monkey {
+
+ThreadPool::ThreadPool(size_t threads, size_t maxSpares)
+    : maxSpares_(std::max<size_t>(maxSpares, 1)) {
+    threads = std::max<size_t>(threads, 1);
+    for (size_t i = 0; i < threads; ++i) {
+        queues_.push_back(std::make_unique<Queue>());
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        workers_.emplace_back([this, i] { run(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    wait();
+    {
+        const std::lock_guard lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    spareWake_.notify_all();
+    for (auto &worker : workers_) {
+        worker.join();
+    }
+    // Nothing can start a spare any more, so spares_ is stable.
+    for (auto &spare : spares_) {
+        spare.join();
+    }
+}
+
+ThreadPool::Blocking::Blocking(ThreadPool &pool)
+    : pool_(currentPool == &pool ? &pool : nullptr) {
+    if (pool_ != nullptr) {
+        helps_ = !pool_->beginBlocking();
+    }
+}
+
+ThreadPool::Blocking::~Blocking() {
+    if (pool_ != nullptr && !helps_) {
+        pool_->endBlocking();
+    }
+}
+
+bool ThreadPool::Blocking::help() { return helps_ && pool_->runOne(); }
+
+size_t ThreadPool::spares() {
+    const std::lock_guard lock(mutex_);
+    return spares_.size();
+}
+
+void ThreadPool::submit(Task task) {
+    size_t target = currentPool == this && currentWorker != SPARE
+                        ? currentWorker
+                        : next_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+    // Count before publishing so that queued_ never drops below the real number of tasks.
+    pending_.fetch_add(1, std::memory_order_relaxed);
+    queued_.fetch_add(1, std::memory_order_release);
+    {
+        const std::lock_guard lock(queues_[target]->mutex);
+        queues_[target]->tasks.push_back(std::move(task));
+    }
+    // Taking the lock orders this wake-up after a sleeper's check of queued_.
+    { const std::lock_guard lock(mutex_); }
+    wake_.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock lock(mutex_);
+    idle_.wait(lock, [this] { return pending_.load(std::memory_order_acquire) == 0; });
+}
+
+bool ThreadPool::popLocal(size_t self, Task &task) {
+    auto &queue = *queues_[self];
+    const std::lock_guard lock(queue.mutex);
+    if (queue.tasks.empty()) {
+        return false;
+    }
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool ThreadPool::steal(size_t self, Task &task) {
+    for (size_t offset = 1; offset < queues_.size(); ++offset) {
+        auto &queue = *queues_[(self + offset) % queues_.size()];
+        const std::lock_guard lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            steals_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::stealAny(Task &task) {
+    for (auto &queue : queues_) {
+        const std::lock_guard lock(queue->mutex);
+        if (!queue->tasks.empty()) {
+            task = std::move(queue->tasks.front());
+            queue->tasks.pop_front();
+            steals_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::execute(Task &task) {
+    queued_.fetch_sub(1, std::memory_order_relaxed);
+    task();
+    task = nullptr;
+    if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        { const std::lock_guard lock(mutex_); }
+        idle_.notify_all();
+    }
+}
+
+bool ThreadPool::beginBlocking() {
+    const std::lock_guard lock(mutex_);
+    if (blocked_ < runningSpares_) {
+        // A surplus spare has not parked yet; it stands in for this thread.
+        ++blocked_;
+        return true;
+    }
+    if (idleSpares_ > 0) {
+        --idleSpares_;
+        ++activations_;
+        spareWake_.notify_one();
+    } else if (spares_.size() < maxSpares_) {
+        spares_.emplace_back([this] { runSpare(); });
+    } else {
+        return false;
+    }
+    ++blocked_;
+    ++runningSpares_;
+    return true;
+}
+
+void ThreadPool::endBlocking() {
+    // The surplus spare parks once it is done with its current task.
+    const std::lock_guard lock(mutex_);
+    --blocked_;
+}
+
+bool ThreadPool::runOne() {
+    if (helpDepth == MAX_HELP_DEPTH) {
+        return false;
+    }
+    Task task;
+    const bool found = currentWorker != SPARE
+                           ? popLocal(currentWorker, task) || steal(currentWorker, task)
+                           : stealAny(task);
+    if (found) {
+        ++helpDepth;
+        execute(task);
+        --helpDepth;
+    }
+    return found;
+}
+
+void ThreadPool::runSpare() {
+    currentPool = this;
+    currentWorker = SPARE;
+
+    Task task;
+    std::unique_lock lock(mutex_);
+    while (true) {
+        if (runningSpares_ > blocked_) {
+            // Pass on a submit() wake-up this surplus spare may have taken from a worker.
+            if (queued_.load(std::memory_order_acquire) > 0) {
+                wake_.notify_one();
+            }
+            --runningSpares_;
+            ++idleSpares_;
+            spareWake_.wait(lock, [this] { return stopping_ || activations_ > 0; });
+            if (stopping_) {
+                return;
+            }
+            --activations_;
+            continue;
+        }
+
+        lock.unlock();
+        const bool found = stealAny(task);
+        if (found) {
+            execute(task);
+        }
+        lock.lock();
+        if (!found) {
+            wake_.wait(lock, [this] {
+                return stopping_ || queued_.load(std::memory_order_acquire) > 0 ||
+                       runningSpares_ > blocked_;
+            });
+            if (stopping_ && queued_.load(std::memory_order_acquire) == 0) {
+                return;
+            }
+        }
+    }
+}
+
+void ThreadPool::run(size_t self) {
+    currentPool = this;
+    currentWorker = self;
+
+    Task task;
+    while (true) {
+        if (popLocal(self, task) || steal(self, task)) {
+            execute(task);
+            continue;
+        }
+
+        std::unique_lock lock(mutex_);
+        wake_.wait(lock, [this] {
+            return stopping_ || queued_.load(std::memory_order_acquire) > 0;
+        });
+        if (stopping_ && queued_.load(std::memory_order_acquire) == 0) {
+            return;
+        }
+    }
+}
+
+} // namespace monkey
\ No newline at end of file
@@ -0,0 +1,53 @@
+#include "monkey/token_buffer.h"
+#include "monkey/lexer.h"
+#include "monkey/token.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace monkey {
+
+TokenBuffer::TokenBuffer(Lexer lexer) {
+    auto push = [this](TokenType type, size_t start, size_t length) {
+        types_.push_back(type);
+        starts_.push_back(static_cast<uint32_t>(start));
+        lengths_.push_back(static_cast<uint32_t>(length));
+    };
+    if (lexer.input_.size() >= MAX_SOURCE) {
+        push(TokenType::EOF_TOKEN, 0, 0);
+    } else {
+        // Most tokens are a few characters long.
+        auto estimate = lexer.input_.size() / 4 + 1;
+        types_.reserve(estimate);
+        starts_.reserve(estimate);
+        lengths_.reserve(estimate);
+        Lexer::Lexeme lexeme{};
+        do {
+            lexeme = lexer.nextLexeme();
+            push(lexeme.type, lexeme.start, lexeme.length);
+        } while (lexeme.type != TokenType::EOF_TOKEN);
+    }
+    source_ = std::move(lexer.input_);
+}
+
+SourcePosition TokenBuffer::position(size_t index) const {
+    if (!lineStarts_) {
+        lineStarts_.emplace();
+        for (size_t i = 0; i < source_.size(); ++i) {
+            if (source_[i] == '\n') {
+                lineStarts_->push_back(static_cast<uint32_t>(i + 1));
+            }
+        }
+    }
+    const auto &starts = *lineStarts_;
+    auto offset = starts_[clamp(index)];
+    // The lines before the token's are those that start at or before it.
+    auto line = static_cast<size_t>(std::ranges::upper_bound(starts, offset) -
+                                    starts.begin());
+    size_t lineStart = line == 0 ? 0 : starts[line - 1];
+    return {line + 1, offset - lineStart + 1};
+}
+
+} // namespace monkey
\ No newline at end of file
@@ -0,0 +1,80 @@
+#include "monkey/trace.h"
+#include "monkey/ast.h"
+#include "monkey/object.h"
+#include "monkey/output.h"
+
+#include <fmt/format.h>
+
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+
+namespace monkey {
+
+void Tracer::onStatement(const Statement &stmt) {
+    // Blocks only group statements; their children are traced one by one.
+    if (std::holds_alternative<BlockStatement>(stmt)) {
+        return;
+    }
+    events_.push_back({TraceEventKind::STATEMENT, depth_, toString(stmt, DETAIL_LIMIT)});
+}
+
+void Tracer::onCall(const CallExpression &call, const Function & /*fn*/,
+                    std::span<const Object> args) {
+    auto detail = printToString(
+        [&](BoundedOutput &out) {
+            print(out, call.function);
+            out.append("(");
+            for (const auto &arg : args) {
+                if (&arg != &args.front()) {
+                    out.append(", ");
+                }
+                inspect(out, arg);
+            }
+            out.append(")");
+        },
+        DETAIL_LIMIT);
+    events_.push_back({TraceEventKind::CALL, depth_, std::move(detail)});
+    ++depth_;
+}
+
+void Tracer::onReturn(const CallExpression &call, const Object &result) {
+    --depth_;
+    auto detail = printToString(
+        [&](BoundedOutput &out) {
+            print(out, call.function);
+            out.append(" => ");
+            inspect(out, result);
+        },
+        DETAIL_LIMIT);
+    events_.push_back({TraceEventKind::RETURN, depth_, std::move(detail)});
+}
+
+void Tracer::onError(const Error &err) {
+    auto detail = printToString([&](BoundedOutput &out) { out.append(err.message); },
+                                DETAIL_LIMIT);
+    events_.push_back({TraceEventKind::ERROR, depth_, std::move(detail)});
+}
+
+std::string toString(const TraceEvent &event) {
+    std::string_view kind;
+    switch (event.kind) {
+    case TraceEventKind::STATEMENT:
+        kind = "stmt";
+        break;
+    case TraceEventKind::CALL:
+        kind = "call";
+        break;
+    case TraceEventKind::RETURN:
+        kind = "return";
+        break;
+    case TraceEventKind::ERROR:
+        kind = "error";
+        break;
+    }
+    return fmt::format("{:{}}{} {}", "", event.depth * 2, kind, event.detail);
+}
+
+} // namespace monkey
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "monkey/ast.h"
 
+#include <fmt/format.h>
 #include <gtest/gtest.h>
 
 using namespace monkey; // NOLINT(google-build-using-namespace) - for cleaner test code
@@ -18,7 +19,36 @@ TEST(AstTest, ToString) {
         .token = Token{.type = TokenType::MINUS, .literal = "-"},
         .op = "-",
         .right = Identifier{.token = Token{.type = TokenType::IDENT, .literal = "5"}},
+        .constant = {},
     }};
 
     EXPECT_EQ(toString(expr), "(-5)");
+}
+
+TEST(AstTest, PrintsIntoOneBoundedOutput) {
+    Statement stmt = ExpressionStatement{
+        .token = Token{.type = TokenType::MINUS, .literal = "-"},
+        .expression = Expression{PrefixExpression{
+            .token = Token{.type = TokenType::MINUS, .literal = "-"},
+            .op = "-",
+            .right = Identifier{.token = Token{.type = TokenType::IDENT, .literal = "x"}},
+            .constant = {},
+        }},
+    };
+
+    fmt::memory_buffer buffer;
+    BoundedOutput out(buffer, 10);
+    print(out, stmt);
+    print(out, stmt);
+    EXPECT_FALSE(out.truncated());
+    EXPECT_EQ(fmt::to_string(buffer), "(-x)(-x)");
+    print(out, stmt);
+    EXPECT_TRUE(out.truncated());
+    EXPECT_EQ(fmt::to_string(buffer), "(-x)(-x)(-...");
+    print(out, stmt);
+    EXPECT_EQ(fmt::to_string(buffer), "(-x)(-x)(-...");
+
+    EXPECT_EQ(toString(stmt, 4), "(-x)");
+    EXPECT_EQ(toString(stmt, 3), "(-x...");
+    EXPECT_EQ(toString(stmt, 0), "...");
 }
\ No newline at end of file
@@ -0,0 +1,87 @@
+#include "monkey/batch.h"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace monkey; // NOLINT(google-build-using-namespace) - for cleaner test code
+
+namespace {
+
+class BatchTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        const auto *test = ::testing::UnitTest::GetInstance()->current_test_info();
+        dir_ = std::filesystem::temp_directory_path() /
+               (std::string("monkey_batch_test_") + test->name());
+        std::filesystem::create_directories(dir_);
+    }
+
+    void TearDown() override { std::filesystem::remove_all(dir_); }
+
+    std::string script(const std::string &name, const std::string &source) {
+        auto path = dir_ / name;
+        std::ofstream(path) << source;
+        return path.string();
+    }
+
+  private:
+    std::filesystem::path dir_;
+};
+
+} // namespace
+
+TEST_F(BatchTest, ResultsKeepInputOrder) {
+    std::vector<std::string> paths;
+    for (int i = 0; i < 40; ++i) {
+        paths.push_back(script(std::to_string(i) + ".monkey",
+                               "let f = fn(n) { n * 2 }; f(" + std::to_string(i) + ");"));
+    }
+
+    auto report = runBatch(paths, {.jobs = 4, .interpreter = {}});
+    ASSERT_EQ(report.scripts.size(), paths.size());
+    for (size_t i = 0; i < paths.size(); ++i) {
+        EXPECT_EQ(report.scripts[i].path, paths[i]);
+        EXPECT_EQ(report.scripts[i].output, std::to_string(i * 2));
+        EXPECT_TRUE(report.scripts[i].ok);
+    }
+    EXPECT_EQ(report.jobs, 4);
+}
+
+TEST_F(BatchTest, IdenticalSourcesAreParsedOnce) {
+    std::vector<std::string> paths;
+    for (int i = 0; i < 10; ++i) {
+        paths.push_back(script(std::to_string(i) + ".monkey", "1 + 2;"));
+    }
+    paths.push_back(script("other.monkey", "3 * 4;"));
+
+    auto report = runBatch(paths, {.jobs = 3, .interpreter = {}});
+    EXPECT_EQ(report.uniquePrograms, 2);
+    size_t cached = 0;
+    for (const auto &result : report.scripts) {
+        cached += result.cached ? 1 : 0;
+    }
+    EXPECT_EQ(cached, 9);
+    EXPECT_EQ(report.scripts.back().output, "12");
+}
+
+TEST_F(BatchTest, FailuresAreReportedPerScript) {
+    std::vector<std::string> paths = {
+        script("good.monkey", "5;"),
+        script("bad.monkey", "-true;"),
+        (std::filesystem::temp_directory_path() / "monkey_batch_missing.monkey").string(),
+    };
+
+    auto report = runBatch(paths, {.jobs = 2, .interpreter = {}});
+    EXPECT_TRUE(report.scripts[0].ok);
+    EXPECT_FALSE(report.scripts[1].ok);
+    EXPECT_EQ(report.scripts[1].output, "ERROR: unknown operator: -true");
+    EXPECT_FALSE(report.scripts[2].ok);
+    EXPECT_TRUE(report.scripts[2].output.starts_with("cannot open"));
+
+    auto table = timingTable(report);
+    EXPECT_NE(table.find("3 scripts, 2 unique programs, 2 jobs"), std::string::npos);
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+#include "monkey/budget.h"
+#include "monkey/env.h"
+#include "monkey/eval.h"
+#include "monkey/lexer.h"
+#include "monkey/parser.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+using namespace monkey; // NOLINT(google-build-using-namespace) - for cleaner test code
+
+namespace {
+
+std::unique_ptr<Program> parse(const std::string &input) {
+    auto parser = Parser(Lexer(input));
+    return parser.parseProgram();
+}
+
+constexpr std::string_view FIB =
+    "let fib = fn(n) { if (n < 2) { return n; } fib(n - 1) + fib(n - 2) };";
+
+} // namespace
+
+TEST(BudgetTest, GenerousBudgetMatchesPlainEval) {
+    auto program = parse(std::string(FIB) + "fib(15);");
+    Budget budget;
+    auto result = eval(*program, makeEnvironment(), budget);
+    ASSERT_TRUE(std::holds_alternative<int64_t>(result));
+    EXPECT_EQ(std::get<int64_t>(result), 610);
+    EXPECT_FALSE(budget.exhausted());
+    EXPECT_GT(budget.fuelUsed(), 0);
+}
+
+TEST(BudgetTest, RunawayRecursionRunsOutOfFuel) {
+    auto program = parse("let loop = fn(n) { loop(n + 1) }; loop(0);");
+    Budget budget(500);
+    auto result = eval(*program, makeEnvironment(), budget);
+    ASSERT_TRUE(std::holds_alternative<Error>(result));
+    EXPECT_EQ(std::get<Error>(result).message, "evaluation ran out of fuel");
+    EXPECT_TRUE(budget.exhausted());
+    EXPECT_EQ(budget.fuelUsed(), 500);
+}
+
+TEST(BudgetTest, DeadlineStopsLongEvaluation) {
+    using namespace std::chrono_literals;
+    auto program = parse(std::string(FIB) + "fib(40);");
+    auto budget = Budget::withTimeout(20ms);
+    auto start = std::chrono::steady_clock::now();
+    auto result = eval(*program, makeEnvironment(), budget);
+    ASSERT_TRUE(std::holds_alternative<Error>(result));
+    EXPECT_EQ(std::get<Error>(result).message, "evaluation deadline exceeded");
+    EXPECT_LT(std::chrono::steady_clock::now() - start, 1s);
+}
\ No newline at end of file
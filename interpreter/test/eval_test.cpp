@@ -6,8 +6,10 @@
 
 #include <gtest/gtest.h>
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
@@ -125,6 +127,10 @@ TEST(EvalTest, ErrorHandling) {
         {"5; true + false; 5", "unknown operator: true + false"},
         {"if (10 > 1) { true + false; }", "unknown operator: true + false"},
         {"foobar", "identifier not found: foobar"},
+        {"1 / 0", "division by zero: 1 / 0"},
+        {"let f = fn(x) { 10 / x }; f(5) + f(0)", "division by zero: 10 / 0"},
+        {"(-9223372036854775807 - 1) / -1",
+         "integer overflow: -9223372036854775808 / -1"},
         {R"("Hello" - "World")", "unknown operator: Hello - World"}};
     for (const auto &[input, expected] : tests) {
         Object evaluated = testEval(input);
@@ -152,11 +158,11 @@ TEST(EvalTest, FunctionObject) {
     ASSERT_TRUE(std::holds_alternative<Box<Function>>(evaluated));
 
     auto fn = std::get<Box<Function>>(evaluated);
-    ASSERT_EQ(fn->parameters.size(), 1);
-    ASSERT_EQ(tokenLiteral(fn->parameters[0]), "x");
+    ASSERT_EQ(fn->parameters().size(), 1);
+    ASSERT_EQ(tokenLiteral(fn->parameters()[0]), "x");
 
     std::string expectedBody = "{ (x + 2) }";
-    ASSERT_EQ(toString(fn->body), expectedBody);
+    ASSERT_EQ(toString(fn->body()), expectedBody);
 }
 
 TEST(EvalTest, FunctionApplication) {
@@ -178,7 +184,7 @@ TEST(EvalTest, StringLiteral) {
 
     Object evaluated = testEval(input);
     ASSERT_TRUE(std::holds_alternative<String>(evaluated));
-    ASSERT_EQ(std::get<String>(evaluated).value, "Hello, world!");
+    ASSERT_EQ(std::get<String>(evaluated).view(), "Hello, world!");
 }
 
 TEST(EvalTest, StringConcatenation) {
@@ -186,5 +192,207 @@ TEST(EvalTest, StringConcatenation) {
 
     Object evaluated = testEval(input);
     ASSERT_TRUE(std::holds_alternative<String>(evaluated));
-    ASSERT_EQ(std::get<String>(evaluated).value, "Hello, world!");
+    ASSERT_EQ(std::get<String>(evaluated).view(), "Hello, world!");
 }
+
+TEST(EvalTest, StringBuilding) {
+    std::vector<std::pair<std::string, std::string>> tests = {
+        {R"(let range = fn(i, n) { if (i < n) { yield i; range(i + 1, n) } };
+            let s = fold(range(0, 100000), "", fn(s, i) { s + "ab" });
+            [len(s), {s: 1}[s], len(s + s)])",
+         "[200000, 1, 400000]"},
+        {R"(let wrap = fn(s, n) { if (n == 0) { s } else { wrap("<" + s + ">", n - 1) } };
+            wrap("x", 3))",
+         "<<<x>>>"},
+        // Doubling only adds rope nodes, so the length can get this far.
+        {R"(let grow = fn(s, n) { if (n == 0) { s } else { grow(s + s, n - 1) } };
+            len(grow("ab", 40)))",
+         "2199023255552"},
+        {R"(let grow = fn(s, n) { if (n == 0) { s } else { grow(s + s, n - 1) } };
+            grow("ab", 70))",
+         "ERROR: string too long: 4611686018427387904 + 4611686018427387904 characters"},
+    };
+    for (const auto &[input, expected] : tests) {
+        EXPECT_EQ(inspect(testEval(input)), expected) << input;
+    }
+}
+
+TEST(EvalTest, ArrayLiterals) {
+    Object evaluated = testEval("[1, 2 * 2, 3 + 3]");
+    ASSERT_TRUE(std::holds_alternative<Array>(evaluated));
+    const auto &elements = std::get<Array>(evaluated);
+    ASSERT_EQ(elements.size(), 3);
+    testIntegerObject(elements[0], 1);
+    testIntegerObject(elements[1], 4);
+    testIntegerObject(elements[2], 6);
+}
+
+TEST(EvalTest, ArrayIndexExpressions) {
+    std::vector<std::pair<std::string, std::string>> tests = {
+        {"[1, 2, 3][0]", "1"},
+        {"[1, 2, 3][1]", "2"},
+        {"[1, 2, 3][2]", "3"},
+        {"let i = 0; [1][i];", "1"},
+        {"[1, 2, 3][1 + 1];", "3"},
+        {"let myArray = [1, 2, 3]; myArray[2];", "3"},
+        {"let myArray = [1, 2, 3]; myArray[0] + myArray[1] + myArray[2];", "6"},
+        {"let myArray = [1, 2, 3]; let i = myArray[0]; myArray[i]", "2"},
+        {"[1, 2, 3][3]", "null"},
+        {"[1, 2, 3][-1]", "null"},
+        {"[[1, 2], [3]][0]", "[1, 2]"},
+    };
+    for (const auto &[input, expected] : tests) {
+        EXPECT_EQ(inspect(testEval(input)), expected) << input;
+    }
+}
+
+TEST(EvalTest, HashLiterals) {
+    std::vector<std::pair<std::string, std::string>> tests = {
+        {"{}", "{}"},
+        // Entries keep the order they were written in.
+        {R"(let two = "two"; {"one": 10 - 9, two: 1 + 1, "thr" + "ee": 6 / 2, 4: 4,)"
+         R"( true: 5, false: 6})",
+         "{one: 1, two: 2, three: 3, 4: 4, true: 5, false: 6}"},
+        {R"({"a": 1, "b": 2, "a": 3})", "{a: 3, b: 2}"},
+        {R"({"a": [1, 2]})", "{a: [1, 2]}"},
+        {R"({[1]: 2})", "ERROR: unusable as hash key: ARRAY"},
+        {R"({fn(x) { x }: 2})", "ERROR: unusable as hash key: FUNCTION"},
+        {R"({"a": 1 + true})", "ERROR: type mismatch: 1 + true"},
+    };
+    for (const auto &[input, expected] : tests) {
+        EXPECT_EQ(inspect(testEval(input)), expected) << input;
+    }
+}
+
+TEST(EvalTest, HashIndexExpressions) {
+    std::vector<std::pair<std::string, std::string>> tests = {
+        {R"({"foo": 5}["foo"])", "5"},
+        {R"({"foo": 5}["bar"])", "null"},
+        {R"(let key = "foo"; {"foo": 5}[key])", "5"},
+        {R"({}["foo"])", "null"},
+        {"{5: 5}[5]", "5"},
+        {"{true: 5}[true]", "5"},
+        {"{false: 5}[false]", "5"},
+        // Keys of different types never match.
+        {R"({1: "int", true: "bool", "1": "string"}[true])", "bool"},
+        {R"({1: "int", "1": "string"}["1"])", "string"},
+        {R"(let h = {"a": {"b": [1, 2, 3]}}; h["a"]["b"][2])", "3"},
+        {R"({"foo": 5}[fn(x) { x }])", "ERROR: unusable as hash key: FUNCTION"},
+    };
+    for (const auto &[input, expected] : tests) {
+        EXPECT_EQ(inspect(testEval(input)), expected) << input;
+    }
+}
+
+TEST(EvalTest, ArrayBuiltins) {
+    std::vector<std::pair<std::string, std::string>> tests = {
+        {"len([])", "0"},
+        {"len([1, 2, 3])", "3"},
+        {"first([1, 2, 3])", "1"},
+        {"first([])", "null"},
+        {"last([1, 2, 3])", "3"},
+        {"last([])", "null"},
+        {"rest([1, 2, 3])", "[2, 3]"},
+        {"rest(rest(rest([1, 2, 3])))", "[]"},
+        {"rest([])", "null"},
+        {"push([], 1)", "[1]"},
+        {"let a = [1]; let b = push(a, 2); let c = push(a, 3); [a, b, c]",
+         "[[1], [1, 2], [1, 3]]"},
+        {"push(rest([1, 2]), 3)", "[2, 3]"},
+        // Build and sum an array through recursion, the way Monkey loops.
+        {"let build = fn(a, n) { if (n == 0) { a } else { build(push(a, n), n - 1) } };"
+         "let sum = fn(a) { if (len(a) == 0) { 0 } else { first(a) + sum(rest(a)) } };"
+         "sum(build([], 1000))",
+         "500500"},
+        {"len(1)", "ERROR: argument to `len` not supported, got INTEGER"},
+        {"first(1)", "ERROR: argument to `first` not supported, got INTEGER"},
+        {"push(1, 1)", "ERROR: argument to `push` not supported, got INTEGER"},
+        {"1[0]", "ERROR: index operator not supported: INTEGER"},
+    };
+    for (const auto &[input, expected] : tests) {
+        EXPECT_EQ(inspect(testEval(input)), expected) << input;
+    }
+}
+
+TEST(EvalTest, IntegerArrayBuiltins) {
+    std::vector<std::pair<std::string, std::string>> tests = {
+        {"sum([])", "0"},
+        {"sum([1, 2, 3, 4, 5, 6, 7, 8, 9])", "45"},
+        {"dot([1, 2, 3], [4, 5, 6])", "32"},
+        {"min([3, -1, 2])", "-1"},
+        {"max([3, -1, 2])", "3"},
+        {"min([])", "null"},
+        {"mapAdd([1, 2, 3], 10)", "[11, 12, 13]"},
+        {"filterGt([5, 1, 7, 3, 9], 4)", "[5, 7, 9]"},
+        {"filterGt([1, 2], 5)", "[]"},
+        {"let a = filterGt([1, 2, 3], 1); [push(a, 4), push(a, 5)]",
+         "[[2, 3, 4], [2, 3, 5]]"},
+        // Arrays that held other values are unboxed on the way in.
+        {R"(sum(rest(push(["a", 1], 2))))", "3"},
+        {R"(push([1, 2], "x"))", "[1, 2, x]"},
+        {"let a = [1, 2]; let b = push(a, true); [a, b, sum(a)]",
+         "[[1, 2], [1, 2, true], 3]"},
+        {R"(sum([1, "a"]))",
+         "ERROR: argument to `sum` not supported, got ARRAY with a STRING element"},
+        {"sum(1)", "ERROR: argument to `sum` not supported, got INTEGER"},
+        {"mapAdd([1], true)", "ERROR: argument to `mapAdd` not supported, got BOOLEAN"},
+        {"dot([1], [1, 2])", "ERROR: arguments to `dot` differ in length: 1 and 2"},
+    };
+    for (const auto &[input, expected] : tests) {
+        EXPECT_EQ(inspect(testEval(input)), expected) << input;
+    }
+}
+
+// Nesting depth and recursion depth are limited by heap memory, not by the C++ stack.
+TEST(EvalTest, DeepNesting) {
+    constexpr size_t DEPTH = 100000;
+    auto repeat = [](std::string_view s, size_t count) {
+        std::string result;
+        for (size_t i = 0; i < count; ++i) {
+            result += s;
+        }
+        return result;
+    };
+    std::vector<std::pair<std::string, std::string>> tests = {
+        {repeat("(", DEPTH) + "1" + repeat(")", DEPTH), "1"},
+        {repeat("-", DEPTH + 1) + "1", "-1"},
+        {"1" + repeat(" + 1", DEPTH), "100001"},
+        {repeat("1 + (", DEPTH) + "1" + repeat(")", DEPTH), "100001"},
+        {repeat("[", DEPTH) + "1" + repeat("][0]", DEPTH), "1"},
+        {"let x = false; " + repeat("if (x) { 1 } else { ", DEPTH) + "2" +
+             repeat(" }", DEPTH),
+         "2"},
+        {repeat("if (true) { ", DEPTH) + "return 3; 4" + repeat(" }", DEPTH), "3"},
+        {"let count = fn(n) { if (n == 0) { 0 } else { 1 + count(n - 1) } };"
+         "count(200000)",
+         "200000"},
+        {"let f = fn(n) { if (n == 0) { -x } else { f(n - 1) } }; f(200000)",
+         "ERROR: identifier not found: x"},
+    };
+    for (const auto &[input, expected] : tests) {
+        EXPECT_EQ(inspect(testEval(input)), expected) << input.substr(0, 40);
+    }
+}
+
+TEST(EvalTest, InspectIsBoundedAndLinear) {
+    // Each level of nesting adds two characters, not a copy of everything inside it.
+    constexpr size_t DEPTH = 100000;
+    auto nested = testEval(
+        "let wrap = fn(a, n) { if (n == 0) { a } else { wrap([a], n - 1) } };"
+        "wrap({\"k\": [1, \"s\"]}, " +
+        std::to_string(DEPTH) + ")");
+    auto text = inspect(nested);
+    EXPECT_EQ(text.size(), 2 * DEPTH + 11);
+    EXPECT_EQ(text.substr(DEPTH - 1, 13), "[{k: [1, s]}]");
+    EXPECT_EQ(inspect(nested, 6), "[[[[[[...");
+
+    // Only the elements that fit are visited.
+    std::vector<Object> elements(1000000, Object{int64_t{0}});
+    for (size_t i = 0; i < elements.size(); ++i) {
+        elements[i] = static_cast<int64_t>(i);
+    }
+    const Object large = Array::from(std::move(elements));
+    EXPECT_EQ(inspect(large, 10), "[0, 1, 2, ...");
+    EXPECT_EQ(inspect(testEval("[1, 2]"), 6), "[1, 2]");
+    EXPECT_EQ(inspect(testEval("fn(x, y) { x + y }"), 12), "fn(x, y) { (...");
+}
\ No newline at end of file
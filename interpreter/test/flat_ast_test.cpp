@@ -0,0 +1,78 @@
+#include "monkey/ast.h"
+#include "monkey/flat_ast.h"
+#include "monkey/lexer.h"
+#include "monkey/parser.h"
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace monkey; // NOLINT(google-build-using-namespace) - for cleaner test code
+
+namespace {
+
+std::unique_ptr<Program> parse(const std::string &input) {
+    auto parser = Parser(Lexer(input));
+    auto program = parser.parseProgram();
+    EXPECT_TRUE(parser.errors().empty()) << input;
+    return program;
+}
+
+} // namespace
+
+TEST(FlatAstTest, PrintsLikeTheTree) {
+    std::vector<std::string> tests = {
+        "",
+        "let x = 5; x;",
+        "-a * b + !c == d[1 + 2] != true",
+        R"(let s = "two words"; s + "")",
+        "if (x < y) { x } else { if (y) { return y; } }",
+        "let f = fn(a, b, c) { let d = a(b, c); d }; f(1, fn() { 2 }, [3, 4]);",
+        "let g = fn() { yield 1; yield 2; }; g()",
+        R"({"a": 1, true: [], 3: {}}["a"])",
+        "fn() { let x = 1; if (x) { x } }()",
+    };
+    for (const auto &input : tests) {
+        auto program = parse(input);
+        EXPECT_EQ(toString(FlatAst::from(*program)), toString(*program)) << input;
+    }
+}
+
+TEST(FlatAstTest, NodesAreInPostOrder) {
+    auto ast = FlatAst::from(*parse("1 + 2 * x; let y = [x, -x];"));
+    using enum NodeKind;
+    EXPECT_EQ(ast.kinds, (std::vector<NodeKind>{INTEGER, INTEGER, IDENTIFIER, INFIX,
+                                                INFIX, EXPRESSION, IDENTIFIER, IDENTIFIER,
+                                                PREFIX, ARRAY, LET}));
+    EXPECT_EQ(ast.integers, (std::vector<int64_t>{1, 2}));
+    // The root of `2 * x` is node 3, and its operands the two nodes before it.
+    EXPECT_EQ(ast.infixes.left[ast.slots[3]], 1);
+    EXPECT_EQ(ast.infixes.right[ast.slots[3]], 2);
+    EXPECT_EQ(ast.infixes.left[ast.slots[4]], 0);
+    EXPECT_EQ(ast.infixes.right[ast.slots[4]], 3);
+    ASSERT_EQ(ast.statements.count, 2);
+    EXPECT_EQ(ast.lists[ast.statements.first], 5);
+    EXPECT_EQ(ast.lists[ast.statements.first + 1], 10);
+    // `x` is written once for its three uses.
+    EXPECT_EQ(ast.texts, (std::vector<std::string>{"x", "*", "+", "-", "y"}));
+}
+
+TEST(FlatAstTest, DeeplyNestedPrograms) {
+    constexpr size_t DEPTH = 100000;
+    std::string input;
+    for (size_t i = 0; i < DEPTH; ++i) {
+        input += "if (x) { [";
+    }
+    input += "1";
+    for (size_t i = 0; i < DEPTH; ++i) {
+        input += "] }";
+    }
+    auto program = parse(input);
+    auto ast = FlatAst::from(*program);
+    EXPECT_EQ(ast.size(), 5 * DEPTH + 2);
+    EXPECT_EQ(toString(ast), toString(*program));
+}
@@ -0,0 +1,219 @@
+#include "monkey/budget.h"
+#include "monkey/builtins.h"
+#include "monkey/env.h"
+#include "monkey/eval.h"
+#include "monkey/generator.h"
+#include "monkey/lexer.h"
+#include "monkey/memory.h"
+#include "monkey/object.h"
+#include "monkey/parser.h"
+#include "monkey/task.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <span>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+using namespace monkey; // NOLINT(google-build-using-namespace) - for cleaner test code
+
+namespace {
+
+Object evaluate(const std::string &input) {
+    auto parser = Parser(Lexer(input));
+    auto program = parser.parseProgram();
+    EXPECT_TRUE(parser.errors().empty());
+    auto env = makeEnvironment();
+    return eval(*program, env);
+}
+
+// Naturals below n, a map and a filter stage, each a generator that hands over to the
+// generator for the rest of the stream.
+constexpr std::string_view PIPELINE = R"(
+    let range = fn(i, n) { if (i < n) { yield i; range(i + 1, n) } };
+    let map = fn(g, f) {
+        let v = next(g);
+        if (v) { yield f(v); map(g, f) }
+    };
+    let filter = fn(g, keep) {
+        let v = next(g);
+        if (v) {
+            if (keep(v)) { yield v; }
+            filter(g, keep)
+        }
+    };
+)";
+
+// Enough of a caller for generators implemented by the host, which evaluate nothing.
+class HostCall final : public CallContext {
+  public:
+    Object apply(const Object & /*fn*/, std::span<const Object> /*args*/) override {
+        return nullptr;
+    }
+    Object evaluate(const Statement & /*statement*/,
+                    const std::shared_ptr<Environment> & /*env*/) override {
+        return nullptr;
+    }
+    Object evaluate(const Expression & /*expression*/,
+                    const std::shared_ptr<Environment> & /*env*/) override {
+        return nullptr;
+    }
+    Applier fork() override { return nullptr; }
+    TaskGroup &tasks() override { return tasks_; }
+    Error fail(std::string message) override { return Error{std::move(message)}; }
+
+  private:
+    TaskGroup tasks_;
+};
+
+} // namespace
+
+TEST(GeneratorTest, YieldsOnDemand) {
+    std::vector<std::pair<std::string, std::string>> tests = {
+        {"let gen = fn() { yield 1; yield 2; 3 }; gen()", "generator"},
+        {"let gen = fn() { yield 1; yield 2 }; let g = gen(); next(g) + 10 * next(g)",
+         "21"},
+        {"let gen = fn() { yield 1 }; let g = gen(); next(g); next(g)", "null"},
+        {"let gen = fn() { yield 1 }; let g = gen(); next(g); next(g); next(g)", "null"},
+        {"let gen = fn(a, b) { yield a; yield b }; let g = gen(4, 2); next(g) * next(g)",
+         "8"},
+        {"let gen = fn(x) { if (x) { yield 1; } else { yield 2; } yield 3 }; "
+         "let g = gen(false); next(g) + next(g)",
+         "5"},
+        {"let gen = fn() { let x = 1; yield x; let x = x + 1; yield x; return 0; 9 }; "
+         "let g = gen(); let a = next(g); let b = next(g); "
+         "if (next(g)) { 0 } else { a + 10 * b }",
+         "21"},
+        // The body does not run before the first next()
+        {"let gen = fn() { -true; yield 1 }; gen(); 42", "42"},
+    };
+    for (const auto &[input, expected] : tests) {
+        EXPECT_EQ(inspect(evaluate(input)), expected) << input;
+    }
+}
+
+TEST(GeneratorTest, ClosuresSeeLaterBindings) {
+    auto result = evaluate(R"(
+        let counter = fn(start) { yield start; yield start + step };
+        let g = counter(1);
+        let step = 10;
+        next(g) + next(g)
+    )");
+    ASSERT_TRUE(std::holds_alternative<int64_t>(result));
+    EXPECT_EQ(std::get<int64_t>(result), 12);
+}
+
+TEST(GeneratorTest, PipelinesFold) {
+    auto result = evaluate(std::string(PIPELINE) + R"(
+        let even = fn(x) { x / 2 * 2 == x };
+        let squares = map(filter(range(0, 1000), even), fn(x) { x * x });
+        fold(squares, 0, fn(acc, x) { acc + x })
+    )");
+    ASSERT_TRUE(std::holds_alternative<int64_t>(result));
+    int64_t expected = 0;
+    for (int64_t i = 0; i < 1000; i += 2) {
+        expected += i * i;
+    }
+    EXPECT_EQ(std::get<int64_t>(result), expected);
+}
+
+TEST(GeneratorTest, PipelinePeakMemoryDoesNotGrowWithLength) {
+    auto peak = [](int64_t length) {
+        auto parser = Parser(Lexer(std::string(PIPELINE) + R"(
+            let n = )" + std::to_string(length) + R"(;
+            fold(map(range(0, n), fn(x) { x + 1 }), 0, fn(acc, x) { acc + x })
+        )"));
+        auto program = parser.parseProgram();
+        MemoryAccount account;
+        const MemoryScope scope(account);
+        auto result = eval(*program, makeEnvironment());
+        EXPECT_EQ(inspect(result), std::to_string(length * (length + 1) / 2));
+        return account.peak();
+    };
+    auto small = peak(100);
+    auto large = peak(20000);
+    EXPECT_GT(small, 0);
+    EXPECT_LE(large, small + small / 4);
+}
+
+TEST(GeneratorTest, ReturnedGeneratorsRunInConstantStack) {
+    // Each element hands over to a fresh generator; without taking over its frame the
+    // chain of delegations would be 200000 deep.
+    auto result = evaluate(R"(
+        let count = fn(i, n) { if (i < n) { yield 1; count(i + 1, n) } };
+        fold(count(0, 200000), 0, fn(acc, x) { acc + x })
+    )");
+    ASSERT_TRUE(std::holds_alternative<int64_t>(result));
+    EXPECT_EQ(std::get<int64_t>(result), 200000);
+}
+
+TEST(GeneratorTest, ReferencedGeneratorsAreDelegatedTo) {
+    // `inner` is still bound, so `g` pulls from it instead of taking its frame; both
+    // handles advance the same generator.
+    auto result = evaluate(R"(
+        let gen = fn(a, b) { yield a; yield b };
+        let inner = gen(2, 3);
+        let outer = fn() { yield 1; inner };
+        let g = outer();
+        let first = next(g);
+        let second = next(g);
+        let third = next(inner);
+        if (next(g)) { -1 } else { first + 10 * second + 100 * third }
+    )");
+    ASSERT_TRUE(std::holds_alternative<int64_t>(result));
+    EXPECT_EQ(std::get<int64_t>(result), 321);
+}
+
+TEST(GeneratorTest, Errors) {
+    std::vector<std::pair<std::string, std::string>> tests = {
+        {"yield 1", "yield outside of a generator"},
+        {"let f = fn() { let x = if (true) { yield 1 }; x }; f()",
+         "yield outside of a generator"},
+        {"next(1)", "argument to `next` not supported, got INTEGER"},
+        {"let gen = fn() { yield 1 }; fold(gen(), 0, 1)",
+         "argument to `fold` not supported, got INTEGER"},
+        {"let gen = fn() { yield 1; -true }; let g = gen(); next(g); next(g)",
+         "unknown operator: -true"},
+        {"let gen = fn() { yield next(g) }; let g = gen(); next(g)",
+         "generator is already running"},
+        {"let gen = fn() { yield 1; yield true }; fold(gen(), 0, fn(a, x) { a + x })",
+         "type mismatch: a + x"},
+    };
+    for (const auto &[input, expected] : tests) {
+        auto result = evaluate(input);
+        ASSERT_TRUE(std::holds_alternative<Error>(result)) << input;
+        EXPECT_EQ(std::get<Error>(result).message, expected) << input;
+    }
+}
+
+TEST(GeneratorTest, FoldSpendsTheBudget) {
+    auto parser = Parser(Lexer(R"(
+        let forever = fn(i) { yield i; forever(i + 1) };
+        fold(forever(0), 0, fn(acc, x) { acc + x })
+    )"));
+    auto program = parser.parseProgram();
+    Budget budget(10000);
+    auto result = eval(*program, makeEnvironment(), budget);
+    ASSERT_TRUE(std::holds_alternative<Error>(result));
+    EXPECT_EQ(std::get<Error>(result).message, "evaluation ran out of fuel");
+}
+TEST(GeneratorTest, ThrowingBodyFinishesTheGenerator) {
+    int calls = 0;
+    GeneratorState generator([&calls]() -> std::optional<Object> {
+        if (++calls == 1) {
+            throw std::bad_alloc();
+        }
+        return int64_t{1};
+    });
+    HostCall context;
+    EXPECT_THROW(generator.next(context), std::bad_alloc);
+    // Not "generator is already running".
+    EXPECT_FALSE(generator.next(context).has_value());
+    EXPECT_EQ(calls, 1);
+}
@@ -0,0 +1,148 @@
+#include "monkey/ast.h"
+#include "monkey/hash_cons.h"
+#include "monkey/interpreter.h"
+#include "monkey/lexer.h"
+#include "monkey/object.h"
+#include "monkey/parser.h"
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <variant>
+#include <vector>
+
+using namespace monkey; // NOLINT(google-build-using-namespace) - for cleaner test code
+
+namespace {
+
+std::unique_ptr<Program> parse(const std::string &input) {
+    auto parser = Parser(Lexer(input));
+    auto program = parser.parseProgram();
+    EXPECT_TRUE(parser.errors().empty()) << input;
+    return program;
+}
+
+const Expression &expression(const Program &program, size_t i) {
+    return std::get<ExpressionStatement>(program.statements[i]).expression;
+}
+
+// The cell of the boxed node of statement `i`.
+template <typename Node>
+const Node *cell(const Program &program, size_t i) {
+    return &*std::get<Box<Node>>(expression(program, i));
+}
+
+template <typename Node>
+const Constant *constant(const Program &program, size_t i) {
+    return cell<Node>(program, i)->constant.get();
+}
+
+std::string run(const std::string &source, CompileOptions options) {
+    Interpreter interpreter;
+    return inspect(interpreter.run(*compile(source, options)));
+}
+
+} // namespace
+
+TEST(HashConsTest, SharesIdenticalSubtrees) {
+    auto program = parse(R"(
+        x + y * 2;
+        x + y * 2;
+        f(x + y * 2, "some text");
+        g("some text");
+        x + y * 3;
+    )");
+    auto text = toString(*program);
+    auto stats = hashCons(*program);
+    EXPECT_EQ(toString(*program), text);
+    // Three copies of `x + y * 2`, of two nodes each, two calls and `x + y * 3`.
+    EXPECT_EQ(stats.nodes, 10);
+    EXPECT_EQ(stats.shared, 4);
+    const auto *sum = cell<InfixExpression>(*program, 0);
+    const auto &first = cell<CallExpression>(*program, 2)->arguments;
+    const auto &second = cell<CallExpression>(*program, 3)->arguments;
+    EXPECT_EQ(cell<InfixExpression>(*program, 1), sum);
+    EXPECT_EQ(&*std::get<Box<InfixExpression>>(first[0]), sum);
+    EXPECT_NE(cell<InfixExpression>(*program, 4), sum);
+    EXPECT_EQ(std::get<StringLiteral>(first[1]).value,
+              std::get<StringLiteral>(second[0]).value);
+}
+
+TEST(HashConsTest, CachesConstantValues) {
+    auto program = parse(R"(
+        1 + 2 * 3;
+        -(4 - 5) == 1;
+        [10, 20][1];
+        {"a": "b" + "c"}["a"];
+        [1][5];
+        1 + true;
+        x + 1;
+        7 / (1 - 1);
+        [x][0];
+        (-9223372036854775807 - 1) / -1;
+    )");
+    auto stats = hashCons(*program);
+    EXPECT_EQ(stats.constants, 13);
+    EXPECT_EQ(*constant<InfixExpression>(*program, 0), Constant(int64_t{7}));
+    EXPECT_EQ(*constant<InfixExpression>(*program, 1), Constant(true));
+    EXPECT_EQ(*constant<IndexExpression>(*program, 2), Constant(int64_t{20}));
+    EXPECT_EQ(*std::get<std::shared_ptr<const std::string>>(
+                  *constant<IndexExpression>(*program, 3)),
+              "bc");
+    EXPECT_EQ(*constant<IndexExpression>(*program, 4), Constant(nullptr));
+    // Errors, divisions by zero among them, are left to the evaluation, as is whatever
+    // names a variable.
+    EXPECT_EQ(constant<InfixExpression>(*program, 5), nullptr);
+    EXPECT_EQ(constant<InfixExpression>(*program, 6), nullptr);
+    EXPECT_EQ(constant<InfixExpression>(*program, 7), nullptr);
+    EXPECT_EQ(constant<IndexExpression>(*program, 8), nullptr);
+    EXPECT_EQ(constant<InfixExpression>(*program, 9), nullptr);
+}
+
+TEST(HashConsTest, EvaluatesLikeTheTree) {
+    std::vector<std::string> tests = {
+        "1 + 2 * 3 - -4",
+        R"(let s = "ab" + "cd"; s + s)",
+        R"(len("some text" + "some text") + {"k": [1, 2][1]}["k"])",
+        "if (1 < 2) { 10 } else { 20 }",
+        "let f = fn(n) { if (n < 1) { 0 } else { n * 2 + 1 } }; f(3) + f(3)",
+        "let mk = fn(n) { fn(x) { x + n } }; mk(1)(2) + mk(10)(2)",
+        "let mk = fn(n) { fn(x) { x + n } }; let a = mk(1); let b = mk(5); [a(0), b(0)]",
+        "[1][5]",
+        "[[1, 2], [1, 2]][1]",
+        "1 + true",
+        "-true",
+        "let f = fn() { 1 / 0 }; 2",
+        "1 / 0",
+        "let g = fn() { yield 1 + 1; yield 1 + 1; }(); [next(g), next(g)]",
+    };
+    for (const auto &source : tests) {
+        EXPECT_EQ(run(source, {.hashCons = true}), run(source, {})) << source;
+    }
+}
+
+TEST(HashConsTest, DeeplyNestedPrograms) {
+    constexpr size_t DEPTH = 100000;
+    std::string sum;
+    std::string arrays;
+    for (size_t i = 0; i < DEPTH; ++i) {
+        sum += "1 + (";
+        arrays += "if (x) { [";
+    }
+    sum += "1";
+    arrays += "1";
+    for (size_t i = 0; i < DEPTH; ++i) {
+        sum += ")";
+        arrays += "] }";
+    }
+    auto program = parse(sum + ";" + arrays);
+    auto text = toString(*program);
+    auto stats = hashCons(*program);
+    EXPECT_EQ(stats.constants, DEPTH);
+    EXPECT_EQ(*constant<InfixExpression>(*program, 0),
+              Constant(static_cast<int64_t>(DEPTH + 1)));
+    EXPECT_EQ(toString(*program), text);
+}
@@ -0,0 +1,112 @@
+#include "monkey/hash_map.h"
+#include "monkey/memory.h"
+#include "monkey/object.h"
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+
+using namespace monkey; // NOLINT(google-build-using-namespace) - for cleaner test code
+
+namespace {
+
+struct Mixed {
+    uint64_t operator()(uint64_t key) const { return key * 0x9e3779b97f4a7c15; }
+};
+
+// Every key lands in the same group with the same control byte, so each lookup has to
+// walk the whole probe sequence and compare keys.
+struct Colliding {
+    uint64_t operator()(uint64_t /*key*/) const { return 42; }
+};
+
+template <typename Hasher>
+using Map = SwissMap<uint64_t, uint64_t, Hasher, std::equal_to<>>;
+
+} // namespace
+
+TEST(SwissMapTest, InsertAndFindThroughGrowth) {
+    Map<Mixed> map;
+    EXPECT_EQ(map.find(1), nullptr);
+    for (uint64_t i = 0; i < 100000; ++i) {
+        ASSERT_TRUE(map.insert(i, i * 2));
+        ASSERT_EQ(map.size(), i + 1);
+    }
+    for (uint64_t i = 0; i < 100000; ++i) {
+        const auto *value = map.find(i);
+        ASSERT_NE(value, nullptr) << i;
+        ASSERT_EQ(*value, i * 2);
+    }
+    EXPECT_EQ(map.find(100000), nullptr);
+}
+
+TEST(SwissMapTest, InsertReplacesAndKeepsOrder) {
+    Map<Mixed> map;
+    map.insert(3, 30);
+    map.insert(1, 10);
+    map.insert(2, 20);
+    EXPECT_FALSE(map.insert(1, 11));
+    ASSERT_EQ(map.size(), 3);
+    auto entries = map.entries();
+    EXPECT_EQ(entries[0], std::make_pair(uint64_t{3}, uint64_t{30}));
+    EXPECT_EQ(entries[1], std::make_pair(uint64_t{1}, uint64_t{11}));
+    EXPECT_EQ(entries[2], std::make_pair(uint64_t{2}, uint64_t{20}));
+}
+
+TEST(SwissMapTest, CollidingHashes) {
+    Map<Colliding> map;
+    for (uint64_t i = 0; i < 500; ++i) {
+        map.insert(i, i + 1);
+    }
+    for (uint64_t i = 0; i < 500; ++i) {
+        ASSERT_EQ(*map.find(i), i + 1) << i;
+    }
+    EXPECT_EQ(map.find(500), nullptr);
+}
+
+TEST(SwissMapTest, ReserveAvoidsRehashing) {
+    MemoryAccount account;
+    const MemoryScope scope(account);
+    Map<Mixed> map(1000);
+    auto reserved = account.live();
+    for (uint64_t i = 0; i < 1000; ++i) {
+        map.insert(i, i);
+    }
+    EXPECT_EQ(account.live(), reserved);
+}
+
+TEST(SwissMapTest, ObjectKeys) {
+    HashTable table;
+    table.insert(*hashKey(int64_t{1}), String("int"));
+    table.insert(*hashKey(true), String("bool"));
+    table.insert(*hashKey(String("1")), String("string"));
+
+    // A slice hashes and compares like an owned string with the same characters.
+    auto owner = std::make_shared<const std::string>("x1y");
+    auto slice = String(owner, std::string_view(*owner).substr(1, 1));
+    const auto *found = table.find(*hashKey(slice));
+    ASSERT_NE(found, nullptr);
+    EXPECT_EQ(inspect(*found), "string");
+    EXPECT_EQ(inspect(*table.find(*hashKey(int64_t{1}))), "int");
+    EXPECT_EQ(inspect(*table.find(*hashKey(true))), "bool");
+    EXPECT_EQ(table.find(*hashKey(false)), nullptr);
+    EXPECT_FALSE(hashKey(nullptr).has_value());
+}
+TEST(SwissMapTest, DeeplyNestedHashesFreeWithoutRecursion) {
+    MemoryAccount account;
+    const MemoryScope scope(account);
+    {
+        Object nested = int64_t{1};
+        for (int i = 0; i < 100000; ++i) {
+            auto table = makeReclaimed<HashTable>(size_t{1});
+            table->insert(*hashKey(int64_t{1}), std::move(nested));
+            nested = Hash{std::move(table)};
+        }
+    }
+    EXPECT_EQ(account.live(), 0);
+}
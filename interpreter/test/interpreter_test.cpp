@@ -0,0 +1,106 @@
+#include "monkey/interpreter.h"
+#include "monkey/object.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace monkey; // NOLINT(google-build-using-namespace) - for cleaner test code
+
+TEST(InterpreterTest, RunsCompiledProgram) {
+    auto program = compile("let double = fn(x) { x * 2 }; double(21);");
+    ASSERT_TRUE(program->ok());
+
+    Interpreter interpreter;
+    auto result = interpreter.run(*program);
+    ASSERT_TRUE(std::holds_alternative<int64_t>(result));
+    EXPECT_EQ(std::get<int64_t>(result), 42);
+    EXPECT_GT(interpreter.memory().peak(), 0);
+}
+
+TEST(InterpreterTest, ParseErrorsAreReturnedAsError) {
+    auto program = compile("let = 5;");
+    EXPECT_FALSE(program->ok());
+
+    Interpreter interpreter;
+    auto result = interpreter.run(*program);
+    ASSERT_TRUE(std::holds_alternative<Error>(result));
+    EXPECT_TRUE(std::get<Error>(result).message.starts_with("parse errors: "));
+}
+
+TEST(InterpreterTest, GlobalsPersistAcrossRunsAndDefine) {
+    Interpreter interpreter;
+    interpreter.define("input", int64_t{5});
+    interpreter.run(*compile("let square = fn(x) { x * x };"));
+    auto result = interpreter.run(*compile("square(input) + 1"));
+    ASSERT_TRUE(std::holds_alternative<int64_t>(result));
+    EXPECT_EQ(std::get<int64_t>(result), 26);
+}
+
+TEST(InterpreterTest, OptionsBoundEachRun) {
+    auto program = compile("let loop = fn(n) { loop(n + 1) }; loop(0);");
+    InterpreterOptions options;
+    options.fuel = 200;
+    Interpreter interpreter(options);
+    auto result = interpreter.run(*program);
+    ASSERT_TRUE(std::holds_alternative<Error>(result));
+    EXPECT_EQ(std::get<Error>(result).message, "evaluation ran out of fuel");
+}
+
+TEST(InterpreterTest, RunsAgainAfterExceedingTheQuota) {
+    InterpreterOptions options;
+    options.memoryQuota = 64 * 1024;
+    Interpreter interpreter(options);
+    auto result = interpreter.run(*compile(R"(
+        let grow = fn(s, n) {
+            if (n == 0) { return s; }
+            let t = s + s;
+            {t: true};
+            grow(t, n - 1)
+        };
+        grow("0123456789abcdef", 24);
+    )"));
+    ASSERT_TRUE(std::holds_alternative<Error>(result));
+    EXPECT_EQ(std::get<Error>(result).message, "evaluation exceeded its memory quota");
+    EXPECT_LE(interpreter.memory().peak(), options.memoryQuota);
+
+    result = interpreter.run(*compile(R"(len(grow("ab", 3)))"));
+    ASSERT_TRUE(std::holds_alternative<int64_t>(result));
+    EXPECT_EQ(std::get<int64_t>(result), 16);
+}
+
+TEST(InterpreterTest, SharedProgramRunsConcurrently) {
+    auto program = compile(R"(
+        let fib = fn(n) { if (n < 2) { return n; } fib(n - 1) + fib(n - 2) };
+        let greet = fn(name) { "hello " + name };
+        greet("monkey");
+        fib(15);
+    )");
+    ASSERT_TRUE(program->ok());
+
+    constexpr int THREADS = 8;
+    constexpr int RUNS = 20;
+    std::vector<int64_t> results(THREADS);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < THREADS; ++t) {
+        workers.emplace_back([&program, &results, t] {
+            for (int i = 0; i < RUNS; ++i) {
+                Interpreter interpreter;
+                auto result = interpreter.run(*program);
+                if (std::holds_alternative<int64_t>(result)) {
+                    results[static_cast<size_t>(t)] += std::get<int64_t>(result);
+                }
+            }
+        });
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    for (auto result : results) {
+        EXPECT_EQ(result, 610 * RUNS);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,189 @@
+#include "monkey/interpreter.h"
+#include "monkey/io.h"
+#include "monkey/object.h"
+#include "monkey/task.h"
+
+#include <fmt/format.h>
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+using namespace monkey; // NOLINT(google-build-using-namespace) - for cleaner test code
+
+namespace {
+
+class IoTest : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        const auto *test = ::testing::UnitTest::GetInstance()->current_test_info();
+        dir_ = std::filesystem::temp_directory_path() /
+               (std::string("monkey_io_test_") + test->name());
+        std::filesystem::create_directories(dir_);
+    }
+
+    void TearDown() override { std::filesystem::remove_all(dir_); }
+
+    [[nodiscard]] std::string path(const std::string &name) const {
+        return (dir_ / name).string();
+    }
+
+    std::string file(const std::string &name, const std::string &contents) {
+        std::ofstream(path(name), std::ios::binary) << contents;
+        return path(name);
+    }
+
+    static std::string contents(const std::string &path) {
+        std::ifstream in(path, std::ios::binary);
+        std::stringstream text;
+        text << in.rdbuf();
+        return text.str();
+    }
+
+    static Object run(const std::string &source) {
+        Interpreter interpreter;
+        return interpreter.run(*compile(source));
+    }
+
+  private:
+    std::filesystem::path dir_;
+};
+
+} // namespace
+
+TEST_F(IoTest, WriteThenRead) {
+    auto path = this->path("hello.txt");
+    auto result = run(fmt::format(R"(
+        let written = await(writeFile("{0}", "hello, " + "world"));
+        let text = await(readFile("{0}"));
+        if (written == len(text)) {{ text }} else {{ written }}
+    )",
+                                  path));
+    EXPECT_EQ(inspect(result), "hello, world");
+    EXPECT_EQ(contents(path), "hello, world");
+}
+
+TEST_F(IoTest, ReadsAreInFlightTogether) {
+    auto a = file("a.txt", "left");
+    auto b = file("b.txt", "right");
+    auto result = run(fmt::format(R"(
+        let a = readFile("{}");
+        let b = readFile("{}");
+        await(b) + await(a)
+    )",
+                                  a, b));
+    EXPECT_EQ(inspect(result), "rightleft");
+}
+
+TEST_F(IoTest, ManyRequestsFromTheHost) {
+    std::vector<std::string> paths;
+    for (size_t i = 0; i < 1000; ++i) {
+        paths.push_back(file(fmt::format("{}.txt", i), std::string(i % 97, 'x')));
+    }
+    std::vector<Task> tasks;
+    for (const auto &path : paths) {
+        tasks.push_back(io().readFile(path));
+    }
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        auto result = tasks[i].state->await();
+        ASSERT_TRUE(std::holds_alternative<String>(result)) << inspect(result);
+        EXPECT_EQ(std::get<String>(result).size(), i % 97);
+    }
+}
+
+TEST_F(IoTest, LargeFilesReadCompletely) {
+    std::string big;
+    for (int i = 0; big.size() < 3 * 1024 * 1024; ++i) {
+        big += fmt::format("line {}\n", i);
+    }
+    auto path = file("big.txt", big);
+    auto result = io().readFile(path).state->await();
+    ASSERT_TRUE(std::holds_alternative<String>(result));
+    EXPECT_TRUE(std::get<String>(result).view() == big);
+}
+
+TEST_F(IoTest, ReadsFailOverTheQuota) {
+    auto path = file("big.txt", std::string(1024 * 1024, 'x'));
+    InterpreterOptions options;
+    options.memoryQuota = 64 * 1024;
+    Interpreter interpreter(options);
+    auto result =
+        interpreter.run(*compile(fmt::format(R"(len(await(readFile("{}"))))", path)));
+    ASSERT_TRUE(std::holds_alternative<Error>(result));
+    EXPECT_EQ(std::get<Error>(result).message,
+              fmt::format("cannot read {}: Cannot allocate memory", path));
+}
+
+TEST_F(IoTest, ReadLines) {
+    auto path = file("lines.txt", "one\ntwo\r\n\nthree");
+    auto result = run(fmt::format(R"(
+        let lines = await(readLines("{}"));
+        fold(lines, "", fn(acc, line) {{ acc + line + "|" }})
+    )",
+                                  path));
+    EXPECT_EQ(inspect(result), "one|two||three|");
+}
+
+TEST_F(IoTest, MappedLines) {
+    std::vector<std::pair<std::string, std::string>> tests = {
+        {"one\ntwo\r\n\nthree", "one|two||three|"},
+        {"trailing\n", "trailing|"},
+        {"", ""},
+    };
+    for (const auto &[text, expected] : tests) {
+        auto result = run(fmt::format(R"(
+            fold(lines("{}"), "", fn(acc, line) {{ acc + line + "|" }})
+        )",
+                                      file("lines.txt", text)));
+        EXPECT_EQ(inspect(result), expected) << text;
+    }
+}
+
+TEST_F(IoTest, MappedLinesAreSlicesThatOutliveTheGenerator) {
+    auto path = file("lines.txt", "first\nsecond\n");
+    Object first;
+    {
+        auto generator = mapLines(path);
+        ASSERT_TRUE(std::holds_alternative<Generator>(generator));
+        Interpreter interpreter;
+        interpreter.define("g", generator);
+        first = interpreter.run(*compile("next(g)"));
+    }
+    ASSERT_TRUE(std::holds_alternative<String>(first));
+    const auto &line = std::get<String>(first);
+    EXPECT_NE(line.owner(), nullptr);
+    EXPECT_EQ(line.view(), "first");
+}
+
+TEST_F(IoTest, EvaluationWaitsForPendingWrites) {
+    auto path = this->path("late.txt");
+    run(fmt::format(R"(writeFile("{}", "done"); 1)", path));
+    EXPECT_EQ(contents(path), "done");
+}
+
+TEST_F(IoTest, Errors) {
+    auto missing = path("missing.txt");
+    std::vector<std::pair<std::string, std::string>> tests = {
+        {fmt::format(R"(await(readFile("{}")))", missing),
+         fmt::format("cannot open {}: No such file or directory", missing)},
+        {fmt::format(R"(await(writeFile("{}/nowhere/x", "")))", missing),
+         fmt::format("cannot open {}/nowhere/x: No such file or directory", missing)},
+        {"readFile(1)", "argument to `readFile` not supported, got INTEGER"},
+        {R"(writeFile("x", 1))", "argument to `writeFile` not supported, got INTEGER"},
+        {"len(1)", "argument to `len` not supported, got INTEGER"},
+        {fmt::format(R"(lines("{}"))", missing),
+         fmt::format("cannot open {}: No such file or directory", missing)},
+        {"lines(1)", "argument to `lines` not supported, got INTEGER"},
+    };
+    for (const auto &[input, expected] : tests) {
+        auto result = run(input);
+        ASSERT_TRUE(std::holds_alternative<Error>(result)) << input;
+        EXPECT_EQ(std::get<Error>(result).message, expected) << input;
+    }
+}
\ No newline at end of file
@@ -5,7 +5,9 @@
 #include <gtest/gtest.h>
 #include <magic_enum/magic_enum_format.hpp>
 
+#include <cstddef>
 #include <string>
+#include <string_view>
 #include <vector>
 
 using namespace monkey; // NOLINT(google-build-using-namespace) - for cleaner test code
@@ -32,6 +34,8 @@ if (5 < 10) {
 10 != 9;
 "foobar"
 "foo bar"
+[1, 2];
+{"foo": "bar"}
 )";
 
     std::vector<Token> expectedTokens{
@@ -82,6 +86,14 @@ if (5 < 10) {
         {TokenType::INT, "9"},         {TokenType::SEMICOLON, ";"},
         {TokenType::STRING, "foobar"}, {TokenType::STRING, "foo bar"},
 
+        {TokenType::LBRACKET, "["},    {TokenType::INT, "1"},
+        {TokenType::COMMA, ","},       {TokenType::INT, "2"},
+        {TokenType::RBRACKET, "]"},    {TokenType::SEMICOLON, ";"},
+
+        {TokenType::LBRACE, "{"},      {TokenType::STRING, "foo"},
+        {TokenType::COLON, ":"},       {TokenType::STRING, "bar"},
+        {TokenType::RBRACE, "}"},
+
         {TokenType::EOF_TOKEN, ""},
     };
 
@@ -97,3 +109,59 @@ if (5 < 10) {
                            expectedToken.literal, token.literal);
     }
 }
+
+// Runs of whitespace, letters and digits are skipped 16 bytes at a time where the input
+// allows; runs of every length, ending anywhere, must lex the same as byte by byte.
+TEST(LexerTest, LongRuns) {
+    for (size_t length = 1; length <= 40; ++length) {
+        const std::string name(length, 'a');
+        const std::string number(length, '7');
+        const std::string space(length, ' ');
+        for (const auto &input : {name + space + number + "\t\r\n" + name + "_Z",
+                                  space + "\"" + name + "\"" + number + space + name}) {
+            Lexer lexer(input);
+            std::vector<Token> tokens;
+            for (auto token = lexer.nextToken(); token.type != TokenType::EOF_TOKEN;
+                 token = lexer.nextToken()) {
+                tokens.push_back(token);
+            }
+            ASSERT_EQ(tokens.size(), 3) << input;
+            if (input.front() == ' ') {
+                EXPECT_EQ(tokens[0].literal, name);
+                EXPECT_EQ(tokens[0].type, TokenType::STRING);
+                EXPECT_EQ(tokens[1].literal, number);
+                EXPECT_EQ(tokens[2].literal, name);
+            } else {
+                EXPECT_EQ(tokens[0].literal, name);
+                EXPECT_EQ(tokens[1].literal, number);
+                EXPECT_EQ(tokens[1].type, TokenType::INT);
+                EXPECT_EQ(tokens[2].literal, name + "_Z");
+            }
+        }
+    }
+
+    // Bytes just outside each class end its run.
+    Lexer lexer("az@AZ[_`{09:/");
+    std::vector<std::string> literals;
+    for (auto token = lexer.nextToken(); token.type != TokenType::EOF_TOKEN;
+         token = lexer.nextToken()) {
+        literals.push_back(token.literal);
+    }
+    EXPECT_EQ(literals, (std::vector<std::string>{"az", "@", "AZ", "[", "_", "`", "{",
+                                                  "09", ":", "/"}));
+}
+
+TEST(LexerTest, Keywords) {
+    for (const auto &[word, type] : keywords::LIST) {
+        EXPECT_EQ(lookupIdent(word), type) << word;
+        Lexer lexer(std::string(word) + " " + std::string(word) + "s");
+        EXPECT_EQ(lexer.nextToken().type, type) << word;
+        EXPECT_EQ(lexer.nextToken().type, TokenType::IDENT) << word;
+    }
+    // Identifiers that share a keyword's length and first and last characters, or are
+    // too short or long to be one.
+    for (std::string_view ident : {"f", "fa", "fun", "lat", "tree", "fable", "iF", "esle",
+                                   "rotten", "yeild", "Let", "returns", "_", ""}) {
+        EXPECT_EQ(lookupIdent(ident), TokenType::IDENT) << ident;
+    }
+}
@@ -0,0 +1,207 @@
+#include "monkey/interpreter.h"
+#include "monkey/memo.h"
+#include "monkey/object.h"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+using namespace monkey; // NOLINT(google-build-using-namespace) - for cleaner test code
+
+namespace {
+
+std::string run(const std::string &source) {
+    Interpreter interpreter;
+    return inspect(interpreter.run(*compile(source)));
+}
+
+MemoKey key(int64_t value) {
+    const std::array<Object, 1> args{value};
+    return *MemoKey::from(args);
+}
+
+} // namespace
+
+TEST(MemoTest, RecursiveCallsGoThroughTheTable) {
+    // Exponential without the table: fib(90) makes about 10^19 calls.
+    EXPECT_EQ(run(R"(
+        let fib = memo(fn(n) { if (n < 2) { n } else { fib(n - 1) + fib(n - 2) } });
+        fib(90)
+    )"),
+              "2880067194370816120");
+    EXPECT_EQ(run(R"(
+        let fib = memo(fn(n) { if (n < 2) { n } else { fib(n - 1) + fib(n - 2) } });
+        fib(30);
+        fib(30);
+        memoStats(fib)
+    )"),
+              "{hits: 29, misses: 31, evictions: 0, size: 31, capacity: 65536}");
+}
+
+TEST(MemoTest, KeysAreArgumentTuples) {
+    // Lattice paths through a 16x16 grid; 2^32 steps without the table.
+    EXPECT_EQ(run(R"(
+        let paths = memo(fn(r, c) {
+            if (r == 0) { return 1; }
+            if (c == 0) { return 1; }
+            paths(r - 1, c) + paths(r, c - 1)
+        });
+        paths(16, 16)
+    )"),
+              "601080390");
+    EXPECT_EQ(run(R"(
+        let tag = memo(fn(s, b) { if (b) { s + "!" } else { s } });
+        [tag("a", true), tag("a", false), tag("a", true), memoStats(tag)["size"]]
+    )"),
+              "[a!, a, a!, 2]");
+}
+
+TEST(MemoTest, OtherArgumentsAreNotCached) {
+    EXPECT_EQ(run(R"(
+        let size = memo(fn(a) { len(a) });
+        [size([1, 2]), size([1, 2]), memoStats(size)["size"]]
+    )"),
+              "[2, 2, 0]");
+}
+
+TEST(MemoTest, ErrorsAreNotCached) {
+    Interpreter interpreter;
+    interpreter.run(*compile("let f = memo(fn(x) { if (x) { -true } else { 1 } });"));
+    for (int i = 0; i < 2; ++i) {
+        EXPECT_EQ(inspect(interpreter.run(*compile("f(true)"))),
+                  "ERROR: unknown operator: -true");
+    }
+    EXPECT_EQ(inspect(interpreter.run(*compile("memoStats(f)"))),
+              "{hits: 0, misses: 2, evictions: 0, size: 0, capacity: 65536}");
+}
+
+TEST(MemoTest, ImpureFunctionsAreRejected) {
+    std::vector<std::pair<std::string, std::string>> tests = {
+        {"memo(fn(ch) { send(ch, 1) })", "cannot memoize a function that calls `send`"},
+        {"memo(fn(n) { yield n; })", "cannot memoize a generator function"},
+        {"let log = fn(x) { writeFile(\"log\", x) }; memo(fn(x) { log(x); x })",
+         "cannot memoize a function that calls `writeFile`"},
+        {"memo(fn(x) { let g = fn() { spawn(fn() { 1 }) }; x })",
+         "cannot memoize a function that calls `spawn`"},
+        {"memo(len)", "argument to `memo` not supported, got BUILTIN"},
+        {"let s = send; memo(fn(ch, x) { s(ch, x) })",
+         "cannot memoize a function that calls `send`"},
+        {"let io = fn() { readFile }; memo(fn(p) { io()(p) })",
+         "cannot memoize a function that calls `readFile`"},
+        {"memo(fn(m) { memoStats(m)[\"hits\"] })",
+         "cannot memoize a function that calls `memoStats`"},
+        {"let r = fn(i, n) { if (i < n) { yield i; r(i + 1, n) } }; let g = r(0, 10); "
+         "memo(fn(x) { fold(g, 0, fn(a, b) { a + b }) + x })",
+         "cannot memoize a function that calls `fold`"},
+        {"let mk = fn() { fn(n) { yield n; } }; memo(fn(n) { mk()(n) })",
+         "cannot memoize a generator function"},
+        {"memo(fn(x) { x }, 0)", "memo capacity must be a positive integer, got 0"},
+        {"memoStats(fn(x) { x })", "argument to `memoStats` not supported, got FUNCTION"},
+    };
+    for (const auto &[input, expected] : tests) {
+        EXPECT_EQ(run(input), "ERROR: " + expected) << input;
+    }
+    // Parameters and local bindings shadow the builtins they are named after.
+    EXPECT_EQ(run("let f = memo(fn(send) { let next = send + 1; next }); f(1)"), "2");
+    // Mutual recursion through the closure terminates.
+    EXPECT_EQ(run(R"(
+        let even = fn(n) { if (n == 0) { true } else { odd(n - 1) } };
+        let odd = fn(n) { if (n == 0) { false } else { even(n - 1) } };
+        memo(even)(10)
+    )"),
+              "true");
+    // Deeply nested bodies are walked without overflowing the stack.
+    constexpr size_t DEPTH = 100000;
+    EXPECT_EQ(run("memo(fn(ch) { " + std::string(DEPTH, '(') + "send(ch, 1)" +
+                  std::string(DEPTH, ')') + " })"),
+              "ERROR: cannot memoize a function that calls `send`");
+}
+
+TEST(MemoTest, RebindingTheClosureIsNotServedStale) {
+    EXPECT_EQ(run(R"(
+        let k = 1;
+        let f = memo(fn(n) { n + k });
+        let a = f(1);
+        let k = 2;
+        [a, f(1), fn(n) { n + k }(1)]
+    )"),
+              "[2, 3, 3]");
+    // Through a function the memoized one calls, and through shadowing in a frame.
+    EXPECT_EQ(run(R"(
+        let g = fn(n) { n };
+        let f = memo(fn(n) { g(n) });
+        let a = f(1);
+        let g = fn(n) { n * 10 };
+        [a, f(1)]
+    )"),
+              "[1, 10]");
+    EXPECT_EQ(run(R"(
+        let k = 1;
+        let h = fn() {
+            let f = memo(fn(n) { n + k });
+            let a = f(1);
+            let k = 5;
+            [a, f(1)]
+        };
+        h()
+    )"),
+              "[2, 6]");
+    // A rebinding that makes the function impure stops caching its calls.
+    Interpreter interpreter;
+    interpreter.run(*compile(R"(
+        let g = fn(n) { n };
+        let f = memo(fn(n) { g(n) });
+        f(1);
+        let g = fn(n) { let t = spawn(fn() { n }); n };
+    )"));
+    EXPECT_EQ(inspect(interpreter.run(*compile("[f(2), f(2), memoStats(f)[\"size\"]]"))),
+              "[2, 2, 0]");
+}
+
+TEST(MemoTest, MemosWorkInTasks) {
+    EXPECT_EQ(run(R"(
+        let square = memo(fn(x) { x * x });
+        pmap([1, 2, 3, 2, 1], square)
+    )"),
+              "[1, 4, 9, 4, 1]");
+}
+
+TEST(MemoTableTest, EvictsTheLeastRecentlyUsed) {
+    MemoTable table(nullptr, 2);
+    table.insert(key(1), Object{int64_t{10}});
+    table.insert(key(2), Object{int64_t{20}});
+    // 1 is now more recent than 2, so 2 makes room for 3.
+    EXPECT_TRUE(table.find(key(1)).has_value());
+    table.insert(key(3), Object{int64_t{30}});
+    EXPECT_FALSE(table.find(key(2)).has_value());
+    ASSERT_TRUE(table.find(key(1)).has_value());
+    EXPECT_EQ(std::get<int64_t>(*table.find(key(3))), 30);
+
+    auto stats = table.stats();
+    EXPECT_EQ(stats.hits, 3);
+    EXPECT_EQ(stats.misses, 1);
+    EXPECT_EQ(stats.evictions, 1);
+    EXPECT_EQ(stats.size, 2);
+    EXPECT_EQ(stats.capacity, 2);
+}
+
+TEST(MemoTableTest, KeysCompareByValue) {
+    const std::array<Object, 2> args{Object{String("x")}, Object{true}};
+    const std::array<Object, 2> same{Object{String("x")}, Object{true}};
+    const std::array<Object, 2> swapped{Object{true}, Object{String("x")}};
+    const std::array<Object, 1> array{Object{Array()}};
+    EXPECT_EQ(MemoKey::from(args)->hash, MemoKey::from(same)->hash);
+    EXPECT_NE(MemoKey::from(args)->hash, MemoKey::from(swapped)->hash);
+    EXPECT_FALSE(MemoKey::from(array).has_value());
+
+    MemoTable table(nullptr, 4);
+    table.insert(*MemoKey::from(args), Object{int64_t{1}});
+    EXPECT_TRUE(table.find(*MemoKey::from(same)).has_value());
+    EXPECT_FALSE(table.find(*MemoKey::from(swapped)).has_value());
+}
@@ -0,0 +1,121 @@
+#include "monkey/box.h"
+#include "monkey/budget.h"
+#include "monkey/env.h"
+#include "monkey/eval.h"
+#include "monkey/lexer.h"
+#include "monkey/memory.h"
+#include "monkey/parser.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+using namespace monkey; // NOLINT(google-build-using-namespace) - for cleaner test code
+
+TEST(MemoryTest, AccountTracksLiveAndPeakBytes) {
+    auto parser =
+        Parser(Lexer(R"(let s = "hello, " + "world, this is a long string"; s)"));
+    auto program = parser.parseProgram();
+
+    MemoryAccount account;
+    {
+        const MemoryScope scope(account);
+        auto env = makeEnvironment();
+        auto result = eval(*program, env);
+        ASSERT_TRUE(std::holds_alternative<String>(result));
+        EXPECT_GT(account.live(), 0);
+    }
+    EXPECT_EQ(account.live(), 0);
+    EXPECT_GT(account.peak(), sizeof(Environment));
+}
+
+TEST(MemoryTest, QuotaStopsEvaluation) {
+    // s + s only adds a rope node; using the result as a hash key flattens it, so every
+    // step allocates twice the characters of the last.
+    auto parser = Parser(Lexer(R"(
+        let grow = fn(s, n) {
+            if (n == 0) { return s; }
+            let t = s + s;
+            {t: true};
+            grow(t, n - 1)
+        };
+        grow("0123456789abcdef", 24);
+    )"));
+    auto program = parser.parseProgram();
+
+    MemoryAccount account(64 * 1024);
+    const MemoryScope scope(account);
+    Budget budget;
+    budget.limitMemory(account);
+    auto result = eval(*program, makeEnvironment(), budget);
+    ASSERT_TRUE(std::holds_alternative<Error>(result));
+    EXPECT_EQ(std::get<Error>(result).message, "evaluation exceeded its memory quota");
+    EXPECT_LE(account.peak(), account.quota());
+}
+
+TEST(MemoryTest, QuotaRefusesTheAllocationThatExceedsIt) {
+    // Without a Budget nothing checks the quota between steps: the allocation that would
+    // exceed it fails, and the evaluation with it.
+    auto parser = Parser(Lexer(R"(
+        let grow = fn(s, n) {
+            if (n == 0) { return s; }
+            let t = s + s;
+            {t: true};
+            grow(t, n - 1)
+        };
+        grow("0123456789abcdef", 24);
+    )"));
+    auto program = parser.parseProgram();
+
+    MemoryAccount account(64 * 1024);
+    {
+        const MemoryScope scope(account);
+        auto result = eval(*program, makeEnvironment());
+        ASSERT_TRUE(std::holds_alternative<Error>(result));
+        EXPECT_EQ(std::get<Error>(result).message,
+                  "evaluation exceeded its memory quota");
+    }
+    EXPECT_GT(account.refusals(), 0);
+    EXPECT_LE(account.peak(), account.quota());
+}
+
+TEST(MemoryTest, QuotaBoundsRopes) {
+    // Doubling only adds rope nodes, but their length counts against the quota.
+    auto parser = Parser(Lexer(R"(
+        let grow = fn(s, n) { if (n == 0) { s } else { grow(s + s, n - 1) } };
+        len(grow("0123456789abcdef", 40));
+    )"));
+    auto program = parser.parseProgram();
+
+    MemoryAccount account(64 * 1024);
+    const MemoryScope scope(account);
+    auto result = eval(*program, makeEnvironment());
+    ASSERT_TRUE(std::holds_alternative<Error>(result));
+    EXPECT_EQ(std::get<Error>(result).message, "evaluation exceeded its memory quota");
+    EXPECT_GT(account.refusals(), 0);
+}
+
+TEST(MemoryTest, BoxCopiesShareUntilWritten) {
+    Box<std::vector<int>> original(std::vector<int>{1, 2, 3});
+    const Box<std::vector<int>> copy = original;
+    EXPECT_EQ(&*copy, &*std::as_const(original));
+
+    original->push_back(4);
+    EXPECT_NE(&*copy, &*std::as_const(original));
+    EXPECT_EQ(copy->size(), 3);
+    EXPECT_EQ(original->size(), 4);
+}
+TEST(MemoryTest, RefusedBoxCopyFreesItsNode) {
+    using Ints = std::vector<int, AccountingAllocator<int>>;
+    MemoryAccount account(6000);
+    MemoryScope scope(account);
+    Box<Ints> original(Ints(1000, 7));
+    const Box<Ints> copy = original;
+    auto live = account.live();
+
+    // The node fits in the quota, the copy of the vector it holds does not.
+    EXPECT_THROW(original->push_back(8), MemoryQuotaExceeded);
+    EXPECT_EQ(account.live(), live);
+    EXPECT_EQ(copy->size(), 1000);
+}
@@ -5,12 +5,15 @@
 #include <fmt/ranges.h>
 #include <gtest/gtest.h>
 
+#include <cstddef>
 #include <cstdint>
 #include <ios>
 #include <ranges>
 #include <string>
+#include <string_view>
 #include <tuple>
 #include <type_traits>
+#include <utility>
 #include <variant>
 #include <vector>
 
@@ -183,6 +186,37 @@ return 993322;
     }
 }
 
+TEST(ParserTest, YieldStatementsMakeGenerators) {
+    std::vector<std::pair<std::string, bool>> tests = {
+        {"fn(x) { x }", false},
+        {"fn(x) { yield x; }", true},
+        {"fn(x) { if (x) { yield 1; } else { 2 } }", true},
+        {"fn(x) { if (x) { 1 } else { if (x) { 2 } else { yield 3; } } }", true},
+        // Yields of a nested function literal make that literal the generator
+        {"fn(x) { fn() { yield x; } }", false},
+    };
+
+    for (const auto &[input, expected] : tests) {
+        auto parser = Parser(Lexer(input));
+        auto program = parser.parseProgram();
+        checkParserErrors(parser);
+        ASSERT_EQ(program->statements.size(), 1) << input;
+
+        const auto &stmt = std::get<ExpressionStatement>(program->statements[0]);
+        const auto *fn = std::get_if<Box<FunctionLiteral>>(&stmt.expression);
+        ASSERT_NE(fn, nullptr) << input;
+        EXPECT_EQ((*fn)->generator, expected) << input;
+    }
+
+    auto parser = Parser(Lexer("yield 5;"));
+    auto program = parser.parseProgram();
+    checkParserErrors(parser);
+    const auto *yieldStmt = std::get_if<YieldStatement>(&program->statements.at(0));
+    ASSERT_NE(yieldStmt, nullptr);
+    EXPECT_EQ(toString(program->statements[0]), "yield 5;");
+    testLiteralExpression(yieldStmt->value, 5);
+}
+
 TEST(ParserTest, IdentifierExpression) {
     std::string input = "foobar;";
 
@@ -380,6 +414,9 @@ TEST(ParserTest, OperatorPrecedenceParsing) {
         {"add(a, b, 1, 2 * 3, 4 + 5, add(6, 7 * 8))",
          "add(a, b, 1, (2 * 3), (4 + 5), add(6, (7 * 8)))"},
         {"add(a + b + c * d / f + g)", "add((((a + b) + ((c * d) / f)) + g))"},
+        {"a * [1, 2, 3, 4][b * c] * d", "((a * ([1, 2, 3, 4][(b * c)])) * d)"},
+        {"add(a * b[2], b[1], 2 * [1, 2][1])",
+         "add((a * (b[2])), (b[1]), (2 * ([1, 2][1])))"},
     };
 
     for (const auto &[input, expected] : tests) {
@@ -672,6 +709,143 @@ TEST(ParserTest, StringLiteralExpression) {
                << typeid(exprStmt->expression).name();
     }
 
-    EXPECT_EQ(stringLiteral->value, "hello world")
-        << "stringLiteral.value not 'hello world'. got=" << stringLiteral->value;
+    EXPECT_EQ(*stringLiteral->value, "hello world")
+        << "stringLiteral.value not 'hello world'. got=" << *stringLiteral->value;
 }
+
+TEST(ParserTest, ArrayLiteralParsing) {
+    std::string input = "[1, 2 * 2, 3 + 3]";
+
+    auto parser = Parser(Lexer(input));
+    auto program = parser.parseProgram();
+
+    checkParserErrors(parser);
+
+    if (program == nullptr) {
+        FAIL() << "parseProgram() returned nullptr";
+    }
+
+    const auto *exprStmt = std::get_if<ExpressionStatement>(&program->statements[0]);
+    if (exprStmt == nullptr) {
+        FAIL() << "stmt not ExpressionStatement";
+    }
+
+    const auto *array = std::get_if<Box<ArrayLiteral>>(&exprStmt->expression);
+    if (array == nullptr) {
+        FAIL() << "expression not ArrayLiteral. got="
+               << typeid(exprStmt->expression).name();
+    }
+
+    ASSERT_EQ((*array)->elements.size(), 3);
+    testIntegerLiteral((*array)->elements[0], 1);
+    testInfixExpression((*array)->elements[1], 2, "*", 2);
+    testInfixExpression((*array)->elements[2], 3, "+", 3);
+}
+
+TEST(ParserTest, IndexExpressionParsing) {
+    std::string input = "myArray[1 + 1]";
+
+    auto parser = Parser(Lexer(input));
+    auto program = parser.parseProgram();
+
+    checkParserErrors(parser);
+
+    if (program == nullptr) {
+        FAIL() << "parseProgram() returned nullptr";
+    }
+
+    const auto *exprStmt = std::get_if<ExpressionStatement>(&program->statements[0]);
+    if (exprStmt == nullptr) {
+        FAIL() << "stmt not ExpressionStatement";
+    }
+
+    const auto *index = std::get_if<Box<IndexExpression>>(&exprStmt->expression);
+    if (index == nullptr) {
+        FAIL() << "expression not IndexExpression. got="
+               << typeid(exprStmt->expression).name();
+    }
+
+    testIdentifier((*index)->left, "myArray");
+    testInfixExpression((*index)->index, 1, "+", 1);
+}
+
+TEST(ParserTest, HashLiteralParsing) {
+    std::vector<std::pair<std::string, std::string>> tests = {
+        {"{}", "{}"},
+        {R"({"one": 1, "two": 2})", "{one:1, two:2}"},
+        {R"({"one": 0 + 1, true: 10 - 8, 3: 15 / 5})",
+         "{one:(0 + 1), true:(10 - 8), 3:(15 / 5)}"},
+        {R"({"a": [1], "b": {"c": 2}}["b"]["c"])", "(({a:[1], b:{c:2}}[b])[c])"},
+    };
+    for (const auto &[input, expected] : tests) {
+        auto parser = Parser(Lexer(input));
+        auto program = parser.parseProgram();
+        checkParserErrors(parser);
+        ASSERT_EQ(program->statements.size(), 1) << input;
+        const auto *exprStmt = std::get_if<ExpressionStatement>(&program->statements[0]);
+        ASSERT_NE(exprStmt, nullptr) << input;
+        EXPECT_EQ(toString(exprStmt->expression), expected) << input;
+    }
+}
+
+TEST(ParserTest, HashLiteralErrors) {
+    for (const std::string input : {R"({"a" 1})", R"({"a": 1 "b": 2})", R"({"a": 1,)"}) {
+        auto parser = Parser(Lexer(input));
+        parser.parseProgram();
+        EXPECT_FALSE(parser.errors().empty()) << input;
+    }
+}
+
+TEST(ParserTest, ErrorsGiveTheLineAndColumn) {
+    std::vector<std::tuple<std::string, std::string>> tests = {
+        {"let x 5;", "1:7: "},
+        {"let x = 1;\n  let = 2;", "2:7: "},
+        {"let x = 1;\nx + ;", "2:5: no prefix parse function for "},
+        {"let x = 1;\n\n  99999999999999999999", "3:3: integer literal "},
+    };
+    for (const auto &[input, prefix] : tests) {
+        auto parser = Parser(Lexer(input));
+        parser.parseProgram();
+        ASSERT_FALSE(parser.errors().empty()) << input;
+        EXPECT_TRUE(parser.errors().front().starts_with(prefix))
+            << input << ": " << parser.errors().front();
+    }
+}
+
+// Nesting depth is limited by heap memory, not by the C++ stack.
+TEST(ParserTest, DeeplyNestedExpressions) {
+    constexpr size_t DEPTH = 100000;
+    auto repeat = [](std::string_view s, size_t count) {
+        std::string result;
+        for (size_t i = 0; i < count; ++i) {
+            result += s;
+        }
+        return result;
+    };
+    std::vector<std::tuple<std::string, std::string>> tests = {
+        {repeat("(", DEPTH) + "1" + repeat(")", DEPTH), "1"},
+        {repeat("-", DEPTH) + "1", repeat("(-", DEPTH) + "1" + repeat(")", DEPTH)},
+        {"1" + repeat(" + 1", DEPTH), repeat("(", DEPTH) + "1" + repeat(" + 1)", DEPTH)},
+        {repeat("1 + (", DEPTH) + "1" + repeat(")", DEPTH),
+         repeat("(1 + ", DEPTH) + "1" + repeat(")", DEPTH)},
+        {repeat("[", DEPTH) + repeat("]", DEPTH),
+         repeat("[", DEPTH) + repeat("]", DEPTH)},
+    };
+    for (const auto &[input, expected] : tests) {
+        auto parser = Parser(Lexer(input));
+        auto program = parser.parseProgram();
+        checkParserErrors(parser);
+        ASSERT_EQ(program->statements.size(), 1);
+        EXPECT_EQ(toString(*program), expected);
+    }
+
+    auto chain = repeat("if (x) { 1 } else { ", DEPTH) + "2" + repeat(" }", DEPTH);
+    auto parser = Parser(Lexer(chain));
+    auto program = parser.parseProgram();
+    checkParserErrors(parser);
+    EXPECT_EQ(program->statements.size(), 1);
+
+    auto unclosed = Parser(Lexer(repeat("(", DEPTH)));
+    unclosed.parseProgram();
+    EXPECT_FALSE(unclosed.errors().empty());
+}
\ No newline at end of file
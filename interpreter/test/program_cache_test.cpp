@@ -0,0 +1,72 @@
+#include "monkey/program_cache.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace monkey; // NOLINT(google-build-using-namespace) - for cleaner test code
+
+TEST(ProgramCacheTest, SourceHashIsFnv1a) {
+    EXPECT_EQ(sourceHash(""), 14695981039346656037ULL);
+    EXPECT_EQ(sourceHash("a"), 0xaf63dc4c8601ec8cULL);
+    EXPECT_NE(sourceHash("1 + 2"), sourceHash("1 + 3"));
+}
+
+TEST(ProgramCacheTest, IdenticalSourceIsParsedOnce) {
+    ProgramCache cache;
+    auto first = cache.get("let x = 1; x + 1;");
+    auto second = cache.get("let x = 1; x + 1;");
+    auto other = cache.get("2 * 3;");
+
+    EXPECT_FALSE(first.hit);
+    EXPECT_TRUE(second.hit);
+    EXPECT_FALSE(other.hit);
+    EXPECT_EQ(first.program, second.program);
+    EXPECT_NE(first.program, other.program);
+    EXPECT_EQ(cache.size(), 2);
+    EXPECT_EQ(cache.hits(), 1);
+    EXPECT_EQ(cache.misses(), 2);
+}
+
+TEST(ProgramCacheTest, ConcurrentLookupsShareOneParse) {
+    ProgramCache cache;
+    std::vector<std::shared_ptr<const CompiledProgram>> programs(8);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < programs.size(); ++i) {
+        threads.emplace_back([&cache, &programs, i] {
+            programs[i] = cache.get("let f = fn(x) { x }; f(1);").program;
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(cache.misses(), 1);
+    for (const auto &program : programs) {
+        EXPECT_EQ(program, programs.front());
+    }
+}
+
+TEST(ProgramCacheTest, FindByIdReturnsCachedProgram) {
+    ProgramCache cache;
+    auto lookup = cache.get("1 + 1;");
+    EXPECT_EQ(lookup.id, sourceHash("1 + 1;"));
+    EXPECT_EQ(cache.find(lookup.id), lookup.program);
+    EXPECT_EQ(cache.find(lookup.id + 1), nullptr);
+}
+
+TEST(ProgramCacheTest, EvictsLeastRecentlyUsed) {
+    ProgramCache cache(2);
+    auto a = cache.get("1;");
+    auto b = cache.get("2;");
+    cache.get("1;"); // "2;" is now the least recently used
+    cache.get("3;");
+
+    EXPECT_EQ(cache.size(), 2);
+    EXPECT_NE(cache.find(a.id), nullptr);
+    EXPECT_EQ(cache.find(b.id), nullptr);
+    EXPECT_FALSE(cache.get("2;").hit);
+}
\ No newline at end of file
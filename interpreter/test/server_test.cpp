@@ -0,0 +1,245 @@
+#include "monkey/server.h"
+
+#include <gtest/gtest.h>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace monkey; // NOLINT(google-build-using-namespace) - for cleaner test code
+
+namespace {
+
+ServerOptions serverOptions(std::string socketPath, size_t workers) {
+    ServerOptions options;
+    options.socketPath = std::move(socketPath);
+    options.workers = workers;
+    options.cacheCapacity = 16;
+    return options;
+}
+
+std::string socketPath(const std::string &name) {
+    return (std::filesystem::temp_directory_path() /
+            (name + "_" + std::to_string(getpid()) + ".sock"))
+        .string();
+}
+
+} // namespace
+
+TEST(ServerTest, FramesRoundTrip) {
+    std::string buffer = encodeFrame("hello") + encodeFrame("") + encodeFrame("wor");
+    buffer.pop_back(); // the last frame is incomplete
+
+    bool malformed = false;
+    EXPECT_EQ(takeFrame(buffer, malformed), "hello");
+    EXPECT_EQ(takeFrame(buffer, malformed), "");
+    EXPECT_EQ(takeFrame(buffer, malformed), std::nullopt);
+    EXPECT_FALSE(malformed);
+
+    std::string oversized = encodeFrame("x");
+    oversized[0] = '\x7f';
+    EXPECT_EQ(takeFrame(oversized, malformed), std::nullopt);
+    EXPECT_TRUE(malformed);
+}
+
+TEST(ServerTest, RequestsRoundTrip) {
+    EvalRequest request{.programId = 0x2a,
+                        .bindings = {{"n", "5"}, {"name", "\"monkey\""}},
+                        .source = "n * 2;\nname;"};
+    auto decoded = decodeRequest(encodeRequest(request));
+    ASSERT_TRUE(decoded.has_value());
+    EXPECT_EQ(decoded->programId, 0x2a);
+    EXPECT_EQ(decoded->bindings, request.bindings);
+    EXPECT_EQ(decoded->source, request.source);
+
+    EXPECT_EQ(decodeRequest("bogus header\n\n1;"), std::nullopt);
+    EXPECT_EQ(decodeRequest("1;"), std::nullopt);
+
+    auto response = decodeResponse(encodeResponse({true, 0xabc, "42"}));
+    ASSERT_TRUE(response.has_value());
+    EXPECT_TRUE(response->ok);
+    EXPECT_EQ(response->programId, 0xabc);
+    EXPECT_EQ(response->result, "42");
+}
+
+TEST(ServerTest, HandleUsesCacheAndBindings) {
+    Server server(serverOptions("", 1));
+    auto first = server.handle(encodeRequest(
+        {.programId = std::nullopt, .bindings = {{"x", "20"}}, .source = "x + 1;"}));
+    EXPECT_TRUE(first.ok);
+    EXPECT_EQ(first.result, "21");
+
+    auto byId = server.handle(encodeRequest(
+        {.programId = first.programId, .bindings = {{"x", "41"}}, .source = ""}));
+    EXPECT_TRUE(byId.ok);
+    EXPECT_EQ(byId.result, "42");
+    EXPECT_EQ(server.cache().misses(), 1);
+
+    auto unknown = server.handle(
+        encodeRequest({.programId = first.programId + 1, .bindings = {}, .source = ""}));
+    EXPECT_FALSE(unknown.ok);
+    EXPECT_TRUE(unknown.result.starts_with("unknown program"));
+
+    auto badBinding = server.handle(encodeRequest(
+        {.programId = std::nullopt, .bindings = {{"x", "fn"}}, .source = "x;"}));
+    EXPECT_FALSE(badBinding.ok);
+    EXPECT_EQ(badBinding.result, "invalid binding: x fn");
+
+    auto failing = server.handle(
+        encodeRequest({.programId = std::nullopt, .bindings = {}, .source = "-true;"}));
+    EXPECT_FALSE(failing.ok);
+    EXPECT_EQ(failing.result, "unknown operator: -true");
+
+    auto division = server.handle(
+        encodeRequest({.programId = std::nullopt, .bindings = {}, .source = "1 / 0;"}));
+    EXPECT_FALSE(division.ok);
+    EXPECT_EQ(division.result, "division by zero: 1 / 0");
+}
+
+TEST(ServerTest, ResultsFitInAFrame) {
+    Server server(serverOptions("", 1));
+    auto huge = server.handle(encodeRequest({.programId = std::nullopt,
+                                             .bindings = {},
+                                             .source = R"(
+        let grow = fn(s, n) { if (n == 0) { s } else { grow(s + s, n - 1) } };
+        grow("0123456789abcdef", 21);
+    )"}));
+    EXPECT_TRUE(huge.ok);
+    EXPECT_EQ(huge.result.size(), MAX_RESULT_SIZE + 3);
+    EXPECT_TRUE(huge.result.ends_with("..."));
+    EXPECT_LE(encodeResponse(huge).size(), MAX_FRAME_SIZE);
+}
+
+TEST(ServerTest, ServesClientsOverSocket) {
+    auto path = socketPath("monkey_server_test");
+    Server server(serverOptions(path, 2));
+    ASSERT_EQ(server.listen(), std::nullopt);
+    std::thread loop([&server] { server.run(); });
+
+    std::vector<std::thread> clients;
+    std::vector<int> correct(4, 0);
+    for (size_t c = 0; c < correct.size(); ++c) {
+        clients.emplace_back([&path, &correct, c] {
+            auto client = Client::connect(path);
+            if (!client) {
+                return;
+            }
+            auto first = client->evaluate({.programId = std::nullopt,
+                                           .bindings = {{"n", "0"}},
+                                           .source = "let f = fn(x) { x * x }; f(n);"});
+            if (!first || !first->ok) {
+                return;
+            }
+            for (int64_t n = 1; n <= 20; ++n) {
+                auto response = client->evaluate({.programId = first->programId,
+                                                  .bindings = {{"n", std::to_string(n)}},
+                                                  .source = ""});
+                if (response && response->ok &&
+                    response->result == std::to_string(n * n)) {
+                    ++correct[c];
+                }
+            }
+        });
+    }
+    for (auto &client : clients) {
+        client.join();
+    }
+
+    server.stop();
+    loop.join();
+    for (int count : correct) {
+        EXPECT_EQ(count, 20);
+    }
+    EXPECT_EQ(server.cache().size(), 1);
+}
+TEST(ServerTest, DoesNotTakeOverALiveSocket) {
+    auto path = socketPath("monkey_server_in_use_test");
+    Server server(serverOptions(path, 1));
+    ASSERT_EQ(server.listen(), std::nullopt);
+    std::thread loop([&server] { server.run(); });
+
+    {
+        Server second(serverOptions(path, 1));
+        EXPECT_EQ(second.listen(), path + " is already in use");
+    }
+    // The first server still owns the path.
+    auto client = Client::connect(path);
+    ASSERT_TRUE(client);
+    auto response = client->evaluate({.programId = std::nullopt, .bindings = {},
+                                      .source = "6 * 7;"});
+    ASSERT_TRUE(response && response->ok);
+    EXPECT_EQ(response->result, "42");
+    client.reset();
+
+    server.stop();
+    loop.join();
+}
+
+TEST(ServerTest, ReplacesAStaleSocket) {
+    auto path = socketPath("monkey_server_stale_test");
+    sockaddr_un address{};
+    path.copy(address.sun_path, path.size());
+    address.sun_family = AF_UNIX;
+    // Bound and closed without unlinking, as left behind by a server that crashed.
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(bind(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)), 0);
+    close(fd);
+
+    Server server(serverOptions(path, 1));
+    EXPECT_EQ(server.listen(), std::nullopt);
+}
+
+TEST(ServerTest, AnswersRequestsSentBeforeShutdown) {
+    auto path = socketPath("monkey_server_shutdown_test");
+    Server server(serverOptions(path, 1));
+    ASSERT_EQ(server.listen(), std::nullopt);
+    std::thread loop([&server] { server.run(); });
+
+    sockaddr_un address{};
+    path.copy(address.sun_path, path.size());
+    address.sun_family = AF_UNIX;
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)),
+              0);
+    // Two pipelined requests, then the client shuts down its side without waiting.
+    std::string requests;
+    for (const auto *source : {"6 * 7;", "\"done\";"}) {
+        requests += encodeFrame(encodeRequest(
+            {.programId = std::nullopt, .bindings = {}, .source = source}));
+    }
+    ASSERT_EQ(write(fd, requests.data(), requests.size()),
+              static_cast<ssize_t>(requests.size()));
+    ASSERT_EQ(shutdown(fd, SHUT_WR), 0);
+
+    // The server answers both and then closes, which ends the read.
+    std::string received;
+    std::array<char, 4096> buffer{};
+    ssize_t got = 0;
+    while ((got = read(fd, buffer.data(), buffer.size())) > 0) {
+        received.append(buffer.data(), static_cast<size_t>(got));
+    }
+    close(fd);
+    server.stop();
+    loop.join();
+
+    bool malformed = false;
+    std::vector<std::string> results;
+    while (auto payload = takeFrame(received, malformed)) {
+        auto response = decodeResponse(*payload);
+        ASSERT_TRUE(response.has_value());
+        results.push_back(response->result);
+    }
+    EXPECT_EQ(results, (std::vector<std::string>{"42", "done"}));
+    EXPECT_TRUE(received.empty());
+}
\ No newline at end of file
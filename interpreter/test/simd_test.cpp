@@ -0,0 +1,92 @@
+#include "monkey/simd.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <span>
+#include <vector>
+
+using namespace monkey; // NOLINT(google-build-using-namespace) - for cleaner test code
+
+namespace {
+
+// Every tail length after the four-wide steps, and sizes with none.
+constexpr auto SIZES = {0UL,  1UL,  2UL,  3UL,  4UL,    5UL,   7UL,
+                        8UL,  9UL, 15UL, 16UL, 17UL, 1000UL, 1003UL};
+
+std::vector<int64_t> randomValues(size_t size, std::mt19937_64 &random) {
+    std::vector<int64_t> values(size);
+    for (auto &value : values) {
+        // Small values for the comparisons, full-width ones for wrap-around.
+        value = random() % 2 == 0 ? static_cast<int64_t>(random() % 200) - 100
+                                  : static_cast<int64_t>(random());
+    }
+    return values;
+}
+
+} // namespace
+
+TEST(SimdTest, ReportsImplementation) {
+    auto name = simd::implementation();
+    EXPECT_TRUE(name == "avx2" || name == "scalar") << name;
+}
+
+TEST(SimdTest, ReductionsMatchScalar) {
+    std::mt19937_64 random(42);
+    for (auto size : SIZES) {
+        auto a = randomValues(size, random);
+        auto b = randomValues(size, random);
+        EXPECT_EQ(simd::sum(a), simd::scalar::sum(a)) << size;
+        EXPECT_EQ(simd::dot(a, b), simd::scalar::dot(a, b)) << size;
+        if (size > 0) {
+            EXPECT_EQ(simd::min(a), simd::scalar::min(a)) << size;
+            EXPECT_EQ(simd::max(a), simd::scalar::max(a)) << size;
+        }
+    }
+}
+
+TEST(SimdTest, ReductionsWrapAround) {
+    constexpr auto MAX = std::numeric_limits<int64_t>::max();
+    constexpr auto MIN = std::numeric_limits<int64_t>::min();
+    const std::vector<int64_t> values = {MAX, 1, 0, 0, 0, 0, 0, 0, 0};
+    EXPECT_EQ(simd::sum(values), MIN);
+    EXPECT_EQ(simd::dot(values, values), 2);
+    EXPECT_EQ(simd::min(values), 0);
+    EXPECT_EQ(simd::max(values), MAX);
+}
+
+TEST(SimdTest, ExtremesInEveryPosition) {
+    for (size_t size = 1; size < 20; ++size) {
+        for (size_t at = 0; at < size; ++at) {
+            std::vector<int64_t> values(size, 7);
+            values[at] = -3;
+            EXPECT_EQ(simd::min(values), -3) << size << " " << at;
+            values[at] = 11;
+            EXPECT_EQ(simd::max(values), 11) << size << " " << at;
+        }
+    }
+}
+
+TEST(SimdTest, MapsMatchScalar) {
+    std::mt19937_64 random(7);
+    for (auto size : SIZES) {
+        auto values = randomValues(size, random);
+        auto addend = static_cast<int64_t>(random());
+        std::vector<int64_t> got(size);
+        std::vector<int64_t> want(size);
+        simd::add(values, addend, got.data());
+        simd::scalar::add(values, addend, want.data());
+        EXPECT_EQ(got, want) << size;
+
+        auto count = simd::filterGreater(values, 0, got.data());
+        auto wantCount = simd::scalar::filterGreater(values, 0, want.data());
+        ASSERT_EQ(count, wantCount) << size;
+        EXPECT_TRUE(std::ranges::equal(std::span(got).first(count),
+                                       std::span(want).first(count)))
+            << size;
+    }
+}
@@ -0,0 +1,62 @@
+#include "monkey/env.h"
+#include "monkey/eval.h"
+#include "monkey/lexer.h"
+#include "monkey/parser.h"
+#include "monkey/stats.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+using namespace monkey; // NOLINT(google-build-using-namespace) - for cleaner test code
+
+namespace {
+
+RuntimeStats evalWithStats(const std::string &input) {
+    auto parser = Parser(Lexer(input));
+    auto program = parser.parseProgram();
+    auto env = makeEnvironment();
+    resetRuntimeStats();
+    eval(*program, env);
+    return runtimeStats();
+}
+
+} // namespace
+
+TEST(StatsTest, DisabledStatsStayZero) {
+    if constexpr (STATS_ENABLED) {
+        GTEST_SKIP() << "built with MONKEY_ENABLE_STATS";
+    }
+    auto stats = evalWithStats("let f = fn(x) { x }; f(1);");
+    EXPECT_EQ(stats.environmentsCreated, 0);
+    EXPECT_EQ(stats.identifierLookups, 0);
+    EXPECT_EQ(stats.objectCopies, 0);
+    EXPECT_EQ(stats.peakCallDepth, 0);
+}
+
+TEST(StatsTest, CountsLookupsAndScopes) {
+    if constexpr (!STATS_ENABLED) {
+        GTEST_SKIP() << "built without MONKEY_ENABLE_STATS";
+    }
+    // `a` is found two frames up from the innermost call, the rest in the first frame.
+    auto stats = evalWithStats(
+        "let a = 1; let outer = fn() { let inner = fn(x) { x + a }; inner(2) }; "
+        "outer();");
+    EXPECT_EQ(stats.environmentsCreated, 2); // one per call, not the global one
+    EXPECT_EQ(stats.identifierLookups, 4);   // outer, inner, x, a
+    EXPECT_EQ(stats.scopesWalked, 6);        // 1 + 1 + 1 + 3
+    EXPECT_EQ(stats.peakCallDepth, 2);
+    EXPECT_EQ(stats.callDepth, 0);
+    EXPECT_DOUBLE_EQ(stats.averageScopeDepth(), 6.0 / 4.0);
+}
+
+TEST(StatsTest, CountsFunctionCopies) {
+    if constexpr (!STATS_ENABLED) {
+        GTEST_SKIP() << "built without MONKEY_ENABLE_STATS";
+    }
+    auto stats = evalWithStats("let f = fn(x) { x }; f(1);");
+    // let binding, lookup of `f`
+    EXPECT_EQ(stats.functionCopies, 2);
+    EXPECT_GT(stats.objectCopies, stats.functionCopies);
+    EXPECT_GT(stats.heapBytes, 0);
+}
\ No newline at end of file
@@ -0,0 +1,177 @@
+#include "monkey/memory.h"
+#include "monkey/string.h"
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace monkey; // NOLINT(google-build-using-namespace) - for cleaner test code
+
+TEST(StringTest, ShortStringsAreInline) {
+    const String empty;
+    EXPECT_TRUE(empty.empty());
+    EXPECT_EQ(empty.view(), "");
+
+    const String small("hello");
+    EXPECT_EQ(small.owner(), nullptr);
+    EXPECT_EQ(small.view(), "hello");
+
+    const std::string long_(String::INLINE_CAPACITY + 1, 'x');
+    const String large(long_);
+    EXPECT_NE(large.owner(), nullptr);
+    EXPECT_EQ(large.view(), long_);
+}
+
+TEST(StringTest, CopiesShareCharacters) {
+    MemoryAccount account;
+    const MemoryScope scope(account);
+    const String original(std::string(1000, 'x'));
+    auto before = account.live();
+    const String copy = original; // NOLINT(performance-unnecessary-copy-initialization)
+    EXPECT_EQ(account.live(), before);
+    EXPECT_EQ(copy.view().data(), original.view().data());
+}
+
+TEST(StringTest, SlicesViewTheirOwner) {
+    auto owner = std::make_shared<const std::string>("first\nsecond");
+    const String slice(owner, std::string_view(*owner).substr(6));
+    EXPECT_EQ(slice.view(), "second");
+    EXPECT_EQ(slice.view().data(), owner->data() + 6);
+    EXPECT_EQ(slice.owner(), owner);
+}
+
+TEST(StringTest, ConcatMatchesStdString) {
+    std::mt19937 random(42);
+    for (int round = 0; round < 200; ++round) {
+        String built;
+        std::string expected;
+        auto steps = random() % 100;
+        for (size_t step = 0; step < steps; ++step) {
+            // Mostly short pieces, sometimes long ones, at either end.
+            auto length = random() % 4 == 0 ? random() % 100 : random() % 5;
+            std::string piece(length, static_cast<char>('a' + random() % 26));
+            if (random() % 3 == 0) {
+                built = String::concat(String(piece), built);
+                expected = piece + expected;
+            } else {
+                built = String::concat(built, String(piece));
+                expected += piece;
+            }
+            ASSERT_EQ(built.size(), expected.size());
+            // Flatten some of the intermediate ropes too.
+            if (random() % 10 == 0) {
+                ASSERT_EQ(built.view(), expected);
+            }
+        }
+        ASSERT_EQ(built.view(), expected) << round;
+    }
+}
+
+TEST(StringTest, ConcatSharesBothSides) {
+    String doubled("0123456789abcdef");
+    for (int i = 0; i < 40; ++i) {
+        doubled = String::concat(doubled, doubled);
+    }
+    // 16 TiB that are never flattened.
+    EXPECT_EQ(doubled.size(), size_t{16} << 40);
+    EXPECT_TRUE(doubled.isRope());
+}
+
+TEST(StringTest, DeepRopesFlattenAndFreeWithoutRecursion) {
+    MemoryAccount account;
+    const MemoryScope scope(account);
+    {
+        const String x("x");
+        const String y(std::string(String::INLINE_CAPACITY, 'y'));
+        // One node per piece: none of them can be joined inline.
+        String appended;
+        String prepended;
+        for (int i = 0; i < 1000000; ++i) {
+            appended = String::concat(appended, y);
+            prepended = String::concat(y, prepended);
+        }
+        EXPECT_EQ(appended.view(), std::string(32000000, 'y'));
+        EXPECT_EQ(prepended.view(), appended.view());
+
+        String grown;
+        for (int i = 0; i < 1000000; ++i) {
+            grown = String::concat(grown, x);
+        }
+        EXPECT_EQ(grown.view(), std::string(1000000, 'x'));
+    }
+    EXPECT_EQ(account.live(), 0);
+}
+
+TEST(StringTest, ReadingEveryIntermediateStaysLinear) {
+    MemoryAccount account;
+    const MemoryScope scope(account);
+    {
+        const String piece("0123456789");
+        String grown;
+        for (int i = 0; i < 20000; ++i) {
+            grown = String::concat(grown, piece);
+            ASSERT_EQ(grown.view().size(), 10 * static_cast<size_t>(i + 1));
+        }
+        // Flattened intermediates drop their pieces: without that, each one kept a copy
+        // of its prefix, 2 GB in all.
+        EXPECT_LT(account.peak(), 2000000);
+    }
+    EXPECT_EQ(account.live(), 0);
+}
+
+TEST(StringTest, ConcurrentReadsFlattenOnce) {
+    String rope;
+    std::string expected;
+    for (int i = 0; i < 10000; ++i) {
+        auto piece = std::to_string(i);
+        rope = String::concat(rope, String(piece));
+        expected += piece;
+    }
+    std::vector<std::string_view> views(8);
+    {
+        std::vector<std::jthread> readers;
+        for (auto &view : views) {
+            readers.emplace_back([&rope, &view] { view = rope.view(); });
+        }
+    }
+    for (auto view : views) {
+        EXPECT_EQ(view, expected);
+        EXPECT_EQ(view.data(), views[0].data());
+    }
+}
+TEST(StringTest, ConcurrentFlattensOfOverlappingRopes) {
+    // Each rope extends the one before it, so flattening one drops children that threads
+    // flattening the others may be walking at the same time.
+    std::vector<String> ropes;
+    std::vector<std::string> expected;
+    String rope;
+    std::string text;
+    for (int i = 0; i < 2000; ++i) {
+        auto piece =
+            std::string(String::INLINE_CAPACITY, static_cast<char>('a' + i % 26));
+        rope = String::concat(rope, String(piece));
+        text += piece;
+        ropes.push_back(rope);
+        expected.push_back(text);
+    }
+    {
+        std::vector<std::jthread> readers;
+        for (unsigned seed = 0; seed < 8; ++seed) {
+            readers.emplace_back([&ropes, &expected, seed] {
+                std::mt19937 random(seed);
+                for (int i = 0; i < 2000; ++i) {
+                    auto index = random() % ropes.size();
+                    auto extended = String::concat(ropes[index], String("x"));
+                    EXPECT_EQ(ropes[index].view(), expected[index]);
+                    EXPECT_EQ(extended.view(), expected[index] + "x");
+                }
+            });
+        }
+    }
+}
@@ -0,0 +1,291 @@
+#include "monkey/budget.h"
+#include "monkey/env.h"
+#include "monkey/eval.h"
+#include "monkey/interpreter.h"
+#include "monkey/lexer.h"
+#include "monkey/object.h"
+#include "monkey/parser.h"
+#include "monkey/task.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <variant>
+#include <vector>
+
+using namespace monkey; // NOLINT(google-build-using-namespace) - for cleaner test code
+
+namespace {
+
+Object evaluate(const std::string &input) {
+    auto parser = Parser(Lexer(input));
+    auto program = parser.parseProgram();
+    EXPECT_TRUE(parser.errors().empty());
+    auto env = makeEnvironment();
+    return eval(*program, env);
+}
+
+} // namespace
+
+TEST(TaskTest, SpawnAndAwait) {
+    std::vector<std::pair<std::string, int64_t>> tests = {
+        {"await(spawn(fn() { 42 }))", 42},
+        {"await(spawn(fn(a, b) { a * b }, 6, 7))", 42},
+        {"let x = 40; let t = spawn(fn() { x + 2 }); await(t)", 42},
+        {"let t = spawn(fn() { 21 }); await(t) + await(t)", 42},
+        {"let t = spawn(fn() { return 42; 0 }); let x = 1; await(t)", 42},
+    };
+    for (const auto &[input, expected] : tests) {
+        auto result = evaluate(input);
+        ASSERT_TRUE(std::holds_alternative<int64_t>(result)) << input;
+        EXPECT_EQ(std::get<int64_t>(result), expected) << input;
+    }
+}
+
+TEST(TaskTest, ParallelFibMatchesSequential) {
+    auto result = evaluate(R"(
+        let fib = fn(n) { if (n < 2) { return n; } fib(n - 1) + fib(n - 2) };
+        let pfib = fn(n) {
+            if (n < 10) { return fib(n); }
+            let left = spawn(pfib, n - 1);
+            let right = pfib(n - 2);
+            await(left) + right
+        };
+        pfib(20);
+    )");
+    ASSERT_TRUE(std::holds_alternative<int64_t>(result));
+    EXPECT_EQ(std::get<int64_t>(result), 6765);
+}
+
+TEST(TaskTest, ChannelsConnectProducersAndConsumers) {
+    auto result = evaluate(R"(
+        let ch = channel(2);
+        let produce = fn(i, n) {
+            if (i > n) { return close(ch); }
+            send(ch, i);
+            produce(i + 1, n)
+        };
+        let consume = fn(total, n) {
+            if (n == 0) { return total; }
+            consume(total + recv(ch), n - 1)
+        };
+        spawn(produce, 1, 100);
+        let total = await(spawn(consume, 0, 100));
+        if (recv(ch)) { -1 } else { total }
+    )");
+    // -1 if recv() on the closed, drained channel did not return null
+    ASSERT_TRUE(std::holds_alternative<int64_t>(result));
+    EXPECT_EQ(std::get<int64_t>(result), 5050);
+}
+
+TEST(TaskTest, BlockedTasksDoNotEachTakeAThread) {
+    auto result = evaluate(R"(
+        let ch = channel();
+        let start = fn(n, tasks) {
+            if (n == 0) { return tasks; }
+            start(n - 1, push(tasks, spawn(fn() { recv(ch) })))
+        };
+        let tasks = start(2000, []);
+        let feed = fn(n) { if (n > 0) { send(ch, n); feed(n - 1) } };
+        feed(2000);
+        let collect = fn(tasks, total) {
+            if (len(tasks) == 0) { return total; }
+            collect(rest(tasks), total + await(first(tasks)))
+        };
+        collect(tasks, 0)
+    )");
+    ASSERT_TRUE(std::holds_alternative<int64_t>(result));
+    EXPECT_EQ(std::get<int64_t>(result), 2001000);
+    // Past the cap on spare threads, waiting workers run the queued tasks themselves.
+    EXPECT_LE(scheduler().spares(), std::thread::hardware_concurrency());
+}
+
+TEST(TaskTest, ClosuresCrossChannels) {
+    auto result = evaluate(R"(
+        let ch = channel();
+        let make = fn(k) { fn(x) { x * k } };
+        spawn(fn() { send(ch, make(3)) });
+        let triple = recv(ch);
+        triple(14);
+    )");
+    ASSERT_TRUE(std::holds_alternative<int64_t>(result));
+    EXPECT_EQ(std::get<int64_t>(result), 42);
+}
+
+TEST(TaskTest, Errors) {
+    std::vector<std::pair<std::string, std::string>> tests = {
+        {"spawn(1)", "argument to `spawn` not supported, got INTEGER"},
+        {"spawn()", "wrong number of arguments. got=0, want at least 1"},
+        {"await(1)", "argument to `await` not supported, got INTEGER"},
+        {"await(spawn(fn() { -true }))", "unknown operator: -true"},
+        {"channel(0)", "channel capacity must be a positive integer, got 0"},
+        {"let ch = channel(); close(ch); send(ch, 1)", "send on closed channel"},
+        {"recv(1, 2)", "wrong number of arguments. got=2, want=1"},
+    };
+    for (const auto &[input, expected] : tests) {
+        auto result = evaluate(input);
+        ASSERT_TRUE(std::holds_alternative<Error>(result)) << input;
+        EXPECT_EQ(std::get<Error>(result).message, expected) << input;
+    }
+}
+
+TEST(TaskTest, BindingsShadowBuiltins) {
+    auto result = evaluate("let spawn = fn(x) { x + 1 }; spawn(41)");
+    ASSERT_TRUE(std::holds_alternative<int64_t>(result));
+    EXPECT_EQ(std::get<int64_t>(result), 42);
+}
+
+TEST(TaskTest, EvaluationJoinsUnawaitedTasks) {
+    auto parser = Parser(Lexer(R"(
+        let ch = channel();
+        let count = fn(n) { if (n == 0) { return 0; } count(n - 1) };
+        spawn(fn() { count(200); send(ch, "done") });
+        ch;
+    )"));
+    auto program = parser.parseProgram();
+    auto env = makeEnvironment();
+    auto channel = eval(*program, env);
+    ASSERT_TRUE(std::holds_alternative<Channel>(channel));
+
+    // The task finished before eval() returned, so its value is already waiting.
+    std::get<Channel>(channel).state->close();
+    auto value = std::get<Channel>(channel).state->receive();
+    ASSERT_TRUE(value.has_value());
+    EXPECT_EQ(inspect(*value), "done");
+}
+
+TEST(TaskTest, TasksInheritTheDeadline) {
+    auto program = compile(R"(
+        let burn = fn(n) { if (n == 0) { return 0; } burn(n - 1) + burn(n - 1) };
+        await(spawn(burn, 40));
+    )");
+    InterpreterOptions options;
+    options.timeout = std::chrono::milliseconds(20);
+    Interpreter interpreter(options);
+    auto result = interpreter.run(*program);
+    ASSERT_TRUE(std::holds_alternative<Error>(result));
+    EXPECT_EQ(std::get<Error>(result).message, "evaluation deadline exceeded");
+}
+
+TEST(TaskTest, TasksSpendTheSpawnersFuel) {
+    InterpreterOptions options;
+    options.fuel = 20000;
+    auto burn = std::string(R"(
+        let burn = fn(n) { if (n == 0) { return 0; } burn(n - 1) + burn(n - 1) };
+        let spawnAll = fn(n) {
+            if (n == 0) { return []; }
+            push(spawnAll(n - 1), spawn(burn, 10))
+        };
+        let awaitAll = fn(ts) {
+            if (len(ts) == 0) { return 0; }
+            await(first(ts)) + awaitAll(rest(ts))
+        };
+    )");
+
+    // One task fits in the budget, eight of them do not.
+    auto one = compile(burn + "awaitAll(spawnAll(1));");
+    auto result = Interpreter(options).run(*one);
+    ASSERT_TRUE(std::holds_alternative<int64_t>(result)) << inspect(result);
+
+    auto eight = compile(burn + "awaitAll(spawnAll(8));");
+    result = Interpreter(options).run(*eight);
+    ASSERT_TRUE(std::holds_alternative<Error>(result)) << inspect(result);
+    EXPECT_EQ(std::get<Error>(result).message, "evaluation ran out of fuel");
+}
+
+TEST(TaskTest, TasksChargeTheSpawnersHeap) {
+    // Flattened through a hash key at every step, as in MemoryTest.QuotaStopsEvaluation.
+    auto program = compile(R"(
+        let grow = fn(s, n) {
+            if (n == 0) { return s; }
+            let t = s + s;
+            {t: true};
+            grow(t, n - 1)
+        };
+        await(spawn(grow, "0123456789abcdef", 24));
+    )");
+    InterpreterOptions options;
+    options.memoryQuota = 64 * 1024;
+    Interpreter interpreter(options);
+    auto result = interpreter.run(*program);
+    ASSERT_TRUE(std::holds_alternative<Error>(result));
+    EXPECT_EQ(std::get<Error>(result).message, "evaluation exceeded its memory quota");
+}
+
+TEST(TaskTest, ParallelCollectionBuiltins) {
+    std::vector<std::pair<std::string, std::string>> tests = {
+        {"pmap([1, 2, 3], fn(x) { x * x })", "[1, 4, 9]"},
+        {"pmap([], fn(x) { x })", "[]"},
+        {R"(pmap(["a", "b"], fn(s) { s + "!" }))", "[a!, b!]"},
+        {R"(pmap(["a", [1, 2]], len))", "[1, 2]"},
+        {"preduce([1, 2, 3, 4], fn(a, b) { a + b }, 10)", "20"},
+        {"preduce([], fn(a, b) { a + b }, 7)", "7"},
+        {"psort([3, 1, 2])", "[1, 2, 3]"},
+        {R"(psort(["b", "a", "c", "ab"]))", "[a, ab, b, c]"},
+        {"psort([])", "[]"},
+        {R"(psort([1, "a"]))",
+         "ERROR: argument to `psort` not supported, got ARRAY with a INTEGER element"},
+        {"pmap([1, 2], fn(x) { -true })", "ERROR: unknown operator: -true"},
+        {"preduce([1, 2], fn(a, b) { a + true }, 0)",
+         "ERROR: type mismatch: a + true"},
+        {"pmap([1], 1)", "ERROR: argument to `pmap` not supported, got INTEGER"},
+        {"preduce(1, len, 0)", "ERROR: argument to `preduce` not supported, got INTEGER"},
+    };
+    for (const auto &[input, expected] : tests) {
+        EXPECT_EQ(inspect(evaluate(input)), expected) << input;
+    }
+}
+
+TEST(TaskTest, ParallelCollectionsMatchSequential) {
+    // Sizes that leave one chunk, and several with some to merge.
+    for (size_t size : {1000UL, 50000UL, 100000UL}) {
+        std::mt19937_64 random(size);
+        std::vector<int64_t> values(size);
+        std::vector<Object> strings;
+        for (auto &value : values) {
+            value = static_cast<int64_t>(random() % 1000000);
+            strings.emplace_back(String(std::to_string(value)));
+        }
+        Interpreter interpreter;
+        interpreter.define("a", Array(IntVector::from(values)));
+        interpreter.define("s", Array::from(strings));
+
+        auto mapped = interpreter.run(*compile("pmap(a, fn(x) { x * 2 + 1 })"));
+        ASSERT_TRUE(std::holds_alternative<Array>(mapped)) << inspect(mapped);
+        const auto &array = std::get<Array>(mapped);
+        ASSERT_EQ(array.size(), size);
+        for (size_t i = 0; i < size; ++i) {
+            ASSERT_EQ(std::get<int64_t>(array[i]), values[i] * 2 + 1) << i;
+        }
+
+        auto reduced = interpreter.run(*compile("preduce(a, fn(x, y) { x + y }, 5)"));
+        int64_t sum = 5;
+        for (auto value : values) {
+            sum += value;
+        }
+        EXPECT_EQ(inspect(reduced), std::to_string(sum));
+
+        auto sorted = interpreter.run(*compile("psort(a)"));
+        std::ranges::sort(values);
+        ASSERT_TRUE(std::holds_alternative<Array>(sorted));
+        for (size_t i = 0; i < size; ++i) {
+            ASSERT_EQ(std::get<int64_t>(std::get<Array>(sorted)[i]), values[i]) << i;
+        }
+
+        auto sortedStrings = interpreter.run(*compile("psort(s)"));
+        const auto *sortedArray = std::get_if<Array>(&sortedStrings);
+        std::ranges::sort(strings, {},
+                          [](const Object &o) { return std::get<String>(o).view(); });
+        ASSERT_NE(sortedArray, nullptr);
+        for (size_t i = 0; i < size; ++i) {
+            ASSERT_EQ(inspect((*sortedArray)[i]), inspect(strings[i])) << i;
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,122 @@
+#include "monkey/thread_pool.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <set>
+#include <thread>
+
+using namespace monkey; // NOLINT(google-build-using-namespace) - for cleaner test code
+
+TEST(ThreadPoolTest, RunsEverySubmittedTask) {
+    ThreadPool pool(4);
+    std::atomic<int> sum{0};
+    for (int i = 1; i <= 1000; ++i) {
+        pool.submit([&sum, i] { sum += i; });
+    }
+    pool.wait();
+    EXPECT_EQ(sum, 500500);
+}
+
+TEST(ThreadPoolTest, WaitCoversNestedSubmits) {
+    ThreadPool pool(3);
+    std::atomic<int> leaves{0};
+    for (int i = 0; i < 10; ++i) {
+        pool.submit([&pool, &leaves] {
+            for (int j = 0; j < 10; ++j) {
+                pool.submit([&leaves] { ++leaves; });
+            }
+        });
+    }
+    pool.wait();
+    EXPECT_EQ(leaves, 100);
+}
+
+TEST(ThreadPoolTest, IdleWorkersStealQueuedWork) {
+    ThreadPool pool(4);
+    std::mutex mutex;
+    std::set<std::thread::id> workers;
+    // One task queues everything on its own worker; the others can only get work by
+    // stealing it.
+    pool.submit([&] {
+        for (int i = 0; i < 200; ++i) {
+            pool.submit([&] {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                const std::lock_guard lock(mutex);
+                workers.insert(std::this_thread::get_id());
+            });
+        }
+    });
+    pool.wait();
+    EXPECT_GT(pool.steals(), 0);
+    EXPECT_GT(workers.size(), 1);
+}
+
+TEST(ThreadPoolTest, DestructorFinishesQueuedTasks) {
+    std::atomic<int> done{0};
+    {
+        ThreadPool pool(2);
+        for (int i = 0; i < 50; ++i) {
+            pool.submit([&done] { ++done; });
+        }
+    }
+    EXPECT_EQ(done, 50);
+}
+
+TEST(ThreadPoolTest, BlockedWorkersAreReplaced) {
+    // One worker: without a spare thread, a task waiting for the task it queued would
+    // wait forever.
+    ThreadPool pool(1);
+    std::atomic<bool> childRan{false};
+    pool.submit([&] {
+        std::mutex mutex;
+        std::condition_variable done;
+        pool.submit([&] {
+            const std::lock_guard lock(mutex);
+            childRan = true;
+            done.notify_all();
+        });
+        const ThreadPool::Blocking blocking(pool);
+        std::unique_lock lock(mutex);
+        done.wait(lock, [&] { return childRan.load(); });
+    });
+    pool.wait();
+    EXPECT_TRUE(childRan);
+}
+TEST(ThreadPoolTest, SparesAreCapped) {
+    // Every task waits until all of them started. The workers wait with a spare in their
+    // place; the two spares can only get there by running the rest of the queue inside
+    // their waits.
+    ThreadPool pool(2, 2);
+    constexpr int TASKS = 24;
+    std::mutex mutex;
+    std::condition_variable changed;
+    int started = 0;
+    for (int i = 0; i < TASKS; ++i) {
+        pool.submit([&] {
+            std::unique_lock lock(mutex);
+            ++started;
+            changed.notify_all();
+            ThreadPool::Blocking blocking(pool);
+            while (started < TASKS) {
+                if (!blocking.helps()) {
+                    changed.wait(lock);
+                    continue;
+                }
+                lock.unlock();
+                const bool helped = blocking.help();
+                lock.lock();
+                if (!helped) {
+                    changed.wait_for(lock, std::chrono::milliseconds(1));
+                }
+            }
+        });
+    }
+    pool.wait();
+    EXPECT_EQ(started, TASKS);
+    EXPECT_EQ(pool.spares(), 2);
+}
@@ -0,0 +1,69 @@
+#include "monkey/lexer.h"
+#include "monkey/token.h"
+#include "monkey/token_buffer.h"
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using namespace monkey; // NOLINT(google-build-using-namespace) - for cleaner test code
+
+TEST(TokenBufferTest, MatchesTheLexer) {
+    std::string input = R"(let add = fn(x, y) {
+    x + y != 10;
+};
+let s = "two words";
+"unterminated)";
+    TokenBuffer tokens{Lexer(input)};
+    Lexer lexer(input);
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        auto token = lexer.nextToken();
+        EXPECT_EQ(tokens.type(i), token.type) << i;
+        EXPECT_EQ(tokens.text(i), token.literal) << i;
+    }
+    EXPECT_EQ(tokens.type(tokens.size() - 1), TokenType::EOF_TOKEN);
+    EXPECT_EQ(tokens.text(tokens.size() - 2), "unterminated");
+    EXPECT_EQ(tokens.source(), input);
+}
+
+TEST(TokenBufferTest, IndicesPastTheEndReadAsEof) {
+    TokenBuffer tokens{Lexer("x;")};
+    ASSERT_EQ(tokens.size(), 3);
+    for (size_t i : {size_t{2}, size_t{3}, size_t{1000}}) {
+        EXPECT_EQ(tokens.type(i), TokenType::EOF_TOKEN);
+        EXPECT_EQ(tokens.text(i), "");
+    }
+
+    TokenBuffer empty{Lexer("")};
+    ASSERT_EQ(empty.size(), 1);
+    EXPECT_EQ(empty.token(0).type, TokenType::EOF_TOKEN);
+    EXPECT_FALSE(empty.tooLarge());
+}
+
+TEST(TokenBufferTest, Positions) {
+    TokenBuffer tokens{Lexer("let x = 5;\n\n  x +\n\"a\nb\" y")};
+    std::vector<std::string_view> texts;
+    std::vector<std::pair<size_t, size_t>> positions;
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        texts.push_back(tokens.text(i));
+        auto [line, column] = tokens.position(i);
+        positions.emplace_back(line, column);
+    }
+    EXPECT_EQ(texts, (std::vector<std::string_view>{"let", "x", "=", "5", ";", "x", "+",
+                                                    "a\nb", "y", ""}));
+    // A string starts after its opening quote.
+    EXPECT_EQ(positions, (std::vector<std::pair<size_t, size_t>>{{1, 1},
+                                                                 {1, 5},
+                                                                 {1, 7},
+                                                                 {1, 9},
+                                                                 {1, 10},
+                                                                 {3, 3},
+                                                                 {3, 5},
+                                                                 {4, 2},
+                                                                 {5, 4},
+                                                                 {5, 5}}));
+}
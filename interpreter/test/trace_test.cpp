@@ -0,0 +1,93 @@
+#include "monkey/env.h"
+#include "monkey/eval.h"
+#include "monkey/lexer.h"
+#include "monkey/parser.h"
+#include "monkey/trace.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace monkey; // NOLINT(google-build-using-namespace) - for cleaner test code
+
+namespace {
+
+std::vector<std::string> trace(const std::string &input) {
+    auto parser = Parser(Lexer(input));
+    auto program = parser.parseProgram();
+    auto env = makeEnvironment();
+    Tracer tracer;
+    eval(*program, env, tracer);
+
+    std::vector<std::string> lines;
+    for (const auto &event : tracer.events()) {
+        lines.push_back(toString(event));
+    }
+    return lines;
+}
+
+} // namespace
+
+TEST(TraceTest, CallsAndReturns) {
+    auto lines = trace("let add = fn(a, b) { a + b }; add(1, add(2, 3));");
+    std::vector<std::string> expected = {
+        "stmt let add = fn(a, b) { (a + b) };",
+        "stmt add(1, add(2, 3))",
+        "call add(2, 3)",
+        "  stmt (a + b)",
+        "return add => 5",
+        "call add(1, 5)",
+        "  stmt (a + b)",
+        "return add => 6",
+    };
+    EXPECT_EQ(lines, expected);
+}
+
+TEST(TraceTest, ErrorsAreReportedOnce) {
+    auto lines = trace("let f = fn(x) { x + true }; f(1);");
+    std::vector<std::string> expected = {
+        "stmt let f = fn(x) { (x + true) };",
+        "stmt f(1)",
+        "call f(1)",
+        "  stmt (x + true)",
+        "  error type mismatch: x + true",
+        "return f => ERROR: type mismatch: x + true",
+    };
+    EXPECT_EQ(lines, expected);
+}
+
+TEST(TraceTest, TracingDoesNotChangeResults) {
+    std::string input =
+        "let fib = fn(n) { if (n < 2) { return n; } fib(n - 1) + fib(n - 2) }; fib(10);";
+    auto parser = Parser(Lexer(input));
+    auto program = parser.parseProgram();
+
+    Tracer tracer;
+    auto traced = eval(*program, makeEnvironment(), tracer);
+    auto plain = eval(*program, makeEnvironment());
+    ASSERT_TRUE(std::holds_alternative<int64_t>(traced));
+    EXPECT_EQ(std::get<int64_t>(traced), std::get<int64_t>(plain));
+    EXPECT_FALSE(tracer.events().empty());
+}
+
+TEST(TraceTest, LongDetailsAreCutShort) {
+    std::string elements = "0";
+    for (int i = 1; i < 1000; ++i) {
+        elements += ", " + std::to_string(i);
+    }
+    auto lines = trace("let id = fn(a) { a }; id([" + elements + "]);");
+    ASSERT_EQ(lines.size(), 5);
+    auto limit = std::string_view("call ").size() + Tracer::DETAIL_LIMIT;
+    EXPECT_EQ(lines[2],
+              "call id([" + elements.substr(0, Tracer::DETAIL_LIMIT - 4) + "...");
+    EXPECT_EQ(lines[2].size(), limit + 3);
+    EXPECT_TRUE(lines[1].ends_with("...")) << lines[1];
+
+    lines = trace(std::string(1000, 'x') + ";");
+    ASSERT_EQ(lines.size(), 2);
+    EXPECT_TRUE(lines[1].starts_with("error identifier not found: xxx")) << lines[1];
+    EXPECT_EQ(lines[1].size(),
+              std::string_view("error ").size() + Tracer::DETAIL_LIMIT + 3);
+}
\ No newline at end of file
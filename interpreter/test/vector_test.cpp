@@ -0,0 +1,157 @@
+#include "monkey/int_vector.h"
+#include "monkey/memory.h"
+#include "monkey/object.h"
+#include "monkey/vector.h"
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+using namespace monkey; // NOLINT(google-build-using-namespace) - for cleaner test code
+
+namespace {
+
+// Sizes around the points where the tail fills up and the trie grows a level.
+constexpr auto SIZES = {0UL,    1UL,    31UL,   32UL,   33UL,
+                        64UL,   1024UL, 1056UL, 1057UL, 33000UL};
+
+std::vector<size_t> elements(const PersistentVector<size_t> &vector) {
+    std::vector<size_t> result;
+    vector.forEachChunk([&result](std::span<const size_t> chunk) {
+        result.insert(result.end(), chunk.begin(), chunk.end());
+    });
+    return result;
+}
+
+std::vector<size_t> iota(size_t first, size_t last) {
+    std::vector<size_t> result;
+    for (auto i = first; i < last; ++i) {
+        result.push_back(i);
+    }
+    return result;
+}
+
+} // namespace
+
+TEST(PersistentVectorTest, PushAndIndex) {
+    PersistentVector<size_t> vector;
+    for (size_t i = 0; i < 33000; ++i) {
+        vector = vector.push(i);
+        ASSERT_EQ(vector.size(), i + 1);
+        ASSERT_EQ(vector[i], i);
+    }
+    for (size_t i = 0; i < vector.size(); ++i) {
+        ASSERT_EQ(vector[i], i) << i;
+    }
+    EXPECT_EQ(elements(vector), iota(0, 33000));
+}
+
+TEST(PersistentVectorTest, FromMatchesPush) {
+    for (auto size : SIZES) {
+        auto built = PersistentVector<size_t>::from(iota(0, size));
+        EXPECT_EQ(built.size(), size);
+        EXPECT_EQ(elements(built), iota(0, size)) << size;
+        // Pushing continues where from() left off.
+        EXPECT_EQ(elements(built.push(size)), iota(0, size + 1)) << size;
+    }
+}
+
+TEST(PersistentVectorTest, OlderVersionsAreUnchanged) {
+    std::vector<PersistentVector<size_t>> versions(1);
+    for (size_t i = 0; i < 1100; ++i) {
+        versions.push_back(versions.back().push(i));
+    }
+    // Branch off an old version; the versions it came from do not see the new element.
+    auto branched = versions[40].push(1000000);
+    EXPECT_EQ(branched[40], 1000000);
+    for (size_t size = 0; size < versions.size(); ++size) {
+        ASSERT_EQ(elements(versions[size]), iota(0, size)) << size;
+    }
+}
+
+TEST(PersistentVectorTest, RestDropsTheFirstElement) {
+    for (auto size : SIZES) {
+        auto vector = PersistentVector<size_t>::from(iota(0, size));
+        for (size_t dropped = 0; dropped < std::min<size_t>(size, 70); ++dropped) {
+            ASSERT_EQ(vector.size(), size - dropped);
+            ASSERT_EQ(vector[0], dropped);
+            vector = vector.rest();
+        }
+        if (size <= 70) {
+            EXPECT_TRUE(vector.empty());
+        } else {
+            EXPECT_EQ(elements(vector), iota(70, size));
+        }
+        EXPECT_EQ(elements(vector.push(size)).back(), size);
+    }
+}
+
+TEST(PersistentVectorTest, PushSharesStructure) {
+    MemoryAccount account;
+    const MemoryScope scope(account);
+    auto vector = PersistentVector<size_t>::from(iota(0, 100000));
+    auto before = account.live();
+    auto pushed = vector.push(1);
+    // A new tail leaf and at most one branch per level, not a copy of the elements.
+    EXPECT_LT(account.live() - before, 4096);
+    EXPECT_EQ(pushed.size(), 100001);
+}
+
+TEST(PersistentVectorTest, DeeplyNestedArraysFreeWithoutRecursion) {
+    MemoryAccount account;
+    const MemoryScope scope(account);
+    {
+        Object nested = Array::from({Object{int64_t{1}}, Object{true}});
+        for (int i = 0; i < 100000; ++i) {
+            nested = Array::from({nested, Object{true}});
+        }
+        // Dropping the last reference in the middle of the chain frees everything below.
+        Object middle = std::get<Array>(nested);
+        for (int i = 0; i < 50000; ++i) {
+            middle = std::get<Array>(middle)[0];
+        }
+        nested = int64_t{0};
+    }
+    EXPECT_EQ(account.live(), 0);
+}
+
+TEST(IntVectorTest, PushAppendsInPlaceOnTheLatestVersion) {
+    MemoryAccount account;
+    const MemoryScope scope(account);
+    IntVector vector;
+    for (int64_t i = 0; i < 1000; ++i) {
+        vector = vector.push(i);
+    }
+    // Doubling from 8 elements: the buffers hold 1024 once the last one is allocated.
+    EXPECT_LT(account.live(), 1024 * sizeof(int64_t) + 1024);
+    ASSERT_EQ(vector.size(), 1000);
+    for (size_t i = 0; i < vector.size(); ++i) {
+        ASSERT_EQ(vector[i], static_cast<int64_t>(i));
+    }
+}
+
+TEST(IntVectorTest, PushOntoOlderVersionsCopies) {
+    auto base = IntVector::from(std::vector<int64_t>{1, 2, 3}).push(4);
+    auto first = base.push(5);
+    auto second = base.push(6);
+    EXPECT_EQ(base.size(), 4);
+    EXPECT_EQ(first[4], 5);
+    EXPECT_EQ(second[4], 6);
+    // Neither push may write over the other's element.
+    EXPECT_NE(first.values().data(), second.values().data());
+    EXPECT_EQ(first.values().data(), base.values().data());
+}
+
+TEST(IntVectorTest, RestSharesTheBuffer) {
+    auto vector = IntVector::from(std::vector<int64_t>{1, 2, 3});
+    auto rest = vector.rest();
+    ASSERT_EQ(rest.size(), 2);
+    EXPECT_EQ(rest[0], 2);
+    EXPECT_EQ(rest.values().data(), vector.values().data() + 1);
+    EXPECT_TRUE(rest.rest().rest().empty());
+    EXPECT_EQ(rest.push(4)[2], 4);
+    EXPECT_EQ(vector[2], 3);
+}
\ No newline at end of file